@@ -66,7 +66,8 @@ dofile( "util/glslc.lua" )
 
 -- Projects
 
-project "Engine"
+-- Everything but the entry points, shared by the interactive engine and the regression runner
+project "EngineLib"
 	local sources = { 
 		"src/**.cpp",
 		"src/**.hpp",
@@ -75,21 +76,43 @@ project "Engine"
 		"third_party/imgui/*.h"
 	}
 
-	kind "ConsoleApp"
+	kind "StaticLib"
 	location "Engine"
 
 	files( sources )
+	removefiles { "src/main.cpp", "src/RegressionMain.cpp" }
 
 	dependson "Engine-shaders"
+	dependson "x-glm"
 
+project "Engine"
+	kind "ConsoleApp"
+	location "Engine"
+
+	files "src/main.cpp"
+
+	links "EngineLib"
+	links "x-volk"
+	links "x-stb"
+	links "x-glfw"
+	links "x-vma"
+	links "x-cgltf"
+	links "x-imgui"
+
+-- Headless image and performance regression run, see RegressionSuite.hpp
+project "Regression"
+	kind "ConsoleApp"
+	location "Engine"
+
+	files "src/RegressionMain.cpp"
+
+	links "EngineLib"
 	links "x-volk"
 	links "x-stb"
 	links "x-glfw"
 	links "x-vma"
 	links "x-cgltf"
 	links "x-imgui"
-	
-	dependson "x-glm"
 
 project "Engine-shaders"
 	local shaders = { 
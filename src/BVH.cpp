@@ -0,0 +1,323 @@
+#include "BVH.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace
+{
+	constexpr uint32_t BIN_COUNT = 16;
+	constexpr uint32_t MAX_LEAF_SIZE = 4;
+	constexpr uint32_t TRAVERSAL_STACK_SIZE = 64;
+
+	// Traversal holds at most one pending sibling per level plus the two children just pushed, so a tree of this
+	// depth never needs more than TRAVERSAL_STACK_SIZE entries. Deeper nodes stay leaves with more triangles
+	constexpr uint32_t MAX_DEPTH = TRAVERSAL_STACK_SIZE - 1;
+
+	struct AABB
+	{
+		glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+		glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+		void Grow(const glm::vec3& p) { min = glm::min(min, p); max = glm::max(max, p); }
+		void Grow(const AABB& b) { min = glm::min(min, b.min); max = glm::max(max, b.max); }
+
+		float Area() const
+		{
+			glm::vec3 e = max - min;
+			return e.x < 0.0f ? 0.0f : e.x * e.y + e.y * e.z + e.z * e.x;
+		}
+	};
+
+	// Slab test, returns the entry distance or FLT_MAX on a miss
+	float IntersectAABB(const glm::vec3& origin, const glm::vec3& rcpDir, float tMin, float tMax, const glm::vec3& bmin, const glm::vec3& bmax)
+	{
+		glm::vec3 t0 = (bmin - origin) * rcpDir;
+		glm::vec3 t1 = (bmax - origin) * rcpDir;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+
+		float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, tMin));
+		float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+
+		return entry <= exit ? entry : std::numeric_limits<float>::max();
+	}
+
+	// Moller-Trumbore
+	bool IntersectTriangle(const vk::BVHRay& ray, const vk::BVHTriangle& tri, float tMax, float& t, float& u, float& v)
+	{
+		const glm::vec3 e1 = tri.v1 - tri.v0;
+		const glm::vec3 e2 = tri.v2 - tri.v0;
+		const glm::vec3 p = glm::cross(ray.direction, e2);
+		const float det = glm::dot(e1, p);
+
+		if (std::abs(det) < 1e-12f)
+			return false;
+
+		const float rcpDet = 1.0f / det;
+		const glm::vec3 s = ray.origin - tri.v0;
+		u = glm::dot(s, p) * rcpDet;
+		if (u < 0.0f || u > 1.0f)
+			return false;
+
+		const glm::vec3 q = glm::cross(s, e1);
+		v = glm::dot(ray.direction, q) * rcpDet;
+		if (v < 0.0f || u + v > 1.0f)
+			return false;
+
+		t = glm::dot(e2, q) * rcpDet;
+		return t > ray.tMin && t < tMax;
+	}
+}
+
+void vk::BVH::Build(std::vector<BVHTriangle> triangles)
+{
+	m_triangles = std::move(triangles);
+	m_nodes.clear();
+
+	if (m_triangles.empty())
+		return;
+
+	std::vector<glm::vec3> centroids(m_triangles.size());
+	for (size_t i = 0; i < m_triangles.size(); i++)
+		centroids[i] = (m_triangles[i].v0 + m_triangles[i].v1 + m_triangles[i].v2) * (1.0f / 3.0f);
+
+	m_nodes.reserve(m_triangles.size() * 2);
+	m_nodes.push_back({});
+	m_nodes[0].leftOrFirst = 0;
+	m_nodes[0].count = static_cast<uint32_t>(m_triangles.size());
+
+	UpdateBounds(0);
+	Subdivide(0, 0, centroids);
+}
+
+void vk::BVH::UpdateBounds(uint32_t nodeIndex)
+{
+	Node& node = m_nodes[nodeIndex];
+	AABB bounds;
+	for (uint32_t i = 0; i < node.count; i++)
+	{
+		const BVHTriangle& tri = m_triangles[node.leftOrFirst + i];
+		bounds.Grow(tri.v0);
+		bounds.Grow(tri.v1);
+		bounds.Grow(tri.v2);
+	}
+	node.boundsMin = bounds.min;
+	node.boundsMax = bounds.max;
+}
+
+void vk::BVH::Subdivide(uint32_t nodeIndex, uint32_t depth, std::vector<glm::vec3>& centroids)
+{
+	const uint32_t first = m_nodes[nodeIndex].leftOrFirst;
+	const uint32_t count = m_nodes[nodeIndex].count;
+
+	if (count <= MAX_LEAF_SIZE || depth >= MAX_DEPTH)
+		return;
+
+	AABB centroidBounds;
+	for (uint32_t i = 0; i < count; i++)
+		centroidBounds.Grow(centroids[first + i]);
+
+	// Binned SAH over all three axes
+	float bestCost = std::numeric_limits<float>::max();
+	int bestAxis = -1;
+	uint32_t bestSplit = 0;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+		if (extent <= 0.0f)
+			continue;
+
+		AABB binBounds[BIN_COUNT];
+		uint32_t binCount[BIN_COUNT] = {};
+		const float scale = BIN_COUNT / extent;
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint32_t bin = std::min(BIN_COUNT - 1, static_cast<uint32_t>((centroids[first + i][axis] - centroidBounds.min[axis]) * scale));
+			const BVHTriangle& tri = m_triangles[first + i];
+			binBounds[bin].Grow(tri.v0);
+			binBounds[bin].Grow(tri.v1);
+			binBounds[bin].Grow(tri.v2);
+			binCount[bin]++;
+		}
+
+		float leftArea[BIN_COUNT - 1], rightArea[BIN_COUNT - 1];
+		uint32_t leftCount[BIN_COUNT - 1], rightCount[BIN_COUNT - 1];
+		AABB leftBox, rightBox;
+		uint32_t leftSum = 0, rightSum = 0;
+
+		for (uint32_t i = 0; i < BIN_COUNT - 1; i++)
+		{
+			leftSum += binCount[i];
+			leftCount[i] = leftSum;
+			leftBox.Grow(binBounds[i]);
+			leftArea[i] = leftBox.Area();
+
+			rightSum += binCount[BIN_COUNT - 1 - i];
+			rightCount[BIN_COUNT - 2 - i] = rightSum;
+			rightBox.Grow(binBounds[BIN_COUNT - 1 - i]);
+			rightArea[BIN_COUNT - 2 - i] = rightBox.Area();
+		}
+
+		for (uint32_t i = 0; i < BIN_COUNT - 1; i++)
+		{
+			float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+			if (leftCount[i] > 0 && rightCount[i] > 0 && cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i;
+			}
+		}
+	}
+
+	// Stop if no split is cheaper than intersecting every triangle in this node
+	AABB nodeBounds{ m_nodes[nodeIndex].boundsMin, m_nodes[nodeIndex].boundsMax };
+	if (bestAxis < 0 || bestCost >= count * nodeBounds.Area())
+		return;
+
+	// Partition triangles (and their centroids) around the split plane
+	const float scale = BIN_COUNT / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]);
+	uint32_t i = first;
+	uint32_t j = first + count - 1;
+	while (i <= j)
+	{
+		uint32_t bin = std::min(BIN_COUNT - 1, static_cast<uint32_t>((centroids[i][bestAxis] - centroidBounds.min[bestAxis]) * scale));
+		if (bin <= bestSplit)
+		{
+			i++;
+		}
+		else
+		{
+			std::swap(m_triangles[i], m_triangles[j]);
+			std::swap(centroids[i], centroids[j]);
+			if (j == 0)
+				break;
+			j--;
+		}
+	}
+
+	const uint32_t leftCount = i - first;
+	if (leftCount == 0 || leftCount == count)
+		return;
+
+	const uint32_t leftIndex = static_cast<uint32_t>(m_nodes.size());
+	m_nodes.push_back({});
+	m_nodes.push_back({});
+
+	m_nodes[leftIndex].leftOrFirst = first;
+	m_nodes[leftIndex].count = leftCount;
+	m_nodes[leftIndex + 1].leftOrFirst = i;
+	m_nodes[leftIndex + 1].count = count - leftCount;
+
+	m_nodes[nodeIndex].leftOrFirst = leftIndex;
+	m_nodes[nodeIndex].count = 0;
+
+	UpdateBounds(leftIndex);
+	UpdateBounds(leftIndex + 1);
+	Subdivide(leftIndex, depth + 1, centroids);
+	Subdivide(leftIndex + 1, depth + 1, centroids);
+}
+
+vk::BVHHit vk::BVH::Intersect(const BVHRay& ray, const std::function<bool(const BVHHit&)>& anyHitFilter) const
+{
+	BVHHit closest;
+	closest.t = ray.tMax;
+
+	if (m_nodes.empty())
+		return BVHHit{};
+
+	const glm::vec3 rcpDir = 1.0f / ray.direction;
+
+	uint32_t stack[TRAVERSAL_STACK_SIZE];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node& node = m_nodes[stack[--stackSize]];
+
+		if (IntersectAABB(ray.origin, rcpDir, ray.tMin, closest.t, node.boundsMin, node.boundsMax) == std::numeric_limits<float>::max())
+			continue;
+
+		if (node.count > 0)
+		{
+			for (uint32_t i = 0; i < node.count; i++)
+			{
+				BVHHit candidate;
+				if (IntersectTriangle(ray, m_triangles[node.leftOrFirst + i], closest.t, candidate.t, candidate.u, candidate.v))
+				{
+					candidate.triangleIndex = node.leftOrFirst + i;
+					if (!anyHitFilter || anyHitFilter(candidate))
+						closest = candidate;
+				}
+			}
+			continue;
+		}
+
+		// Visit the nearer child first
+		const Node& left = m_nodes[node.leftOrFirst];
+		const Node& right = m_nodes[node.leftOrFirst + 1];
+		float tLeft = IntersectAABB(ray.origin, rcpDir, ray.tMin, closest.t, left.boundsMin, left.boundsMax);
+		float tRight = IntersectAABB(ray.origin, rcpDir, ray.tMin, closest.t, right.boundsMin, right.boundsMax);
+
+		uint32_t nearIndex = node.leftOrFirst;
+		uint32_t farIndex = node.leftOrFirst + 1;
+		if (tRight < tLeft)
+		{
+			std::swap(tLeft, tRight);
+			std::swap(nearIndex, farIndex);
+		}
+
+		// MAX_DEPTH bounds the stack, see Subdivide
+		assert(stackSize + 2 <= TRAVERSAL_STACK_SIZE);
+		if (tRight != std::numeric_limits<float>::max())
+			stack[stackSize++] = farIndex;
+		if (tLeft != std::numeric_limits<float>::max())
+			stack[stackSize++] = nearIndex;
+	}
+
+	if (!closest.IsValid())
+		return BVHHit{};
+
+	return closest;
+}
+
+bool vk::BVH::Occluded(const BVHRay& ray) const
+{
+	if (m_nodes.empty())
+		return false;
+
+	const glm::vec3 rcpDir = 1.0f / ray.direction;
+
+	uint32_t stack[TRAVERSAL_STACK_SIZE];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node& node = m_nodes[stack[--stackSize]];
+
+		if (IntersectAABB(ray.origin, rcpDir, ray.tMin, ray.tMax, node.boundsMin, node.boundsMax) == std::numeric_limits<float>::max())
+			continue;
+
+		if (node.count > 0)
+		{
+			float t, u, v;
+			for (uint32_t i = 0; i < node.count; i++)
+			{
+				if (IntersectTriangle(ray, m_triangles[node.leftOrFirst + i], ray.tMax, t, u, v))
+					return true;
+			}
+			continue;
+		}
+
+		assert(stackSize + 2 <= TRAVERSAL_STACK_SIZE);
+		stack[stackSize++] = node.leftOrFirst + 1;
+		stack[stackSize++] = node.leftOrFirst;
+	}
+
+	return false;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <functional>
+#include <glm/glm.hpp>
+
+namespace vk
+{
+	struct BVHTriangle
+	{
+		glm::vec3 v0;
+		glm::vec3 v1;
+		glm::vec3 v2;
+		uint32_t meshIndex;
+		uint32_t primitiveIndex; // triangle index within the mesh
+	};
+
+	struct BVHRay
+	{
+		glm::vec3 origin;
+		glm::vec3 direction;
+		float tMin;
+		float tMax;
+	};
+
+	struct BVHHit
+	{
+		float t = 0.0f;
+		float u = 0.0f; // barycentrics of v1 and v2
+		float v = 0.0f;
+		uint32_t triangleIndex = UINT32_MAX;
+
+		bool IsValid() const { return triangleIndex != UINT32_MAX; }
+	};
+
+	// CPU bounding volume hierarchy over world space triangles, used by the reference renderer
+	// for primary and shadow rays. Built with binned SAH and stored as a flat array of nodes
+	class BVH
+	{
+	public:
+		BVH() = default;
+
+		void Build(std::vector<BVHTriangle> triangles);
+
+		// Closest hit. anyHitFilter is called for every candidate hit and can reject it (e.g. alpha testing)
+		BVHHit Intersect(const BVHRay& ray, const std::function<bool(const BVHHit&)>& anyHitFilter = nullptr) const;
+
+		// Returns on the first hit, equivalent to gl_RayFlagsTerminateOnFirstHitEXT with opaque geometry
+		bool Occluded(const BVHRay& ray) const;
+
+		const std::vector<BVHTriangle>& GetTriangles() const { return m_triangles; }
+
+	private:
+		struct Node
+		{
+			glm::vec3 boundsMin;
+			uint32_t leftOrFirst; // left child index for inner nodes, first triangle for leaves
+			glm::vec3 boundsMax;
+			uint32_t count;       // 0 for inner nodes
+		};
+
+		void Subdivide(uint32_t nodeIndex, uint32_t depth, std::vector<glm::vec3>& centroids);
+		void UpdateBounds(uint32_t nodeIndex);
+
+		std::vector<Node> m_nodes;
+		std::vector<BVHTriangle> m_triangles;
+	};
+}
@@ -0,0 +1,261 @@
+#include "BindlessHeap.hpp"
+#include "Context.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+
+namespace
+{
+	constexpr uint32_t initialTextureCapacity = 256;
+	constexpr uint32_t maxTextures = 1u << 16;
+	constexpr uint32_t maxStorageBuffers = 4096;
+	constexpr uint32_t maxStorageImages = 1024;
+
+	constexpr VkDescriptorType descriptorTypes[3] = {
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+	};
+}
+
+vk::BindlessHeap::BindlessHeap(Context& context) :
+	context{ context },
+	m_layout{ VK_NULL_HANDLE },
+	m_pool{ VK_NULL_HANDLE },
+	m_set{ VK_NULL_HANDLE },
+	m_capacity{ 0, 0, 0 },
+	m_textureCapacity{ 0 },
+	m_next{ 0, 0, 0 }
+{
+	VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES };
+	VkPhysicalDeviceProperties2 properties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+	properties.pNext = &indexingProperties;
+	vkGetPhysicalDeviceProperties2(context.pDevice, &properties);
+
+	// The per stage limits are the tighter ones, every binding is visible to all stages
+	m_capacity[0] = std::min({ maxStorageBuffers, indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers, indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers });
+	m_capacity[1] = std::min({ maxStorageImages, indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageImages, indexingProperties.maxDescriptorSetUpdateAfterBindStorageImages });
+	m_capacity[2] = std::min({ maxTextures, indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages, indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages });
+
+	std::vector<VkDescriptorSetLayoutBinding> bindings;
+	for (uint32_t binding = 0; binding < 3; binding++)
+		bindings.push_back(CreateDescriptorBinding(binding, m_capacity[binding], descriptorTypes[binding], VK_SHADER_STAGE_ALL));
+
+	// Slots that no draw or dispatch reads may be written while the set is bound or in flight
+	constexpr VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+	const VkDescriptorBindingFlags flags[3] = { bindingFlags, bindingFlags, bindingFlags | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT };
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO };
+	flagsInfo.bindingCount = 3;
+	flagsInfo.pBindingFlags = flags;
+
+	VkDescriptorSetLayoutCreateInfo info{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+	info.pNext = &flagsInfo;
+	info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	info.bindingCount = static_cast<uint32_t>(bindings.size());
+	info.pBindings = bindings.data();
+
+	VK_CHECK(vkCreateDescriptorSetLayout(context.device, &info, nullptr, &m_layout), "Failed to create bindless descriptor set layout");
+
+	for (uint32_t type = 0; type < 3; type++)
+	{
+		m_descriptors[type].resize(type == 2 ? std::min(initialTextureCapacity, m_capacity[2]) : m_capacity[type]);
+		m_live[type].resize(m_descriptors[type].size(), false);
+	}
+
+	AllocateSet(std::min(initialTextureCapacity, m_capacity[2]));
+}
+
+vk::BindlessHeap::~BindlessHeap()
+{
+	for (const auto& retired : m_retired)
+		vkDestroyDescriptorPool(context.device, retired.pool, nullptr);
+
+	vkDestroyDescriptorPool(context.device, m_pool, nullptr);
+	vkDestroyDescriptorSetLayout(context.device, m_layout, nullptr);
+}
+
+void vk::BindlessHeap::AllocateSet(uint32_t textureCapacity)
+{
+	const VkDescriptorPoolSize poolSizes[3] = {
+		{ descriptorTypes[0], m_capacity[0] },
+		{ descriptorTypes[1], m_capacity[1] },
+		{ descriptorTypes[2], textureCapacity }
+	};
+
+	VkDescriptorPoolCreateInfo poolInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 3;
+	poolInfo.pPoolSizes = poolSizes;
+
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	VK_CHECK(vkCreateDescriptorPool(context.device, &poolInfo, nullptr, &pool), "Failed to create bindless descriptor pool");
+
+	VkDescriptorSetVariableDescriptorCountAllocateInfo countInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO };
+	countInfo.descriptorSetCount = 1;
+	countInfo.pDescriptorCounts = &textureCapacity;
+
+	VkDescriptorSetAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+	allocInfo.pNext = &countInfo;
+	allocInfo.descriptorPool = pool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &m_layout;
+
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	VK_CHECK(vkAllocateDescriptorSets(context.device, &allocInfo, &set), "Failed to allocate bindless descriptor set");
+
+	// Frames recorded before this may still be using the old set
+	if (m_pool != VK_NULL_HANDLE)
+		m_retired.push_back({ m_pool, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) });
+
+	m_pool = pool;
+	m_set = set;
+	m_textureCapacity = textureCapacity;
+
+	// Everything live in the old set, in one call
+	std::vector<VkWriteDescriptorSet> writes;
+	for (uint32_t type = 0; type < 3; type++)
+	{
+		for (uint32_t slot = 0; slot < m_next[type]; slot++)
+		{
+			if (!m_live[type][slot])
+				continue;
+
+			VkWriteDescriptorSet write{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+			write.dstSet = m_set;
+			write.dstBinding = type;
+			write.dstArrayElement = slot;
+			write.descriptorCount = 1;
+			write.descriptorType = descriptorTypes[type];
+			if (type == 0)
+				write.pBufferInfo = &m_descriptors[type][slot].buffer;
+			else
+				write.pImageInfo = &m_descriptors[type][slot].image;
+
+			writes.push_back(write);
+		}
+	}
+
+	if (!writes.empty())
+		vkUpdateDescriptorSets(context.device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+vk::BindlessHandle vk::BindlessHeap::Allocate(Type type)
+{
+	const uint32_t index = static_cast<uint32_t>(type);
+
+	if (!m_free[index].empty())
+	{
+		const BindlessHandle handle = m_free[index].back();
+		m_free[index].pop_back();
+		return handle;
+	}
+
+	if (m_next[index] == m_capacity[index])
+		throw std::runtime_error("Bindless heap is out of slots");
+
+	if (type == Type::TEXTURE && m_next[index] == m_textureCapacity)
+	{
+		const uint32_t capacity = std::min(m_textureCapacity * 2, m_capacity[index]);
+		m_descriptors[index].resize(capacity);
+		m_live[index].resize(capacity, false);
+		AllocateSet(capacity);
+	}
+
+	return m_next[index]++;
+}
+
+void vk::BindlessHeap::Write(Type type, BindlessHandle handle, const Descriptor& descriptor)
+{
+	const uint32_t index = static_cast<uint32_t>(type);
+	m_descriptors[index][handle] = descriptor;
+	m_live[index][handle] = true;
+
+	VkWriteDescriptorSet write{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+	write.dstSet = m_set;
+	write.dstBinding = index;
+	write.dstArrayElement = handle;
+	write.descriptorCount = 1;
+	write.descriptorType = descriptorTypes[index];
+	if (type == Type::STORAGE_BUFFER)
+		write.pBufferInfo = &m_descriptors[index][handle].buffer;
+	else
+		write.pImageInfo = &m_descriptors[index][handle].image;
+
+	vkUpdateDescriptorSets(context.device, 1, &write, 0, nullptr);
+}
+
+vk::BindlessHandle vk::BindlessHeap::AddStorageBuffer(VkBuffer buffer, VkDeviceSize range)
+{
+	const BindlessHandle handle = Allocate(Type::STORAGE_BUFFER);
+	UpdateStorageBuffer(handle, buffer, range);
+	return handle;
+}
+
+vk::BindlessHandle vk::BindlessHeap::AddStorageImage(VkImageView imageView)
+{
+	const BindlessHandle handle = Allocate(Type::STORAGE_IMAGE);
+	UpdateStorageImage(handle, imageView);
+	return handle;
+}
+
+vk::BindlessHandle vk::BindlessHeap::AddTexture(VkImageView imageView, VkSampler sampler)
+{
+	const BindlessHandle handle = Allocate(Type::TEXTURE);
+	UpdateTexture(handle, imageView, sampler);
+	return handle;
+}
+
+void vk::BindlessHeap::UpdateStorageBuffer(BindlessHandle handle, VkBuffer buffer, VkDeviceSize range)
+{
+	Descriptor descriptor = {};
+	descriptor.buffer = { .buffer = buffer, .offset = 0, .range = range };
+	Write(Type::STORAGE_BUFFER, handle, descriptor);
+}
+
+void vk::BindlessHeap::UpdateStorageImage(BindlessHandle handle, VkImageView imageView)
+{
+	Descriptor descriptor = {};
+	descriptor.image = { .sampler = VK_NULL_HANDLE, .imageView = imageView, .imageLayout = VK_IMAGE_LAYOUT_GENERAL };
+	Write(Type::STORAGE_IMAGE, handle, descriptor);
+}
+
+void vk::BindlessHeap::UpdateTexture(BindlessHandle handle, VkImageView imageView, VkSampler sampler)
+{
+	Descriptor descriptor = {};
+	descriptor.image = { .sampler = sampler, .imageView = imageView, .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	Write(Type::TEXTURE, handle, descriptor);
+}
+
+void vk::BindlessHeap::Release(Type type, BindlessHandle handle)
+{
+	const uint32_t index = static_cast<uint32_t>(type);
+	if (handle == InvalidBindlessHandle || !m_live[index][handle])
+		return;
+
+	// Left written, partially bound only cares about slots that are read
+	m_live[index][handle] = false;
+	m_free[index].push_back(handle);
+}
+
+void vk::BindlessHeap::Bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set) const
+{
+	vkCmdBindDescriptorSets(cmd, bindPoint, pipelineLayout, set, 1, &m_set, 0, nullptr);
+}
+
+void vk::BindlessHeap::Collect()
+{
+	for (auto it = m_retired.begin(); it != m_retired.end();)
+	{
+		if (--it->framesLeft == 0)
+		{
+			vkDestroyDescriptorPool(context.device, it->pool, nullptr);
+			it = m_retired.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
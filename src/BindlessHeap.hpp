@@ -0,0 +1,88 @@
+#pragma once
+#include <volk/volk.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace vk
+{
+	class Context;
+
+	// Index into one of the heap's arrays, what shaders address the resource with
+	using BindlessHandle = uint32_t;
+	inline constexpr BindlessHandle InvalidBindlessHandle = ~0u;
+
+	// One update-after-bind descriptor set holding every bindless resource, declared in shaders/Bindless.glsl
+	// Storage buffers live in binding 0, storage images in 1 and sampled textures in 2, each slot addressed by a
+	// 32-bit handle that stays valid until it is released. Textures are the variable count binding: once they are full
+	// the heap allocates a set twice the size from the same layout, writes every live descriptor into it and retires
+	// the old set after the frames still using it are done. The layout never changes, so pipelines stay valid
+	class BindlessHeap
+	{
+	public:
+		enum class Type : uint32_t
+		{
+			STORAGE_BUFFER = 0,
+			STORAGE_IMAGE = 1,
+			TEXTURE = 2
+		};
+
+		explicit BindlessHeap(Context& context);
+		~BindlessHeap();
+
+		BindlessHandle AddStorageBuffer(VkBuffer buffer, VkDeviceSize range = VK_WHOLE_SIZE);
+		BindlessHandle AddStorageImage(VkImageView imageView);
+		BindlessHandle AddTexture(VkImageView imageView, VkSampler sampler);
+
+		// Points an existing handle at a new resource, e.g. after a resize
+		void UpdateStorageBuffer(BindlessHandle handle, VkBuffer buffer, VkDeviceSize range = VK_WHOLE_SIZE);
+		void UpdateStorageImage(BindlessHandle handle, VkImageView imageView);
+		void UpdateTexture(BindlessHandle handle, VkImageView imageView, VkSampler sampler);
+
+		// The slot is handed out again, nothing in flight may still index it
+		void Release(Type type, BindlessHandle handle);
+
+		void Bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set) const;
+
+		// Frees sets retired by a growth once no frame in flight can use them, call after waiting on the frame fence
+		void Collect();
+
+		VkDescriptorSetLayout GetLayout() const { return m_layout; }
+		uint32_t GetTextureCapacity() const { return m_textureCapacity; }
+		uint32_t GetCount(Type type) const { return m_next[static_cast<uint32_t>(type)] - static_cast<uint32_t>(m_free[static_cast<uint32_t>(type)].size()); }
+
+	private:
+		// CPU copy of every descriptor, written again into the set a growth allocates
+		union Descriptor
+		{
+			VkDescriptorBufferInfo buffer;
+			VkDescriptorImageInfo image;
+		};
+
+		struct Retired
+		{
+			VkDescriptorPool pool;
+			uint32_t framesLeft;
+		};
+
+		BindlessHandle Allocate(Type type);
+		void Write(Type type, BindlessHandle handle, const Descriptor& descriptor);
+		void AllocateSet(uint32_t textureCapacity);
+
+		Context& context;
+
+		VkDescriptorSetLayout m_layout;
+		VkDescriptorPool m_pool;           // one per set, a growth retires it whole
+		VkDescriptorSet m_set;
+
+		std::array<uint32_t, 3> m_capacity; // layout maximum per binding, textures can only grow up to it
+		uint32_t m_textureCapacity;         // what the current set was allocated with
+
+		std::array<uint32_t, 3> m_next;     // first never used slot
+		std::array<std::vector<BindlessHandle>, 3> m_free;
+		std::array<std::vector<Descriptor>, 3> m_descriptors;
+		std::array<std::vector<bool>, 3> m_live;
+
+		std::vector<Retired> m_retired;
+	};
+}
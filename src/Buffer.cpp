@@ -12,6 +12,7 @@ vk::Buffer::Buffer(Buffer&& other) noexcept :
     buffer(std::exchange(other.buffer, VK_NULL_HANDLE)),
     allocation(std::exchange(other.allocation, VK_NULL_HANDLE)),
     allocator(std::exchange(other.allocator, VK_NULL_HANDLE)),
+    mapped(std::exchange(other.mapped, nullptr)),
     name(std::exchange(other.name, "")) {}
 
 vk::Buffer& vk::Buffer::operator=(vk::Buffer&& other) noexcept
@@ -19,6 +20,7 @@ vk::Buffer& vk::Buffer::operator=(vk::Buffer&& other) noexcept
     std::swap(buffer, other.buffer);
 	std::swap(allocation, other.allocation);
 	std::swap(allocator, other.allocator);
+	std::swap(mapped, other.mapped);
     std::swap(name, other.name);
 
 	return *this;
@@ -42,6 +44,15 @@ vk::Buffer vk::CreateBuffer(const std::string& name, Context& context, VkDeviceS
 		.usage = usage
 	};
 
+	// Readable from both queues without ownership transfers, the render graph only hands images over between them
+	const uint32_t queueFamilies[] = { context.graphicsFamilyIndex, context.computeFamilyIndex };
+	if (context.HasAsyncCompute())
+	{
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = 2;
+		bufferInfo.pQueueFamilyIndices = queueFamilies;
+	}
+
 	VmaAllocationCreateInfo allocInfo = {
 		.flags = memoryFlags,
 		.usage = memUsage
@@ -49,13 +60,18 @@ vk::Buffer vk::CreateBuffer(const std::string& name, Context& context, VkDeviceS
 
 	VkBuffer buffer = VK_NULL_HANDLE;
 	VmaAllocation allocation = VK_NULL_HANDLE;
+	VmaAllocationInfo allocationInfo = {};
 
-	VK_CHECK(vmaCreateBuffer(context.allocator, &bufferInfo, &allocInfo, &buffer, &allocation, nullptr), "Failed to create & allocate buffer");
+	VK_CHECK(vmaCreateBuffer(context.allocator, &bufferInfo, &allocInfo, &buffer, &allocation, &allocationInfo), "Failed to create & allocate buffer");
 
     vmaSetAllocationName(context.allocator, allocation, name.c_str());
     context.SetObjectName(context.device, (uint64_t)buffer, VK_OBJECT_TYPE_BUFFER, name.c_str());
 
-	return Buffer(name, context.allocator, buffer, allocation);
+	Buffer result(name, context.allocator, buffer, allocation);
+	if (memoryFlags & VMA_ALLOCATION_CREATE_MAPPED_BIT)
+		result.mapped = allocationInfo.pMappedData;
+
+	return result;
 }
 
 void vk::CreateAndUploadBuffer(vk::Context& context, const void* data, VkDeviceSize size, VkBufferUsageFlags usage, vk::Buffer& destinationBuffer)
@@ -99,3 +115,24 @@ void vk::CreateAndUploadBuffer(vk::Context& context, const void* data, VkDeviceS
 
     stagingBuffer.Destroy(context.device);
 }
+
+vk::Buffer vk::CreateReservoirBuffer(const std::string& name, vk::Context& context, uint32_t width, uint32_t height)
+{
+    const VkDeviceSize size = VkDeviceSize(width) * height * sizeof(PackedReservoir);
+
+    vk::Buffer reservoirs = vk::CreateBuffer(name, context, size,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        0, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+
+    // Zero is index 0 with W = 0 and M = 0, which contributes nothing if read before the first write (e.g. as temporal history)
+    ExecuteSingleTimeCommands(context, [&](VkCommandBuffer cmd) {
+
+        vkCmdFillBuffer(cmd, reservoirs.buffer, 0, VK_WHOLE_SIZE, 0);
+
+        BufferBarrier(cmd, reservoirs.buffer,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        });
+
+    return reservoirs;
+}
@@ -39,6 +39,18 @@ namespace vk
 				throw std::runtime_error("Attempted to write to buffer with no valid memory allocation.");
 			}
 
+			// Created with VMA_ALLOCATION_CREATE_MAPPED_BIT, written in place
+			if (mapped != nullptr)
+			{
+				if constexpr (!std::is_pointer_v<T>) {
+					std::memcpy(mapped, &data, size_in_bytes);
+				}
+				else {
+					std::memcpy(mapped, data, size_in_bytes);
+				}
+				return;
+			}
+
 			void* mappedData = nullptr;
 			if (vmaMapMemory(allocator, allocation, &mappedData) == VK_SUCCESS)
 			{
@@ -60,9 +72,13 @@ namespace vk
 		VkBuffer buffer = VK_NULL_HANDLE;
 		VmaAllocation allocation = VK_NULL_HANDLE;
 		VmaAllocator allocator = VK_NULL_HANDLE;
+		void* mapped = nullptr; // persistent mapping, only for buffers created mapped
 		std::string name = "";
 	};
 
 	Buffer CreateBuffer(const std::string& name, Context& context, VkDeviceSize bSize, VkBufferUsageFlags usage, VmaAllocationCreateFlags memoryFlags, VmaMemoryUsage = VMA_MEMORY_USAGE_AUTO);
 	void CreateAndUploadBuffer(Context& context, const void* data, VkDeviceSize size, VkBufferUsageFlags usage, vk::Buffer& destinationBuffer);
+
+	// Device local storage buffer holding one PackedReservoir per pixel, cleared to empty reservoirs
+	Buffer CreateReservoirBuffer(const std::string& name, Context& context, uint32_t width, uint32_t height);
 }
\ No newline at end of file
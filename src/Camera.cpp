@@ -19,10 +19,11 @@ vk::Camera::Camera(Context& context, const glm::vec3 position, glm::vec3 directi
 	m_transform.fov = 45.0f;
 	m_cameraSpeed = defaultSpeed;
 
+	// Bound by most passes' sets, so it keeps its own buffers rather than an arena offset, mapped once
 	m_cameraUBO.resize(MAX_FRAMES_IN_FLIGHT);
 	for (auto& buffer : m_cameraUBO)
 	{
-		buffer = CreateBuffer("cameraUBO", context, sizeof(CameraTransform), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+		buffer = CreateBuffer("cameraUBO", context, sizeof(CameraTransform), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
 	}
 }
 
@@ -50,13 +51,15 @@ void vk::Camera::UpdateTransforms(uint32_t width, uint32_t height)
 {
 	m_transform.model = glm::mat4(1.0f);
 	m_transform.view = glm::lookAt(m_position, m_position + m_direction, m_up);
-	m_transform.projection = glm::perspective(m_transform.fov, width / (float)height, m_transform.nearPlane, m_transform.farPlane);
+	// Aspect of the swapchain rather than of the render extent, the rounded render extent is stretched back over it
+	m_transform.projection = glm::perspective(m_transform.fov, context.extent.width / (float)context.extent.height, m_transform.nearPlane, m_transform.farPlane);
 	m_transform.projection[1][1] *= -1;
 	m_transform.cameraPosition = glm::vec4(m_position.x, m_position.y, m_position.z, 1.0);
 	m_transform.viewportSize = glm::vec2(width, height);
 	m_transform.nearPlane = m_transform.nearPlane;
 	m_transform.farPlane = m_transform.farPlane;
 	m_transform.fov = m_transform.fov;
+	m_transform.inverseViewProjection = glm::inverse(m_transform.projection * m_transform.view);
 }
 
 void vk::Camera::UpdateCameraMovement()
@@ -28,6 +28,7 @@ namespace vk
 		alignas(4) float fov;
 		alignas(4) float nearPlane;
 		alignas(4) float farPlane;
+		alignas(16) glm::mat4 inverseViewProjection; // position reconstruction from the packed G-buffer surface
 	};
 
 
@@ -1,4 +1,4 @@
-// Image& initial_candidates, Image& hit_world_positions, Image& hit_normals, Image& motion_vectors
+// Image& initial_candidates, Image& hit_world_positions, Image& hit_normals, const std::vector<Image>& motion_vectors
 
 #include "Context.hpp"
 #include "Camera.hpp"
@@ -7,196 +7,61 @@
 #include "Pipeline.hpp"
 #include "Utils.hpp"
 #include "Buffer.hpp"
+#include "UniformArena.hpp"
 
-vk::Candidates::Candidates(Context& context, std::shared_ptr<Scene>& scene, std::shared_ptr<Camera>& camera, const GBuffer::GBufferMRT& gbufferMRT) :
+vk::Candidates::Candidates(Context& context, std::shared_ptr<Scene>& scene, std::shared_ptr<Camera>& camera, const std::vector<GBuffer::GBufferMRT>& gbufferMRT, const std::vector<Buffer>& lightTiles, const std::vector<Buffer>& gpuStats, const Buffer& sampling) :
 	context{ context },
 	scene{ scene },
 	camera{ camera },
 	gbufferMRT{ gbufferMRT },
+	lightTiles{ lightTiles },
+	gpuStats{ gpuStats },
+	sampling{ sampling },
 	m_Pipeline{ VK_NULL_HANDLE },
 	m_PipelineLayout{ VK_NULL_HANDLE },
+	m_Permutations{ context },
 	m_descriptorSetLayout{ VK_NULL_HANDLE },
+	m_descriptorTemplate{ VK_NULL_HANDLE },
 	m_width{ 0 },
-	m_height{ 0 }
+	m_height{ 0 },
+	m_reservoirExtent{ 0, 0 }
 {
 
 	m_width = context.extent.width;
 	m_height = context.extent.height;
+	m_reservoirExtent = GetReservoirExtent(context.extent, restirResolution);
 
-	m_uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-	for (auto& buffer : m_uniformBuffers)
-		buffer = CreateBuffer("CandidatesUBO", context, sizeof(uCandidatesPass), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+	m_Reservoirs = CreateReservoirBuffer("CandidatesReservoirs", context, m_reservoirExtent.width, m_reservoirExtent.height);
 
-	m_RenderTarget = CreateImageTexture2D(
-		"CandidatesRT",
-		context,
-		m_width,
-		m_height,
-		VK_FORMAT_R16G16B16A16_SFLOAT,
-		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-	m_ShadingResult = CreateImageTexture2D(
-		"CandidatesPassShadingRT",
-		context,
-		m_width,
-		m_height,
-		VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-	ExecuteSingleTimeCommands(context, [&](VkCommandBuffer cmd) {
-
-		ImageTransition(
-			cmd,
-			m_RenderTarget.image,
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0,
-			VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-		);
-
-		ImageTransition(
-			cmd,
-			m_ShadingResult.image,
-			VK_FORMAT_R32G32B32A32_SFLOAT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0,
-			VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-		);
-	});
+	CreateAdaptiveHistory();
 
 	BuildDescriptors();
-	CreatePipeline();
+	SelectPipeline(false);
 }
 
 
 vk::Candidates::~Candidates()
 {
-	for (auto& buffer : m_uniformBuffers)
-	{
-		buffer.Destroy(context.device);
-	}
-	m_RenderTarget.Destroy(context.device);
-	m_ShadingResult.Destroy(context.device);
-	vkDestroyPipeline(context.device, m_Pipeline, nullptr);
-	vkDestroyPipelineLayout(context.device, m_PipelineLayout, nullptr);
+	m_Reservoirs.Destroy(context.device);
+	m_AdaptiveHistory.Destroy(context.device);
 	vkDestroyDescriptorSetLayout(context.device, m_descriptorSetLayout, nullptr);
+	vkDestroyDescriptorUpdateTemplate(context.device, m_descriptorTemplate, nullptr);
 }
 
 void vk::Candidates::Resize()
 {
-	m_RenderTarget.Destroy(context.device);
-	m_ShadingResult.Destroy(context.device);
+	m_Reservoirs.Destroy(context.device);
+	m_AdaptiveHistory.Destroy(context.device);
 
 	m_width = context.extent.width;
 	m_height = context.extent.height;
+	m_reservoirExtent = GetReservoirExtent(context.extent, restirResolution);
 
-	m_RenderTarget = CreateImageTexture2D(
-		"CandidatesRT",
-		context,
-		m_width,
-		m_height,
-		VK_FORMAT_R16G16B16A16_SFLOAT,
-		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-	m_ShadingResult = CreateImageTexture2D(
-		"CandidatesPassShadingRT",
-		context,
-		m_width,
-		m_height,
-		VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-	ExecuteSingleTimeCommands(context, [&](VkCommandBuffer cmd) {
-
-		ImageTransition(
-			cmd,
-			m_RenderTarget.image,
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0,
-			VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-		);
-
-		ImageTransition(
-			cmd,
-			m_ShadingResult.image,
-			VK_FORMAT_R32G32B32A32_SFLOAT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0,
-			VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-		);
-	});
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.WorldPositions.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 2, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.Normal.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 3, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.Albedo.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 4, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-			.sampler = VK_NULL_HANDLE,
-			.imageView = m_RenderTarget.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_GENERAL
-		};
-
-		UpdateDescriptorSet(context, 5, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
+	m_Reservoirs = CreateReservoirBuffer("CandidatesReservoirs", context, m_reservoirExtent.width, m_reservoirExtent.height);
 
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.MetallicRoughness.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
+	CreateAdaptiveHistory();
 
-		UpdateDescriptorSet(context, 8, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
+	UpdateDescriptors();
 }
 
 void vk::Candidates::Execute(VkCommandBuffer cmd)
@@ -205,49 +70,12 @@ void vk::Candidates::Execute(VkCommandBuffer cmd)
 	RenderPassLabel(cmd, "Candidates");
 #endif // !DEBUG
 
-	ImageTransition(
-		cmd,
-		m_RenderTarget.image,
-		VK_FORMAT_R16G16B16A16_SFLOAT,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
-		VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
-		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-	);
-
-	ImageTransition(
-		cmd,
-		m_ShadingResult.image,
-		VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
-		VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
-		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-	);
-
 	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
-	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &m_descriptorSets[currentFrame], 0, nullptr);
-
-	// 8x8x1 threads per dispatch
-	vkCmdDispatch(cmd, m_width / 8, m_height / 8, 1);
-
-	ImageTransition(
-		cmd,
-		m_RenderTarget.image,
-		VK_FORMAT_R16G16B16A16_SFLOAT,
-		VK_IMAGE_LAYOUT_GENERAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
-		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-	);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &m_descriptorSets[currentFrame], 1, &m_uniformOffset);
 
-	ImageTransition(
-		cmd,
-		m_ShadingResult.image,
-		VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_LAYOUT_GENERAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
-		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-	);
+	// 8x8x1 threads per dispatch, rounded up, the kernel skips invocations past the grid
+	const VkExtent2D grid = GetReservoirExtent(renderExtent, restirResolution);
+	vkCmdDispatch(cmd, (grid.width + 7) / 8, (grid.height + 7) / 8, 1);
 
 #ifdef _DEBUG
 	EndRenderPassLabel(cmd);
@@ -258,21 +86,43 @@ void vk::Candidates::Execute(VkCommandBuffer cmd)
 void vk::Candidates::Update()
 {
 	CandidatesPassData.frameIndex = frameNumber;
-	CandidatesPassData.viewportSize = { m_width, m_height };
+	CandidatesPassData.viewportSize = { renderExtent.width, renderExtent.height };
 	CandidatesPassData.M = CandidatesPassData.M;
-	m_uniformBuffers[currentFrame].WriteToBuffer(&CandidatesPassData, sizeof(uCandidatesPass));
+	CandidatesPassData.lightTileCount = LightTilesPassData.tileCount;
+	CandidatesPassData.lightTileSize = LightTilesPassData.tileSize;
+	CandidatesPassData.enableLightTiles = enableLightTiles ? 1 : 0;
+	CandidatesPassData.resolutionMode = static_cast<int>(restirResolution);
+	// The history length comes from temporal reuse, without it every cell would look disoccluded
+	CandidatesPassData.adaptiveM = enableAdaptiveCandidates && enableReSTIR ? 1 : 0;
+	CandidatesPassData.minM = std::clamp(CandidatesPassData.minM, 1, CandidatesPassData.M);
+	m_uniformOffset = context.uniformArena->Push(CandidatesPassData);
+
+	SelectPipeline(m_Pipeline == VK_NULL_HANDLE);
 }
 
-void vk::Candidates::CreatePipeline()
+// Permutation for the current settings, compiled in the background the first time they are used
+// Waits only when asked to, the first frame has nothing bound yet
+void vk::Candidates::SelectPipeline(bool wait)
 {
-	auto pipelineResult = vk::PipelineBuilder(context, PipelineType::COMPUTE, VertexBinding::NONE, 0)
-		.AddShader("assets/shaders/CandidatesCompute.comp.spv", ShaderType::COMPUTE)
-		.SetPipelineLayout({ {m_descriptorSetLayout} })
-		.Build();
+	const std::string shaderPath = "assets/shaders/CandidatesCompute.comp.spv";
+
+	// The adaptive count differs per cell, only a fixed count can be baked in
+	SpecializationConstants constants;
+	if (enableSpecializedPipelines && CandidatesPassData.adaptiveM == 0)
+		constants.Set(SPEC_CANDIDATE_COUNT, CandidatesPassData.M);
+
+	constants.Set(SPEC_SAMPLING, samplingMode == SamplingMode::LOW_DISCREPANCY);
 
-	m_Pipeline = pipelineResult.first;
-	m_PipelineLayout = pipelineResult.second;
+	const auto* pipeline = m_Permutations.Get(shaderPath, constants, [this, shaderPath](const SpecializationConstants& specialization) {
+		return vk::PipelineBuilder(context, PipelineType::COMPUTE, VertexBinding::NONE, 0)
+			.AddShader(shaderPath, ShaderType::COMPUTE, specialization)
+			.SetPipelineLayout({ {m_descriptorSetLayout} })
+			.Build();
+	}, wait);
 
+	// The bound permutation stays in use until the new one has compiled
+	if (pipeline)
+		std::tie(m_Pipeline, m_PipelineLayout) = *pipeline;
 }
 
 void vk::Candidates::BuildDescriptors()
@@ -280,112 +130,93 @@ void vk::Candidates::BuildDescriptors()
 	m_descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
 	{
 		std::vector<VkDescriptorSetLayoutBinding> bindings = {
-			CreateDescriptorBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // ubo
+			CreateDescriptorBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT), // ubo, offset into the uniform arena
 			CreateDescriptorBinding(1, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // Light ubo
-			CreateDescriptorBinding(2, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT), // GBuffer : World position
-			CreateDescriptorBinding(3, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT), // GBuffer : World normal
-			CreateDescriptorBinding(4, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT), // GBuffer : Albedo
-			CreateDescriptorBinding(5, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT), // reservoir storage image
+			CreateDescriptorBinding(2, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT), // GBuffer : Packed surface
+			CreateDescriptorBinding(5, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // reservoir storage buffer
 			CreateDescriptorBinding(6, 1, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, VK_SHADER_STAGE_COMPUTE_BIT), // TLAS
 			CreateDescriptorBinding(7, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
-			CreateDescriptorBinding(8, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+			CreateDescriptorBinding(9, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // Light tiles
+			CreateDescriptorBinding(11, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // GPU stats
+			CreateDescriptorBinding(12, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT), // Adaptive candidate history
+			CreateDescriptorBinding(13, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Sampling tables
 		};
 
 		m_descriptorSetLayout = CreateDescriptorSetLayout(context, bindings);
 		AllocateDescriptorSets(context, context.descriptorPool, m_descriptorSetLayout, MAX_FRAMES_IN_FLIGHT, m_descriptorSets);
 	}
 
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorBufferInfo buffer_info = {
-			.buffer = m_uniformBuffers[i].buffer,
-			.offset = 0,
-			.range = sizeof(uCandidatesPass)
-		};
-		UpdateDescriptorSet(context, 0, buffer_info, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorBufferInfo buffer_info = {
-			.buffer = scene->GetLightsUBO()[i].buffer,
-			.offset = 0,
-			.range = sizeof(LightBuffer)
-		};
-		UpdateDescriptorSet(context, 1, buffer_info, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.WorldPositions.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 2, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.Normal.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 3, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
+	UpdateDescriptors();
+}
 
+// Every binding of every frame in flight, one templated update per set
+void vk::Candidates::UpdateDescriptors()
+{
+	DescriptorWriter writer;
 	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
 	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.Albedo.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
+		writer
+			.WriteBuffer(0, context.uniformArena->GetBuffer(static_cast<uint32_t>(i)).buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, sizeof(uCandidatesPass))
+			.WriteBuffer(1, scene->GetLightsUBO()[i].buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sizeof(LightBuffer))
+			.WriteImage(2, gbufferMRT[i].Surface.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, clampToEdgeSamplerAniso)
+			.WriteBuffer(5, m_Reservoirs.buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteAccelerationStructure(6, scene->TopLevelAccelerationStructure.handle)
+			.WriteBuffer(7, camera->GetBuffers()[i].buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sizeof(CameraTransform))
+			.WriteBuffer(9, lightTiles[i].buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteBuffer(11, gpuStats[i].buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteImage(12, m_AdaptiveHistory.imageView, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+			.WriteBuffer(13, sampling.buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
 
-		UpdateDescriptorSet(context, 4, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-			.sampler = VK_NULL_HANDLE,
-			.imageView = m_RenderTarget.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_GENERAL
-		};
+		if (m_descriptorTemplate == VK_NULL_HANDLE)
+			m_descriptorTemplate = writer.CreateTemplate(context, m_descriptorSetLayout);
 
-		UpdateDescriptorSet(context, 5, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+		writer.Update(context, m_descriptorSets[i], m_descriptorTemplate);
 	}
+}
 
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		UpdateDescriptorSet(context, 6, scene->TopLevelAccelerationStructure.handle, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR);
-	}
+void vk::Candidates::CreateAdaptiveHistory()
+{
+	m_AdaptiveHistory = CreateImageTexture2D(
+		"CandidatesAdaptiveHistory",
+		context,
+		m_reservoirExtent.width,
+		m_reservoirExtent.height,
+		VK_FORMAT_R32G32B32A32_SFLOAT,
+		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+		VK_IMAGE_ASPECT_COLOR_BIT,
+		1
+	);
 
-	// Camera Transform UBO
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = camera->GetBuffers()[i].buffer;
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(CameraTransform);
-		UpdateDescriptorSet(context, 7, bufferInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-	}
+	// Cleared to no history so every cell starts at the full candidate count
+	ExecuteSingleTimeCommands(context, [&](VkCommandBuffer cmd) {
 
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
+		ImageTransition(
+			cmd,
+			m_AdaptiveHistory.image,
+			VK_FORMAT_R32G32B32A32_SFLOAT,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			0, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT
+		);
 
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.MetallicRoughness.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+		VkClearColorValue clearColor = {};
+		VkImageSubresourceRange range = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1
 		};
+		vkCmdClearColorImage(cmd, m_AdaptiveHistory.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColor, 1, &range);
 
-		UpdateDescriptorSet(context, 8, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
+		// Only ever accessed as a storage image
+		ImageTransition(
+			cmd,
+			m_AdaptiveHistory.image,
+			VK_FORMAT_R32G32B32A32_SFLOAT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+		);
+	});
 }
@@ -4,6 +4,8 @@
 #include "Image.hpp"
 #include <vector>
 #include "GBuffer.hpp"
+#include "PipelinePermutations.hpp"
+#include "DescriptorWriter.hpp"
 
 namespace vk
 {
@@ -14,35 +16,44 @@ namespace vk
 	class Candidates
 	{
 	public:
-		explicit Candidates(Context& context, std::shared_ptr<Scene>& scene, std::shared_ptr<Camera>& camera, const GBuffer::GBufferMRT& gbufferMRT);
+		explicit Candidates(Context& context, std::shared_ptr<Scene>& scene, std::shared_ptr<Camera>& camera, const std::vector<GBuffer::GBufferMRT>& gbufferMRT, const std::vector<Buffer>& lightTiles, const std::vector<Buffer>& gpuStats, const Buffer& sampling);
 		~Candidates();
 
 		void Execute(VkCommandBuffer cmd);
 		void Update();
 		void Resize();
 
-		Image& GetRenderTarget() { return m_ShadingResult; }
-		Image& GetInitialCandidates() { return m_RenderTarget; }
+		Buffer& GetInitialCandidates() { return m_Reservoirs; }
+		Image& GetAdaptiveHistory() { return m_AdaptiveHistory; }
+		uint32_t GetUniformOffset() const { return m_uniformOffset; }
 
 	private:
-		void CreatePipeline();
+		void SelectPipeline(bool wait);
 		void BuildDescriptors();
+		void UpdateDescriptors();
+		void CreateAdaptiveHistory();
 
 		Context& context;
 		std::shared_ptr<Scene> scene;
 		std::shared_ptr<Camera> camera;
-		const GBuffer::GBufferMRT& gbufferMRT;
-		Image m_RenderTarget;
-		Image m_ShadingResult;
+		const std::vector<GBuffer::GBufferMRT>& gbufferMRT;
+		const std::vector<Buffer>& lightTiles;
+		const std::vector<Buffer>& gpuStats;
+		const Buffer& sampling;
+		Buffer m_Reservoirs;
+		Image m_AdaptiveHistory; // per cell luminance moments, history length and candidate count, see shaders/AdaptiveCandidates.glsl
 
 		VkPipeline m_Pipeline;
 		VkPipelineLayout m_PipelineLayout;
+		PipelinePermutations m_Permutations; // owns m_Pipeline
 		std::vector<VkDescriptorSet> m_descriptorSets;
 		VkDescriptorSetLayout m_descriptorSetLayout;
+		VkDescriptorUpdateTemplate m_descriptorTemplate;
 
 		uint32_t m_width;
 		uint32_t m_height;
+		VkExtent2D m_reservoirExtent; // grid the reservoirs are stored for at the swapchain extent, dispatches cover the grid of renderExtent
 
-		std::vector<Buffer> m_uniformBuffers;
+		uint32_t m_uniformOffset = 0; // of this frame's uCandidatesPass in the uniform arena
 	};
 }
\ No newline at end of file
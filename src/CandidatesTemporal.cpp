@@ -0,0 +1,178 @@
+#include "Context.hpp"
+#include "Camera.hpp"
+#include "Scene.hpp"
+#include "Candidates.hpp"
+#include "TemporalCompute.hpp"
+#include "CandidatesTemporal.hpp"
+#include "Pipeline.hpp"
+#include "Utils.hpp"
+#include "Buffer.hpp"
+#include "UniformArena.hpp"
+
+vk::CandidatesTemporal::CandidatesTemporal(Context& context, std::shared_ptr<Scene>& scene, std::shared_ptr<Camera>& camera, Candidates& candidates, TemporalCompute& temporal, const std::vector<Image>& motion_vectors, const std::vector<GBuffer::GBufferMRT>& gbufferMRT, const std::vector<Buffer>& lightTiles, const std::vector<Buffer>& gpuStats, const Buffer& sampling) :
+	context{ context },
+	scene{ scene },
+	camera{ camera },
+	candidates{ candidates },
+	temporal{ temporal },
+	motion_vectors{ motion_vectors },
+	gbufferMRT{ gbufferMRT },
+	lightTiles{ lightTiles },
+	gpuStats{ gpuStats },
+	sampling{ sampling },
+	m_Pipeline{ VK_NULL_HANDLE },
+	m_PipelineLayout{ VK_NULL_HANDLE },
+	m_Permutations{ context },
+	m_descriptorSetLayout{ VK_NULL_HANDLE },
+	m_descriptorTemplate{ VK_NULL_HANDLE },
+	m_width{ 0 },
+	m_height{ 0 },
+	m_reservoirExtent{ 0, 0 }
+{
+	m_width = context.extent.width;
+	m_height = context.extent.height;
+	m_reservoirExtent = GetReservoirExtent(context.extent, restirResolution);
+
+	BuildDescriptors();
+	SelectPipeline(false);
+}
+
+vk::CandidatesTemporal::~CandidatesTemporal()
+{
+	vkDestroyDescriptorSetLayout(context.device, m_descriptorSetLayout, nullptr);
+	vkDestroyDescriptorUpdateTemplate(context.device, m_descriptorTemplate, nullptr);
+}
+
+// Must run after Candidates and TemporalCompute have recreated their buffers
+void vk::CandidatesTemporal::Resize()
+{
+	m_width = context.extent.width;
+	m_height = context.extent.height;
+	m_reservoirExtent = GetReservoirExtent(context.extent, restirResolution);
+
+	UpdateDescriptors();
+}
+
+void vk::CandidatesTemporal::Execute(VkCommandBuffer cmd)
+{
+#ifdef _DEBUG
+	RenderPassLabel(cmd, "CandidatesTemporal");
+#endif // !DEBUG
+
+	// The initial candidates only need to reach memory when the shading pass displays them
+	int writeInitialCandidates = ShadingPassData.reservoir_pass == 0 ? 1 : 0;
+
+	// Both passes pushed their uniforms this frame, in binding order
+	const uint32_t uniformOffsets[] = { candidates.GetUniformOffset(), temporal.GetUniformOffset() };
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &m_descriptorSets[currentFrame], 2, uniformOffsets);
+	vkCmdPushConstants(cmd, m_PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(int), &writeInitialCandidates);
+
+	// 8x8x1 threads per dispatch, rounded up, the kernel skips invocations past the grid
+	const VkExtent2D grid = GetReservoirExtent(renderExtent, restirResolution);
+	vkCmdDispatch(cmd, (grid.width + 7) / 8, (grid.height + 7) / 8, 1);
+
+#ifdef _DEBUG
+	EndRenderPassLabel(cmd);
+#endif // !DEBUG
+}
+
+// The uniforms belong to Candidates and TemporalCompute, must run after their Update
+void vk::CandidatesTemporal::Update()
+{
+	SelectPipeline(m_Pipeline == VK_NULL_HANDLE);
+}
+
+// Permutation for the current settings, compiled in the background the first time they are used
+// Waits only when asked to, the first frame has nothing bound yet
+void vk::CandidatesTemporal::SelectPipeline(bool wait)
+{
+	const std::string shaderPath = "assets/shaders/CandidatesTemporalFused.comp.spv";
+
+	// Same constants as the separate passes, the adaptive count differs per cell so only a fixed count is baked in
+	SpecializationConstants constants;
+	if (enableSpecializedPipelines)
+	{
+		if (CandidatesPassData.adaptiveM == 0)
+			constants.Set(SPEC_CANDIDATE_COUNT, CandidatesPassData.M);
+		constants.Set(SPEC_UNBIASED, TemporalPassData.enableUnbiased ? 1 : 0);
+	}
+
+	constants.Set(SPEC_SAMPLING, samplingMode == SamplingMode::LOW_DISCREPANCY);
+
+	const auto* pipeline = m_Permutations.Get(shaderPath, constants, [this, shaderPath](const SpecializationConstants& specialization) {
+		VkPushConstantRange pushConstant = {
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.offset = 0,
+			.size = sizeof(int)
+		};
+
+		return vk::PipelineBuilder(context, PipelineType::COMPUTE, VertexBinding::NONE, 0)
+			.AddShader(shaderPath, ShaderType::COMPUTE, specialization)
+			.SetPipelineLayout({ {m_descriptorSetLayout} }, pushConstant)
+			.Build();
+	}, wait);
+
+	// The bound permutation stays in use until the new one has compiled
+	if (pipeline)
+		std::tie(m_Pipeline, m_PipelineLayout) = *pipeline;
+}
+
+void vk::CandidatesTemporal::BuildDescriptors()
+{
+	m_descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+	{
+		// 0, 1, 2, 5, 6, 7 and 9 match CandidatesCompute.comp
+		std::vector<VkDescriptorSetLayoutBinding> bindings = {
+			CreateDescriptorBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT), // Candidates ubo
+			CreateDescriptorBinding(1, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // Light ubo
+			CreateDescriptorBinding(2, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT), // GBuffer : Packed surface
+			CreateDescriptorBinding(3, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT), // Motion vectors
+			CreateDescriptorBinding(4, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // Previous frame
+			CreateDescriptorBinding(5, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // Initial candidates
+			CreateDescriptorBinding(6, 1, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, VK_SHADER_STAGE_COMPUTE_BIT), // TLAS
+			CreateDescriptorBinding(7, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // Camera
+			CreateDescriptorBinding(8, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT), // Temporal ubo
+			CreateDescriptorBinding(9, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // Light tiles
+			CreateDescriptorBinding(10, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // Output
+			CreateDescriptorBinding(11, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // GPU stats
+			CreateDescriptorBinding(12, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT), // Adaptive candidate history
+			CreateDescriptorBinding(13, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Sampling tables
+		};
+
+		m_descriptorSetLayout = CreateDescriptorSetLayout(context, bindings);
+		AllocateDescriptorSets(context, context.descriptorPool, m_descriptorSetLayout, MAX_FRAMES_IN_FLIGHT, m_descriptorSets);
+	}
+
+	UpdateDescriptors();
+}
+
+// Every binding of every frame in flight, one templated update per set
+void vk::CandidatesTemporal::UpdateDescriptors()
+{
+	DescriptorWriter writer;
+	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		writer
+			.WriteBuffer(0, context.uniformArena->GetBuffer(static_cast<uint32_t>(i)).buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, sizeof(uCandidatesPass))
+			.WriteBuffer(1, scene->GetLightsUBO()[i].buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sizeof(LightBuffer))
+			.WriteImage(2, gbufferMRT[i].Surface.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, clampToEdgeSamplerAniso)
+			.WriteImage(3, motion_vectors[i].imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, clampToEdgeSamplerAniso)
+			.WriteBuffer(4, temporal.GetPreviousReservoirs().buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteBuffer(5, candidates.GetInitialCandidates().buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteAccelerationStructure(6, scene->TopLevelAccelerationStructure.handle)
+			.WriteBuffer(7, camera->GetBuffers()[i].buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sizeof(CameraTransform))
+			.WriteBuffer(8, context.uniformArena->GetBuffer(static_cast<uint32_t>(i)).buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, sizeof(uTemporalPass))
+			.WriteBuffer(9, lightTiles[i].buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteBuffer(10, temporal.GetRenderTarget().buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteBuffer(11, gpuStats[i].buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteImage(12, candidates.GetAdaptiveHistory().imageView, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+			.WriteBuffer(13, sampling.buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+
+		if (m_descriptorTemplate == VK_NULL_HANDLE)
+			m_descriptorTemplate = writer.CreateTemplate(context, m_descriptorSetLayout);
+
+		writer.Update(context, m_descriptorSets[i], m_descriptorTemplate);
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <volk/volk.h>
+#include <memory>
+#include "Image.hpp"
+#include <vector>
+#include "GBuffer.hpp"
+#include "PipelinePermutations.hpp"
+#include "DescriptorWriter.hpp"
+
+namespace vk
+{
+	class Context;
+	class Camera;
+	class Scene;
+	class Candidates;
+	class TemporalCompute;
+
+	// Candidate generation and temporal reuse in a single dispatch, see CandidatesTemporalFused.comp
+	// Reads the Candidates and TemporalCompute uniforms and writes into their reservoir buffers,
+	// so Spatial and Shading are bound to the same resources whichever path produced them
+	class CandidatesTemporal
+	{
+	public:
+		explicit CandidatesTemporal(Context& context, std::shared_ptr<Scene>& scene, std::shared_ptr<Camera>& camera, Candidates& candidates, TemporalCompute& temporal, const std::vector<Image>& motion_vectors, const std::vector<GBuffer::GBufferMRT>& gbufferMRT, const std::vector<Buffer>& lightTiles, const std::vector<Buffer>& gpuStats, const Buffer& sampling);
+		~CandidatesTemporal();
+
+		void Execute(VkCommandBuffer cmd);
+		void Update();
+		void Resize();
+
+	private:
+		void SelectPipeline(bool wait);
+		void BuildDescriptors();
+		void UpdateDescriptors();
+
+		Context& context;
+		std::shared_ptr<Scene> scene;
+		std::shared_ptr<Camera> camera;
+		Candidates& candidates;
+		TemporalCompute& temporal;
+		const std::vector<Image>& motion_vectors;
+		const std::vector<GBuffer::GBufferMRT>& gbufferMRT;
+		const std::vector<Buffer>& lightTiles;
+		const std::vector<Buffer>& gpuStats;
+		const Buffer& sampling;
+
+		VkPipeline m_Pipeline;
+		VkPipelineLayout m_PipelineLayout;
+		PipelinePermutations m_Permutations; // owns m_Pipeline
+		std::vector<VkDescriptorSet> m_descriptorSets;
+		VkDescriptorSetLayout m_descriptorSetLayout;
+		VkDescriptorUpdateTemplate m_descriptorTemplate;
+
+		uint32_t m_width;
+		uint32_t m_height;
+		VkExtent2D m_reservoirExtent; // grid the reservoirs are stored for at the swapchain extent, dispatches cover the grid of renderExtent
+	};
+}
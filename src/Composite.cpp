@@ -4,9 +4,11 @@
 #include "Utils.hpp"
 #include "Buffer.hpp"
 #include "RenderPass.hpp"
+#include "RenderGraph.hpp"
 
-vk::Composite::Composite(Context& context, Image& shading_result) :
+vk::Composite::Composite(Context& context, Image& shading_result, RenderGraph& graph) :
 	context{ context },
+	m_RenderTarget{ graph.CreateImage({ "CompositeRT", VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT }) },
 	shading_result{ shading_result },
 	m_Pipeline{ VK_NULL_HANDLE },
 	m_PipelineLayout{ VK_NULL_HANDLE },
@@ -20,17 +22,6 @@ vk::Composite::Composite(Context& context, Image& shading_result) :
 	m_width = context.extent.width;
 	m_height = context.extent.height;
 
-	m_RenderTarget = CreateImageTexture2D(
-		"CompositeRT",
-		context,
-		context.extent.width,
-		context.extent.height,
-		VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
 	BuildDescriptors();
 	CreateRenderPass();
 	CreateFramebuffer();
@@ -39,8 +30,6 @@ vk::Composite::Composite(Context& context, Image& shading_result) :
 
 vk::Composite::~Composite()
 {
-	m_RenderTarget.Destroy(context.device);
-
 	vkDestroyPipeline(context.device, m_Pipeline, nullptr);
 	vkDestroyPipelineLayout(context.device, m_PipelineLayout, nullptr);
 
@@ -49,25 +38,13 @@ vk::Composite::~Composite()
 	vkDestroyDescriptorSetLayout(context.device, m_descriptorSetLayout, nullptr);
 }
 
+// The target belongs to the render graph and was realised again before this
 void vk::Composite::Resize()
 {
 	m_width = context.extent.width;
 	m_height = context.extent.height;
 
 	vkDestroyFramebuffer(context.device, m_framebuffer, nullptr);
-
-	m_RenderTarget.Destroy(context.device);
-
-	m_RenderTarget = CreateImageTexture2D(
-		"CompositeRT",
-		context,
-		context.extent.width,
-		context.extent.height,
-		VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
 	CreateFramebuffer();
 
 
@@ -95,7 +72,7 @@ void vk::Composite::Execute(VkCommandBuffer cmd)
 	VkRenderPassBeginInfo rpBegin{ VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
 	rpBegin.renderPass = m_renderPass;
 	rpBegin.framebuffer = m_framebuffer;
-	rpBegin.renderArea.extent = { m_width, m_height };
+	rpBegin.renderArea.extent = renderExtent;
 
 	VkClearValue clearValues[1];
 	clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
@@ -105,15 +82,15 @@ void vk::Composite::Execute(VkCommandBuffer cmd)
 	VkViewport viewport{};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
-	viewport.width = (float)m_width;
-	viewport.height = (float)m_height;
+	viewport.width = (float)renderExtent.width;
+	viewport.height = (float)renderExtent.height;
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
 	vkCmdSetViewport(cmd, 0, 1, &viewport);
 
 	VkRect2D scissor{};
 	scissor.offset = { 0,0 };
-	scissor.extent = { m_width, m_height };
+	scissor.extent = renderExtent;
 	vkCmdSetScissor(cmd, 0, 1, &scissor);
 
 	vkCmdBeginRenderPass(cmd, &rpBegin, VK_SUBPASS_CONTENTS_INLINE);
@@ -138,22 +115,25 @@ void vk::Composite::Update()
 
 void vk::Composite::CreatePipeline()
 {
-	// Create the pipeline
-	auto pipelineResult = vk::PipelineBuilder(context, PipelineType::GRAPHICS, VertexBinding::NONE, 0)
-		.AddShader("assets/shaders/fs_tri.vert.spv", ShaderType::VERTEX)
-		.AddShader("assets/shaders/composite.frag.spv", ShaderType::FRAGMENT)
-		.SetInputAssembly(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
-		.SetDynamicState({ {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR} })
-		.SetRasterizationState(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE)
-		.SetPipelineLayout({ {m_descriptorSetLayout} })
-		.SetSampling(VK_SAMPLE_COUNT_1_BIT)
-		.AddBlendAttachmentState()
-		.SetDepthState(VK_FALSE, VK_FALSE, VK_COMPARE_OP_LESS_OR_EQUAL) // Turn depth read and write OFF ========
-		.SetRenderPass(m_renderPass)
-		.Build();
-
-	m_Pipeline = pipelineResult.first;
-	m_PipelineLayout = pipelineResult.second;
+	// Compiled on a worker thread, the renderer waits for every startup pipeline before the first frame
+	context.pipelineCompiler->Submit([this]() {
+		// Create the pipeline
+		auto pipelineResult = vk::PipelineBuilder(context, PipelineType::GRAPHICS, VertexBinding::NONE, 0)
+			.AddShader("assets/shaders/fs_tri.vert.spv", ShaderType::VERTEX)
+			.AddShader("assets/shaders/composite.frag.spv", ShaderType::FRAGMENT)
+			.SetInputAssembly(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+			.SetDynamicState({ {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR} })
+			.SetRasterizationState(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE)
+			.SetPipelineLayout({ {m_descriptorSetLayout} })
+			.SetSampling(VK_SAMPLE_COUNT_1_BIT)
+			.AddBlendAttachmentState()
+			.SetDepthState(VK_FALSE, VK_FALSE, VK_COMPARE_OP_LESS_OR_EQUAL) // Turn depth read and write OFF ========
+			.SetRenderPass(m_renderPass)
+			.Build();
+
+		m_Pipeline = pipelineResult.first;
+		m_PipelineLayout = pipelineResult.second;
+	});
 }
 
 void vk::Composite::CreateRenderPass()
@@ -7,11 +7,12 @@
 namespace vk
 {
 	class Context;
+	class RenderGraph;
 
 	class Composite
 	{
 	public:
-		explicit Composite(Context& context, Image& shading_result);
+		explicit Composite(Context& context, Image& shading_result, RenderGraph& graph);
 		~Composite();
 
 		void Execute(VkCommandBuffer cmd);
@@ -27,7 +28,7 @@ namespace vk
 		void BuildDescriptors();
 
 		Context& context;
-		Image m_RenderTarget;
+		Image& m_RenderTarget; // transient, owned by the render graph
 		Image& shading_result;
 
 		VkPipeline m_Pipeline;
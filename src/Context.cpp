@@ -2,6 +2,9 @@
 #include "Context.hpp"
 #include "Utils.hpp"
 #include "RenderPass.hpp"
+#include "PipelineCompiler.hpp"
+#include "BindlessHeap.hpp"
+#include "UniformArena.hpp"
 
 #include <unordered_set>
 #include <string>
@@ -9,6 +12,9 @@
 #include <cassert>
 #include <algorithm>
 #include <cstring>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 
 // Instance + Device
 namespace
@@ -22,6 +28,7 @@ namespace
     float ScoreDevice(VkPhysicalDevice pDevice, VkInstance instance, VkSurfaceKHR surface);
     VkPhysicalDevice SelectPhysicalDevice(VkInstance instance, VkSurfaceKHR surface);
     std::pair<std::optional<uint32_t>, std::optional<uint32_t>> GetGraphicsQueueFamily(VkPhysicalDevice pDevice, VkInstance instance, VkSurfaceKHR surface);
+    std::optional<uint32_t> GetComputeQueueFamily(VkPhysicalDevice pDevice);
 }
 
 // Swapchain
@@ -193,6 +200,27 @@ namespace
         }
         return queueFamilies;
     }
+
+    // A family with compute but no graphics, which hardware exposes for its async compute engines.
+    // It has to write timestamps, the async pass timings come from them
+    std::optional<uint32_t> GetComputeQueueFamily(VkPhysicalDevice pDevice)
+    {
+        uint32_t numQueues = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(pDevice, &numQueues, nullptr);
+
+        std::vector<VkQueueFamilyProperties> families(numQueues);
+        vkGetPhysicalDeviceQueueFamilyProperties(pDevice, &numQueues, families.data());
+
+        for (uint32_t i = 0; i < numQueues; i++)
+        {
+            const auto& family = families[i];
+            if ((family.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(family.queueFlags & VK_QUEUE_GRAPHICS_BIT) && family.timestampValidBits > 0)
+            {
+                return i;
+            }
+        }
+        return std::nullopt;
+    }
 }
 
 namespace
@@ -315,6 +343,36 @@ namespace
     }
 }
 
+// Pipeline cache
+namespace
+{
+    constexpr const char* PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+    constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x50434B56; // "VKCP"
+
+    // Written in front of the driver's cache data
+    struct PipelineCacheFileHeader
+    {
+        uint32_t magic;
+        uint32_t dataSize;
+        double coldPipelineMilliseconds;
+    };
+
+    // Drivers reject foreign data themselves, but not all of them do it gracefully
+    bool IsPipelineCacheCompatible(const std::vector<char>& data, const VkPhysicalDeviceProperties& props)
+    {
+        VkPipelineCacheHeaderVersionOne header;
+        if (data.size() < sizeof(header))
+            return false;
+
+        std::memcpy(&header, data.data(), sizeof(header));
+
+        return header.headerSize >= sizeof(header) &&
+            header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+            header.vendorID == props.vendorID &&
+            header.deviceID == props.deviceID &&
+            std::memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+}
 
 vk::Context::Context() :
 	window(nullptr),
@@ -324,8 +382,10 @@ vk::Context::Context() :
 	surface(VK_NULL_HANDLE),
 	graphicsFamilyIndex(0),
 	presentFamilyIndex(0),
+	computeFamilyIndex(0),
 	graphicsQueue(VK_NULL_HANDLE),
 	presentQueue(VK_NULL_HANDLE),
+	computeQueue(VK_NULL_HANDLE),
 	debugMessenger(VK_NULL_HANDLE),
 	enableDebugUtil(false),
     numIndices(0),
@@ -339,7 +399,12 @@ vk::Context::Context() :
     isSwapchainOutdated(false),
     transientCommandPool(VK_NULL_HANDLE),
     descriptorPool(VK_NULL_HANDLE),
-    vkSetDebugUtilsObjectNameEXT(VK_NULL_HANDLE)
+    vkSetDebugUtilsObjectNameEXT(VK_NULL_HANDLE),
+    pipelineCache(VK_NULL_HANDLE),
+    pipelineMilliseconds(0.0),
+    pipelineCount(0),
+    pipelineCacheLoaded(false),
+    coldPipelineMilliseconds(0.0)
 {
 
 }
@@ -373,11 +438,23 @@ void vk::Context::Destroy()
         vkDestroyCommandPool(device, transientCommandPool, nullptr);
     }
 
+    bindlessHeap.reset();
+    uniformArena.reset();
+
     if (descriptorPool != VK_NULL_HANDLE)
     {
         vkDestroyDescriptorPool(device, descriptorPool, nullptr);
     }
 
+    // Nothing may still be compiling into the cache while it is saved
+    pipelineCompiler.reset();
+
+    if (pipelineCache != VK_NULL_HANDLE)
+    {
+        SavePipelineCache();
+        vkDestroyPipelineCache(device, pipelineCache, nullptr);
+    }
+
     if (surface != VK_NULL_HANDLE)
     {
         vkDestroySurfaceKHR(instance, surface, nullptr);
@@ -468,12 +545,21 @@ void vk::Context::CreateLogicalDevice()
     queueInfo.pQueuePriorities = queuePriorities;
     queueInfo.queueCount = 1;
 
+    // Second queue for the passes the render graph runs asynchronously, only when it is a family of its own
+    std::vector<VkDeviceQueueCreateInfo> queueInfos = { queueInfo };
+    if (HasAsyncCompute())
+    {
+        queueInfo.queueFamilyIndex = computeFamilyIndex;
+        queueInfos.push_back(queueInfo);
+    }
+
     std::vector<const char*> extensions{
         VK_KHR_SWAPCHAIN_EXTENSION_NAME,
         VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME,
         VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME,
         VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME,
-        VK_KHR_RAY_QUERY_EXTENSION_NAME
+        VK_KHR_RAY_QUERY_EXTENSION_NAME,
+        VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME
     };
 
     VkPhysicalDeviceAccelerationStructureFeaturesKHR asFeatures = {
@@ -506,11 +592,36 @@ void vk::Context::CreateLogicalDevice()
         .scalarBlockLayout = VK_TRUE
     };
 
+    // Paces the frames in flight in Renderer
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures =
+    {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+        .pNext = &scalarBlockFeatures,
+        .timelineSemaphore = VK_TRUE
+    };
+
+    // GPUTimer resets its queries from the host, the first command buffer of a frame may run on either queue
+    VkPhysicalDeviceHostQueryResetFeatures hostQueryResetFeatures =
+    {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES,
+        .pNext = &timelineFeatures,
+        .hostQueryReset = VK_TRUE
+    };
+
     VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures =
     {
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES,
-        .pNext = &scalarBlockFeatures,
+        .pNext = &hostQueryResetFeatures,
         .shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
+        .shaderStorageBufferArrayNonUniformIndexing = VK_TRUE,
+        .shaderStorageImageArrayNonUniformIndexing = VK_TRUE,
+        .descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+        .descriptorBindingStorageImageUpdateAfterBind = VK_TRUE,
+        .descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE,
+        .descriptorBindingUpdateUnusedWhilePending = VK_TRUE,
+        .descriptorBindingPartiallyBound = VK_TRUE,
+        .descriptorBindingVariableDescriptorCount = VK_TRUE,
+        .runtimeDescriptorArray = VK_TRUE,
     };
 
     VkPhysicalDeviceFeatures2 deviceFeatures2{};
@@ -520,8 +631,8 @@ void vk::Context::CreateLogicalDevice()
 
     VkDeviceCreateInfo deviceInfo = {};
     deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    deviceInfo.queueCreateInfoCount = 1;
-    deviceInfo.pQueueCreateInfos = &queueInfo;
+    deviceInfo.queueCreateInfoCount = static_cast<uint32_t>(queueInfos.size());
+    deviceInfo.pQueueCreateInfos = queueInfos.data();
     deviceInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
     deviceInfo.ppEnabledExtensionNames = extensions.data();
     deviceInfo.pNext = &deviceFeatures2;
@@ -626,9 +737,6 @@ void vk::Context::CreateSwapchain()
         .oldSwapchain = oldSwapchain
     };
 
-    // Set max frames in flight
-    vk::MAX_FRAMES_IN_FLIGHT = imageCount;
-
     if (numIndices <= 1)
     {
         swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
@@ -649,8 +757,11 @@ void vk::Context::CreateSwapchain()
     swapchainFramebuffers = CreateSwapchainFramebuffers(device, swapchainImageViews, renderPass, extent);
 }
 
-bool vk::Context::MakeContext(uint32_t width, uint32_t height)
+bool vk::Context::MakeContext(uint32_t width, uint32_t height, bool visible)
 {
+    // One frame serialises CPU and GPU, past a few only latency and per frame copies grow
+    vk::MAX_FRAMES_IN_FLIGHT = std::clamp(vk::MAX_FRAMES_IN_FLIGHT, 1, 4);
+
     if (volkInitialize() != VK_SUCCESS) {
         ERROR("Failed to initialize Volk.");
         return false;
@@ -677,6 +788,7 @@ bool vk::Context::MakeContext(uint32_t width, uint32_t height)
 
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE); // hidden for the regression suite, it still presents
     window = glfwCreateWindow(width, height, "MSc Project - ReSTIR DI", nullptr, nullptr);
 
     if (!window)
@@ -765,6 +877,10 @@ bool vk::Context::MakeContext(uint32_t width, uint32_t height)
 
     numIndices = graphicsFamilyIndex != presentFamilyIndex ? 2 : 1;
 
+    // Without a dedicated family the async passes are recorded into the graphics queue's command buffers
+    computeFamilyIndex = GetComputeQueueFamily(pDevice).value_or(graphicsFamilyIndex);
+    std::fprintf(stderr, "Async compute: %s\n", HasAsyncCompute() ? "dedicated compute queue" : "none, graphics queue only");
+
     CreateLogicalDevice();
 
     if (device == VK_NULL_HANDLE)
@@ -774,10 +890,16 @@ bool vk::Context::MakeContext(uint32_t width, uint32_t height)
 
     vkGetDeviceQueue(device, graphicsFamilyIndex, 0, &graphicsQueue);
     vkGetDeviceQueue(device, presentFamilyIndex, 0, &presentQueue);
+    vkGetDeviceQueue(device, computeFamilyIndex, 0, &computeQueue);
 
     CreateAllocator();
     CreateTransientCommandPool();
     CreateDescriptorPool();
+    CreatePipelineCache();
+
+    bindlessHeap = std::make_shared<BindlessHeap>(*this);
+
+    pipelineCompiler = std::make_shared<PipelineCompiler>();
 
     assert(graphicsQueue != VK_NULL_HANDLE);
     assert(presentQueue != VK_NULL_HANDLE);
@@ -786,6 +908,9 @@ bool vk::Context::MakeContext(uint32_t width, uint32_t height)
 
     CreateSwapchain();
 
+    // Needs the frame count the swapchain settled on
+    uniformArena = std::make_shared<UniformArena>(*this, 256 * 1024);
+
     // Set max anisotropic level
     maxAnisotropic = props.limits.maxSamplerAnisotropy;
 
@@ -811,8 +936,12 @@ void vk::Context::CreateDescriptorPool()
     samplerPoolSize.descriptorCount = 512;
     VkDescriptorPoolSize storagePoolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER };
     storagePoolSize.descriptorCount = 512;
+    VkDescriptorPoolSize storageImagePoolSize{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE };
+    storageImagePoolSize.descriptorCount = 512;
+    VkDescriptorPoolSize dynamicBufferPoolSize{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC };
+    dynamicBufferPoolSize.descriptorCount = 128;
 
-    std::vector<VkDescriptorPoolSize> poolSize = { bufferPoolSize, samplerPoolSize, storagePoolSize };
+    std::vector<VkDescriptorPoolSize> poolSize = { bufferPoolSize, samplerPoolSize, storagePoolSize, storageImagePoolSize, dynamicBufferPoolSize };
 
     VkDescriptorPoolCreateInfo info{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
     info.poolSizeCount = static_cast<uint32_t>(poolSize.size());
@@ -821,4 +950,99 @@ void vk::Context::CreateDescriptorPool()
     info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
 
     VK_CHECK(vkCreateDescriptorPool(device, &info, nullptr, &descriptorPool), "Failed to create descriptor pool");
+}
+
+void vk::Context::CreatePipelineCache()
+{
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(pDevice, &props);
+
+    std::vector<char> data;
+    std::ifstream file(PIPELINE_CACHE_PATH, std::ios::ate | std::ios::binary);
+    if (file.is_open())
+    {
+        const size_t fileSize = static_cast<size_t>(file.tellg());
+        PipelineCacheFileHeader header = {};
+
+        file.seekg(0);
+        if (fileSize >= sizeof(header) && file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+            header.magic == PIPELINE_CACHE_MAGIC && header.dataSize == fileSize - sizeof(header))
+        {
+            data.resize(header.dataSize);
+            file.read(data.data(), header.dataSize);
+            coldPipelineMilliseconds = header.coldPipelineMilliseconds;
+        }
+
+        if (!file || !IsPipelineCacheCompatible(data, props))
+        {
+            std::fprintf(stderr, "Pipeline cache: %s is invalid or from another driver or device, starting empty\n", PIPELINE_CACHE_PATH);
+            data.clear();
+            coldPipelineMilliseconds = 0.0;
+        }
+    }
+
+    pipelineCacheLoaded = !data.empty();
+
+    VkPipelineCacheCreateInfo createInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = data.size(),
+        .pInitialData = data.empty() ? nullptr : data.data()
+    };
+
+    VK_CHECK(vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache), "Failed to create pipeline cache");
+}
+
+// Written to a temporary file and renamed over the old one, so a crash mid write never leaves a truncated cache
+void vk::Context::SavePipelineCache()
+{
+    size_t dataSize = 0;
+    VK_CHECK(vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr), "Failed to get pipeline cache size");
+
+    std::vector<char> data(dataSize);
+    VK_CHECK(vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data()), "Failed to get pipeline cache data");
+
+    const PipelineCacheFileHeader header = {
+        .magic = PIPELINE_CACHE_MAGIC,
+        .dataSize = static_cast<uint32_t>(dataSize),
+        .coldPipelineMilliseconds = coldPipelineMilliseconds
+    };
+
+    const std::string temporaryPath = std::string(PIPELINE_CACHE_PATH) + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(data.data(), dataSize);
+
+        if (!file)
+        {
+            std::fprintf(stderr, "Pipeline cache: failed to write %s\n", temporaryPath.c_str());
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, PIPELINE_CACHE_PATH, error);
+    if (error)
+        std::fprintf(stderr, "Pipeline cache: failed to replace %s: %s\n", PIPELINE_CACHE_PATH, error.message().c_str());
+}
+
+void vk::Context::ReportPipelineCache()
+{
+    if (!pipelineCacheLoaded)
+    {
+        // This run fills the cache, its time is what later runs are compared against
+        coldPipelineMilliseconds = pipelineMilliseconds.load();
+        std::fprintf(stderr, "Pipeline cache: cold, %u pipelines in %.1f ms\n", pipelineCount.load(), pipelineMilliseconds.load());
+        return;
+    }
+
+    if (coldPipelineMilliseconds > 0.0)
+    {
+        std::fprintf(stderr, "Pipeline cache: warm, %u pipelines in %.1f ms against %.1f ms cold, saved %.1f ms\n",
+            pipelineCount.load(), pipelineMilliseconds.load(), coldPipelineMilliseconds, coldPipelineMilliseconds - pipelineMilliseconds.load());
+    }
+    else
+    {
+        std::fprintf(stderr, "Pipeline cache: warm, %u pipelines in %.1f ms\n", pipelineCount.load(), pipelineMilliseconds.load());
+    }
 }
\ No newline at end of file
@@ -3,16 +3,22 @@
 #include <volk/volk.h>
 #include <vk_mem_alloc.h>
 #include <vector>
+#include <atomic>
+#include <memory>
 #include "Image.hpp"
 
 namespace vk
 {
+	class PipelineCompiler;
+	class BindlessHeap;
+	class UniformArena;
+
 	class Context
 	{
 	public:
 		Context();
 		void Destroy();
-		bool MakeContext(uint32_t width, uint32_t height);
+		bool MakeContext(uint32_t width, uint32_t height, bool visible = true);
 		void CreateLogicalDevice();
 		void CreateAllocator();
 		void CreateSwapchain();
@@ -21,6 +27,9 @@ namespace vk
 
 		void SetObjectName(VkDevice device, uint64_t objectHandle, VkObjectType objectType, const char* name);
 
+		// Prints the time spent building pipelines since startup against the run that filled the cache
+		void ReportPipelineCache();
+
 		GLFWwindow* window;
 		VkInstance instance;
 
@@ -30,9 +39,14 @@ namespace vk
 
 		uint32_t graphicsFamilyIndex;
 		uint32_t presentFamilyIndex;
+		uint32_t computeFamilyIndex; // compute only family, the graphics family when the device has none
 
 		VkQueue graphicsQueue;
 		VkQueue presentQueue;
+		VkQueue computeQueue;        // the graphics queue when the device has no compute only family
+
+		// Whether the render graph can overlap its async compute passes with the graphics queue
+		bool HasAsyncCompute() const { return computeFamilyIndex != graphicsFamilyIndex; }
 
 		VkDebugUtilsMessengerEXT debugMessenger;
 		bool enableDebugUtil;
@@ -54,9 +68,26 @@ namespace vk
 		VkCommandPool transientCommandPool;
 		VkDescriptorPool descriptorPool;
 		PFN_vkSetDebugUtilsObjectNameEXT vkSetDebugUtilsObjectNameEXT;
+
+		// Shared by every PipelineBuilder, loaded from disk in MakeContext and written back in Destroy
+		VkPipelineCache pipelineCache;
+		std::atomic<double> pipelineMilliseconds; // spent in vkCreate*Pipelines, accumulated by PipelineBuilder on any thread
+		std::atomic<uint32_t> pipelineCount;
+		std::shared_ptr<PipelineCompiler> pipelineCompiler;
+
+		// Every texture, storage image and storage buffer registered for bindless access, one set bound by handle
+		std::shared_ptr<BindlessHeap> bindlessHeap;
+
+		// Per frame uniforms, bound with dynamic offsets and rewound once the frame's fence has signalled
+		std::shared_ptr<UniformArena> uniformArena;
 	private:
 		// Create transient pool once to use for one-time submit command buffers
 		void CreateTransientCommandPool();
 		void CreateDescriptorPool();
+		void CreatePipelineCache();
+		void SavePipelineCache();
+
+		bool pipelineCacheLoaded;
+		double coldPipelineMilliseconds; // startup pipeline time of the run that started without a cache, 0 if unknown
 	};
 }
\ No newline at end of file
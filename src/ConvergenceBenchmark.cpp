@@ -0,0 +1,513 @@
+#include "Context.hpp"
+#include "ConvergenceBenchmark.hpp"
+#include "Camera.hpp"
+#include "GPUTimer.hpp"
+#include "Pipeline.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// Static poses through Sponza, each gets a reference of its own
+	const std::array<vk::ConvergenceBenchmark::Pose, 3> benchmarkPath = { {
+		{ { -567.0f, 100.0f, -69.0f }, { -566.0f, 120.0f, -70.0f } }, // the startup camera
+		{ { 400.0f, 150.0f, -40.0f }, { -1.0f, -0.1f, 0.0f } },
+		{ { -900.0f, 200.0f, 300.0f }, { 1.0f, -0.2f, -0.3f } }
+	} };
+
+	// Configurations compared against each other, plain RIS first as the baseline
+	constexpr std::array<vk::ConvergenceBenchmark::Configuration, 6> benchmarkConfigurations = { {
+		{ "RIS M=32",              false, false, 32, 30 },
+		{ "ReSTIR M=4 r=30",       true,  false, 4,  30 },
+		{ "ReSTIR M=8 r=30",       true,  false, 8,  30 },
+		{ "ReSTIR M=32 r=30",      true,  false, 32, 30 },
+		{ "ReSTIR M=8 r=10",       true,  false, 8,  10 },
+		{ "ReSTIR unbiased M=8",   true,  true,  8,  30 }
+	} };
+
+	// The reference is plain RIS accumulated by the History pass, which caps the accumulation at 1000 frames
+	constexpr uint32_t referenceFrames = 512;
+	constexpr int referenceM = 32;
+	constexpr uint32_t settleFrames = 8;     // timer results lag MAX_FRAMES_IN_FLIGHT frames behind the settings
+	constexpr uint32_t measureFrames = 120;
+	constexpr uint32_t errorGroupSize = 16;
+
+	uint32_t GroupCount(uint32_t pixels)
+	{
+		return (pixels + errorGroupSize - 1) / errorGroupSize;
+	}
+}
+
+vk::ConvergenceBenchmark::ConvergenceBenchmark(Context& context, const Image& shadingResult, const Image& denoisedResult, const Image& accumulatedResult) :
+	context{ context },
+	shadingResult{ shadingResult },
+	denoisedResult{ denoisedResult },
+	accumulatedResult{ accumulatedResult },
+	m_referenceFrames{ referenceFrames },
+	m_settleFrames{ settleFrames },
+	m_measureFrames{ measureFrames },
+	m_running{ false },
+	m_phase{ Phase::REFERENCE },
+	m_pose{ 0 },
+	m_configuration{ 0 },
+	m_frame{ 0 },
+	m_restoreCamera{ false },
+	m_saved{},
+	m_width{ 0 },
+	m_height{ 0 },
+	m_ErrorPipeline{ VK_NULL_HANDLE },
+	m_ErrorPipelineLayout{ VK_NULL_HANDLE },
+	m_ReducePipeline{ VK_NULL_HANDLE },
+	m_ReducePipelineLayout{ VK_NULL_HANDLE },
+	m_descriptorSetLayout{ VK_NULL_HANDLE },
+	m_PushConstants{}
+{
+	m_slots.resize(MAX_FRAMES_IN_FLIGHT);
+
+	m_Results.resize(MAX_FRAMES_IN_FLIGHT);
+	for (auto& buffer : m_Results)
+	{
+		buffer = CreateBuffer("ConvergenceResult", context, sizeof(FrameError), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
+	}
+
+	CreateTargets();
+
+	BuildDescriptors();
+	CreatePipeline();
+}
+
+vk::ConvergenceBenchmark::~ConvergenceBenchmark()
+{
+	for (auto& buffer : m_Results)
+	{
+		buffer.Destroy(context.device);
+	}
+
+	m_Partials.Destroy(context.device);
+	m_Reference.Destroy(context.device);
+
+	vkDestroyPipeline(context.device, m_ErrorPipeline, nullptr);
+	vkDestroyPipelineLayout(context.device, m_ErrorPipelineLayout, nullptr);
+	vkDestroyPipeline(context.device, m_ReducePipeline, nullptr);
+	vkDestroyPipelineLayout(context.device, m_ReducePipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(context.device, m_descriptorSetLayout, nullptr);
+}
+
+void vk::ConvergenceBenchmark::Update(Camera& camera)
+{
+	// Only ever set for the first measured frame of a configuration
+	resetTemporalHistory = false;
+
+	if (!m_running)
+	{
+		if (m_restoreCamera)
+		{
+			camera.SetPosition(m_saved.position);
+			camera.SetDirection(m_saved.direction);
+			m_restoreCamera = false;
+		}
+
+		if (!runConvergenceBenchmark)
+			return;
+
+		runConvergenceBenchmark = false;
+		Start(camera);
+		if (!m_running)
+			return;
+	}
+	else
+	{
+		m_frame++;
+		if (m_phase == Phase::REFERENCE && m_frame == m_referenceFrames)
+		{
+			m_phase = Phase::MEASURE;
+			m_configuration = 0;
+			m_frame = 0;
+		}
+		else if (m_phase == Phase::MEASURE && m_frame == m_settleFrames + m_measureFrames)
+		{
+			m_configuration++;
+			m_frame = 0;
+			if (m_configuration == benchmarkConfigurations.size())
+			{
+				m_phase = Phase::REFERENCE;
+				m_configuration = 0;
+				m_pose++;
+			}
+		}
+
+		if (m_pose == benchmarkPath.size())
+		{
+			Finish();
+			return;
+		}
+	}
+
+	// Camera input still applies on top, it is only ever one frame's worth
+	camera.SetPosition(benchmarkPath[m_pose].position);
+	camera.SetDirection(glm::normalize(benchmarkPath[m_pose].direction));
+
+	ApplySettings();
+
+	SlotTag& slot = m_slots[currentFrame];
+	slot = {};
+	if (IsMeasuring())
+	{
+		slot.written = true;
+		slot.pose = m_pose;
+		slot.configuration = m_configuration;
+		slot.frame = m_frame - m_settleFrames;
+	}
+}
+
+void vk::ConvergenceBenchmark::Collect(const GPUTimer& gpuTimer)
+{
+	const SlotTag slot = m_slots[currentFrame];
+	m_slots[currentFrame] = {};
+
+	if (slot.written)
+	{
+		Buffer& buffer = m_Results[currentFrame];
+
+		FrameError error;
+		void* mappedData = nullptr;
+		VK_CHECK(vmaMapMemory(buffer.allocator, buffer.allocation, &mappedData), "Failed to map convergence result buffer");
+		vmaInvalidateAllocation(buffer.allocator, buffer.allocation, 0, VK_WHOLE_SIZE);
+		std::memcpy(&error, mappedData, sizeof(FrameError));
+		vmaUnmapMemory(buffer.allocator, buffer.allocation);
+
+		// The frame's cost without the measurement itself, its passes run on the graphics queue inside the frame span
+		double frameMilliseconds = gpuTimer.GetFrameMilliseconds();
+		for (const auto& result : gpuTimer.GetResults())
+		{
+			if (result.name.rfind("Convergence", 0) == 0)
+				frameMilliseconds -= result.milliseconds;
+		}
+
+		auto& samples = m_samples[slot.pose * benchmarkConfigurations.size() + slot.configuration];
+		const double milliseconds = (samples.empty() ? 0.0 : samples.back().milliseconds) + frameMilliseconds;
+		samples.push_back({ milliseconds, error });
+
+		const Configuration& configuration = benchmarkConfigurations[slot.configuration];
+		m_csv << slot.pose << ',' << slot.configuration << ",\"" << configuration.name << "\"," << configuration.restir << ',' << configuration.unbiased << ','
+			<< configuration.M << ',' << configuration.radius << ',' << m_saved.denoiser << ',' << slot.frame << ',' << frameMilliseconds << ',' << milliseconds << ','
+			<< error.mse << ',' << error.relMSE << ',' << error.flip << '\n';
+	}
+
+	// The last measured frames are still in flight when the run finishes
+	if (!m_running && m_csv.is_open() && std::none_of(m_slots.begin(), m_slots.end(), [](const SlotTag& tag) { return tag.written; }))
+	{
+		m_csv.close();
+		PrintSummary();
+	}
+}
+
+void vk::ConvergenceBenchmark::CopyReference(VkCommandBuffer cmd)
+{
+#ifdef _DEBUG
+	RenderPassLabel(cmd, "ConvergenceReference");
+#endif // !DEBUG
+
+	// Both images are fp32 RGBA, the render graph moved them into the transfer layouts
+	VkImageCopy region = {
+		.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+		.srcOffset = { 0, 0, 0 },
+		.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+		.dstOffset = { 0, 0, 0 },
+		.extent = { renderExtent.width, renderExtent.height, 1 }
+	};
+
+	vkCmdCopyImage(cmd, accumulatedResult.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_Reference.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+#ifdef _DEBUG
+	EndRenderPassLabel(cmd);
+#endif // !DEBUG
+}
+
+void vk::ConvergenceBenchmark::Measure(VkCommandBuffer cmd)
+{
+#ifdef _DEBUG
+	RenderPassLabel(cmd, "ConvergenceError");
+#endif // !DEBUG
+
+	const uint32_t groupsX = GroupCount(renderExtent.width);
+	const uint32_t groupsY = GroupCount(renderExtent.height);
+
+	m_PushConstants.renderExtent = glm::vec2(renderExtent.width, renderExtent.height);
+	m_PushConstants.partialCount = static_cast<int>(groupsX * groupsY);
+
+	const uint32_t set = (denoiser.enable ? MAX_FRAMES_IN_FLIGHT : 0) + currentFrame;
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_ErrorPipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_ErrorPipelineLayout, 0, 1, &m_descriptorSets[set], 0, nullptr);
+	vkCmdPushConstants(cmd, m_ErrorPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uConvergencePass), &m_PushConstants);
+	vkCmdDispatch(cmd, groupsX, groupsY, 1);
+
+#ifdef _DEBUG
+	EndRenderPassLabel(cmd);
+#endif // !DEBUG
+}
+
+void vk::ConvergenceBenchmark::Reduce(VkCommandBuffer cmd)
+{
+#ifdef _DEBUG
+	RenderPassLabel(cmd, "ConvergenceReduce");
+#endif // !DEBUG
+
+	const uint32_t set = (denoiser.enable ? MAX_FRAMES_IN_FLIGHT : 0) + currentFrame;
+
+	// A single workgroup, there are at most a few thousand partial sums
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_ReducePipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_ReducePipelineLayout, 0, 1, &m_descriptorSets[set], 0, nullptr);
+	vkCmdPushConstants(cmd, m_ReducePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uConvergencePass), &m_PushConstants);
+	vkCmdDispatch(cmd, 1, 1, 1);
+
+#ifdef _DEBUG
+	EndRenderPassLabel(cmd);
+#endif // !DEBUG
+}
+
+void vk::ConvergenceBenchmark::Resize()
+{
+	// The renderer also rebuilds its targets when only the reservoir grid or the transient aliasing changed
+	if (context.extent.width != m_width || context.extent.height != m_height)
+	{
+		m_Partials.Destroy(context.device);
+		m_Reference.Destroy(context.device);
+		CreateTargets();
+
+		// Every reference so far was accumulated at the old extent
+		if (m_running)
+		{
+			std::printf("Convergence benchmark stopped, the swapchain was resized\n");
+			Finish();
+		}
+	}
+
+	UpdateDescriptors();
+}
+
+void vk::ConvergenceBenchmark::Start(const Camera& camera)
+{
+	m_csv.open("convergence.csv", std::ios::out | std::ios::trunc);
+	if (!m_csv.is_open())
+	{
+		ERROR("Failed to open convergence.csv, convergence benchmark not started");
+		return;
+	}
+
+	m_csv << "pose,config,name,restir,unbiased,M,radius,denoised,frame,gpu_ms,time_ms,mse,relmse,flip\n";
+
+	m_saved.position = camera.GetPosition();
+	m_saved.direction = camera.GetDirection();
+	m_saved.restir = enableReSTIR;
+	m_saved.temporalUnbiased = TemporalPassData.enableUnbiased;
+	m_saved.spatialUnbiased = SpatialPassData.enableUnbiased;
+	m_saved.M = CandidatesPassData.M;
+	m_saved.radius = SpatialPassData.radius;
+	m_saved.accumulating = isAccumulating;
+	m_saved.dynamicResolution = dynamicResolution.enable;
+	m_saved.denoiser = denoiser.enable;
+	m_saved.animateLights = ShouldAnimateLights;
+
+	m_running = true;
+	m_phase = Phase::REFERENCE;
+	m_pose = 0;
+	m_configuration = 0;
+	m_frame = 0;
+	m_samples.assign(benchmarkPath.size() * benchmarkConfigurations.size(), {});
+
+	std::printf("Convergence benchmark: %zu poses, %zu configurations, %u reference frames and %u measured frames each\n",
+		benchmarkPath.size(), benchmarkConfigurations.size(), m_referenceFrames, m_measureFrames);
+}
+
+void vk::ConvergenceBenchmark::Finish()
+{
+	RestoreSettings();
+	m_running = false;
+	m_restoreCamera = true;
+}
+
+void vk::ConvergenceBenchmark::ApplySettings()
+{
+	// A fixed resolution and static lights, the reference has to stay valid for every configuration
+	dynamicResolution.enable = false;
+	ShouldAnimateLights = false;
+
+	if (m_phase == Phase::REFERENCE)
+	{
+		enableReSTIR = false;
+		CandidatesPassData.M = referenceM;
+		denoiser.enable = false;
+		isAccumulating = true;
+
+		if (m_frame == 0)
+		{
+			// History::Update counts this frame as the first one
+			rtxSettings.frameIndex = -1;
+			shouldClearBeforeDraw = true;
+		}
+		return;
+	}
+
+	const Configuration& configuration = benchmarkConfigurations[m_configuration];
+	enableReSTIR = configuration.restir;
+	TemporalPassData.enableUnbiased = configuration.unbiased;
+	SpatialPassData.enableUnbiased = configuration.unbiased;
+	CandidatesPassData.M = configuration.M;
+	SpatialPassData.radius = configuration.radius;
+	denoiser.enable = m_saved.denoiser;
+	isAccumulating = false;
+
+	// Converges from scratch once the settings have settled
+	resetTemporalHistory = m_frame == m_settleFrames;
+}
+
+void vk::ConvergenceBenchmark::RestoreSettings()
+{
+	enableReSTIR = m_saved.restir;
+	TemporalPassData.enableUnbiased = m_saved.temporalUnbiased;
+	SpatialPassData.enableUnbiased = m_saved.spatialUnbiased;
+	CandidatesPassData.M = m_saved.M;
+	SpatialPassData.radius = m_saved.radius;
+	isAccumulating = m_saved.accumulating;
+	dynamicResolution.enable = m_saved.dynamicResolution;
+	denoiser.enable = m_saved.denoiser;
+	ShouldAnimateLights = m_saved.animateLights;
+
+	// The History target was overwritten, restart the accumulation if it was running
+	if (isAccumulating)
+	{
+		rtxSettings.frameIndex = -1;
+		shouldClearBeforeDraw = true;
+	}
+}
+
+// Equal-time comparison: every configuration's error once it has spent as much GPU time as the cheapest one did in total
+void vk::ConvergenceBenchmark::PrintSummary()
+{
+	for (size_t pose = 0; pose < benchmarkPath.size(); pose++)
+	{
+		const size_t first = pose * benchmarkConfigurations.size();
+
+		double equalTime = 0.0;
+		bool measured = false;
+		for (size_t i = 0; i < benchmarkConfigurations.size(); i++)
+		{
+			const auto& samples = m_samples[first + i];
+			if (samples.empty())
+				continue;
+
+			equalTime = measured ? std::min(equalTime, samples.back().milliseconds) : samples.back().milliseconds;
+			measured = true;
+		}
+
+		if (!measured)
+			continue;
+
+		std::printf("Pose %zu, errors at %.2f ms of GPU time\n", pose, equalTime);
+		std::printf("%24s %10s %12s %12s %12s %8s\n", "Configuration", "ms/frame", "MSE", "relMSE", "FLIP", "Frames");
+		for (size_t i = 0; i < benchmarkConfigurations.size(); i++)
+		{
+			const auto& samples = m_samples[first + i];
+			if (samples.empty())
+				continue;
+
+			// Last frame finished within the time budget
+			auto last = std::find_if(samples.rbegin(), samples.rend(), [equalTime](const Sample& sample) { return sample.milliseconds <= equalTime; });
+			const Sample& sample = last != samples.rend() ? *last : samples.front();
+			const size_t frames = last != samples.rend() ? static_cast<size_t>(samples.rend() - last) : 1;
+
+			std::printf("%24s %10.4f %12.6f %12.6f %12.6f %8zu\n", benchmarkConfigurations[i].name, samples.back().milliseconds / samples.size(),
+				sample.error.mse, sample.error.relMSE, sample.error.flip, frames);
+		}
+	}
+
+	std::printf("Convergence curves written to convergence.csv\n");
+}
+
+void vk::ConvergenceBenchmark::CreateTargets()
+{
+	const uint32_t width = context.extent.width;
+	const uint32_t height = context.extent.height;
+
+	m_Reference = CreateImageTexture2D("Convergence_Reference", context, width, height, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+	m_width = width;
+	m_height = height;
+
+	// Sampled until the first reference is copied in, the render graph takes it from there
+	ExecuteSingleTimeCommands(context, [&](VkCommandBuffer cmd) {
+
+		ImageTransition(cmd, m_Reference.image, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+	});
+
+	const VkDeviceSize partialsSize = VkDeviceSize(GroupCount(width)) * GroupCount(height) * sizeof(glm::vec4);
+	m_Partials = CreateBuffer("ConvergencePartials", context, partialsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 0, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+}
+
+void vk::ConvergenceBenchmark::CreatePipeline()
+{
+	VkPushConstantRange pushConstant = {
+		.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		.offset = 0,
+		.size = sizeof(uConvergencePass)
+	};
+
+	// Compiled on worker threads, the renderer waits for every startup pipeline before the first frame
+	context.pipelineCompiler->Submit([this, pushConstant]() {
+		auto pipelineResult = vk::PipelineBuilder(context, PipelineType::COMPUTE, VertexBinding::NONE, 0)
+			.AddShader("assets/shaders/ConvergenceError.comp.spv", ShaderType::COMPUTE)
+			.SetPipelineLayout({ {m_descriptorSetLayout} }, pushConstant)
+			.Build();
+
+		m_ErrorPipeline = pipelineResult.first;
+		m_ErrorPipelineLayout = pipelineResult.second;
+	});
+
+	context.pipelineCompiler->Submit([this, pushConstant]() {
+		auto pipelineResult = vk::PipelineBuilder(context, PipelineType::COMPUTE, VertexBinding::NONE, 0)
+			.AddShader("assets/shaders/ConvergenceReduce.comp.spv", ShaderType::COMPUTE)
+			.SetPipelineLayout({ {m_descriptorSetLayout} }, pushConstant)
+			.Build();
+
+		m_ReducePipeline = pipelineResult.first;
+		m_ReducePipelineLayout = pipelineResult.second;
+	});
+}
+
+void vk::ConvergenceBenchmark::BuildDescriptors()
+{
+	// Bindings are listed in shaders/Convergence.glsl
+	std::vector<VkDescriptorSetLayoutBinding> bindings = {
+		CreateDescriptorBinding(0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),  // Image under test
+		CreateDescriptorBinding(1, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),  // Reference
+		CreateDescriptorBinding(2, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),          // Partial sums
+		CreateDescriptorBinding(3, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)           // Frame result
+	};
+
+	m_descriptorSetLayout = CreateDescriptorSetLayout(context, bindings);
+	AllocateDescriptorSets(context, context.descriptorPool, m_descriptorSetLayout, MAX_FRAMES_IN_FLIGHT * 2, m_descriptorSets);
+
+	UpdateDescriptors();
+}
+
+void vk::ConvergenceBenchmark::UpdateDescriptors()
+{
+	DescriptorWriter writer;
+	for (uint32_t variant = 0; variant < 2; variant++)
+	{
+		const Image& testImage = variant == 0 ? shadingResult : denoisedResult;
+
+		for (uint32_t frame = 0; frame < static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT); frame++)
+		{
+			writer
+				.WriteImage(0, testImage.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, repeatSampler)
+				.WriteImage(1, m_Reference.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, repeatSampler)
+				.WriteBuffer(2, m_Partials.buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+				.WriteBuffer(3, m_Results[frame].buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, sizeof(FrameError))
+				.Update(context, m_descriptorSets[variant * MAX_FRAMES_IN_FLIGHT + frame]);
+		}
+	}
+}
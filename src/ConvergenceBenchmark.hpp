@@ -0,0 +1,163 @@
+#pragma once
+#include <volk/volk.h>
+#include <array>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Buffer.hpp"
+#include "DescriptorWriter.hpp"
+#include "Image.hpp"
+#include "Utils.hpp"
+
+namespace vk
+{
+	class Context;
+	class Camera;
+	class GPUTimer;
+
+	// Equal-time convergence of the ReSTIR configurations against an accumulated reference
+	// For every pose of a fixed camera path the History pass first accumulates a reference from plain RIS, then each
+	// configuration renders from a reset history while ConvergenceError.comp and ConvergenceReduce.comp measure its
+	// MSE, relMSE and a FLIP-like error against it on the GPU. The results are read back like GPUStats, a frame in
+	// flight later, and written with the GPU time spent so far to convergence.csv as error-vs-time curves
+	class ConvergenceBenchmark
+	{
+	public:
+		struct Pose
+		{
+			glm::vec3 position;
+			glm::vec3 direction;
+		};
+
+		struct Configuration
+		{
+			const char* name;
+			bool restir;
+			bool unbiased;
+			int M;          // initial candidates
+			int radius;     // spatial reuse
+		};
+
+		ConvergenceBenchmark(Context& context, const Image& shadingResult, const Image& denoisedResult, const Image& accumulatedResult);
+		~ConvergenceBenchmark();
+
+		// Moves the camera and applies the settings of the current step, call before the camera and the passes update
+		void Update(Camera& camera);
+
+		// Reads back the errors from the last time this frame slot was used, call after the GPU timer was collected
+		void Collect(const GPUTimer& gpuTimer);
+
+		void CopyReference(VkCommandBuffer cmd);
+		void Measure(VkCommandBuffer cmd);
+		void Reduce(VkCommandBuffer cmd);
+
+		// The transients were realised again by the render graph before this, a running benchmark is stopped
+		void Resize();
+
+		// Which of the passes the renderer has to declare this frame
+		bool IsCapturingReference() const { return m_running && m_phase == Phase::REFERENCE && m_frame + 1 == m_referenceFrames; }
+		bool IsMeasuring() const { return m_running && m_phase == Phase::MEASURE && m_frame >= m_settleFrames; }
+		bool IsRunning() const { return m_running; }
+
+		const Image& GetReference() const { return m_Reference; }
+		const Buffer& GetPartials() const { return m_Partials; }
+		const std::vector<Buffer>& GetResults() const { return m_Results; }
+
+	private:
+		enum class Phase
+		{
+			REFERENCE,
+			MEASURE
+		};
+
+		// Read back from the GPU, must match FrameResult in shaders/Convergence.glsl
+		struct FrameError
+		{
+			float mse;
+			float relMSE;
+			float flip;
+			float pixels;
+		};
+
+		// What the frame recorded into a slot measured, so its readback lands in the right row
+		struct SlotTag
+		{
+			bool written = false;
+			uint32_t pose = 0;
+			uint32_t configuration = 0;
+			uint32_t frame = 0;
+		};
+
+		struct Sample
+		{
+			double milliseconds;   // GPU time spent on the configuration up to and including this frame
+			FrameError error;
+		};
+
+		void Start(const Camera& camera);
+		void Finish();
+		void ApplySettings();
+		void RestoreSettings();
+		void PrintSummary();
+
+		void CreatePipeline();
+		void BuildDescriptors();
+		void UpdateDescriptors();
+		void CreateTargets();
+
+		Context& context;
+		const Image& shadingResult;
+		const Image& denoisedResult;
+		const Image& accumulatedResult;
+
+		uint32_t m_referenceFrames;
+		uint32_t m_settleFrames;     // new settings run unmeasured until the timer and pipelines have caught up with them
+		uint32_t m_measureFrames;
+
+		bool m_running;
+		Phase m_phase;
+		uint32_t m_pose;
+		uint32_t m_configuration;
+		uint32_t m_frame;
+		bool m_restoreCamera;    // the run finished outside Update, the camera goes back on the next one
+
+		std::vector<SlotTag> m_slots;
+		std::vector<std::vector<Sample>> m_samples; // pose * configuration count + configuration
+		std::ofstream m_csv;
+
+		// Restored once the run finishes
+		struct SavedSettings
+		{
+			glm::vec3 position;
+			glm::vec3 direction;
+			bool restir;
+			bool temporalUnbiased;
+			bool spatialUnbiased;
+			int M;
+			int radius;
+			bool accumulating;
+			bool dynamicResolution;
+			bool denoiser;
+			bool animateLights;
+		} m_saved;
+
+		uint32_t m_width;        // extent the reference was created at
+		uint32_t m_height;
+
+		Image m_Reference;
+		Buffer m_Partials;
+		std::vector<Buffer> m_Results;
+
+		VkPipeline m_ErrorPipeline;
+		VkPipelineLayout m_ErrorPipelineLayout;
+		VkPipeline m_ReducePipeline;
+		VkPipelineLayout m_ReducePipelineLayout;
+		VkDescriptorSetLayout m_descriptorSetLayout;
+
+		// Per frame in flight, first against the shading result then against the denoised target
+		std::vector<VkDescriptorSet> m_descriptorSets;
+
+		uConvergencePass m_PushConstants;
+	};
+}
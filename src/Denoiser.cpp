@@ -0,0 +1,275 @@
+#include "Context.hpp"
+#include "Denoiser.hpp"
+#include "Pipeline.hpp"
+#include "Utils.hpp"
+#include "RenderGraph.hpp"
+
+vk::Denoiser::Denoiser(Context& context, const Image& shadingResult, const std::vector<Image>& motionVectors, const std::vector<GBuffer::GBufferMRT>& gbufferMRT, RenderGraph& graph) :
+	context{ context },
+	shadingResult{ shadingResult },
+	motionVectors{ motionVectors },
+	gbufferMRT{ gbufferMRT },
+	m_HistoryIndex{ 0 },
+	m_ResetHistory{ true },
+	m_Integrated{ graph.CreateImage({ "SVGF_Integrated", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT }) },
+	m_PingA{ graph.CreateImage({ "SVGF_PingA", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT }) },
+	m_PingB{ graph.CreateImage({ "SVGF_PingB", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT }) },
+	m_RenderTarget{ graph.CreateImage({ "DenoisedRT", VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT }) },
+	m_TemporalPipeline{ VK_NULL_HANDLE },
+	m_TemporalPipelineLayout{ VK_NULL_HANDLE },
+	m_VariancePipeline{ VK_NULL_HANDLE },
+	m_VariancePipelineLayout{ VK_NULL_HANDLE },
+	m_FilterPipeline{ VK_NULL_HANDLE },
+	m_FilterPipelineLayout{ VK_NULL_HANDLE },
+	m_descriptorSetLayout{ VK_NULL_HANDLE },
+	m_descriptorTemplate{ VK_NULL_HANDLE },
+	m_PushConstants{}
+{
+	CreateHistory();
+
+	BuildDescriptors();
+	CreatePipeline();
+}
+
+vk::Denoiser::~Denoiser()
+{
+	for (auto& history : m_History)
+	{
+		history.depthNormal.Destroy(context.device);
+		history.colour.Destroy(context.device);
+		history.moments.Destroy(context.device);
+	}
+
+	vkDestroyPipeline(context.device, m_TemporalPipeline, nullptr);
+	vkDestroyPipelineLayout(context.device, m_TemporalPipelineLayout, nullptr);
+	vkDestroyPipeline(context.device, m_VariancePipeline, nullptr);
+	vkDestroyPipelineLayout(context.device, m_VariancePipelineLayout, nullptr);
+	vkDestroyPipeline(context.device, m_FilterPipeline, nullptr);
+	vkDestroyPipelineLayout(context.device, m_FilterPipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(context.device, m_descriptorSetLayout, nullptr);
+	vkDestroyDescriptorUpdateTemplate(context.device, m_descriptorTemplate, nullptr);
+}
+
+// The transients were realised again by the render graph before this, the history is recreated at the new extent
+void vk::Denoiser::Resize()
+{
+	for (auto& history : m_History)
+	{
+		history.depthNormal.Destroy(context.device);
+		history.colour.Destroy(context.device);
+		history.moments.Destroy(context.device);
+	}
+
+	CreateHistory();
+	m_ResetHistory = true;
+
+	UpdateDescriptors();
+}
+
+void vk::Denoiser::Update()
+{
+	if (!denoiser.enable)
+	{
+		// Stale by the time the denoiser is switched back on
+		m_ResetHistory = true;
+		return;
+	}
+
+	// Last frame's current history is this frame's previous one
+	m_HistoryIndex ^= 1;
+
+	m_PushConstants.renderExtent = glm::vec2(renderExtent.width, renderExtent.height);
+	m_PushConstants.resetHistory = m_ResetHistory || renderExtentChanged || resetTemporalHistory ? 1 : 0;
+	m_PushConstants.colourAlpha = denoiser.colourAlpha;
+	m_PushConstants.momentsAlpha = denoiser.momentsAlpha;
+	m_PushConstants.phiColour = denoiser.phiColour;
+	m_PushConstants.phiNormal = denoiser.phiNormal;
+	m_PushConstants.phiDepth = denoiser.phiDepth;
+
+	m_ResetHistory = false;
+}
+
+void vk::Denoiser::Temporal(VkCommandBuffer cmd)
+{
+#ifdef _DEBUG
+	RenderPassLabel(cmd, "SVGFTemporal");
+#endif // !DEBUG
+
+	Dispatch(cmd, m_TemporalPipeline, m_TemporalPipelineLayout, m_HistoryIndex * 3, m_PushConstants);
+
+#ifdef _DEBUG
+	EndRenderPassLabel(cmd);
+#endif // !DEBUG
+}
+
+void vk::Denoiser::Variance(VkCommandBuffer cmd)
+{
+#ifdef _DEBUG
+	RenderPassLabel(cmd, "SVGFVariance");
+#endif // !DEBUG
+
+	Dispatch(cmd, m_VariancePipeline, m_VariancePipelineLayout, m_HistoryIndex * 3, m_PushConstants);
+
+#ifdef _DEBUG
+	EndRenderPassLabel(cmd);
+#endif // !DEBUG
+}
+
+void vk::Denoiser::Filter(VkCommandBuffer cmd, uint32_t iteration)
+{
+#ifdef _DEBUG
+	RenderPassLabel(cmd, "SVGFAtrous");
+#endif // !DEBUG
+
+	uDenoiserPass constants = m_PushConstants;
+	constants.stepSize = 1 << iteration;
+	constants.writeHistory = iteration == 0 ? 1 : 0;
+	constants.finalIteration = iteration + 1 == static_cast<uint32_t>(denoiser.atrousIterations) ? 1 : 0;
+
+	Dispatch(cmd, m_FilterPipeline, m_FilterPipelineLayout, m_HistoryIndex * 3 + 1 + iteration % 2, constants);
+
+#ifdef _DEBUG
+	EndRenderPassLabel(cmd);
+#endif // !DEBUG
+}
+
+void vk::Denoiser::Dispatch(VkCommandBuffer cmd, VkPipeline pipeline, VkPipelineLayout pipelineLayout, uint32_t set, const uDenoiserPass& constants)
+{
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &m_descriptorSets[currentFrame * 6 + set], 0, nullptr);
+	vkCmdPushConstants(cmd, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uDenoiserPass), &constants);
+
+	// 8x8x1 threads per dispatch
+	vkCmdDispatch(cmd, renderExtent.width / 8, renderExtent.height / 8, 1);
+}
+
+void vk::Denoiser::CreatePipeline()
+{
+	VkPushConstantRange pushConstant = {
+		.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		.offset = 0,
+		.size = sizeof(uDenoiserPass)
+	};
+
+	// Compiled on worker threads, the renderer waits for every startup pipeline before the first frame
+	context.pipelineCompiler->Submit([this, pushConstant]() {
+		auto pipelineResult = vk::PipelineBuilder(context, PipelineType::COMPUTE, VertexBinding::NONE, 0)
+			.AddShader("assets/shaders/SVGFTemporal.comp.spv", ShaderType::COMPUTE)
+			.SetPipelineLayout({ {m_descriptorSetLayout} }, pushConstant)
+			.Build();
+
+		m_TemporalPipeline = pipelineResult.first;
+		m_TemporalPipelineLayout = pipelineResult.second;
+	});
+
+	context.pipelineCompiler->Submit([this, pushConstant]() {
+		auto pipelineResult = vk::PipelineBuilder(context, PipelineType::COMPUTE, VertexBinding::NONE, 0)
+			.AddShader("assets/shaders/SVGFVariance.comp.spv", ShaderType::COMPUTE)
+			.SetPipelineLayout({ {m_descriptorSetLayout} }, pushConstant)
+			.Build();
+
+		m_VariancePipeline = pipelineResult.first;
+		m_VariancePipelineLayout = pipelineResult.second;
+	});
+
+	context.pipelineCompiler->Submit([this, pushConstant]() {
+		auto pipelineResult = vk::PipelineBuilder(context, PipelineType::COMPUTE, VertexBinding::NONE, 0)
+			.AddShader("assets/shaders/SVGFAtrous.comp.spv", ShaderType::COMPUTE)
+			.SetPipelineLayout({ {m_descriptorSetLayout} }, pushConstant)
+			.Build();
+
+		m_FilterPipeline = pipelineResult.first;
+		m_FilterPipelineLayout = pipelineResult.second;
+	});
+}
+
+void vk::Denoiser::BuildDescriptors()
+{
+	// Bindings are listed in shaders/SVGF.glsl
+	std::vector<VkDescriptorSetLayoutBinding> bindings = {
+		CreateDescriptorBinding(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT),           // Shading result
+		CreateDescriptorBinding(1, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),  // Motion vectors
+		CreateDescriptorBinding(2, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),  // GBuffer - Packed surface
+		CreateDescriptorBinding(3, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT),           // Previous depth and normal
+		CreateDescriptorBinding(4, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT),           // Previous colour history
+		CreateDescriptorBinding(5, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT),           // Previous moments
+		CreateDescriptorBinding(6, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT),           // Current depth and normal
+		CreateDescriptorBinding(7, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT),           // Current colour history
+		CreateDescriptorBinding(8, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT),           // Current moments
+		CreateDescriptorBinding(9, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT),           // Integrated illumination
+		CreateDescriptorBinding(10, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT),          // Wavelet input
+		CreateDescriptorBinding(11, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT),          // Wavelet output
+		CreateDescriptorBinding(12, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)           // Denoised target
+	};
+
+	m_descriptorSetLayout = CreateDescriptorSetLayout(context, bindings);
+	AllocateDescriptorSets(context, context.descriptorPool, m_descriptorSetLayout, MAX_FRAMES_IN_FLIGHT * 6, m_descriptorSets);
+
+	UpdateDescriptors();
+}
+
+// The motion vectors and G-buffer of the frame in flight, and which history is current
+void vk::Denoiser::UpdateDescriptors()
+{
+	DescriptorWriter writer;
+	for (uint32_t set = 0; set < static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) * 2; set++)
+	{
+		const uint32_t frame = set / 2;
+		const uint32_t history = set % 2;
+		const FrameHistory& current = m_History[history];
+		const FrameHistory& previous = m_History[history ^ 1];
+
+		for (uint32_t stage = 0; stage < 3; stage++)
+		{
+			// Variance (stage 0) writes the input of the even passes, the wavelet passes alternate from there
+			const Image& filterInput = stage == 1 ? m_PingA : m_PingB;
+			const Image& filterOutput = stage == 1 ? m_PingB : m_PingA;
+
+			writer
+				.WriteImage(0, shadingResult.imageView, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+				.WriteImage(1, motionVectors[frame].imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, clampToEdgeSamplerAniso)
+				.WriteImage(2, gbufferMRT[frame].Surface.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, clampToEdgeSamplerAniso)
+				.WriteImage(3, previous.depthNormal.imageView, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+				.WriteImage(4, previous.colour.imageView, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+				.WriteImage(5, previous.moments.imageView, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+				.WriteImage(6, current.depthNormal.imageView, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+				.WriteImage(7, current.colour.imageView, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+				.WriteImage(8, current.moments.imageView, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+				.WriteImage(9, m_Integrated.imageView, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+				.WriteImage(10, filterInput.imageView, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+				.WriteImage(11, filterOutput.imageView, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+				.WriteImage(12, m_RenderTarget.imageView, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+
+			// Same bindings for every set, and again on every resize
+			if (m_descriptorTemplate == VK_NULL_HANDLE)
+				m_descriptorTemplate = writer.CreateTemplate(context, m_descriptorSetLayout);
+
+			writer.Update(context, m_descriptorSets[set * 3 + stage], m_descriptorTemplate);
+		}
+	}
+}
+
+void vk::Denoiser::CreateHistory()
+{
+	const uint32_t width = context.extent.width;
+	const uint32_t height = context.extent.height;
+
+	for (auto& history : m_History)
+	{
+		history.depthNormal = CreateImageTexture2D("SVGF_DepthNormalHistory", context, width, height, VK_FORMAT_R32_UINT, VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+		history.colour = CreateImageTexture2D("SVGF_ColourHistory", context, width, height, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+		history.moments = CreateImageTexture2D("SVGF_MomentsHistory", context, width, height, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+	}
+
+	// Only ever accessed as storage images, the contents are ignored until a frame has written them
+	ExecuteSingleTimeCommands(context, [&](VkCommandBuffer cmd) {
+
+		for (auto& history : m_History)
+		{
+			ImageTransition(cmd, history.depthNormal.image, VK_FORMAT_R32_UINT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+			ImageTransition(cmd, history.colour.image, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+			ImageTransition(cmd, history.moments.image, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		}
+
+	});
+}
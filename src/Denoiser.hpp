@@ -0,0 +1,87 @@
+#pragma once
+#include <volk/volk.h>
+#include <array>
+#include <vector>
+#include "Image.hpp"
+#include "GBuffer.hpp"
+#include "DescriptorWriter.hpp"
+#include "Utils.hpp"
+
+namespace vk
+{
+	class Context;
+	class RenderGraph;
+
+	// Spatiotemporal variance-guided filtering (SVGF) of the shading result
+	// Temporal integrates the demodulated illumination and its luminance moments with last frame's history,
+	// Variance estimates the per pixel variance from them and Filter runs one edge-aware a-trous wavelet pass.
+	// The intermediate targets are render graph transients, so the filter ping-pongs between two images that share
+	// memory with whatever else in the frame does not overlap them
+	class Denoiser
+	{
+	public:
+		// Kept from one frame to the next, the renderer imports both sets into the render graph
+		struct FrameHistory
+		{
+			Image depthNormal; // r32ui, see PackDepthNormal in shaders/SVGF.glsl
+			Image colour;      // filtered illumination after the first wavelet pass, a = variance
+			Image moments;     // luminance and luminance squared, z = history length
+		};
+
+		Denoiser(Context& context, const Image& shadingResult, const std::vector<Image>& motionVectors, const std::vector<GBuffer::GBufferMRT>& gbufferMRT, RenderGraph& graph);
+		~Denoiser();
+
+		void Temporal(VkCommandBuffer cmd);
+		void Variance(VkCommandBuffer cmd);
+		void Filter(VkCommandBuffer cmd, uint32_t iteration);
+
+		// Swaps the history sets, call once per frame before the passes are declared
+		void Update();
+		void Resize();
+
+		const FrameHistory& GetCurrentHistory() const { return m_History[m_HistoryIndex]; }
+		const FrameHistory& GetPreviousHistory() const { return m_History[m_HistoryIndex ^ 1]; }
+
+		Image& GetIntegrated() { return m_Integrated; }
+		// Variance writes the input of the first wavelet pass, the last one writes the render target instead of its output
+		Image& GetFilterInput(uint32_t iteration) { return iteration % 2 == 0 ? m_PingA : m_PingB; }
+		Image& GetFilterOutput(uint32_t iteration) { return iteration % 2 == 0 ? m_PingB : m_PingA; }
+		Image& GetRenderTarget() { return m_RenderTarget; }
+
+	private:
+		void CreatePipeline();
+		void BuildDescriptors();
+		void UpdateDescriptors();
+		void CreateHistory();
+		void Dispatch(VkCommandBuffer cmd, VkPipeline pipeline, VkPipelineLayout pipelineLayout, uint32_t set, const uDenoiserPass& constants);
+
+		Context& context;
+		const Image& shadingResult;
+		const std::vector<Image>& motionVectors;
+		const std::vector<GBuffer::GBufferMRT>& gbufferMRT;
+
+		std::array<FrameHistory, 2> m_History;
+		uint32_t m_HistoryIndex;
+		bool m_ResetHistory; // history images hold nothing usable, after a resize or while the denoiser was off
+
+		Image& m_Integrated;    // transients, owned by the render graph
+		Image& m_PingA;
+		Image& m_PingB;
+		Image& m_RenderTarget;
+
+		VkPipeline m_TemporalPipeline;
+		VkPipelineLayout m_TemporalPipelineLayout;
+		VkPipeline m_VariancePipeline;
+		VkPipelineLayout m_VariancePipelineLayout;
+		VkPipeline m_FilterPipeline;
+		VkPipelineLayout m_FilterPipelineLayout;
+		VkDescriptorSetLayout m_descriptorSetLayout;
+		VkDescriptorUpdateTemplate m_descriptorTemplate;
+
+		// Six sets per frame in flight, one per history index and stage: temporal and variance, even wavelet
+		// passes, odd wavelet passes
+		std::vector<VkDescriptorSet> m_descriptorSets;
+
+		uDenoiserPass m_PushConstants;
+	};
+}
@@ -0,0 +1,140 @@
+#include "DescriptorWriter.hpp"
+#include "Context.hpp"
+#include "Utils.hpp"
+
+vk::DescriptorWriter& vk::DescriptorWriter::WriteBuffer(uint32_t binding, VkBuffer buffer, VkDescriptorType type, VkDeviceSize range, VkDeviceSize offset)
+{
+	Descriptor descriptor = {};
+	descriptor.buffer = {
+		.buffer = buffer,
+		.offset = offset,
+		.range = range
+	};
+
+	m_entries.push_back({ binding, type });
+	m_descriptors.push_back(descriptor);
+	return *this;
+}
+
+vk::DescriptorWriter& vk::DescriptorWriter::WriteImage(uint32_t binding, VkImageView imageView, VkImageLayout layout, VkDescriptorType type, VkSampler sampler)
+{
+	Descriptor descriptor = {};
+	descriptor.image = {
+		.sampler = sampler,
+		.imageView = imageView,
+		.imageLayout = layout
+	};
+
+	m_entries.push_back({ binding, type });
+	m_descriptors.push_back(descriptor);
+	return *this;
+}
+
+vk::DescriptorWriter& vk::DescriptorWriter::WriteAccelerationStructure(uint32_t binding, VkAccelerationStructureKHR accelerationStructure)
+{
+	Descriptor descriptor = {};
+	descriptor.accelerationStructure = accelerationStructure;
+
+	m_entries.push_back({ binding, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR });
+	m_descriptors.push_back(descriptor);
+	return *this;
+}
+
+void vk::DescriptorWriter::BuildWrites()
+{
+	m_writes.clear();
+	m_accelerationStructures.clear();
+
+	// Reserved up front, the writes point into it
+	m_accelerationStructures.reserve(m_entries.size());
+
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		VkWriteDescriptorSet write{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+		write.dstBinding = m_entries[i].binding;
+		write.dstArrayElement = 0;
+		write.descriptorType = m_entries[i].type;
+		write.descriptorCount = 1;
+
+		switch (m_entries[i].type)
+		{
+		case VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR:
+			m_accelerationStructures.push_back({
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR,
+				.accelerationStructureCount = 1,
+				.pAccelerationStructures = &m_descriptors[i].accelerationStructure
+			});
+			write.pNext = &m_accelerationStructures.back();
+			break;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+			write.pBufferInfo = &m_descriptors[i].buffer;
+			break;
+		default:
+			write.pImageInfo = &m_descriptors[i].image;
+			break;
+		}
+
+		m_writes.push_back(write);
+	}
+}
+
+void vk::DescriptorWriter::Update(Context& context, VkDescriptorSet descriptorSet)
+{
+	BuildWrites();
+	for (auto& write : m_writes)
+		write.dstSet = descriptorSet;
+
+	vkUpdateDescriptorSets(context.device, static_cast<uint32_t>(m_writes.size()), m_writes.data(), 0, nullptr);
+	Clear();
+}
+
+void vk::DescriptorWriter::Update(Context& context, VkDescriptorSet descriptorSet, VkDescriptorUpdateTemplate updateTemplate)
+{
+	vkUpdateDescriptorSetWithTemplate(context.device, descriptorSet, updateTemplate, m_descriptors.data());
+	Clear();
+}
+
+void vk::DescriptorWriter::Push(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set)
+{
+	BuildWrites();
+	vkCmdPushDescriptorSetKHR(cmd, bindPoint, pipelineLayout, set, static_cast<uint32_t>(m_writes.size()), m_writes.data());
+	Clear();
+}
+
+VkDescriptorUpdateTemplate vk::DescriptorWriter::CreateTemplate(Context& context, VkDescriptorSetLayout descriptorSetLayout) const
+{
+	std::vector<VkDescriptorUpdateTemplateEntry> entries;
+	entries.reserve(m_entries.size());
+
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		entries.push_back({
+			.dstBinding = m_entries[i].binding,
+			.dstArrayElement = 0,
+			.descriptorCount = 1,
+			.descriptorType = m_entries[i].type,
+			.offset = i * sizeof(Descriptor),
+			.stride = sizeof(Descriptor)
+		});
+	}
+
+	VkDescriptorUpdateTemplateCreateInfo info{ VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO };
+	info.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+	info.pDescriptorUpdateEntries = entries.data();
+	info.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+	info.descriptorSetLayout = descriptorSetLayout;
+
+	VkDescriptorUpdateTemplate updateTemplate = VK_NULL_HANDLE;
+	VK_CHECK(vkCreateDescriptorUpdateTemplate(context.device, &info, nullptr, &updateTemplate), "Failed to create descriptor update template");
+
+	return updateTemplate;
+}
+
+void vk::DescriptorWriter::Clear()
+{
+	m_entries.clear();
+	m_descriptors.clear();
+}
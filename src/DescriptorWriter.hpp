@@ -0,0 +1,58 @@
+#pragma once
+#include <volk/volk.h>
+#include <vector>
+
+namespace vk
+{
+	class Context;
+
+	// Collects every write of a descriptor set and hands them to the driver in one call
+	// Update flushes them into an allocated set with vkUpdateDescriptorSets, or with an update template when the set is
+	// written with the same bindings again and again, once per frame in flight and on every resize. Push records them
+	// into the command buffer as push descriptors instead, for sets that change every frame and are never allocated.
+	// Every flush clears the writer so it can be filled for the next set
+	class DescriptorWriter
+	{
+	public:
+		DescriptorWriter& WriteBuffer(uint32_t binding, VkBuffer buffer, VkDescriptorType type, VkDeviceSize range = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+		DescriptorWriter& WriteImage(uint32_t binding, VkImageView imageView, VkImageLayout layout, VkDescriptorType type, VkSampler sampler = VK_NULL_HANDLE);
+		DescriptorWriter& WriteAccelerationStructure(uint32_t binding, VkAccelerationStructureKHR accelerationStructure);
+
+		void Update(Context& context, VkDescriptorSet descriptorSet);
+
+		// The writes have to be made in the order of the writer the template was created from
+		void Update(Context& context, VkDescriptorSet descriptorSet, VkDescriptorUpdateTemplate updateTemplate);
+
+		// Into a set whose layout was created with VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR
+		void Push(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set);
+
+		// Template for the writes made so far, which are kept
+		VkDescriptorUpdateTemplate CreateTemplate(Context& context, VkDescriptorSetLayout descriptorSetLayout) const;
+
+		void Clear();
+
+	private:
+		// The template reads these at a fixed stride, one per write
+		union Descriptor
+		{
+			VkDescriptorBufferInfo buffer;
+			VkDescriptorImageInfo image;
+			VkAccelerationStructureKHR accelerationStructure;
+		};
+
+		struct Entry
+		{
+			uint32_t binding;
+			VkDescriptorType type;
+		};
+
+		void BuildWrites();
+
+		std::vector<Entry> m_entries;
+		std::vector<Descriptor> m_descriptors;
+
+		// Built at the flush, once m_descriptors stopped moving
+		std::vector<VkWriteDescriptorSet> m_writes;
+		std::vector<VkWriteDescriptorSetAccelerationStructureKHR> m_accelerationStructures;
+	};
+}
@@ -0,0 +1,82 @@
+#include "Context.hpp"
+#include "DynamicResolution.hpp"
+#include "GPUTimer.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Weight of the newest frame in the smoothed frame time
+	constexpr double FrameTimeSmoothing = 0.2;
+}
+
+vk::DynamicResolution::DynamicResolution(Context& context) :
+	context{ context },
+	m_scale{ 1.0f },
+	m_integral{ 1.0f },
+	m_filteredMilliseconds{ 0.0 }
+{
+	renderExtent = context.extent;
+	renderExtentChanged = false;
+}
+
+void vk::DynamicResolution::Update(const GPUTimer& timer)
+{
+	renderExtentChanged = false;
+
+	// The graphics queue's span, async compute running alongside it is not counted twice
+	const double frameMilliseconds = timer.GetFrameMilliseconds();
+
+	if (frameMilliseconds <= 0.0)
+	{
+		return;
+	}
+
+	m_filteredMilliseconds = m_filteredMilliseconds <= 0.0 ? frameMilliseconds : m_filteredMilliseconds + FrameTimeSmoothing * (frameMilliseconds - m_filteredMilliseconds);
+
+	const float minScale = std::clamp(dynamicResolution.minScale, 0.1f, 1.0f);
+	const float maxScale = std::clamp(dynamicResolution.maxScale, minScale, 1.0f);
+
+	// Disabled renders at the upper bound
+	if (!dynamicResolution.enable)
+	{
+		m_integral = maxScale;
+		ApplyScale(maxScale);
+		return;
+	}
+
+	// Hold the scale while accumulating so the reference image is built at one resolution
+	if (isAccumulating)
+	{
+		return;
+	}
+
+	// GPU time grows with the pixel count, the square of the per axis scale, so the error is taken on the square root
+	// of the time ratio. That makes it roughly the relative scale change needed to hit the target
+	const float error = float(std::sqrt(dynamicResolution.targetMilliseconds / m_filteredMilliseconds)) - 1.0f;
+
+	// Clamping the integral to the bounds stops it winding up while the scale is pinned at either end
+	m_integral = std::clamp(m_integral + dynamicResolution.ki * error, minScale, maxScale);
+	ApplyScale(std::clamp(m_integral + dynamicResolution.kp * error, minScale, maxScale));
+}
+
+void vk::DynamicResolution::Resize()
+{
+	renderExtent = GetRenderExtent(context.extent, m_scale);
+	renderExtentChanged = true;
+}
+
+void vk::DynamicResolution::ApplyScale(float scale)
+{
+	m_scale = scale;
+
+	// The extent is quantised to 16 pixels, small corrections do not reset the temporal history every frame
+	VkExtent2D extent = GetRenderExtent(context.extent, m_scale);
+	if (extent.width != renderExtent.width || extent.height != renderExtent.height)
+	{
+		renderExtent = extent;
+		renderExtentChanged = true;
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <volk/volk.h>
+
+namespace vk
+{
+	class Context;
+	class GPUTimer;
+
+	// Scales the internal render resolution to hold dynamicResolution.targetMilliseconds of GPU time
+	// A PI controller on the collected GPUTimer frame time drives the per axis scale between the configured bounds.
+	// Targets are never reallocated, the passes render into the top left renderExtent and PresentPass upscales it
+	class DynamicResolution
+	{
+	public:
+		explicit DynamicResolution(Context& context);
+
+		// Steps the controller with the last collected frame, call after GPUTimer::Collect and before the passes update
+		void Update(const GPUTimer& timer);
+
+		// Swapchain was recreated, keeps the current scale of the new extent
+		void Resize();
+
+		float GetScale() const { return m_scale; }
+		double GetFilteredMilliseconds() const { return m_filteredMilliseconds; }
+
+	private:
+		void ApplyScale(float scale);
+
+		Context& context;
+		float m_scale;
+		float m_integral;              // integral term, kept in scale units so changing ki does not jump the output
+		double m_filteredMilliseconds; // smoothed GPU frame time, the raw timestamps are too noisy to steer from
+	};
+}
@@ -2,6 +2,8 @@
 #include "Image.hpp"
 #include <glm/glm.hpp>
 #include "Utils.hpp"
+#include <chrono>
+#include <stdexcept>
 
 vk::Engine::Engine()
 {
@@ -9,7 +11,7 @@ vk::Engine::Engine()
 	m_lastFrameTime = 0.0;
 }
 
-bool vk::Engine::Initialize()
+bool vk::Engine::Initialize(uint32_t width, uint32_t height, bool visible)
 {
 	std::cout << "=========================== CONTROLS ===========================================" << std::endl;
 	std::cout << "** Right-Mouse to Activate & Deactivate Camera" << std::endl;
@@ -18,7 +20,7 @@ bool vk::Engine::Initialize()
 	std::cout << "** Use on-screen GUI to Enable and Disable ReSTIR and adjust settings" << std::endl;
 	std::cout << "================================================================================" << std::endl;
 
-	if (m_context.MakeContext(1920, 1080))
+	if (m_context.MakeContext(width, height, visible))
 	{
 		m_isRunning = true;
 	}
@@ -53,6 +55,28 @@ void vk::Engine::Run()
 	Shutdown();
 }
 
+bool vk::Engine::RunRegression(const RegressionSettings& settings)
+{
+	RegressionSuite suite(settings, m_context, *m_Renderer);
+
+	// A fixed time step, nothing in the cases may depend on how fast the frames were
+	deltaTime = 1.0 / 60.0;
+
+	while (m_isRunning && !suite.IsDone())
+	{
+		glfwPollEvents();
+		suite.Update();
+
+		auto start = std::chrono::steady_clock::now();
+		Render();
+		suite.EndFrame(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	bool passed = suite.Finish();
+	Shutdown();
+	return passed;
+}
+
 void vk::Engine::Update(double deltaTime)
 {
 	//m_Renderer->Update(deltaTime);
@@ -62,3 +86,22 @@ void vk::Engine::Render()
 {
 	m_Renderer->Render(deltaTime);
 }
+
+std::vector<std::string> vk::ParseEngineArgs(int argc, char** argv)
+{
+	std::vector<std::string> args;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		auto next = [&]() -> std::string {
+			if (i + 1 >= argc)
+				throw std::runtime_error("Missing value for " + arg);
+			return argv[++i];
+		};
+
+		if (arg == "--frames-in-flight")      MAX_FRAMES_IN_FLIGHT = std::stoi(next());
+		else if (arg == "--no-async-compute") enableAsyncCompute = false;
+		else args.push_back(arg);
+	}
+	return args;
+}
@@ -3,7 +3,10 @@
 #include "Context.hpp"
 #include "Renderer.hpp"
 #include "Camera.hpp"
+#include "RegressionSuite.hpp"
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace vk
 {
@@ -11,8 +14,11 @@ namespace vk
 	{
 	public:
 		Engine();
-		bool Initialize();
+		bool Initialize(uint32_t width = 1920, uint32_t height = 1080, bool visible = true);
 		void Run();
+
+		// Renders the regression cases instead of running interactively, shuts down and returns whether they passed
+		bool RunRegression(const RegressionSettings& settings);
 		void Shutdown();
 
 	private:
@@ -26,4 +32,8 @@ namespace vk
 
 		std::unique_ptr<Renderer> m_Renderer;
 	};
+
+	// Flags every executable takes (--frames-in-flight, --no-async-compute), applied to the globals in Utils.hpp
+	// and removed, the rest is returned for the executable's own parser
+	std::vector<std::string> ParseEngineArgs(int argc, char** argv);
 }
\ No newline at end of file
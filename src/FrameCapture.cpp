@@ -0,0 +1,415 @@
+#include "Context.hpp"
+#include "FrameCapture.hpp"
+
+#include <stb_image_write.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+namespace
+{
+	constexpr const char* captureDirectory = "captures";
+
+	// Every capturable target is R32G32B32A32_SFLOAT
+	constexpr VkDeviceSize texelSize = sizeof(float) * 4;
+
+	const char* SourceName(vk::CaptureSource source)
+	{
+		switch (source)
+		{
+		case vk::CaptureSource::COMPOSITE:
+			return "composite";
+		case vk::CaptureSource::HISTORY:
+			return "history";
+		default:
+			return "shading";
+		}
+	}
+
+	const char* Extension(vk::CaptureFormat format)
+	{
+		switch (format)
+		{
+		case vk::CaptureFormat::EXR:
+			return "exr";
+		case vk::CaptureFormat::PFM:
+			return "pfm";
+		default:
+			return "png";
+		}
+	}
+
+	// Same tone mapping as present_pass.frag, the composite target already has it applied
+	uint8_t ToDisplay(float value, bool toneMap)
+	{
+		value = std::max(value, 0.0f);
+		if (toneMap)
+			value = std::pow(value / (value + 1.0f), 1.0f / 2.2f);
+
+		return static_cast<uint8_t>(std::min(value, 1.0f) * 255.0f + 0.5f);
+	}
+
+	bool WritePNG(const std::string& path, const float* pixels, uint32_t width, uint32_t height, bool toneMap)
+	{
+		std::vector<uint8_t> rgb(size_t(width) * height * 3);
+		for (size_t i = 0; i < size_t(width) * height; i++)
+		{
+			rgb[i * 3 + 0] = ToDisplay(pixels[i * 4 + 0], toneMap);
+			rgb[i * 3 + 1] = ToDisplay(pixels[i * 4 + 1], toneMap);
+			rgb[i * 3 + 2] = ToDisplay(pixels[i * 4 + 2], toneMap);
+		}
+
+		return stbi_write_png(path.c_str(), int(width), int(height), 3, rgb.data(), int(width * 3)) != 0;
+	}
+
+	bool WritePFM(const std::string& path, const float* pixels, uint32_t width, uint32_t height)
+	{
+		FILE* file = std::fopen(path.c_str(), "wb");
+		if (!file)
+			return false;
+
+		std::fprintf(file, "PF\n%u %u\n-1.0\n", width, height);
+
+		// PFM scanlines are stored bottom to top
+		std::vector<float> row(size_t(width) * 3);
+		for (uint32_t y = height; y-- > 0;)
+		{
+			const float* source = pixels + size_t(y) * width * 4;
+			for (uint32_t x = 0; x < width; x++)
+			{
+				row[x * 3 + 0] = source[x * 4 + 0];
+				row[x * 3 + 1] = source[x * 4 + 1];
+				row[x * 3 + 2] = source[x * 4 + 2];
+			}
+			std::fwrite(row.data(), sizeof(float), row.size(), file);
+		}
+
+		return std::fclose(file) == 0;
+	}
+
+	// Single part scanline OpenEXR, uncompressed 32 bit float B, G and R channels (channels are sorted by name)
+	bool WriteEXR(const std::string& path, const float* pixels, uint32_t width, uint32_t height)
+	{
+		std::vector<uint8_t> header;
+		auto bytes = [&](const void* data, size_t size) {
+			const uint8_t* begin = static_cast<const uint8_t*>(data);
+			header.insert(header.end(), begin, begin + size);
+		};
+		auto string = [&](const char* text) { bytes(text, std::strlen(text) + 1); };
+		auto int32 = [&](int32_t value) { bytes(&value, sizeof(value)); };
+		auto float32 = [&](float value) { bytes(&value, sizeof(value)); };
+		auto attribute = [&](const char* name, const char* type, int32_t size) { string(name); string(type); int32(size); };
+
+		const uint8_t magic[] = { 0x76, 0x2f, 0x31, 0x01, 2, 0, 0, 0 };
+		bytes(magic, sizeof(magic));
+
+		// name, pixel type 2 = FLOAT, pLinear + 3 reserved bytes, x and y sampling
+		attribute("channels", "chlist", 3 * 18 + 1);
+		for (const char* channel : { "B", "G", "R" })
+		{
+			string(channel);
+			int32(2);
+			int32(0);
+			int32(1);
+			int32(1);
+		}
+		header.push_back(0);
+
+		attribute("compression", "compression", 1);
+		header.push_back(0);
+
+		const int32_t window[] = { 0, 0, int32_t(width) - 1, int32_t(height) - 1 };
+		attribute("dataWindow", "box2i", sizeof(window));
+		bytes(window, sizeof(window));
+		attribute("displayWindow", "box2i", sizeof(window));
+		bytes(window, sizeof(window));
+
+		attribute("lineOrder", "lineOrder", 1);
+		header.push_back(0);
+
+		attribute("pixelAspectRatio", "float", 4);
+		float32(1.0f);
+		attribute("screenWindowCenter", "v2f", 8);
+		float32(0.0f);
+		float32(0.0f);
+		attribute("screenWindowWidth", "float", 4);
+		float32(1.0f);
+		header.push_back(0);
+
+		// Offset table, one scanline per chunk without compression
+		const uint64_t lineBytes = uint64_t(width) * 3 * sizeof(float);
+		uint64_t offset = header.size() + uint64_t(height) * sizeof(uint64_t);
+		for (uint32_t y = 0; y < height; y++)
+		{
+			bytes(&offset, sizeof(offset));
+			offset += 2 * sizeof(int32_t) + lineBytes;
+		}
+
+		FILE* file = std::fopen(path.c_str(), "wb");
+		if (!file)
+			return false;
+
+		std::fwrite(header.data(), 1, header.size(), file);
+
+		std::vector<float> line(size_t(width) * 3);
+		for (uint32_t y = 0; y < height; y++)
+		{
+			const float* source = pixels + size_t(y) * width * 4;
+			for (uint32_t x = 0; x < width; x++)
+			{
+				line[x] = source[x * 4 + 2];
+				line[width + x] = source[x * 4 + 1];
+				line[width * 2 + x] = source[x * 4 + 0];
+			}
+
+			const int32_t chunk[] = { int32_t(y), int32_t(lineBytes) };
+			std::fwrite(chunk, sizeof(int32_t), 2, file);
+			std::fwrite(line.data(), sizeof(float), line.size(), file);
+		}
+
+		return std::fclose(file) == 0;
+	}
+}
+
+vk::FrameCapture::FrameCapture(Context& context, const Image& shadingResult, const Image& compositeResult, const Image& accumulatedResult) :
+	context{ context },
+	shadingResult{ shadingResult },
+	compositeResult{ compositeResult },
+	accumulatedResult{ accumulatedResult },
+	m_requested{ false },
+	m_pending{ 0 },
+	m_written{ 0 },
+	m_failed{ 0 },
+	m_stalls{ 0 },
+	m_directoryCreated{ false },
+	m_encoders{ std::max(1u, std::thread::hardware_concurrency() / 2) }
+{
+	m_slots.resize(MAX_FRAMES_IN_FLIGHT);
+}
+
+vk::FrameCapture::~FrameCapture()
+{
+	// Files still being written are finished first
+	m_encoders.Wait();
+
+	for (auto& staging : m_staging)
+	{
+		staging->buffer.Destroy(context.device);
+	}
+}
+
+void vk::FrameCapture::Update()
+{
+	PendingCapture& slot = m_slots[currentFrame];
+	slot = {};
+
+	if (m_requested)
+	{
+		slot = m_request;
+		m_requested = false;
+	}
+	else if (ShouldWriteToFile || capture.framesRemaining > 0)
+	{
+		if (capture.framesRemaining > 0)
+			capture.framesRemaining--;
+
+		slot.source = capture.source;
+		slot.format = capture.format;
+	}
+	else
+	{
+		return;
+	}
+
+	if (!m_directoryCreated)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(captureDirectory, error);
+		m_directoryCreated = true;
+	}
+
+	slot.staging = AcquireStaging(VkDeviceSize(renderExtent.width) * renderExtent.height * texelSize);
+	slot.width = renderExtent.width;
+	slot.height = renderExtent.height;
+	slot.frame = frameNumber;
+}
+
+void vk::FrameCapture::Collect()
+{
+	const PendingCapture slot = m_slots[currentFrame];
+	m_slots[currentFrame] = {};
+
+	if (!slot.staging)
+		return;
+
+	// The copy was made visible to the host at the end of the frame, the memory is cached
+	vmaInvalidateAllocation(slot.staging->buffer.allocator, slot.staging->buffer.allocation, 0, VK_WHOLE_SIZE);
+
+	std::string path = slot.path;
+	if (path.empty())
+	{
+		char name[64];
+		std::snprintf(name, sizeof(name), "%s_%06u.%s", SourceName(slot.source), slot.frame, Extension(slot.format));
+		path = (std::filesystem::path(captureDirectory) / name).string();
+	}
+
+	m_pending++;
+	m_encoders.Submit([this, slot, path]() {
+		if (Encode(slot, path))
+		{
+			m_written++;
+		}
+		else
+		{
+			m_failed++;
+			ERROR("Failed to write " + path);
+		}
+
+		m_pending--;
+		Release(*slot.staging);
+	});
+}
+
+void vk::FrameCapture::Copy(VkCommandBuffer cmd)
+{
+#ifdef _DEBUG
+	RenderPassLabel(cmd, "Capture");
+#endif // !DEBUG
+
+	// A swapchain resize between Update and recording only ever shrinks what fits in the staging buffer
+	PendingCapture& slot = m_slots[currentFrame];
+	slot.width = std::min(slot.width, renderExtent.width);
+	slot.height = std::min(slot.height, renderExtent.height);
+
+	// Tightly packed rows of the render extent, the render graph moved the source into TRANSFER_SRC
+	VkBufferImageCopy region = {
+		.bufferOffset = 0,
+		.bufferRowLength = 0,
+		.bufferImageHeight = 0,
+		.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+		.imageOffset = { 0, 0, 0 },
+		.imageExtent = { slot.width, slot.height, 1 }
+	};
+
+	vkCmdCopyImageToBuffer(cmd, GetSource().image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.staging->buffer.buffer, 1, &region);
+
+	// The staging buffer is not part of the render graph, the host reads it once the frame fence has signalled
+	BufferBarrier(
+		cmd,
+		slot.staging->buffer.buffer,
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT
+	);
+
+#ifdef _DEBUG
+	EndRenderPassLabel(cmd);
+#endif // !DEBUG
+}
+
+void vk::FrameCapture::CaptureTo(const std::string& path, CaptureSource source, CaptureFormat format)
+{
+	m_request = {};
+	m_request.source = source;
+	m_request.format = format;
+	m_request.path = path;
+	m_requested = true;
+}
+
+bool vk::FrameCapture::IsIdle() const
+{
+	const bool recorded = std::any_of(m_slots.begin(), m_slots.end(), [](const PendingCapture& slot) { return slot.staging != nullptr; });
+	return !m_requested && !recorded && m_pending.load() == 0;
+}
+
+const vk::Image& vk::FrameCapture::GetSource() const
+{
+	switch (m_slots[currentFrame].source)
+	{
+	case CaptureSource::COMPOSITE:
+		return compositeResult;
+	case CaptureSource::HISTORY:
+		return accumulatedResult;
+	default:
+		return shadingResult;
+	}
+}
+
+// A free buffer large enough for the capture, grown or added to the pool when there is none
+vk::FrameCapture::Staging* vk::FrameCapture::AcquireStaging(VkDeviceSize size)
+{
+	std::unique_lock<std::mutex> lock(m_releaseMutex);
+
+	auto findFree = [&]() -> Staging* {
+		for (auto& staging : m_staging)
+		{
+			if (!staging->busy.load())
+				return staging.get();
+		}
+		return nullptr;
+	};
+
+	Staging* staging = findFree();
+	if (!staging && m_staging.size() < MaxStagingBuffers)
+	{
+		m_staging.push_back(std::make_unique<Staging>());
+		staging = m_staging.back().get();
+	}
+
+	if (!staging)
+	{
+		// Every buffer is queued for encoding, only a long capture on a slow disk gets here
+		m_stalls++;
+		m_released.wait(lock, [&]() { return (staging = findFree()) != nullptr; });
+	}
+
+	staging->busy = true;
+	lock.unlock();
+
+	if (staging->size < size)
+	{
+		staging->buffer.Destroy(context.device);
+		CreateStaging(*staging, size);
+	}
+
+	return staging;
+}
+
+void vk::FrameCapture::CreateStaging(Staging& staging, VkDeviceSize size)
+{
+	// Cached host memory, the encoders read every byte of it
+	staging.buffer = CreateBuffer("CaptureStaging", context, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+	VmaAllocationInfo allocationInfo;
+	vmaGetAllocationInfo(staging.buffer.allocator, staging.buffer.allocation, &allocationInfo);
+	staging.mapped = allocationInfo.pMappedData;
+	staging.size = size;
+}
+
+void vk::FrameCapture::Release(Staging& staging)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_releaseMutex);
+		staging.busy = false;
+	}
+	m_released.notify_one();
+}
+
+bool vk::FrameCapture::Encode(const PendingCapture& capture, const std::string& path)
+{
+	const float* pixels = static_cast<const float*>(capture.staging->mapped);
+
+	switch (capture.format)
+	{
+	case CaptureFormat::EXR:
+		return WriteEXR(path, pixels, capture.width, capture.height);
+	case CaptureFormat::PFM:
+		return WritePFM(path, pixels, capture.width, capture.height);
+	default:
+		return WritePNG(path, pixels, capture.width, capture.height, capture.source != CaptureSource::COMPOSITE);
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <volk/volk.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Buffer.hpp"
+#include "Image.hpp"
+#include "ThreadPool.hpp"
+#include "Utils.hpp"
+
+namespace vk
+{
+	class Context;
+
+	// Copies a render target out of the frame into host memory and writes it to disk without stalling the renderer
+	// The copy is recorded into the frame's command buffer, into a staging buffer taken from a small pool. Once that
+	// frame's fence has been waited on, Collect hands the buffer to a worker that encodes it as PNG, EXR or PFM and
+	// gives the buffer back. The pool grows up to MaxStagingBuffers when the encoders fall behind, only past that
+	// does the next capture wait for one of them
+	class FrameCapture
+	{
+	public:
+		static constexpr uint32_t MaxStagingBuffers = 8;
+
+		FrameCapture(Context& context, const Image& shadingResult, const Image& compositeResult, const Image& accumulatedResult);
+		~FrameCapture();
+
+		// Decides whether this frame is captured and takes a staging buffer for it, call before the passes are declared
+		void Update();
+
+		// Hands the capture recorded into this frame slot to the encoders, call after waiting on the frame fence
+		void Collect();
+
+		void Copy(VkCommandBuffer cmd);
+
+		// Captures the next frame to path, whatever the capture settings are
+		void CaptureTo(const std::string& path, CaptureSource source, CaptureFormat format);
+
+		// Nothing recorded and waiting for its fence or being encoded
+		bool IsIdle() const;
+
+		bool IsCapturing() const { return m_slots[currentFrame].staging != nullptr; }
+		const Image& GetSource() const;
+
+		uint32_t GetPendingCount() const { return m_pending.load(); }
+		uint32_t GetWrittenCount() const { return m_written.load(); }
+		uint32_t GetFailedCount() const { return m_failed.load(); }
+		uint32_t GetStallCount() const { return m_stalls; }
+		uint32_t GetStagingCount() const { return static_cast<uint32_t>(m_staging.size()); }
+
+	private:
+		struct Staging
+		{
+			Buffer buffer;
+			const void* mapped = nullptr;   // persistently mapped
+			VkDeviceSize size = 0;
+			std::atomic<bool> busy = false; // from the copy being recorded until the encoder is done with it
+		};
+
+		// What the frame recorded into a slot copied, so the encoder knows how to read it
+		struct PendingCapture
+		{
+			Staging* staging = nullptr;
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t frame = 0;
+			CaptureSource source = CaptureSource::SHADING;
+			CaptureFormat format = CaptureFormat::PNG;
+			std::string path;               // empty for captures/<source>_<frame>
+		};
+
+		Staging* AcquireStaging(VkDeviceSize size);
+		void CreateStaging(Staging& staging, VkDeviceSize size);
+		void Release(Staging& staging);
+
+		static bool Encode(const PendingCapture& capture, const std::string& path);
+
+		Context& context;
+		const Image& shadingResult;
+		const Image& compositeResult;
+		const Image& accumulatedResult;
+
+		std::vector<std::unique_ptr<Staging>> m_staging;
+		std::vector<PendingCapture> m_slots; // per frame in flight
+		PendingCapture m_request;            // from CaptureTo, taken by the next Update
+		bool m_requested;
+
+		std::mutex m_releaseMutex;
+		std::condition_variable m_released;
+
+		std::atomic<uint32_t> m_pending;
+		std::atomic<uint32_t> m_written;
+		std::atomic<uint32_t> m_failed;
+		uint32_t m_stalls;                   // captures that had to wait for an encoder
+		bool m_directoryCreated;
+
+		ThreadPool m_encoders;
+	};
+}
@@ -6,66 +6,14 @@
 #include "Buffer.hpp"
 #include "RenderPass.hpp"
 #include "Camera.hpp"
+#include "BindlessHeap.hpp"
 
 vk::GBuffer::GBuffer(Context& context, std::shared_ptr<Scene>& scene, std::shared_ptr<Camera>& camera) :
 	context{ context },
 	scene{ scene },
 	camera{ camera }
 {
-	m_GBufferMRT.Albedo = CreateImageTexture2D(
-		"GBuffer_Albedo_RT",
-		context,
-		context.extent.width,
-		context.extent.height,
-		VK_FORMAT_R8G8B8A8_SRGB,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-	m_GBufferMRT.Normal = CreateImageTexture2D(
-		"GBuffer_Normal_RT",
-		context,
-		context.extent.width,
-		context.extent.height,
-		VK_FORMAT_A2R10G10B10_UNORM_PACK32,// VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-	m_GBufferMRT.WorldPositions = CreateImageTexture2D(
-		"GBuffer_WorldPositions_RT",
-		context,
-		context.extent.width,
-		context.extent.height,
-		VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-	m_GBufferMRT.MetallicRoughness = CreateImageTexture2D(
-		"GBuffer_MetRoughness_RT",
-		context,
-		context.extent.width,
-		context.extent.height,
-		VK_FORMAT_R8G8_UNORM,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-	m_GBufferMRT.Depth = CreateImageTexture2D(
-		"GBuffer_Depth_RT",
-		context,
-		context.extent.width,
-		context.extent.height,
-		VK_FORMAT_D32_SFLOAT,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_IMAGE_ASPECT_DEPTH_BIT,
-		1
-	);
+	CreateTargets();
 
 	BuildDescriptors();
 	CreateRenderPass();
@@ -75,18 +23,13 @@ vk::GBuffer::GBuffer(Context& context, std::shared_ptr<Scene>& scene, std::share
 
 vk::GBuffer::~GBuffer()
 {
-	m_GBufferMRT.Albedo.Destroy(context.device);
-	m_GBufferMRT.Normal.Destroy(context.device);
-	m_GBufferMRT.WorldPositions.Destroy(context.device);
-	m_GBufferMRT.MetallicRoughness.Destroy(context.device);
-	m_GBufferMRT.Depth.Destroy(context.device);
+	DestroyTargets();
 
 	vkDestroyPipeline(context.device, m_Pipeline, nullptr);
 	vkDestroyPipelineLayout(context.device, m_PipelineLayout, nullptr);
 	// vkDestroyPipeline(context.device, m_AlphaMaskingPipeline, nullptr);
 	// vkDestroyPipelineLayout(context.device, m_AlphaMaskingPipelineLayout, nullptr);
 
-	vkDestroyFramebuffer(context.device, m_framebuffer, nullptr);
 	vkDestroyRenderPass(context.device, m_renderPass, nullptr);
 
 	if (m_descriptorSetLayout != VK_NULL_HANDLE) {
@@ -94,77 +37,73 @@ vk::GBuffer::~GBuffer()
 	}
 }
 
+// Every frame in flight's copy, the device is idle
 void vk::GBuffer::Resize()
 {
-	uint32_t width = context.extent.width;
-	uint32_t height = context.extent.height;
-
-	vkDestroyFramebuffer(context.device, m_framebuffer, nullptr);
-
-	m_GBufferMRT.Albedo.Destroy(context.device);
-	m_GBufferMRT.Normal.Destroy(context.device);
-	m_GBufferMRT.WorldPositions.Destroy(context.device);
-	m_GBufferMRT.MetallicRoughness.Destroy(context.device);
-	m_GBufferMRT.Depth.Destroy(context.device);
-
-	m_GBufferMRT.Albedo = CreateImageTexture2D(
-		"GBuffer_Albedo_RT",
-		context,
-		context.extent.width,
-		context.extent.height,
-		VK_FORMAT_R8G8B8A8_SRGB,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-	m_GBufferMRT.Normal = CreateImageTexture2D(
-		"GBuffer_Normal_RT",
-		context,
-		context.extent.width,
-		context.extent.height,
-		VK_FORMAT_A2R10G10B10_UNORM_PACK32,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-	m_GBufferMRT.WorldPositions = CreateImageTexture2D(
-		"GBuffer_WorldPositions_RT",
-		context,
-		context.extent.width,
-		context.extent.height,
-		VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-	m_GBufferMRT.MetallicRoughness = CreateImageTexture2D(
-		"GBuffer_MetRoughness_RT",
-		context,
-		context.extent.width,
-		context.extent.height,
-		VK_FORMAT_R8G8_UNORM,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-	m_GBufferMRT.Depth = CreateImageTexture2D(
-		"GBuffer_Depth_RT",
-		context,
-		context.extent.width,
-		context.extent.height,
-		VK_FORMAT_D32_SFLOAT,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_IMAGE_ASPECT_DEPTH_BIT,
-		1
-	);
-
+	DestroyTargets();
+	CreateTargets();
 	CreateFramebuffer();
 }
 
+// One set of targets per frame in flight, so the next frame's G-buffer does not wait for the compute passes
+// still reading this frame's
+void vk::GBuffer::CreateTargets()
+{
+	m_GBufferMRT.resize(MAX_FRAMES_IN_FLIGHT);
+	for (size_t i = 0; i < m_GBufferMRT.size(); i++)
+	{
+		const std::string frame = std::to_string(i);
+
+		m_GBufferMRT[i].WorldPositions = CreateImageTexture2D(
+			"GBuffer_WorldPositions_RT" + frame,
+			context,
+			context.extent.width,
+			context.extent.height,
+			VK_FORMAT_R32G32B32A32_SFLOAT,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			1
+		);
+
+		m_GBufferMRT[i].Surface = CreateImageTexture2D(
+			"GBuffer_Surface_RT" + frame,
+			context,
+			context.extent.width,
+			context.extent.height,
+			VK_FORMAT_R32G32B32A32_UINT,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			1
+		);
+
+		m_GBufferMRT[i].Depth = CreateImageTexture2D(
+			"GBuffer_Depth_RT" + frame,
+			context,
+			context.extent.width,
+			context.extent.height,
+			VK_FORMAT_D32_SFLOAT,
+			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			VK_IMAGE_ASPECT_DEPTH_BIT,
+			1
+		);
+	}
+}
+
+// Framebuffers with them, the vector is kept so the passes holding it see the new images
+void vk::GBuffer::DestroyTargets()
+{
+	for (auto& framebuffer : m_framebuffers)
+		vkDestroyFramebuffer(context.device, framebuffer, nullptr);
+	m_framebuffers.clear();
+
+	for (auto& gbuffer : m_GBufferMRT)
+	{
+		gbuffer.WorldPositions.Destroy(context.device);
+		gbuffer.Surface.Destroy(context.device);
+		gbuffer.Depth.Destroy(context.device);
+	}
+}
+
 void vk::GBuffer::Execute(VkCommandBuffer cmd)
 {
 #ifdef _DEBUG
@@ -174,36 +113,40 @@ void vk::GBuffer::Execute(VkCommandBuffer cmd)
 	VkRenderPassBeginInfo beginInfo = {};
 	beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	beginInfo.renderPass = m_renderPass;
-	beginInfo.framebuffer = m_framebuffer;
-	beginInfo.renderArea.extent = context.extent;
+	beginInfo.framebuffer = m_framebuffers[currentFrame];
+	beginInfo.renderArea.extent = renderExtent; // targets are swapchain sized, only the dynamic resolution sub rectangle is drawn
 
-	VkClearValue clearValues[5];
+	VkClearValue clearValues[3];
 	clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
-	clearValues[1].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
-	clearValues[2].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
-	clearValues[3].color = { {0.0f, 0.0f} };
-	clearValues[4].depthStencil.depth = { 1.0f };
-	beginInfo.clearValueCount = 5;
+	clearValues[1].color.uint32[0] = 0; // zero depth marks background in the packed surface
+	clearValues[1].color.uint32[1] = 0;
+	clearValues[1].color.uint32[2] = 0;
+	clearValues[1].color.uint32[3] = 0;
+	clearValues[2].depthStencil.depth = { 1.0f };
+	beginInfo.clearValueCount = 3;
 	beginInfo.pClearValues = clearValues;
 
 	VkViewport viewport{};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
-	viewport.width = (float)context.extent.width;
-	viewport.height = (float)context.extent.height;
+	viewport.width = (float)renderExtent.width;
+	viewport.height = (float)renderExtent.height;
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
 	vkCmdSetViewport(cmd, 0, 1, &viewport);
 
 	VkRect2D scissor{};
 	scissor.offset = { 0,0 };
-	scissor.extent = { context.extent.width, context.extent.height };
+	scissor.extent = renderExtent;
 	vkCmdSetScissor(cmd, 0, 1, &scissor);
 
 	vkCmdBeginRenderPass(cmd, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
 	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
 	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_descriptorSets[currentFrame], 0, nullptr);
 
+	// Every material texture is reached through the heap, bound once for all meshes
+	context.bindlessHeap->Bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 1);
+
 	scene->DrawGLTF(cmd, m_PipelineLayout);
 
 	vkCmdEndRenderPass(cmd);
@@ -215,53 +158,54 @@ void vk::GBuffer::Execute(VkCommandBuffer cmd)
 
 void vk::GBuffer::CreatePipeline()
 {
-	VkPushConstantRange pushConstantRange = {
-		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-		.offset = 0,
-		.size = sizeof(MeshPushConstants)
-	};
-
-	// G-Buffer for non-alpha material meshes
-	auto gBufferPipelineRes =
-		vk::PipelineBuilder(context, PipelineType::GRAPHICS, VertexBinding::BIND, 0)
-		.AddShader("assets/shaders/default.vert.spv", ShaderType::VERTEX)
-		.AddShader("assets/shaders/gbuffer.frag.spv", ShaderType::FRAGMENT)
-		.SetInputAssembly(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
-		.SetDynamicState({ {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR} })
-		.SetRasterizationState(VK_POLYGON_MODE_FILL, VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE)
-		.SetPipelineLayout({ {m_descriptorSetLayout, materialDescriptorSetLayout} }, pushConstantRange)
-		.SetSampling(VK_SAMPLE_COUNT_1_BIT)
-		.AddBlendAttachmentState()
-		.AddBlendAttachmentState()
-		.AddBlendAttachmentState()
-		.AddBlendAttachmentState()
-		.SetDepthState(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL)
-		.SetRenderPass(m_renderPass)
-		.Build();
-
-	m_Pipeline = gBufferPipelineRes.first;
-	m_PipelineLayout = gBufferPipelineRes.second;
-
-	//// G-Buffer alpha masking
-	//auto gBufferAlphaMaskingPipelineRes =
-	//	vk::PipelineBuilder(context, PipelineType::GRAPHICS, VertexBinding::BIND, 0)
-	//	.AddShader("../Engine/assets/shaders/default.vert.spv", ShaderType::VERTEX)
-	//	.AddShader("../Engine/assets/shaders/gbuffer_alpha.frag.spv", ShaderType::FRAGMENT)
-	//	.SetInputAssembly(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
-	//	.SetDynamicState({ {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR} })
-	//	.SetRasterizationState(VK_POLYGON_MODE_FILL, VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE)
-	//	.SetPipelineLayout({ {m_descriptorSetLayout} }, pushConstantRange)
-	//	.SetSampling(VK_SAMPLE_COUNT_1_BIT)
-	//	.AddBlendAttachmentState()
-	//	.AddBlendAttachmentState()
-	//	.AddBlendAttachmentState()
-	//	.AddBlendAttachmentState()
-	//	.SetDepthState(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL)
-	//	.SetRenderPass(m_renderPass)
-	//	.Build();
-
-	//m_AlphaMaskingPipeline = gBufferAlphaMaskingPipelineRes.first;
-	//m_AlphaMaskingPipelineLayout = gBufferAlphaMaskingPipelineRes.second;
+	// Compiled on a worker thread, the renderer waits for every startup pipeline before the first frame
+	context.pipelineCompiler->Submit([this]() {
+		VkPushConstantRange pushConstantRange = {
+			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+			.offset = 0,
+			.size = sizeof(MeshPushConstants)
+		};
+
+		// G-Buffer for non-alpha material meshes
+		auto gBufferPipelineRes =
+			vk::PipelineBuilder(context, PipelineType::GRAPHICS, VertexBinding::BIND, 0)
+			.AddShader("assets/shaders/default.vert.spv", ShaderType::VERTEX)
+			.AddShader("assets/shaders/gbuffer.frag.spv", ShaderType::FRAGMENT)
+			.SetInputAssembly(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+			.SetDynamicState({ {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR} })
+			.SetRasterizationState(VK_POLYGON_MODE_FILL, VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE)
+			.SetPipelineLayout({ {m_descriptorSetLayout, context.bindlessHeap->GetLayout()} }, pushConstantRange)
+			.SetSampling(VK_SAMPLE_COUNT_1_BIT)
+			.AddBlendAttachmentState()
+			.AddBlendAttachmentState() // Packed surface, integer attachments can't blend
+			.SetDepthState(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL)
+			.SetRenderPass(m_renderPass)
+			.Build();
+
+		m_Pipeline = gBufferPipelineRes.first;
+		m_PipelineLayout = gBufferPipelineRes.second;
+
+		//// G-Buffer alpha masking
+		//auto gBufferAlphaMaskingPipelineRes =
+		//	vk::PipelineBuilder(context, PipelineType::GRAPHICS, VertexBinding::BIND, 0)
+		//	.AddShader("../Engine/assets/shaders/default.vert.spv", ShaderType::VERTEX)
+		//	.AddShader("../Engine/assets/shaders/gbuffer_alpha.frag.spv", ShaderType::FRAGMENT)
+		//	.SetInputAssembly(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+		//	.SetDynamicState({ {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR} })
+		//	.SetRasterizationState(VK_POLYGON_MODE_FILL, VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE)
+		//	.SetPipelineLayout({ {m_descriptorSetLayout} }, pushConstantRange)
+		//	.SetSampling(VK_SAMPLE_COUNT_1_BIT)
+		//	.AddBlendAttachmentState()
+		//	.AddBlendAttachmentState()
+		//	.AddBlendAttachmentState()
+		//	.AddBlendAttachmentState()
+		//	.SetDepthState(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL)
+		//	.SetRenderPass(m_renderPass)
+		//	.Build();
+
+		//m_AlphaMaskingPipeline = gBufferAlphaMaskingPipelineRes.first;
+		//m_AlphaMaskingPipelineLayout = gBufferAlphaMaskingPipelineRes.second;
+	});
 }
 
 void vk::GBuffer::CreateRenderPass()
@@ -269,17 +213,13 @@ void vk::GBuffer::CreateRenderPass()
 	RenderPass builder(context.device, 1);
 
 	m_renderPass = builder
-		.AddAttachment(VK_FORMAT_R8G8B8A8_SRGB, VK_SAMPLE_COUNT_1_BIT, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-		.AddAttachment(VK_FORMAT_A2R10G10B10_UNORM_PACK32, VK_SAMPLE_COUNT_1_BIT, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
 		.AddAttachment(VK_FORMAT_R32G32B32A32_SFLOAT, VK_SAMPLE_COUNT_1_BIT, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-		.AddAttachment(VK_FORMAT_R8G8_UNORM, VK_SAMPLE_COUNT_1_BIT, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+		.AddAttachment(VK_FORMAT_R32G32B32A32_UINT, VK_SAMPLE_COUNT_1_BIT, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
 		.AddAttachment(VK_FORMAT_D32_SFLOAT, VK_SAMPLE_COUNT_1_BIT, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL)
 
 		.AddColorAttachmentRef(0, 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
 		.AddColorAttachmentRef(0, 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-		.AddColorAttachmentRef(0, 2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-		.AddColorAttachmentRef(0, 3, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-		.SetDepthAttachmentRef(0, 4, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
+		.SetDepthAttachmentRef(0, 2, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
 
 		// External -> 0 : Color
 		.AddDependency(VK_SUBPASS_EXTERNAL, 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_DEPENDENCY_BY_REGION_BIT)
@@ -302,25 +242,27 @@ void vk::GBuffer::CreateRenderPass()
 
 void vk::GBuffer::CreateFramebuffer()
 {
-	// Framebuffer
-	std::vector<VkImageView> attachments = {
-		m_GBufferMRT.Albedo.imageView,
-		m_GBufferMRT.Normal.imageView,
-		m_GBufferMRT.WorldPositions.imageView,
-		m_GBufferMRT.MetallicRoughness.imageView,
-		m_GBufferMRT.Depth.imageView
-	};
-	VkFramebufferCreateInfo fbcInfo = {
-		.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
-		.renderPass = m_renderPass,
-		.attachmentCount = static_cast<uint32_t>(attachments.size()),
-		.pAttachments = attachments.data(),
-		.width = context.extent.width,
-		.height = context.extent.height,
-		.layers = 1
-	};
-
-	VK_CHECK(vkCreateFramebuffer(context.device, &fbcInfo, nullptr, &m_framebuffer), "Failed to create Forward pass framebuffer.");
+	// Framebuffer per frame in flight
+	m_framebuffers.resize(m_GBufferMRT.size());
+	for (size_t i = 0; i < m_GBufferMRT.size(); i++)
+	{
+		std::vector<VkImageView> attachments = {
+			m_GBufferMRT[i].WorldPositions.imageView,
+			m_GBufferMRT[i].Surface.imageView,
+			m_GBufferMRT[i].Depth.imageView
+		};
+		VkFramebufferCreateInfo fbcInfo = {
+			.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+			.renderPass = m_renderPass,
+			.attachmentCount = static_cast<uint32_t>(attachments.size()),
+			.pAttachments = attachments.data(),
+			.width = context.extent.width,
+			.height = context.extent.height,
+			.layers = 1
+		};
+
+		VK_CHECK(vkCreateFramebuffer(context.device, &fbcInfo, nullptr, &m_framebuffers[i]), "Failed to create Forward pass framebuffer.");
+	}
 }
 
 void vk::GBuffer::BuildDescriptors()
@@ -16,10 +16,8 @@ namespace vk
 
 		struct GBufferMRT
 		{
-			Image Albedo;
-			Image Normal;
-			Image WorldPositions;
-			Image MetallicRoughness;
+			Image WorldPositions; // sampled by the motion vectors pass
+			Image Surface; // 16 byte packed depth/normal/albedo/metallic/roughness read by the ReSTIR passes, see Surface.glsl
 			Image Depth;
 		};
 
@@ -29,18 +27,22 @@ namespace vk
 		void Update();
 		void Resize();
 
-		GBufferMRT& GetGBufferMRT() { return m_GBufferMRT; }
+		// The copy the frame in flight renders into, and all of them for the passes binding one per descriptor set
+		GBufferMRT& GetGBufferMRT() { return m_GBufferMRT[currentFrame]; }
+		const std::vector<GBufferMRT>& GetGBufferMRTs() const { return m_GBufferMRT; }
 
 	private:
 		void CreatePipeline();
 		void CreateRenderPass();
 		void CreateFramebuffer();
 		void BuildDescriptors();
+		void CreateTargets();
+		void DestroyTargets();
 
-		GBufferMRT m_GBufferMRT;
+		std::vector<GBufferMRT> m_GBufferMRT;
 
 		VkRenderPass m_renderPass;
-		VkFramebuffer m_framebuffer;
+		std::vector<VkFramebuffer> m_framebuffers;
 		VkDescriptorSetLayout m_descriptorSetLayout;
 
 		Context& context;
@@ -203,52 +203,46 @@ void vk::Material::Destroy()
 }
 
 // ======================== Material Manager ========================
-void vk::MaterialManager::Setup(Context& context)
-{
-    CreateDescriptorLayout(context);
-}
-
 void vk::MaterialManager::Destroy(Context& context)
 {
-    for (auto& material : materials)
+    for (auto handle : textureHandles)
     {
-        material.Destroy();
+        context.bindlessHeap->Release(BindlessHeap::Type::TEXTURE, handle);
     }
 
-    vkDestroyDescriptorSetLayout(context.device, vk::materialDescriptorSetLayout, nullptr);
-}
-
-void vk::MaterialManager::CreateDescriptorLayout(Context& context)
-{
-    std::vector<VkDescriptorSetLayoutBinding> bindings = {
-        CreateDescriptorBinding(0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
-        CreateDescriptorBinding(1, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-    };
+    context.bindlessHeap->Release(BindlessHeap::Type::STORAGE_BUFFER, materialBufferHandle);
+    materialBuffer.Destroy(context.device);
 
-    vk::materialDescriptorSetLayout = CreateDescriptorSetLayout(context, bindings);
+    for (auto& material : materials)
+    {
+        material.Destroy();
+    }
 }
 
 void vk::MaterialManager::BuildMaterials(Context& context)
 {
-    materialDescriptorSets.resize(materials.size());
+    std::vector<MaterialHandles> handles(materials.size(), { InvalidBindlessHandle, InvalidBindlessHandle });
 
     for (size_t i = 0; i < materials.size(); i++)
     {
-        AllocateDescriptorSet(context, context.descriptorPool, vk::materialDescriptorSetLayout, 1, materialDescriptorSets[i]);
-
-        // For all textures this current material needs to point to
-        // For each img in textures, create a descriptor image info for the descriptor to point to
-        for (size_t img = 0; img < materials[i].textures.size(); img++) {
+        // Index 0 is albedo, index 1 metallic roughness, the order the loaders fill textures in
+        BindlessHandle* slots[] = { &handles[i].albedo, &handles[i].metallicRoughness };
 
-            VkDescriptorImageInfo imageInfo = {
-                .sampler = repeatSamplerAniso,
-                .imageView = materials[i].textures[img].imageView,
-                .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-            };
+        for (size_t img = 0; img < materials[i].textures.size() && img < std::size(slots); img++) {
 
-            UpdateDescriptorSet(context, static_cast<uint32_t>(img), imageInfo, materialDescriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+            *slots[img] = context.bindlessHeap->AddTexture(materials[i].textures[img].imageView, repeatSamplerAniso);
+            textureHandles.push_back(*slots[img]);
         }
     }
+
+    if (handles.empty())
+    {
+        return;
+    }
+
+    // Unused entries keep invalid handles, no mesh indexes them
+    CreateAndUploadBuffer(context, handles.data(), sizeof(MaterialHandles) * handles.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, materialBuffer);
+    materialBufferHandle = context.bindlessHeap->AddStorageBuffer(materialBuffer.buffer);
 }
 
 void vk::MaterialManager::LoadTexturesForMaterial(uint32_t matIndex, const MeshData& mesh, vk::Context& context)
@@ -8,6 +8,7 @@
 #include <utility>
 #include "Utils.hpp"
 #include "Image.hpp"
+#include "BindlessHeap.hpp"
 
 // TODO:
 // Scene should release the resources of the GLTF
@@ -110,6 +111,13 @@ namespace vk
 	{
 		uint32_t albedoIndex;
 	};
+
+	// Bindless texture handles of a material, what the material buffer holds (shaders/Bindless.glsl)
+	struct MaterialHandles
+	{
+		BindlessHandle albedo;
+		BindlessHandle metallicRoughness;
+	};
 //
 //	struct MaterialHasher
 //	{
@@ -123,19 +131,26 @@ namespace vk
 	struct MaterialManager
 	{
 		// Material has the GPU textures
-		// We just need a descriptor for each material
-		// Each mesh has a unique material index and it can index into descriptor array
-		// to get and bind the correct material descriptor which will have its textures
+		// Their textures go into the bindless heap and every material is one entry of handles in the material buffer
+		// Each mesh has a unique material index it pushes with the draw, nothing is bound per mesh
 		std::vector<Material> materials;
-		std::vector<VkDescriptorSet> materialDescriptorSets;
-		// VkDescriptorSetLayout materialDescriptorSetLayout; // TODO: temp (needs to be discussed where this should go)
+		std::vector<BindlessHandle> textureHandles; // every handle BuildMaterials added, released in Destroy
+		Buffer materialBuffer;
+		BindlessHandle materialBufferHandle = InvalidBindlessHandle;
 
-		void Setup(Context& context); // creates the descriptor set layout by calling the method
 		void Destroy(Context& context);
-		void CreateDescriptorLayout(Context& context); // descriptor set layout for materials
-		void BuildMaterials(Context& context); // creates the materials
+		void BuildMaterials(Context& context); // registers the textures and uploads the material buffer
+
+		// Grows the materials so index count - 1 is valid
+		void Reserve(Context& context, size_t count) {
+
+			while (materials.size() < count)
+			{
+				materials.emplace_back(context);
+			}
+		}
 
-		uint32_t GetNextAvailableIndex() {
+		uint32_t GetNextAvailableIndex(Context& context) {
 
 			for (size_t i = 0; i < materials.size(); i++)
 			{
@@ -145,7 +160,8 @@ namespace vk
 				}
 			}
 
-			return -1;
+			materials.emplace_back(context);
+			return static_cast<uint32_t>(materials.size() - 1);
 		}
 
 		void LoadTexturesForMaterial(uint32_t matIndex, const MeshData& mesh, Context& context);
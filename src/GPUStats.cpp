@@ -0,0 +1,167 @@
+#include "Context.hpp"
+#include "GPUStats.hpp"
+#include "GPUTimer.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+#include <cstddef>
+
+vk::GPUStats::GPUStats(Context& context, size_t historyLength) :
+	context{ context },
+	m_historyLength{ historyLength },
+	m_supported{ false }
+{
+	// The shaders aggregate each counter across the subgroup before a single atomic
+	VkPhysicalDeviceSubgroupProperties subgroupProps = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES
+	};
+
+	VkPhysicalDeviceProperties2 props = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+		.pNext = &subgroupProps
+	};
+	vkGetPhysicalDeviceProperties2(context.pDevice, &props);
+
+	const VkSubgroupFeatureFlags required = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT;
+	m_supported = (subgroupProps.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) != 0 && (subgroupProps.supportedOperations & required) == required;
+	if (!m_supported)
+	{
+		ERROR("GPU counters disabled, compute shaders do not support subgroup arithmetic on this device");
+	}
+
+	// Zeroed so the passes see the counters as disabled until the first BeginFrame
+	const Counters cleared = {};
+
+	m_buffers.resize(MAX_FRAMES_IN_FLIGHT);
+	m_written.resize(MAX_FRAMES_IN_FLIGHT, false);
+	for (auto& buffer : m_buffers)
+	{
+		buffer = CreateBuffer("GPUStats", context, sizeof(Counters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
+		buffer.WriteToBuffer(cleared, sizeof(Counters));
+		vmaFlushAllocation(buffer.allocator, buffer.allocation, 0, VK_WHOLE_SIZE);
+	}
+}
+
+vk::GPUStats::~GPUStats()
+{
+	for (auto& buffer : m_buffers)
+	{
+		buffer.Destroy(context.device);
+	}
+}
+
+void vk::GPUStats::Collect(const GPUTimer& gpuTimer)
+{
+	if (!m_written[currentFrame])
+	{
+		if (!logGPUStats && m_csv.is_open())
+			m_csv.close();
+		return;
+	}
+	m_written[currentFrame] = false;
+
+	Buffer& buffer = m_buffers[currentFrame];
+
+	Counters counters;
+	void* mappedData = nullptr;
+	VK_CHECK(vmaMapMemory(buffer.allocator, buffer.allocation, &mappedData), "Failed to map GPU stats buffer");
+	vmaInvalidateAllocation(buffer.allocator, buffer.allocation, 0, VK_WHOLE_SIZE);
+	std::memcpy(&counters, mappedData, sizeof(Counters));
+	vmaUnmapMemory(buffer.allocator, buffer.allocation);
+
+	Sample sample;
+	sample.frame = counters.frameIndex;
+	sample.gpuMilliseconds = gpuTimer.GetFrameMilliseconds();
+
+	for (uint32_t i = 0; i < PASS_COUNT; i++)
+	{
+		const PassCounters& pass = counters.passes[i];
+		const uint64_t mSum = (uint64_t(pass.mSumHigh) << 32) | pass.mSumLow;
+
+		sample.passes[i].shadowRays = pass.shadowRays;
+		sample.passes[i].invalidReservoirs = pass.invalidReservoirs;
+		sample.passes[i].historyRejections = pass.historyRejections;
+		sample.passes[i].meanM = pass.reservoirs > 0 ? double(mSum) / double(pass.reservoirs) : 0.0;
+		sample.passes[i].maxM = pass.mMax;
+	}
+
+	std::copy(std::begin(counters.candidateHistogram), std::end(counters.candidateHistogram), sample.candidateHistogram.begin());
+
+	m_history.push_back(sample);
+	while (m_history.size() > m_historyLength)
+		m_history.pop_front();
+
+	if (logGPUStats)
+		WriteCSV(sample, gpuTimer);
+	else if (m_csv.is_open())
+		m_csv.close();
+}
+
+void vk::GPUStats::BeginFrame(VkCommandBuffer cmd)
+{
+	Buffer& buffer = m_buffers[currentFrame];
+	const bool enabled = enableGPUStats && m_supported;
+
+	// The header is written from the host, the GPU only clears the counters after it
+	const uint32_t header[2] = { enabled ? 1u : 0u, frameNumber };
+	buffer.WriteToBuffer(header, sizeof(header));
+	vmaFlushAllocation(buffer.allocator, buffer.allocation, 0, sizeof(header));
+
+	m_written[currentFrame] = enabled;
+	if (!enabled)
+		return;
+
+	BufferBarrier(
+		cmd,
+		buffer.buffer,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT
+	);
+
+	vkCmdFillBuffer(cmd, buffer.buffer, offsetof(Counters, passes), sizeof(Counters) - offsetof(Counters, passes), 0);
+
+	BufferBarrier(
+		cmd,
+		buffer.buffer,
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+	);
+}
+
+void vk::GPUStats::WriteCSV(const Sample& sample, const GPUTimer& gpuTimer)
+{
+	if (!m_csv.is_open())
+	{
+		m_csv.open("gpu_stats.csv", std::ios::out | std::ios::trunc);
+		if (!m_csv.is_open())
+		{
+			ERROR("Failed to open gpu_stats.csv, GPU stats logging stopped");
+			logGPUStats = false;
+			return;
+		}
+
+		m_csv << "frame,gpu_ms,CandidatesTemporal_ms";
+		for (const char* name : PassNames)
+		{
+			m_csv << ',' << name << "_ms," << name << "_rays," << name << "_invalid," << name << "_rejected," << name << "_mean_m," << name << "_max_m";
+		}
+		for (uint32_t bin = 0; bin < M_HISTOGRAM_BINS; bin++)
+		{
+			m_csv << ",candidates_m" << bin * M_HISTOGRAM_BIN_WIDTH + 1 << '_' << (bin + 1) * M_HISTOGRAM_BIN_WIDTH;
+		}
+		m_csv << '\n';
+	}
+
+	m_csv << sample.frame << ',' << sample.gpuMilliseconds << ',' << gpuTimer.GetMilliseconds("CandidatesTemporal");
+	for (uint32_t i = 0; i < PASS_COUNT; i++)
+	{
+		const PassSample& pass = sample.passes[i];
+		m_csv << ',' << gpuTimer.GetMilliseconds(PassNames[i]) << ',' << pass.shadowRays << ',' << pass.invalidReservoirs << ','
+			<< pass.historyRejections << ',' << pass.meanM << ',' << pass.maxM;
+	}
+	for (uint32_t count : sample.candidateHistogram)
+	{
+		m_csv << ',' << count;
+	}
+	m_csv << '\n';
+}
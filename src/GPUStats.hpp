@@ -0,0 +1,101 @@
+#pragma once
+#include <volk/volk.h>
+#include <array>
+#include <deque>
+#include <fstream>
+#include <vector>
+#include "Buffer.hpp"
+
+namespace vk
+{
+	class Context;
+	class GPUTimer;
+
+	// Counters written by the ReSTIR compute passes, see shaders/Stats.glsl
+	// One host visible buffer per frame in flight, read back once that frame's fence has been waited on
+	// so the CPU never stalls on the GPU. Collected frames go into a rolling history and optionally a CSV file
+	class GPUStats
+	{
+	public:
+		enum Pass : uint32_t
+		{
+			CANDIDATES = 0,
+			TEMPORAL,
+			SPATIAL,
+			SHADING,
+			PASS_COUNT
+		};
+
+		// Must match STATS_M_BINS and STATS_M_BIN_WIDTH in shaders/Stats.glsl
+		static constexpr uint32_t M_HISTOGRAM_BINS = 16;
+		static constexpr uint32_t M_HISTOGRAM_BIN_WIDTH = 8;
+
+		// Must match PassStats in shaders/Stats.glsl
+		struct PassCounters
+		{
+			uint32_t shadowRays;
+			uint32_t invalidReservoirs;
+			uint32_t historyRejections;
+			uint32_t reservoirs;
+			uint32_t mSumLow;
+			uint32_t mSumHigh;
+			uint32_t mMax;
+			uint32_t pad;
+		};
+
+		// Must match RenderStatsBuffer in shaders/Stats.glsl
+		struct Counters
+		{
+			uint32_t enabled;
+			uint32_t frameIndex;
+			uint32_t pad[2];
+			PassCounters passes[PASS_COUNT];
+			uint32_t candidateHistogram[M_HISTOGRAM_BINS]; // reservoirs per candidate count bin
+		};
+
+		struct PassSample
+		{
+			uint32_t shadowRays = 0;
+			uint32_t invalidReservoirs = 0;
+			uint32_t historyRejections = 0;
+			double meanM = 0.0;
+			uint32_t maxM = 0;
+		};
+
+		struct Sample
+		{
+			uint32_t frame = 0;
+			double gpuMilliseconds = 0.0; // GPUTimer's frame span
+			std::array<PassSample, PASS_COUNT> passes;
+			std::array<uint32_t, M_HISTOGRAM_BINS> candidateHistogram{};
+		};
+
+		static constexpr const char* PassNames[PASS_COUNT] = { "Candidates", "Temporal", "Spatial", "Shading" };
+
+		explicit GPUStats(Context& context, size_t historyLength = 240);
+		~GPUStats();
+
+		// Reads back the counters from the last time this frame slot was used, call after waiting on the frame fence.
+		// The timer must have been collected for the same slot so the CSV rows line up with the pass timings
+		void Collect(const GPUTimer& gpuTimer);
+
+		// Clears this frame's counters, must be recorded before any pass that writes them
+		void BeginFrame(VkCommandBuffer cmd);
+
+		const std::vector<Buffer>& GetBuffers() const { return m_buffers; }
+		const std::deque<Sample>& GetHistory() const { return m_history; }
+		bool IsSupported() const { return m_supported; }
+
+	private:
+		void WriteCSV(const Sample& sample, const GPUTimer& gpuTimer);
+
+		Context& context;
+		size_t m_historyLength;
+		bool m_supported;
+
+		std::vector<Buffer> m_buffers;
+		std::vector<bool> m_written; // whether the frame slot holds counters from an enabled frame
+		std::deque<Sample> m_history;
+		std::ofstream m_csv;
+	};
+}
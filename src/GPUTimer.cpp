@@ -0,0 +1,192 @@
+#include "Context.hpp"
+#include "GPUTimer.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+
+namespace
+{
+	// Ticks past timestampValidBits are undefined, a 64 bit counter keeps them all
+	uint64_t TimestampMask(VkPhysicalDevice device, uint32_t family)
+	{
+		uint32_t familyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, families.data());
+
+		const uint32_t bits = families[family].timestampValidBits;
+		return bits >= 64 ? ~0ull : (1ull << bits) - 1;
+	}
+}
+
+vk::GPUTimer::GPUTimer(Context& context, uint32_t maxScopes) :
+	context{ context },
+	m_maxScopes{ maxScopes },
+	m_frameQuery{ maxScopes * 2 },
+	m_timestampPeriod{ 1.0f },
+	m_graphicsMask{ TimestampMask(context.pDevice, context.graphicsFamilyIndex) },
+	m_computeMask{ TimestampMask(context.pDevice, context.computeFamilyIndex) },
+	m_openScope{ UINT32_MAX },
+	m_frameMilliseconds{ 0.0 },
+	m_graphicsBusyMilliseconds{ 0.0 },
+	m_computeBusyMilliseconds{ 0.0 }
+{
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(context.pDevice, &props);
+	m_timestampPeriod = props.limits.timestampPeriod;
+
+	if (m_graphicsMask == 0)
+		throw std::runtime_error("GPUTimer: the graphics queue family does not support timestamps");
+
+	VkQueryPoolCreateInfo poolInfo = {
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = m_frameQuery + 2
+	};
+
+	m_queryPools.resize(MAX_FRAMES_IN_FLIGHT);
+	m_scopeNames.resize(MAX_FRAMES_IN_FLIGHT);
+	m_scopeAsync.resize(MAX_FRAMES_IN_FLIGHT);
+	m_frameWritten.resize(MAX_FRAMES_IN_FLIGHT, false);
+	for (auto& pool : m_queryPools)
+	{
+		VK_CHECK(vkCreateQueryPool(context.device, &poolInfo, nullptr, &pool), "Failed to create timestamp query pool");
+	}
+}
+
+vk::GPUTimer::~GPUTimer()
+{
+	for (auto& pool : m_queryPools)
+	{
+		vkDestroyQueryPool(context.device, pool, nullptr);
+	}
+}
+
+void vk::GPUTimer::Collect()
+{
+	auto& names = m_scopeNames[currentFrame];
+	if (names.empty() || !m_frameWritten[currentFrame])
+		return;
+
+	// Scopes fill the pool from the front, the frame span has the last two queries
+	std::vector<uint64_t> timestamps(names.size() * 2, 0);
+	uint64_t frame[2] = {};
+	VkResult scopeResult = vkGetQueryPoolResults(
+		context.device,
+		m_queryPools[currentFrame],
+		0, static_cast<uint32_t>(timestamps.size()),
+		timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT
+	);
+	VkResult frameResult = vkGetQueryPoolResults(
+		context.device,
+		m_queryPools[currentFrame],
+		m_frameQuery, 2,
+		sizeof(frame), frame, sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT
+	);
+
+	// VK_NOT_READY keeps the previous results rather than showing zeros
+	if (scopeResult != VK_SUCCESS || frameResult != VK_SUCCESS)
+		return;
+
+	// Masked differences stay correct across a counter wrap
+	auto milliseconds = [&](uint64_t begin, uint64_t end, uint64_t mask) {
+		return double((end - begin) & mask) * m_timestampPeriod * 1e-6;
+	};
+
+	m_results.clear();
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		const bool async = m_scopeAsync[currentFrame][i];
+		const double duration = milliseconds(timestamps[i * 2], timestamps[i * 2 + 1], async ? m_computeMask : m_graphicsMask);
+		m_results.push_back({ names[i], duration, async });
+	}
+
+	// Scopes on one queue, offset from its first one, merged where they overlap
+	auto busyMilliseconds = [&](bool async) {
+		const uint64_t mask = async ? m_computeMask : m_graphicsMask;
+		std::vector<std::pair<double, double>> intervals;
+		uint64_t origin = 0;
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			if (m_scopeAsync[currentFrame][i] != async)
+				continue;
+
+			if (intervals.empty())
+				origin = timestamps[i * 2];
+
+			const double begin = milliseconds(origin, timestamps[i * 2], mask);
+			intervals.push_back({ begin, begin + m_results[i].milliseconds });
+		}
+
+		std::sort(intervals.begin(), intervals.end());
+
+		double busy = 0.0;
+		double covered = 0.0;
+		for (const auto& [begin, end] : intervals)
+		{
+			busy += std::max(0.0, end - std::max(begin, covered));
+			covered = std::max(covered, end);
+		}
+		return busy;
+	};
+
+	m_frameMilliseconds = milliseconds(frame[0], frame[1], m_graphicsMask);
+	m_graphicsBusyMilliseconds = busyMilliseconds(false);
+	m_computeBusyMilliseconds = busyMilliseconds(true);
+}
+
+void vk::GPUTimer::BeginFrame()
+{
+	m_scopeNames[currentFrame].clear();
+	m_scopeAsync[currentFrame].clear();
+	m_frameWritten[currentFrame] = false;
+	m_openScope = UINT32_MAX;
+	vkResetQueryPool(context.device, m_queryPools[currentFrame], 0, m_frameQuery + 2);
+}
+
+void vk::GPUTimer::WriteFrameBegin(VkCommandBuffer cmd)
+{
+	vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPools[currentFrame], m_frameQuery);
+}
+
+void vk::GPUTimer::WriteFrameEnd(VkCommandBuffer cmd)
+{
+	vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPools[currentFrame], m_frameQuery + 1);
+	m_frameWritten[currentFrame] = true;
+}
+
+void vk::GPUTimer::Begin(VkCommandBuffer cmd, const std::string& name, bool async)
+{
+	auto& names = m_scopeNames[currentFrame];
+	if (names.size() >= m_maxScopes || m_openScope != UINT32_MAX)
+	{
+		ERROR("GPUTimer scope '" << name << "' ignored, scopes cannot nest and at most " << m_maxScopes << " are allowed per frame");
+		return;
+	}
+
+	m_openScope = static_cast<uint32_t>(names.size());
+	names.push_back(name);
+	m_scopeAsync[currentFrame].push_back(async);
+	vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPools[currentFrame], m_openScope * 2);
+}
+
+void vk::GPUTimer::End(VkCommandBuffer cmd)
+{
+	if (m_openScope == UINT32_MAX)
+		return;
+
+	vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPools[currentFrame], m_openScope * 2 + 1);
+	m_openScope = UINT32_MAX;
+}
+
+double vk::GPUTimer::GetMilliseconds(const std::string& name) const
+{
+	for (const auto& result : m_results)
+	{
+		if (result.name == name)
+			return result.milliseconds;
+	}
+	return 0.0;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <volk/volk.h>
+#include <string>
+#include <vector>
+
+namespace vk
+{
+	class Context;
+
+	// GPU timestamps around named scopes in the frame's command buffers
+	// One query pool per frame in flight, results are read back once that frame's timeline value has been reached.
+	// Timestamps from different queues are not on a common timeline, so only differences within one queue are
+	// used: each scope on its own, how long each queue was busy and the frame span on the graphics queue, from the
+	// start of the first graphics batch to the end of the last. Ticks are masked to each family's timestampValidBits
+	class GPUTimer
+	{
+	public:
+		struct Result
+		{
+			std::string name;
+			double milliseconds = 0.0;
+			bool async = false; // recorded for the async compute queue
+		};
+
+		explicit GPUTimer(Context& context, uint32_t maxScopes = 32);
+		~GPUTimer();
+
+		// Reads back the results from the last time this frame slot was used, call after waiting on the frame's timeline
+		void Collect();
+
+		// Resets this frame's queries from the host, before any Begin/End is recorded into any of its command buffers
+		void BeginFrame();
+
+		void Begin(VkCommandBuffer cmd, const std::string& name, bool async = false);
+		void End(VkCommandBuffer cmd);
+
+		// Frame span, into the first and the last graphics command buffer of the frame
+		void WriteFrameBegin(VkCommandBuffer cmd);
+		void WriteFrameEnd(VkCommandBuffer cmd);
+
+		// Last collected time for a scope, 0 if it did not run
+		double GetMilliseconds(const std::string& name) const;
+		const std::vector<Result>& GetResults() const { return m_results; }
+
+		// GPU time of the last collected frame, the graphics queue's frame span. Summing the scopes would count
+		// async compute that ran alongside graphics twice
+		double GetFrameMilliseconds() const { return m_frameMilliseconds; }
+
+		// Time each queue had a scope in flight in the last collected frame, the union of its scopes on that
+		// queue's own clock. Compared against the frame span: together above it, the queues overlapped
+		double GetGraphicsBusyMilliseconds() const { return m_graphicsBusyMilliseconds; }
+		double GetComputeBusyMilliseconds() const { return m_computeBusyMilliseconds; }
+
+	private:
+		Context& context;
+		uint32_t m_maxScopes;
+		uint32_t m_frameQuery;   // first of the two frame span queries, after every scope's
+		float m_timestampPeriod; // nanoseconds per tick
+		uint64_t m_graphicsMask; // valid bits of a timestamp on each queue
+		uint64_t m_computeMask;
+
+		std::vector<VkQueryPool> m_queryPools;
+		std::vector<std::vector<std::string>> m_scopeNames; // per frame, scope i uses queries 2i and 2i + 1
+		std::vector<std::vector<bool>> m_scopeAsync;
+		std::vector<bool> m_frameWritten;                   // per frame, both frame span queries were recorded
+		std::vector<Result> m_results;
+		uint32_t m_openScope;
+
+		double m_frameMilliseconds;
+		double m_graphicsBusyMilliseconds;
+		double m_computeBusyMilliseconds;
+	};
+}
@@ -2,6 +2,7 @@
 #include "Pipeline.hpp"
 #include "RenderPass.hpp"
 #include "History.hpp"
+#include "UniformArena.hpp"
 
 vk::History::History(Context& context, const Image& renderedImage) : context{context}, renderedImage{renderedImage}
 {
@@ -9,16 +10,13 @@ vk::History::History(Context& context, const Image& renderedImage) : context{con
 	m_width = context.extent.width;
 	m_height = context.extent.height;
 
-	m_rtxSettingsUBO.resize(MAX_FRAMES_IN_FLIGHT);
-	for (auto& buffer : m_rtxSettingsUBO)
-		buffer = CreateBuffer("HistoryRTXUBO", context, sizeof(RTX), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-
+	// fp32, at 1 / frameIndex an fp16 accumulation stops moving long before 1000 frames. Also the reference of ConvergenceBenchmark
 	m_RenderTarget = CreateImageTexture2D(
 		"History_Accum_RT",
 		context,
 		m_width,
 		m_height,
-		VK_FORMAT_R16G16B16A16_SFLOAT,
+		VK_FORMAT_R32G32B32A32_SFLOAT,
 		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
 		VK_IMAGE_ASPECT_COLOR_BIT,
 		1
@@ -26,7 +24,7 @@ vk::History::History(Context& context, const Image& renderedImage) : context{con
 
 	ExecuteSingleTimeCommands(context, [&](VkCommandBuffer cmd) {
 
-		ImageTransition(cmd, m_RenderTarget.image, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		ImageTransition(cmd, m_RenderTarget.image, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
 
 	});
 
@@ -36,11 +34,6 @@ vk::History::History(Context& context, const Image& renderedImage) : context{con
 
 vk::History::~History()
 {
-	for (auto& buffer : m_rtxSettingsUBO)
-	{
-		buffer.Destroy(context.device);
-	}
-
 	m_RenderTarget.Destroy(context.device);
 	vkDestroyPipeline(context.device, m_pipeline, nullptr);
 	vkDestroyPipelineLayout(context.device, m_pipelineLayout, nullptr);
@@ -66,7 +59,7 @@ void vk::History::Update()
 		rtxSettings.frameIndex = -1;
 	}
 
-	m_rtxSettingsUBO[currentFrame].WriteToBuffer(&rtxSettings, sizeof(RTX));
+	m_rtxSettingsOffset = context.uniformArena->Push(rtxSettings);
 }
 
 void vk::History::Resize()
@@ -81,8 +74,8 @@ void vk::History::Resize()
 		context,
 		m_width,
 		m_height,
-		VK_FORMAT_R16G16B16A16_SFLOAT,
-		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_FORMAT_R32G32B32A32_SFLOAT,
+		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
 		VK_IMAGE_ASPECT_COLOR_BIT,
 		1
 	);
@@ -90,31 +83,30 @@ void vk::History::Resize()
 
 	ExecuteSingleTimeCommands(context, [&](VkCommandBuffer cmd) {
 
-		ImageTransition(cmd, m_RenderTarget.image, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		ImageTransition(cmd, m_RenderTarget.image, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
 
 	});
+}
 
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imgInfo = {
-			.sampler = repeatSampler,
-			.imageView = renderedImage.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL // VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 0, imgInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imgInfo = {
-			.sampler = VK_NULL_HANDLE,
-			.imageView = m_RenderTarget.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_GENERAL
-		};
-
-		UpdateDescriptorSet(context, 1, imgInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-	}
+// Restarts the accumulation, the render graph moves the image into TRANSFER_DST before this
+void vk::History::Clear(VkCommandBuffer cmd)
+{
+	VkClearColorValue clearColor = {};
+	clearColor.float32[0] = 0.0f;
+	clearColor.float32[1] = 0.0f;
+	clearColor.float32[2] = 0.0f;
+	clearColor.float32[3] = 0.0f;
+
+	VkImageSubresourceRange range = {};
+	range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	range.baseMipLevel = 0;
+	range.levelCount = 1;
+	range.baseArrayLayer = 0;
+	range.layerCount = 1;
+
+	vkCmdClearColorImage(cmd, m_RenderTarget.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColor, 1, &range);
+
+	shouldClearBeforeDraw = false;
 }
 
 void vk::History::Execute(VkCommandBuffer cmd)
@@ -124,70 +116,14 @@ void vk::History::Execute(VkCommandBuffer cmd)
 	RenderPassLabel(cmd, "HistoryPass");
 #endif // !DEBUG
 
-
-	if (shouldClearBeforeDraw)
-	{
-		// Transition image to transfer destination layout for clearing
-		ImageTransition(
-			cmd,
-			m_RenderTarget.image,
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			0, // srcAccessMask
-			VK_ACCESS_TRANSFER_WRITE_BIT, // dstAccessMask
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, // srcStageMask (or the previous stage)
-			VK_PIPELINE_STAGE_TRANSFER_BIT // dstStageMask
-		);
-
-		// Clear the image
-		VkClearColorValue clearColor = {};
-		clearColor.float32[0] = 0.0f;
-		clearColor.float32[1] = 0.0f;
-		clearColor.float32[2] = 0.0f;
-		clearColor.float32[3] = 0.0f;
-
-		VkImageSubresourceRange range = {};
-		range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		range.baseMipLevel = 0;
-		range.levelCount = 1;
-		range.baseArrayLayer = 0;
-		range.layerCount = 1;
-
-		vkCmdClearColorImage(cmd, m_RenderTarget.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColor, 1, &range);
-
-	}
-
-	// Transition to general layout for compute pass
-	if (shouldClearBeforeDraw) {
-
-		ImageTransition(
-			cmd,
-			m_RenderTarget.image,
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_GENERAL,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-		);
-
-		shouldClearBeforeDraw = false;
-	}
-	else
-	{
-		// Transition temporal acc image from shader read only to general layout to read and write to it using this compute pass
-		ImageTransition(cmd, m_RenderTarget.image, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-	}
-
 	// Execute horizontal blur
 	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
-	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSets[currentFrame], 0, nullptr);
-	vkCmdDispatch(cmd, m_width / 16, m_height / 16, 1);
-
-	// Transition temporal acc image to shader read only to be used later
-	ImageTransition(cmd, m_RenderTarget.image, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	m_descriptorWriter
+		.WriteImage(0, renderedImage.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, repeatSampler)
+		.WriteImage(1, m_RenderTarget.imageView, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+		.WriteBuffer(2, context.uniformArena->GetBuffer(currentFrame).buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sizeof(RTX), m_rtxSettingsOffset)
+		.Push(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0);
+	vkCmdDispatch(cmd, renderExtent.width / 16, renderExtent.height / 16, 1);
 
 #ifdef _DEBUG
 	EndRenderPassLabel(cmd);
@@ -196,19 +132,20 @@ void vk::History::Execute(VkCommandBuffer cmd)
 
 void vk::History::CreatePipeline()
 {
-	auto pipelineResult = vk::PipelineBuilder(context, PipelineType::COMPUTE, VertexBinding::NONE, 0)
-		.AddShader("assets/shaders/history_compute.comp.spv", ShaderType::COMPUTE)
-		.SetPipelineLayout({ m_descriptorSetLayout })
-		.Build();
-
-	m_pipeline = pipelineResult.first;
-	m_pipelineLayout = pipelineResult.second;
+	// Compiled on a worker thread, the renderer waits for every startup pipeline before the first frame
+	context.pipelineCompiler->Submit([this]() {
+		auto pipelineResult = vk::PipelineBuilder(context, PipelineType::COMPUTE, VertexBinding::NONE, 0)
+			.AddShader("assets/shaders/history_compute.comp.spv", ShaderType::COMPUTE)
+			.SetPipelineLayout({ m_descriptorSetLayout })
+			.Build();
+
+		m_pipeline = pipelineResult.first;
+		m_pipelineLayout = pipelineResult.second;
+	});
 }
 
 void vk::History::BuildDescriptors()
 {
-	m_descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-
 	// Set = 0, binding 0 = rendered scene image
 	std::vector<VkDescriptorSetLayoutBinding> bindings = {
 		CreateDescriptorBinding(0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),
@@ -216,39 +153,6 @@ void vk::History::BuildDescriptors()
 		CreateDescriptorBinding(2, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
 	};
 
-	m_descriptorSetLayout = CreateDescriptorSetLayout(context, bindings);
-
-	AllocateDescriptorSets(context, context.descriptorPool, m_descriptorSetLayout, MAX_FRAMES_IN_FLIGHT, m_descriptorSets);
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imgInfo = {
-			.sampler = repeatSampler,
-			.imageView = renderedImage.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL // VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 0, imgInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imgInfo = {
-			.sampler = VK_NULL_HANDLE,
-			.imageView = m_RenderTarget.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_GENERAL
-		};
-
-		UpdateDescriptorSet(context, 1, imgInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = m_rtxSettingsUBO[i].buffer;
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(RTX);
-		UpdateDescriptorSet(context, 2, bufferInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-	}
+	// Pushed every frame, nothing to allocate or to update on resize and the UBO of the frame in flight is picked while recording
+	m_descriptorSetLayout = CreateDescriptorSetLayout(context, bindings, VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR);
 }
-
@@ -2,6 +2,7 @@
 
 #include <volk/volk.h>
 #include "Image.hpp"
+#include "DescriptorWriter.hpp"
 #include <vector>
 
 namespace vk
@@ -12,6 +13,7 @@ namespace vk
 	public:
 		History(Context& context, const Image& renderedImage);
 		~History();
+		void Clear(VkCommandBuffer cmd);
 		void Execute(VkCommandBuffer cmd);
 		Image& GetRenderTarget() { return m_RenderTarget; }
 
@@ -35,8 +37,8 @@ namespace vk
 
 		VkPipeline m_pipeline;
 		VkPipelineLayout m_pipelineLayout;
-		VkDescriptorSetLayout m_descriptorSetLayout;
-		std::vector<VkDescriptorSet> m_descriptorSets;
-		std::vector<Buffer> m_rtxSettingsUBO;
+		VkDescriptorSetLayout m_descriptorSetLayout; // push descriptors, written while recording
+		DescriptorWriter m_descriptorWriter;
+		uint32_t m_rtxSettingsOffset = 0; // pushed descriptors take the arena offset directly, no dynamic binding needed
 	};
 }
\ No newline at end of file
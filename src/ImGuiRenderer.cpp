@@ -3,6 +3,11 @@
 #include "Camera.hpp"
 #include "RenderPass.hpp"
 #include "ImGuiRenderer.hpp"
+#include "GPUTimer.hpp"
+#include "GPUStats.hpp"
+#include "DynamicResolution.hpp"
+#include "RenderGraph.hpp"
+#include "FrameCapture.hpp"
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_vulkan.h>
@@ -35,18 +40,20 @@ void vk::ImGuiRenderer::Initialize(const Context& context) {
     info.Queue = context.graphicsQueue;
     info.QueueFamily = context.graphicsFamilyIndex;
     info.DescriptorPool = ImGuiRenderer::imGuiDescriptorPool;
-    info.MinImageCount = 3;
-    info.ImageCount = MAX_FRAMES_IN_FLIGHT;
+    // ImGui rotates its vertex buffers over ImageCount frames, it has to cover every frame in flight
+    info.MinImageCount = 2;
+    info.ImageCount = std::max(static_cast<uint32_t>(context.swapchainImages.size()), static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
     info.Subpass = 0;
     info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
     info.RenderPass = context.renderPass;
+    info.PipelineCache = context.pipelineCache;
 
     ImGui_ImplVulkan_Init(&info);
 
     io.Fonts->AddFontDefault();
 }
 
-void vk::ImGuiRenderer::Update(const std::shared_ptr<Scene>& scene, const std::shared_ptr<Camera>& camera)
+void vk::ImGuiRenderer::Update(const std::shared_ptr<Scene>& scene, const std::shared_ptr<Camera>& camera, const GPUTimer& gpuTimer, const GPUStats& gpuStats, const DynamicResolution& dynamicResolutionController, const RenderGraph& renderGraph, const FrameCapture& frameCapture, double frameWaitMilliseconds)
 {
     ImGui_ImplVulkan_NewFrame();
     ImGui_ImplGlfw_NewFrame();
@@ -58,6 +65,9 @@ void vk::ImGuiRenderer::Update(const std::shared_ptr<Scene>& scene, const std::s
         ImVec4(0.76, 0.5, 0.0, 1.0), "FPS: (%.1f FPS), %.3f ms/frame",
         ImGui::GetIO().Framerate, 1000.0f / ImGui::GetIO().Framerate);
 
+    // Time the CPU was blocked on the GPU, fewer frames in flight trade throughput for latency
+    ImGui::Text("CPU wait: %.3f ms, %d frames in flight", frameWaitMilliseconds, MAX_FRAMES_IN_FLIGHT);
+
     // Add camera position
     ImGui::Text("Camera Position: (%.2f, %.2f, %.2f)",
         camera->GetPosition().x,
@@ -88,6 +98,93 @@ void vk::ImGuiRenderer::Update(const std::shared_ptr<Scene>& scene, const std::s
     ImGui::SeparatorText("ReSTIR Settings");
 	ImGui::SliderInt("Candidate M: ", &CandidatesPassData.M, 1, 100);
 	ImGui::SliderInt("Spatial Radius: ", &SpatialPassData.radius, 0, 100);
+    ImGui::Checkbox("Tiled Spatial Reuse", &enableTiledSpatial);
+    ImGui::Checkbox("Fused Candidates + Temporal", &enableFusedTemporal);
+    ImGui::Checkbox("Specialized Pipelines", &enableSpecializedPipelines);
+    ImGui::SetItemTooltip("Bake candidate M and the unbiased toggle into the ReSTIR kernels, each new combination compiles once");
+
+    // Candidate picks and spatial taps, each mode compiles its own permutation
+    const char* samplingModes[] = { "White Noise", "Low Discrepancy" };
+    int sampling = static_cast<int>(samplingMode);
+    if (ImGui::Combo("Sampling", &sampling, samplingModes, IM_ARRAYSIZE(samplingModes)))
+        samplingMode = static_cast<SamplingMode>(sampling);
+    ImGui::SetItemTooltip("Low discrepancy draws candidates from a scrambled Sobol sequence and spatial neighbours from a blue noise rotated Poisson disk");
+
+    // Converged cells draw fewer candidates, disoccluded or noisy ones keep the full count
+    ImGui::Checkbox("Adaptive Candidate M", &enableAdaptiveCandidates);
+    ImGui::SetItemTooltip("Per cell count from temporal history length and luminance variance, needs ReSTIR enabled");
+    if (enableAdaptiveCandidates)
+        ImGui::SliderInt("Min Candidate M", &CandidatesPassData.minM, 1, CandidatesPassData.M);
+
+    // Candidates, temporal and spatial reuse on a reduced reservoir grid, shading still covers every pixel
+    const char* resolutionModes[] = { "Full", "Half", "Checkerboard" };
+    int resolution = static_cast<int>(restirResolution);
+    if (ImGui::Combo("ReSTIR Resolution", &resolution, resolutionModes, IM_ARRAYSIZE(resolutionModes)))
+        restirResolution = static_cast<ReSTIRResolution>(resolution);
+    if (restirResolution != ReSTIRResolution::FULL) {
+        ImGui::Checkbox("Bilateral Upsample", &enableReSTIRUpsample);
+        ImGui::SetItemTooltip("Shade once per reservoir and upsample, otherwise every pixel is shaded with the closest matching reservoir");
+    }
+    if (ImGui::Button("Benchmark Spatial Reuse"))
+    {
+        // Results are printed to the console once every radius has been timed
+        runSpatialBenchmark = true;
+    }
+    if (ImGui::Button("Benchmark Convergence"))
+    {
+        // Accumulates a reference per pose first, the curves go to convergence.csv and a summary to the console
+        runConvergenceBenchmark = true;
+    }
+    ImGui::SetItemTooltip("Equal-time error of RIS and ReSTIR configurations against an accumulated reference");
+
+    // Reservoir reads + writes per pixel each frame: candidates 1 write, temporal 2 reads + 1 write,
+    // spatial 4 reads + 1 write, shading 1 read and the history copy 1 read + 1 write.
+    // The fused kernel keeps the candidate in registers, dropping the candidates write and its read back
+    const bool fused = enableReSTIR && enableFusedTemporal;
+    const glm::vec2 viewport = camera->GetCameraTransform().viewportSize;
+    const VkExtent2D grid = GetReservoirExtent({ uint32_t(viewport.x), uint32_t(viewport.y) }, restirResolution);
+    const double cells = double(grid.width) * grid.height;
+    const double reservoirAccesses = cells * (enableReSTIR ? (fused ? 10.0 : 12.0) : 4.0);
+    ImGui::Text("Estimated reservoir traffic: %.1f MB/frame (RGBA16F images: %.1f MB)",
+        reservoirAccesses * sizeof(PackedReservoir) / 1.0e6,
+        reservoirAccesses * 8.0 / 1.0e6);
+
+    // G-buffer reads per pixel: candidates 1, temporal 2 (pixel + reprojected), spatial 4 (pixel + 3 neighbours), shading 1,
+    // the fused candidates + temporal kernel shares the pixel's surface so it reads 2
+    // 16 byte packed surface against 26 bytes for position, normal, albedo and metallic/roughness.
+    // The byte counts are computed from these access counts, not measured, only the pass times come from the GPU
+    if (ImGui::CollapsingHeader("G-Buffer Traffic (estimated)")) {
+        ImGui::TextDisabled("Estimated from access counts, times are measured");
+        const double pixels = double(viewport.x) * viewport.y;
+        const std::vector<std::pair<const char*, double>> passes = fused ?
+            std::vector<std::pair<const char*, double>>{ {"CandidatesTemporal", 2.0}, {"Spatial", 4.0}, {"Shading", 1.0} } :
+            std::vector<std::pair<const char*, double>>{ {"Candidates", 1.0}, {"Temporal", 2.0}, {"Spatial", 4.0}, {"Shading", 1.0} };
+        for (const auto& [pass, reads] : passes) {
+            // Only shading runs per pixel, the reservoir passes run once per grid cell
+            const double invocations = std::string(pass) == "Shading" ? pixels : cells;
+            ImGui::Text("%-10s ~%6.1f MB/frame (unpacked: ~%6.1f MB) %.3f ms",
+                pass,
+                invocations * reads * 16.0 / 1.0e6,
+                invocations * reads * 26.0 / 1.0e6,
+                gpuTimer.GetMilliseconds(pass));
+        }
+    }
+
+    // Most shadow rays a pixel may trace in each pass. Visibility is stored with the reservoir and reused by later
+    // passes, a sample left unresolved is traced by the next pass with budget and counts as visible if none has any
+    if (ImGui::CollapsingHeader("Shadow Ray Budget")) {
+        ImGui::SliderInt("Candidates Rays", &CandidatesPassData.rayBudget, 0, 1);
+        ImGui::SliderInt("Temporal Rays", &TemporalPassData.rayBudget, 0, 2);
+        ImGui::SliderInt("Spatial Rays", &SpatialPassData.rayBudget, 0, 4);
+        ImGui::SliderInt("Shading Rays", &ShadingPassData.rayBudget, 0, 1);
+    }
+
+    ImGui::Checkbox("Light Tiles", &enableLightTiles);
+    if (enableLightTiles)
+    {
+        ImGui::SliderInt("Light Tile Count: ", &LightTilesPassData.tileCount, 1, MAX_LIGHT_TILES);
+        ImGui::SliderInt("Light Tile Size: ", &LightTilesPassData.tileSize, 1, MAX_LIGHT_TILE_SIZE);
+    }
 
     if (ImGui::CollapsingHeader("Lights")) {
         auto& lights = scene->GetLights();
@@ -101,6 +198,185 @@ void vk::ImGuiRenderer::Update(const std::shared_ptr<Scene>& scene, const std::s
 
     ImGui::Checkbox("Animate Lights: ", &ShouldAnimateLights);
 
+    if (ImGui::CollapsingHeader("GPU Timings")) {
+        double total = 0.0;
+        for (const auto& result : gpuTimer.GetResults()) {
+            ImGui::Text("%-14s %.3f ms%s", result.name.c_str(), result.milliseconds, result.async ? " (async)" : "");
+            total += result.milliseconds;
+        }
+        ImGui::Text("%-14s %.3f ms", "Sum", total);
+        ImGui::Text("%-14s %.3f ms", "Frame", gpuTimer.GetFrameMilliseconds());
+        ImGui::Text("%-14s %zu", "Passes", gpuTimer.GetResults().size());
+        const double frame = std::max(gpuTimer.GetFrameMilliseconds(), 1e-6);
+        ImGui::Text("%-14s %.3f ms, %.0f%% of the frame", "Graphics busy", gpuTimer.GetGraphicsBusyMilliseconds(), 100.0 * gpuTimer.GetGraphicsBusyMilliseconds() / frame);
+        ImGui::Text("%-14s %.3f ms, %.0f%% of the frame", "Compute busy", gpuTimer.GetComputeBusyMilliseconds(), 100.0 * gpuTimer.GetComputeBusyMilliseconds() / frame);
+        ImGui::SetItemTooltip("Each queue on its own clock, the frame is timed on the graphics queue. Above 100%% together, the queues overlapped");
+
+        // Only one of the two paths runs in a frame, so keep the last time seen for each to compare them
+        static double separateMilliseconds = 0.0;
+        static double fusedMilliseconds = 0.0;
+        if (enableReSTIR) {
+            const double candidates = gpuTimer.GetMilliseconds("Candidates");
+            const double temporal = gpuTimer.GetMilliseconds("Temporal");
+            const double candidatesTemporal = gpuTimer.GetMilliseconds("CandidatesTemporal");
+            if (candidates > 0.0 && temporal > 0.0)
+                separateMilliseconds = candidates + temporal;
+            if (candidatesTemporal > 0.0)
+                fusedMilliseconds = candidatesTemporal;
+        }
+
+        ImGui::SeparatorText("Candidates + Temporal");
+        ImGui::Text("Separate: 2 dispatches %.3f ms", separateMilliseconds);
+        ImGui::Text("Fused:    1 dispatch   %.3f ms", fusedMilliseconds);
+
+        // Likewise for the specialised and generic permutations of each ReSTIR kernel
+        const char* restirPasses[] = { "Candidates", "Temporal", "CandidatesTemporal", "Spatial" };
+        static double specializedMilliseconds[IM_ARRAYSIZE(restirPasses)] = {};
+        static double genericMilliseconds[IM_ARRAYSIZE(restirPasses)] = {};
+        ImGui::SeparatorText("Specialized / Generic");
+        for (int i = 0; i < IM_ARRAYSIZE(restirPasses); i++) {
+            const double milliseconds = gpuTimer.GetMilliseconds(restirPasses[i]);
+            if (milliseconds > 0.0)
+                (enableSpecializedPipelines ? specializedMilliseconds : genericMilliseconds)[i] = milliseconds;
+            ImGui::Text("%-18s %.3f ms / %.3f ms", restirPasses[i], specializedMilliseconds[i], genericMilliseconds[i]);
+        }
+    }
+
+    // SVGF between shading and present, meant to hold image quality at a few candidates and one spatial pass
+    if (ImGui::CollapsingHeader("Denoiser")) {
+        ImGui::Checkbox("Enable SVGF", &denoiser.enable);
+        ImGui::SliderInt("A-Trous Iterations", &denoiser.atrousIterations, 1, MAX_ATROUS_ITERATIONS);
+        ImGui::SliderFloat("Colour Alpha", &denoiser.colourAlpha, 0.01f, 1.0f, "%.2f");
+        ImGui::SliderFloat("Moments Alpha", &denoiser.momentsAlpha, 0.01f, 1.0f, "%.2f");
+        ImGui::SliderFloat("Phi Colour", &denoiser.phiColour, 0.1f, 16.0f, "%.1f");
+        ImGui::SliderFloat("Phi Normal", &denoiser.phiNormal, 1.0f, 256.0f, "%.0f");
+        ImGui::SliderFloat("Phi Depth", &denoiser.phiDepth, 0.1f, 8.0f, "%.1f");
+
+        double svgfMilliseconds = 0.0;
+        for (const auto& result : gpuTimer.GetResults()) {
+            if (result.name.rfind("SVGF", 0) == 0)
+                svgfMilliseconds += result.milliseconds;
+        }
+        ImGui::Text("SVGF %.3f ms", svgfMilliseconds);
+    }
+
+    if (ImGui::CollapsingHeader("Render Graph")) {
+        const double allocatedMB = double(renderGraph.GetTransientBytes()) / (1024.0 * 1024.0);
+        const double unaliasedMB = double(renderGraph.GetUnaliasedBytes()) / (1024.0 * 1024.0);
+        ImGui::Text("%u passes, %u culled", renderGraph.GetPassCount(), renderGraph.GetCulledCount());
+        ImGui::Text("%u transient targets in %u allocations", renderGraph.GetTransientCount(), renderGraph.GetAllocationCount());
+        ImGui::Text("%.1f MB instead of %.1f MB, %.1f MB saved by aliasing", allocatedMB, unaliasedMB, unaliasedMB - allocatedMB);
+        ImGui::Checkbox("Async Compute", &enableAsyncCompute);
+        ImGui::SameLine();
+        ImGui::TextDisabled("%zu batches", renderGraph.GetBatches().size());
+        if (ImGui::Button("Dump Render Graph"))
+            dumpRenderGraph = true;
+        ImGui::SameLine();
+        ImGui::TextDisabled("render_graph.txt");
+    }
+
+    // Frames are copied out a frame in flight later and written to captures/ on worker threads
+    if (ImGui::CollapsingHeader("Capture")) {
+        const char* sources[] = { "Shading", "Composite", "History" };
+        int source = static_cast<int>(capture.source);
+        if (ImGui::Combo("Source", &source, sources, IM_ARRAYSIZE(sources)))
+            capture.source = static_cast<CaptureSource>(source);
+
+        const char* formats[] = { "PNG", "EXR (float)", "PFM" };
+        int format = static_cast<int>(capture.format);
+        if (ImGui::Combo("Format", &format, formats, IM_ARRAYSIZE(formats)))
+            capture.format = static_cast<CaptureFormat>(format);
+
+        if (ImGui::Button("Capture Frame"))
+            capture.framesRemaining = 1;
+        ImGui::SameLine();
+        if (ImGui::Button("Capture Sequence"))
+            capture.framesRemaining = capture.sequenceLength;
+        ImGui::SliderInt("Sequence Length", &capture.sequenceLength, 1, 1000);
+        ImGui::Checkbox("Capture Every Frame", &ShouldWriteToFile);
+
+        ImGui::Text("%d frames left, %u encoding, %u written, %u failed", capture.framesRemaining,
+            frameCapture.GetPendingCount(), frameCapture.GetWrittenCount(), frameCapture.GetFailedCount());
+        ImGui::Text("%u staging buffers, %u captures waited for an encoder", frameCapture.GetStagingCount(), frameCapture.GetStallCount());
+    }
+
+    // Internal resolution follows the GPU frame time, the scale is per axis so 0.5 shades a quarter of the pixels
+    if (ImGui::CollapsingHeader("Dynamic Resolution")) {
+        ImGui::Checkbox("Enable Dynamic Resolution", &dynamicResolution.enable);
+        ImGui::SliderFloat("Target GPU ms", &dynamicResolution.targetMilliseconds, 2.0f, 50.0f, "%.1f");
+        ImGui::SliderFloat("Min Scale", &dynamicResolution.minScale, 0.25f, 1.0f, "%.2f");
+        ImGui::SliderFloat("Max Scale", &dynamicResolution.maxScale, 0.25f, 1.0f, "%.2f");
+        ImGui::SliderFloat("Kp", &dynamicResolution.kp, 0.0f, 1.0f, "%.3f");
+        ImGui::SliderFloat("Ki", &dynamicResolution.ki, 0.0f, 0.2f, "%.3f");
+        ImGui::Text("Scale %.3f, render %ux%u of %ux%u, filtered GPU %.3f ms",
+            dynamicResolutionController.GetScale(),
+            renderExtent.width, renderExtent.height,
+            uint32_t(ImGui::GetIO().DisplaySize.x), uint32_t(ImGui::GetIO().DisplaySize.y),
+            dynamicResolutionController.GetFilteredMilliseconds());
+        if (isAccumulating)
+            ImGui::TextDisabled("Scale held while accumulating");
+    }
+
+    if (ImGui::CollapsingHeader("GPU Counters")) {
+        if (!gpuStats.IsSupported())
+            ImGui::TextDisabled("Subgroup arithmetic not supported by this device, counters stay disabled");
+
+        ImGui::Checkbox("Enable GPU Counters", &enableGPUStats);
+        ImGui::Checkbox("Log to CSV", &logGPUStats);
+        ImGui::SetItemTooltip("Appends one row per frame to gpu_stats.csv");
+
+        const auto& history = gpuStats.GetHistory();
+        if (!history.empty()) {
+            const GPUStats::Sample& latest = history.back();
+            ImGui::Text("Frame %u", latest.frame);
+
+            if (ImGui::BeginTable("GPUCounters", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+                ImGui::TableSetupColumn("Pass");
+                ImGui::TableSetupColumn("Rays");
+                ImGui::TableSetupColumn("Invalid");
+                ImGui::TableSetupColumn("Rejected");
+                ImGui::TableSetupColumn("Mean M");
+                ImGui::TableSetupColumn("Max M");
+                ImGui::TableHeadersRow();
+
+                for (uint32_t pass = 0; pass < GPUStats::PASS_COUNT; pass++) {
+                    const GPUStats::PassSample& sample = latest.passes[pass];
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn(); ImGui::TextUnformatted(GPUStats::PassNames[pass]);
+                    ImGui::TableNextColumn(); ImGui::Text("%u", sample.shadowRays);
+                    ImGui::TableNextColumn(); ImGui::Text("%u", sample.invalidReservoirs);
+                    ImGui::TableNextColumn(); ImGui::Text("%u", sample.historyRejections);
+                    ImGui::TableNextColumn(); ImGui::Text("%.2f", sample.meanM);
+                    ImGui::TableNextColumn(); ImGui::Text("%u", sample.maxM);
+                }
+                ImGui::EndTable();
+            }
+
+            std::vector<float> rays;
+            std::vector<float> milliseconds;
+            rays.reserve(history.size());
+            milliseconds.reserve(history.size());
+            for (const auto& sample : history) {
+                uint32_t total = 0;
+                for (const auto& pass : sample.passes)
+                    total += pass.shadowRays;
+                rays.push_back(static_cast<float>(total) / 1000000.0f);
+                milliseconds.push_back(static_cast<float>(sample.gpuMilliseconds));
+            }
+
+            ImGui::PlotLines("Shadow Rays (M)", rays.data(), static_cast<int>(rays.size()), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 60));
+            ImGui::PlotLines("GPU ms", milliseconds.data(), static_cast<int>(milliseconds.size()), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 60));
+
+            // Candidates drawn per reservoir this frame, bins of M_HISTOGRAM_BIN_WIDTH starting at 1
+            std::vector<float> bins(latest.candidateHistogram.begin(), latest.candidateHistogram.end());
+            const std::string label = "Candidate M (bins of " + std::to_string(GPUStats::M_HISTOGRAM_BIN_WIDTH) + ")";
+            ImGui::PlotHistogram(label.c_str(), bins.data(), static_cast<int>(bins.size()), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 60));
+        }
+        else {
+            ImGui::TextDisabled("No samples yet");
+        }
+    }
+
     ImGui::EndChild();
 }
 
@@ -9,6 +9,11 @@ namespace vk
     class Context;
     class Scene;
     class Camera;
+    class GPUTimer;
+    class GPUStats;
+    class DynamicResolution;
+    class RenderGraph;
+    class FrameCapture;
     namespace ImGuiRenderer
     {
         static std::vector<std::function<void()>> ImGuiComponents;
@@ -33,7 +38,7 @@ namespace vk
 
         void Initialize(const Context& context);
         void Shutdown(const Context& context);
-        void Update(const std::shared_ptr<Scene>& scene, const std::shared_ptr<Camera>& camera);
+        void Update(const std::shared_ptr<Scene>& scene, const std::shared_ptr<Camera>& camera, const GPUTimer& gpuTimer, const GPUStats& gpuStats, const DynamicResolution& dynamicResolutionController, const RenderGraph& renderGraph, const FrameCapture& frameCapture, double frameWaitMilliseconds);
         void Render(VkCommandBuffer cmd, const Context& context, uint32_t imageIndex);
 
         inline VkDescriptorPool imGuiDescriptorPool;
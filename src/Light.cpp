@@ -0,0 +1,42 @@
+#include "Light.hpp"
+
+#include <random>
+
+namespace
+{
+	const int LIGHT_GRID_SIZE = 10;
+	const glm::vec3 LIGHT_GRID_START = glm::vec3(-1000.0f, 30.0f, -400.0f);
+	const glm::vec3 LIGHT_GRID_SPACING = glm::vec3(230.0f, 20.0f, 100.0f); // y rises with x, not with z
+}
+
+std::vector<vk::Light> vk::CreateSpotLightGrid(uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+	std::vector<Light> lights;
+	lights.reserve(LIGHT_GRID_SIZE * LIGHT_GRID_SIZE);
+
+	for (int i = 0; i < LIGHT_GRID_SIZE; i++) {
+		for (int j = 0; j < LIGHT_GRID_SIZE; j++) {
+			glm::vec4 position = glm::vec4(
+				LIGHT_GRID_START.x + i * LIGHT_GRID_SPACING.x,
+				LIGHT_GRID_START.y + i * LIGHT_GRID_SPACING.y,
+				LIGHT_GRID_START.z + j * LIGHT_GRID_SPACING.z,
+				1.0f);
+
+			Light light = {};
+			light.Type = LightType::Spot;
+			light.basePosition = position;
+			light.position = position;
+			// One draw per channel in r, g, b order, the order is part of what the seed reproduces
+			float r = dist(rng);
+			float g = dist(rng);
+			float b = dist(rng);
+			light.colour = glm::vec4(r, g, b, 1.0f);
+			lights.push_back(light);
+		}
+	}
+
+	return lights;
+}
@@ -6,6 +6,8 @@
 #include "Buffer.hpp"
 #include "Image.hpp"
 
+#include <vector>
+
 namespace vk
 {
 	enum class LightType
@@ -22,4 +24,10 @@ namespace vk
 		glm::vec4 colour = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
 		glm::mat4 LightSpaceMatrix = glm::mat4(1.0f);
 	};
+
+	// Colours of the spot light grid are drawn from this seed, shared by the GPU renderer and the CPU reference
+	constexpr uint32_t DEFAULT_LIGHT_SEED = 1;
+
+	// 10x10 grid of spot lights over Sponza, the only place the light layout is defined
+	std::vector<Light> CreateSpotLightGrid(uint32_t seed = DEFAULT_LIGHT_SEED);
 }
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "Context.hpp"
+#include "Scene.hpp"
+#include "LightTiles.hpp"
+#include "Pipeline.hpp"
+#include "Utils.hpp"
+#include "Buffer.hpp"
+#include "UniformArena.hpp"
+
+vk::LightTiles::LightTiles(Context& context, std::shared_ptr<Scene>& scene) :
+	context{ context },
+	scene{ scene },
+	m_Pipeline{ VK_NULL_HANDLE },
+	m_PipelineLayout{ VK_NULL_HANDLE },
+	m_descriptorSetLayout{ VK_NULL_HANDLE },
+	m_descriptorTemplate{ VK_NULL_HANDLE }
+{
+	// Sized for the largest tile configuration so the tile count and size can be changed at runtime
+	m_lightTileBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	for (auto& buffer : m_lightTileBuffers)
+		buffer = CreateBuffer("LightTilesSSBO", context, sizeof(LightTileSample) * MAX_LIGHT_TILES * MAX_LIGHT_TILE_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 0, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+
+	BuildDescriptors();
+	CreatePipeline();
+}
+
+vk::LightTiles::~LightTiles()
+{
+	for (auto& buffer : m_lightTileBuffers)
+	{
+		buffer.Destroy(context.device);
+	}
+
+	vkDestroyPipeline(context.device, m_Pipeline, nullptr);
+	vkDestroyPipelineLayout(context.device, m_PipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(context.device, m_descriptorSetLayout, nullptr);
+	vkDestroyDescriptorUpdateTemplate(context.device, m_descriptorTemplate, nullptr);
+}
+
+void vk::LightTiles::Execute(VkCommandBuffer cmd)
+{
+	if (!enableLightTiles)
+		return;
+
+#ifdef _DEBUG
+	RenderPassLabel(cmd, "LightTiles");
+#endif // !DEBUG
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &m_descriptorSets[currentFrame], 1, &m_uniformOffset);
+
+	// 128x1x1 threads per group, one thread per light sample
+	const uint32_t sampleCount = static_cast<uint32_t>(LightTilesPassData.tileCount * LightTilesPassData.tileSize);
+	vkCmdDispatch(cmd, (sampleCount + 127) / 128, 1, 1);
+
+#ifdef _DEBUG
+	EndRenderPassLabel(cmd);
+#endif // !DEBUG
+}
+
+void vk::LightTiles::Update()
+{
+	LightTilesPassData.frameIndex = frameNumber;
+	LightTilesPassData.tileCount = glm::clamp(LightTilesPassData.tileCount, 1, MAX_LIGHT_TILES);
+	LightTilesPassData.tileSize = glm::clamp(LightTilesPassData.tileSize, 1, MAX_LIGHT_TILE_SIZE);
+	m_uniformOffset = context.uniformArena->Push(LightTilesPassData);
+}
+
+void vk::LightTiles::CreatePipeline()
+{
+	// Compiled on a worker thread, the renderer waits for every startup pipeline before the first frame
+	context.pipelineCompiler->Submit([this]() {
+		auto pipelineResult = vk::PipelineBuilder(context, PipelineType::COMPUTE, VertexBinding::NONE, 0)
+			.AddShader("assets/shaders/LightTiles.comp.spv", ShaderType::COMPUTE)
+			.SetPipelineLayout({ {m_descriptorSetLayout} })
+			.Build();
+
+		m_Pipeline = pipelineResult.first;
+		m_PipelineLayout = pipelineResult.second;
+	});
+}
+
+void vk::LightTiles::BuildDescriptors()
+{
+	m_descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+	{
+		std::vector<VkDescriptorSetLayoutBinding> bindings = {
+			CreateDescriptorBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT), // ubo, offset into the uniform arena
+			CreateDescriptorBinding(1, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // Light ubo
+			CreateDescriptorBinding(2, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)  // Light tiles
+		};
+
+		m_descriptorSetLayout = CreateDescriptorSetLayout(context, bindings);
+		AllocateDescriptorSets(context, context.descriptorPool, m_descriptorSetLayout, MAX_FRAMES_IN_FLIGHT, m_descriptorSets);
+	}
+
+	// Every binding of every frame in flight, one templated update per set
+	DescriptorWriter writer;
+	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		writer
+			.WriteBuffer(0, context.uniformArena->GetBuffer(static_cast<uint32_t>(i)).buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, sizeof(uLightTilesPass))
+			.WriteBuffer(1, scene->GetLightsUBO()[i].buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sizeof(LightBuffer))
+			.WriteBuffer(2, m_lightTileBuffers[i].buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+
+		if (m_descriptorTemplate == VK_NULL_HANDLE)
+			m_descriptorTemplate = writer.CreateTemplate(context, m_descriptorSetLayout);
+
+		writer.Update(context, m_descriptorSets[i], m_descriptorTemplate);
+	}
+}
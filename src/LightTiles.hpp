@@ -0,0 +1,42 @@
+#pragma once
+#include <volk/volk.h>
+#include <memory>
+#include <vector>
+#include "Buffer.hpp"
+#include "DescriptorWriter.hpp"
+
+namespace vk
+{
+	class Context;
+	class Scene;
+
+	// Draws K tiles of N light samples from the light power distribution at the start of the frame.
+	// The candidates pass reads one tile per workgroup so its light fetches stay in cache
+	class LightTiles
+	{
+	public:
+		explicit LightTiles(Context& context, std::shared_ptr<Scene>& scene);
+		~LightTiles();
+
+		void Execute(VkCommandBuffer cmd);
+		void Update();
+
+		const std::vector<Buffer>& GetLightTileBuffers() const { return m_lightTileBuffers; }
+
+	private:
+		void CreatePipeline();
+		void BuildDescriptors();
+
+		Context& context;
+		std::shared_ptr<Scene> scene;
+
+		VkPipeline m_Pipeline;
+		VkPipelineLayout m_PipelineLayout;
+		std::vector<VkDescriptorSet> m_descriptorSets;
+		VkDescriptorSetLayout m_descriptorSetLayout;
+		VkDescriptorUpdateTemplate m_descriptorTemplate;
+
+		uint32_t m_uniformOffset = 0; // of this frame's uLightTilesPass in the uniform arena
+		std::vector<Buffer> m_lightTileBuffers;
+	};
+}
@@ -2,35 +2,17 @@
 #include "MotionVectors.hpp"
 #include "Pipeline.hpp"
 #include "RenderPass.hpp"
+#include "UniformArena.hpp"
 #include <memory>
 
-vk::MotionVectors::MotionVectors(Context& context, std::shared_ptr<Camera> camera, Image& GBufferWorldPosition)
-	: context{context}, camera{camera}, GBufferWorldPosition{ GBufferWorldPosition }
+vk::MotionVectors::MotionVectors(Context& context, std::shared_ptr<Camera> camera, const std::vector<GBuffer::GBufferMRT>& gbufferMRT)
+	: context{context}, camera{camera}, gbufferMRT{ gbufferMRT }
 {
 	m_width = context.extent.width;
 	m_height = context.extent.height;
 	m_PreviousCameraTransform = {};
 
-	m_RenderTarget = CreateImageTexture2D(
-		"MotionVectors_RT",
-		context,
-		m_width,
-		m_height,
-		VK_FORMAT_R16G16_SFLOAT,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-
-	// sfloat
-
-	m_previousCameraUB.resize(MAX_FRAMES_IN_FLIGHT);
-	for (auto& buffer : m_previousCameraUB)
-	{
-		buffer = CreateBuffer("PreviousCameraUB", context, sizeof(CameraTransform), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-	}
-
+	CreateTargets();
 	CreateDescriptors();
 	CreateRenderPass();
 	CreateFramebuffer();
@@ -39,59 +21,62 @@ vk::MotionVectors::MotionVectors(Context& context, std::shared_ptr<Camera> camer
 
 vk::MotionVectors::~MotionVectors()
 {
-	for (auto& buffer : m_previousCameraUB)
-	{
-		buffer.Destroy(context.device);
-	}
-	m_RenderTarget.Destroy(context.device);
 	vkDestroyPipeline(context.device, m_Pipeline, nullptr);
 	vkDestroyPipelineLayout(context.device, m_PipelineLayout, nullptr);
 	vkDestroyDescriptorSetLayout(context.device, m_DescriptorSetLayout, nullptr);
-	vkDestroyFramebuffer(context.device, m_Framebuffer, nullptr);
+	DestroyTargets();
 	vkDestroyRenderPass(context.device, m_RenderPass, nullptr);
 }
 
 // @TODO: Make sure to call this right at the end of all passes and not in the Renderers update function
 // To ensure it updates to the previous frames camera transform and doesn't update with the current camera transform.
+// Only kept on the CPU, Execute pushes it into the next frame's uniform arena
 void vk::MotionVectors::Update()
 {
 	m_PreviousCameraTransform = camera->GetCameraTransform();
-	m_previousCameraUB[currentFrame].WriteToBuffer(m_PreviousCameraTransform, sizeof(CameraTransform));
 }
 
+// After the G-buffer was recreated at the new extent
 void vk::MotionVectors::Resize()
 {
-	m_RenderTarget.Destroy(context.device);
-	vkDestroyFramebuffer(context.device, m_Framebuffer, nullptr);
+	DestroyTargets();
 
 	m_width = context.extent.width;
 	m_height = context.extent.height;
 
-	m_RenderTarget = CreateImageTexture2D(
-		"MotionVectors_RT",
-		context,
-		m_width,
-		m_height,
-		VK_FORMAT_R16G16_SFLOAT,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
+	CreateTargets();
 	CreateFramebuffer();
+	UpdateDescriptors();
+}
 
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
+void vk::MotionVectors::CreateTargets()
+{
+	m_RenderTargets.resize(MAX_FRAMES_IN_FLIGHT);
+	for (size_t i = 0; i < m_RenderTargets.size(); i++)
 	{
-		VkDescriptorImageInfo imgInfo = {
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = GBufferWorldPosition.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 0, imgInfo, m_DescriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+		m_RenderTargets[i] = CreateImageTexture2D(
+			"MotionVectors_RT" + std::to_string(i),
+			context,
+			m_width,
+			m_height,
+			VK_FORMAT_R16G16_SFLOAT,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			1
+		);
 	}
 }
 
+void vk::MotionVectors::DestroyTargets()
+{
+	for (auto& framebuffer : m_Framebuffers)
+		vkDestroyFramebuffer(context.device, framebuffer, nullptr);
+	m_Framebuffers.clear();
+
+	for (auto& target : m_RenderTargets)
+		target.Destroy(context.device);
+}
+
 void vk::MotionVectors::Execute(VkCommandBuffer cmd)
 {
 #ifdef _DEBUG
@@ -100,8 +85,8 @@ void vk::MotionVectors::Execute(VkCommandBuffer cmd)
 
 	VkRenderPassBeginInfo rpBegin{ VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
 	rpBegin.renderPass = m_RenderPass;
-	rpBegin.framebuffer = m_Framebuffer;
-	rpBegin.renderArea.extent = { m_width, m_height };
+	rpBegin.framebuffer = m_Framebuffers[currentFrame];
+	rpBegin.renderArea.extent = renderExtent;
 
 	VkClearValue clearValues[1];
 	clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
@@ -111,21 +96,22 @@ void vk::MotionVectors::Execute(VkCommandBuffer cmd)
 	VkViewport viewport{};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
-	viewport.width = (float)m_width;
-	viewport.height = (float)m_height;
+	viewport.width = (float)renderExtent.width;
+	viewport.height = (float)renderExtent.height;
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
 	vkCmdSetViewport(cmd, 0, 1, &viewport);
 
 	VkRect2D scissor{};
 	scissor.offset = { 0,0 };
-	scissor.extent = { m_width, m_height };
+	scissor.extent = renderExtent;
 	vkCmdSetScissor(cmd, 0, 1, &scissor);
 
 	vkCmdBeginRenderPass(cmd, &rpBegin, VK_SUBPASS_CONTENTS_INLINE);
 	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
 
-	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_DescriptorSets[currentFrame], 0, nullptr);
+	const uint32_t previousCameraOffset = context.uniformArena->Push(m_PreviousCameraTransform);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_DescriptorSets[currentFrame], 1, &previousCameraOffset);
 
 	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
 	vkCmdDraw(cmd, 3, 1, 0, 0);
@@ -139,21 +125,24 @@ void vk::MotionVectors::Execute(VkCommandBuffer cmd)
 
 void vk::MotionVectors::CreatePipeline()
 {
-	auto pipelineResult = vk::PipelineBuilder(context, PipelineType::GRAPHICS, VertexBinding::NONE, 0)
-		.AddShader("assets/shaders/fs_tri.vert.spv", ShaderType::VERTEX)
-		.AddShader("assets/shaders/MotionVectors.frag.spv", ShaderType::FRAGMENT)
-		.SetInputAssembly(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
-		.SetDynamicState({ {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR} })
-		.SetRasterizationState(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE)
-		.SetPipelineLayout({ {m_DescriptorSetLayout} })
-		.SetSampling(VK_SAMPLE_COUNT_1_BIT)
-		.AddBlendAttachmentState()
-		.SetDepthState(VK_FALSE, VK_FALSE, VK_COMPARE_OP_LESS_OR_EQUAL)
-		.SetRenderPass(m_RenderPass)
-		.Build();
-
-	m_Pipeline = pipelineResult.first;
-	m_PipelineLayout = pipelineResult.second;
+	// Compiled on a worker thread, the renderer waits for every startup pipeline before the first frame
+	context.pipelineCompiler->Submit([this]() {
+		auto pipelineResult = vk::PipelineBuilder(context, PipelineType::GRAPHICS, VertexBinding::NONE, 0)
+			.AddShader("assets/shaders/fs_tri.vert.spv", ShaderType::VERTEX)
+			.AddShader("assets/shaders/MotionVectors.frag.spv", ShaderType::FRAGMENT)
+			.SetInputAssembly(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+			.SetDynamicState({ {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR} })
+			.SetRasterizationState(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE)
+			.SetPipelineLayout({ {m_DescriptorSetLayout} })
+			.SetSampling(VK_SAMPLE_COUNT_1_BIT)
+			.AddBlendAttachmentState()
+			.SetDepthState(VK_FALSE, VK_FALSE, VK_COMPARE_OP_LESS_OR_EQUAL)
+			.SetRenderPass(m_RenderPass)
+			.Build();
+
+		m_Pipeline = pipelineResult.first;
+		m_PipelineLayout = pipelineResult.second;
+	});
 }
 
 void vk::MotionVectors::CreateRenderPass()
@@ -176,18 +165,22 @@ void vk::MotionVectors::CreateRenderPass()
 
 void vk::MotionVectors::CreateFramebuffer()
 {
-	VkFramebufferCreateInfo fbInfo = {
-
-		.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
-		.renderPass = m_RenderPass,
-		.attachmentCount = 1,
-		.pAttachments = &m_RenderTarget.imageView,
-		.width = m_width,
-		.height = m_height,
-		.layers = 1
-	};
+	m_Framebuffers.resize(m_RenderTargets.size());
+	for (size_t i = 0; i < m_RenderTargets.size(); i++)
+	{
+		VkFramebufferCreateInfo fbInfo = {
+
+			.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+			.renderPass = m_RenderPass,
+			.attachmentCount = 1,
+			.pAttachments = &m_RenderTargets[i].imageView,
+			.width = m_width,
+			.height = m_height,
+			.layers = 1
+		};
 
-	VK_CHECK(vkCreateFramebuffer(context.device, &fbInfo, nullptr, &m_Framebuffer), "Failed to create Framebuffer for Motion Vectors");
+		VK_CHECK(vkCreateFramebuffer(context.device, &fbInfo, nullptr, &m_Framebuffers[i]), "Failed to create Framebuffer for Motion Vectors");
+	}
 }
 
 void vk::MotionVectors::CreateDescriptors()
@@ -197,7 +190,7 @@ void vk::MotionVectors::CreateDescriptors()
 
 		CreateDescriptorBinding(0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
 		CreateDescriptorBinding(1, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT),
-		CreateDescriptorBinding(2, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+		CreateDescriptorBinding(2, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_FRAGMENT_BIT) // previous camera, offset into the uniform arena
 	};
 
 	m_DescriptorSetLayout = CreateDescriptorSetLayout(context, bindings);
@@ -208,16 +201,7 @@ void vk::MotionVectors::CreateDescriptors()
 	// Current frame camera uniform
 	// Previous frame camera uniform
 
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imgInfo = {
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = GBufferWorldPosition.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 0, imgInfo, m_DescriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
+	UpdateDescriptors();
 
 	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
 	{
@@ -232,10 +216,25 @@ void vk::MotionVectors::CreateDescriptors()
 	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
 	{
 		VkDescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = m_previousCameraUB[i].buffer;
+		bufferInfo.buffer = context.uniformArena->GetBuffer(static_cast<uint32_t>(i)).buffer;
 		bufferInfo.offset = 0;
 		bufferInfo.range = sizeof(CameraTransform);
-		UpdateDescriptorSet(context, 2, bufferInfo, m_DescriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+		UpdateDescriptorSet(context, 2, bufferInfo, m_DescriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
 	}
 
 }
+
+// World positions of the frame in flight the set is bound in
+void vk::MotionVectors::UpdateDescriptors()
+{
+	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		VkDescriptorImageInfo imgInfo = {
+			.sampler = clampToEdgeSamplerAniso,
+			.imageView = gbufferMRT[i].WorldPositions.imageView,
+			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+		};
+
+		UpdateDescriptorSet(context, 0, imgInfo, m_DescriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+	}
+}
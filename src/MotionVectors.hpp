@@ -2,6 +2,7 @@
 
 #include <volk/volk.h>
 #include "Image.hpp"
+#include "GBuffer.hpp"
 #include <vector>
 #include <memory>
 
@@ -15,35 +16,39 @@ namespace vk
 	class MotionVectors
 	{
 	public:
-		MotionVectors(Context& context, std::shared_ptr<Camera> camera, Image& GBufferWorldPosition);
+		MotionVectors(Context& context, std::shared_ptr<Camera> camera, const std::vector<GBuffer::GBufferMRT>& gbufferMRT);
 		~MotionVectors();
 		void Update();
 		void Resize();
 		void Execute(VkCommandBuffer cmd);
 
-		Image& GetRenderTarget() { return m_RenderTarget; }
+		// The frame in flight's target, and all of them for the passes binding one per descriptor set
+		Image& GetRenderTarget() { return m_RenderTargets[currentFrame]; }
+		const std::vector<Image>& GetRenderTargets() const { return m_RenderTargets; }
 
 	private:
 		void CreatePipeline();
 		void CreateRenderPass();
+		void CreateTargets();
+		void DestroyTargets();
 		void CreateFramebuffer();
 		void CreateDescriptors();
+		void UpdateDescriptors();
 	private:
 		Context& context;
 		std::shared_ptr<Camera> camera;
-		Image& GBufferWorldPosition;
+		const std::vector<GBuffer::GBufferMRT>& gbufferMRT; // world positions of the same frame in flight are read
+		std::vector<Image> m_RenderTargets; // per frame in flight, like the G-buffer they are computed from
 
 		uint32_t m_width;
 		uint32_t m_height;
-		Image m_RenderTarget;
 
 		VkPipeline m_Pipeline;
 		VkPipelineLayout m_PipelineLayout;
-		VkFramebuffer m_Framebuffer;
+		std::vector<VkFramebuffer> m_Framebuffers;
 		VkRenderPass m_RenderPass;
 		VkDescriptorSetLayout m_DescriptorSetLayout;
 		std::vector<VkDescriptorSet> m_DescriptorSets;
-		std::vector<Buffer> m_previousCameraUB;
 
 		CameraTransform m_PreviousCameraTransform;
 	};
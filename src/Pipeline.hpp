@@ -6,8 +6,11 @@
 #include <optional>
 #include <fstream>
 #include <utility>
+#include <chrono>
 #include "Utils.hpp"
 #include "GLTF.hpp"
+#include "PipelinePermutations.hpp"
+#include "PipelineCompiler.hpp"
 /*
     Pipeline abstraction which allows simpler and easier construction of pipelines
     Improvements:
@@ -72,9 +75,10 @@ namespace vk {
 
             {}
 
-            // Add a shader to the pipeline
-            PipelineBuilder& AddShader(const std::string& shaderPath, ShaderType type) {
+            // Add a shader to the pipeline, constants override the defaults of its layout(constant_id) constants
+            PipelineBuilder& AddShader(const std::string& shaderPath, ShaderType type, const SpecializationConstants& constants = {}) {
                 shaders.push_back({ ShaderTypeToVkShaderStage(type), CreateShaderModule(shaderPath) });
+                specializations.push_back(constants);
                 return *this;
             }
 
@@ -124,8 +128,9 @@ namespace vk {
                 m_pipelineLayout.pSetLayouts = descriptorLayouts.data();
 
                 if (pushConstant.has_value()) {
+                    pushConstantRange = pushConstant.value();
                     m_pipelineLayout.pushConstantRangeCount = 1;
-                    m_pipelineLayout.pPushConstantRanges = &pushConstant.value();
+                    m_pipelineLayout.pPushConstantRanges = &pushConstantRange;
                 }
                 else {
                     m_pipelineLayout.pushConstantRangeCount = 0;
@@ -233,6 +238,8 @@ namespace vk {
             VkRenderPass renderPass = VK_NULL_HANDLE;
             VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
             std::vector<std::pair<VkShaderStageFlagBits, VkShaderModule>> shaders;
+            std::vector<SpecializationConstants> specializations; // one per shader
+            std::vector<VkSpecializationInfo> specializationInfos;
             std::vector<VkDescriptorSetLayout> descriptorLayouts;
             VkPushConstantRange pushConstantRange;
 
@@ -265,16 +272,28 @@ namespace vk {
                 return shaderModule;
             }
 
+            // Stage infos point into specializationInfos, nullptr for shaders without constants
+            const VkSpecializationInfo* GetSpecializationInfo(size_t shaderIndex) {
+                if (specializationInfos.size() != specializations.size()) {
+                    specializationInfos.clear();
+                    for (const auto& constants : specializations)
+                        specializationInfos.push_back(constants.GetInfo());
+                }
+
+                return specializations[shaderIndex].Empty() ? nullptr : &specializationInfos[shaderIndex];
+            }
+
             VkPipeline CreateRayTracingPipeline()
             {
                 std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
 
-                for (const auto& shader : shaders) {
+                for (size_t i = 0; i < shaders.size(); i++) {
                     VkPipelineShaderStageCreateInfo shaderStageInfo{};
                     shaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-                    shaderStageInfo.stage = shader.first;
-                    shaderStageInfo.module = shader.second;
+                    shaderStageInfo.stage = shaders[i].first;
+                    shaderStageInfo.module = shaders[i].second;
                     shaderStageInfo.pName = "main";
+                    shaderStageInfo.pSpecializationInfo = GetSpecializationInfo(i);
                     shaderStages.push_back(shaderStageInfo);
                 }
 
@@ -291,11 +310,13 @@ namespace vk {
 
                 VkPipeline pipeline;
 
+                const auto start = std::chrono::steady_clock::now();
+
                 VK_CHECK(
                     vkCreateRayTracingPipelinesKHR(
                         context.device,
                         VK_NULL_HANDLE,
-                        VK_NULL_HANDLE,
+                        context.pipelineCache,
                         1,
                         &rtPipeline,
                         nullptr,
@@ -303,6 +324,8 @@ namespace vk {
                     )
                 , "Failed to create ray tracing pipeline.");
 
+                RecordBuildTime(start);
+
 
                 for (auto& pair : shaders)
                     vkDestroyShaderModule(context.device, pair.second, nullptr);
@@ -315,12 +338,13 @@ namespace vk {
 
                 std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
 
-                for (const auto& shader : shaders) {
+                for (size_t i = 0; i < shaders.size(); i++) {
                     VkPipelineShaderStageCreateInfo shaderStageInfo{};
                     shaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-                    shaderStageInfo.stage = shader.first;
-                    shaderStageInfo.module = shader.second;
+                    shaderStageInfo.stage = shaders[i].first;
+                    shaderStageInfo.module = shaders[i].second;
                     shaderStageInfo.pName = "main";
+                    shaderStageInfo.pSpecializationInfo = GetSpecializationInfo(i);
                     shaderStages.push_back(shaderStageInfo);
                 }
 
@@ -375,11 +399,15 @@ namespace vk {
                 pipelineInfo.renderPass = renderPass;
                 pipelineInfo.subpass = subpass;
 
+                const auto start = std::chrono::steady_clock::now();
+
                 VkPipeline pipeline;
-                if (vkCreateGraphicsPipelines(context.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+                if (vkCreateGraphicsPipelines(context.device, context.pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
                     throw std::runtime_error("Failed to create graphics pipeline!");
                 }
 
+                RecordBuildTime(start);
+
                 for (auto& pair : shaders)
                     vkDestroyShaderModule(context.device, pair.second, nullptr);
 
@@ -395,6 +423,7 @@ namespace vk {
                 computeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
                 computeShaderStageInfo.module = shaders[0].second;
                 computeShaderStageInfo.pName = "main";
+                computeShaderStageInfo.pSpecializationInfo = GetSpecializationInfo(0);
 
                 VK_CHECK(vkCreatePipelineLayout(context.device, &m_pipelineLayout, nullptr, &pipelineLayout), "Failed to create compute pipeline layout");
 
@@ -403,24 +432,35 @@ namespace vk {
                 computePipelineInfo.stage = computeShaderStageInfo;
                 computePipelineInfo.layout = pipelineLayout;
 
+                const auto start = std::chrono::steady_clock::now();
+
                 VkPipeline pipeline;
-                if (vkCreateComputePipelines(context.device, VK_NULL_HANDLE, 1, &computePipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+                if (vkCreateComputePipelines(context.device, context.pipelineCache, 1, &computePipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
                     throw std::runtime_error("Failed to create compute pipeline!");
                 }
 
+                RecordBuildTime(start);
+
                 for (auto& pair : shaders)
                     vkDestroyShaderModule(context.device, pair.second, nullptr);
 
                 return pipeline;
             }
 
+            // Driver compile time only, shader module creation is not included
+            void RecordBuildTime(std::chrono::steady_clock::time_point start) {
+                context.pipelineMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                context.pipelineCount++;
+            }
+
             // Reference: https://vulkan-tutorial.com/Drawing_a_triangle/Graphics_pipeline_basics/Shader_modules
             std::vector<char> ReadShader(const std::string& filename)
             {
                 std::ifstream file(filename, std::ios::ate | std::ios::binary);
                 if (!file.is_open())
                 {
-                    throw std::runtime_error("Failed to open shader file: " + filename);
+                    // Compiled from src/shaders by the Engine-shaders project, which Engine depends on
+                    throw std::runtime_error("Failed to open shader file: " + filename + ", build the Engine-shaders project to compile it");
                 }
 
                 size_t fileSize = (size_t)file.tellg();
@@ -0,0 +1,44 @@
+#include "PipelineCompiler.hpp"
+
+#include <memory>
+
+vk::PipelineCompiler::PipelineCompiler(uint32_t threadCount) :
+	m_pool{ threadCount }
+{
+}
+
+// packaged_task hands exceptions thrown by the builder to whoever reads the future instead of the worker
+std::shared_future<vk::PipelineCompiler::Pipeline> vk::PipelineCompiler::Compile(std::function<Pipeline()> build)
+{
+	auto task = std::make_shared<std::packaged_task<Pipeline()>>(std::move(build));
+	std::shared_future<Pipeline> future = task->get_future().share();
+
+	m_pool.Submit([task]() { (*task)(); });
+
+	return future;
+}
+
+void vk::PipelineCompiler::Submit(std::function<void()> build)
+{
+	auto task = std::make_shared<std::packaged_task<void()>>(std::move(build));
+	{
+		std::lock_guard<std::mutex> lock(m_submittedMutex);
+		m_submitted.push_back(task->get_future());
+	}
+
+	m_pool.Submit([task]() { (*task)(); });
+}
+
+void vk::PipelineCompiler::Wait()
+{
+	m_pool.Wait();
+
+	std::vector<std::future<void>> submitted;
+	{
+		std::lock_guard<std::mutex> lock(m_submittedMutex);
+		submitted.swap(m_submitted);
+	}
+
+	for (auto& future : submitted)
+		future.get();
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <volk/volk.h>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "ThreadPool.hpp"
+
+namespace vk
+{
+	// Builds pipelines on worker threads, every PipelineBuilder goes through the engine wide pipeline cache
+	// vkCreate*Pipelines and the pipeline cache are internally synchronised, so builds only need their own
+	// builder and can run side by side. Pass constructors queue their pipelines with Submit and the renderer
+	// waits for all of them once every pass has been set up. Permutations picked at runtime use Compile and
+	// keep the previous pipeline bound until the future is ready, see PipelinePermutations
+	class PipelineCompiler
+	{
+	public:
+		using Pipeline = std::pair<VkPipeline, VkPipelineLayout>;
+
+		explicit PipelineCompiler(uint32_t threadCount = 0); // 0 = hardware concurrency
+
+		PipelineCompiler(const PipelineCompiler&) = delete;
+		PipelineCompiler& operator=(const PipelineCompiler&) = delete;
+
+		std::shared_future<Pipeline> Compile(std::function<Pipeline()> build);
+
+		// The build stores its own results, errors are rethrown by Wait
+		void Submit(std::function<void()> build);
+
+		// Blocks until every queued build has finished, the calling thread compiles too while it waits
+		void Wait();
+
+		uint32_t GetThreadCount() const { return m_pool.GetThreadCount(); }
+
+	private:
+		ThreadPool m_pool;
+
+		std::mutex m_submittedMutex;
+		std::vector<std::future<void>> m_submitted;
+	};
+}
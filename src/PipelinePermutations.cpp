@@ -0,0 +1,115 @@
+#include "Context.hpp"
+#include "PipelinePermutations.hpp"
+#include "PipelineCompiler.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+
+vk::SpecializationConstants& vk::SpecializationConstants::Set(uint32_t id, int32_t value)
+{
+	return SetBits(id, std::bit_cast<uint32_t>(value));
+}
+
+vk::SpecializationConstants& vk::SpecializationConstants::Set(uint32_t id, uint32_t value)
+{
+	return SetBits(id, value);
+}
+
+vk::SpecializationConstants& vk::SpecializationConstants::Set(uint32_t id, float value)
+{
+	return SetBits(id, std::bit_cast<uint32_t>(value));
+}
+
+// GLSL bool constants are 32 bit VkBool32 values
+vk::SpecializationConstants& vk::SpecializationConstants::Set(uint32_t id, bool value)
+{
+	return SetBits(id, value ? VK_TRUE : VK_FALSE);
+}
+
+vk::SpecializationConstants& vk::SpecializationConstants::SetBits(uint32_t id, uint32_t bits)
+{
+	auto it = std::lower_bound(m_entries.begin(), m_entries.end(), id, [](const VkSpecializationMapEntry& entry, uint32_t id) {
+		return entry.constantID < id;
+	});
+
+	const size_t index = static_cast<size_t>(it - m_entries.begin());
+
+	if (it != m_entries.end() && it->constantID == id)
+	{
+		m_data[index] = bits;
+		return *this;
+	}
+
+	m_entries.insert(it, { id, 0, sizeof(uint32_t) });
+	m_data.insert(m_data.begin() + index, bits);
+
+	// Inserting moves the values behind it along, offsets follow the sorted order
+	for (size_t i = 0; i < m_entries.size(); i++)
+		m_entries[i].offset = static_cast<uint32_t>(i * sizeof(uint32_t));
+
+	return *this;
+}
+
+VkSpecializationInfo vk::SpecializationConstants::GetInfo() const
+{
+	return {
+		.mapEntryCount = static_cast<uint32_t>(m_entries.size()),
+		.pMapEntries = m_entries.data(),
+		.dataSize = m_data.size() * sizeof(uint32_t),
+		.pData = m_data.data()
+	};
+}
+
+std::string vk::SpecializationConstants::Key() const
+{
+	std::string key;
+	for (size_t i = 0; i < m_entries.size(); i++)
+		key += std::to_string(m_entries[i].constantID) + "=" + std::to_string(m_data[i]) + ";";
+
+	return key;
+}
+
+vk::PipelinePermutations::PipelinePermutations(Context& context) :
+	context{ context }
+{
+}
+
+vk::PipelinePermutations::~PipelinePermutations()
+{
+	// Permutations still compiling are finished first, their handles are owned here too.
+	// A build that threw has nothing to destroy, its exception is logged rather than rethrown out of a destructor
+	for (auto& [key, future] : m_pipelines)
+	{
+		future.wait();
+		try
+		{
+			const Pipeline& pipeline = future.get();
+			vkDestroyPipeline(context.device, pipeline.first, nullptr);
+			vkDestroyPipelineLayout(context.device, pipeline.second, nullptr);
+		}
+		catch (const std::exception& e)
+		{
+			ERROR("Pipeline permutation " << key << " failed to build: " << e.what());
+		}
+	}
+}
+
+const vk::PipelinePermutations::Pipeline* vk::PipelinePermutations::Get(const std::string& shaderPath, const SpecializationConstants& constants, const BuildFunction& build, bool wait)
+{
+	const std::string key = shaderPath + "|" + constants.Key();
+
+	auto it = m_pipelines.find(key);
+	if (it == m_pipelines.end())
+	{
+		// The build runs on a worker thread, it gets its own copies of the function and the constants
+		std::shared_future<Pipeline> future = context.pipelineCompiler->Compile([build, constants]() { return build(constants); });
+		it = m_pipelines.emplace(key, std::move(future)).first;
+	}
+
+	if (!wait && it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return nullptr;
+
+	return &it->second.get();
+}
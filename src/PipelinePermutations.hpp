@@ -0,0 +1,67 @@
+#pragma once
+#include <volk/volk.h>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vk
+{
+	class Context;
+
+	// Values for a shader's layout(constant_id = N) constants, every constant is 32 bits
+	// Entries are kept sorted by id so the same set of values always produces the same key
+	class SpecializationConstants
+	{
+	public:
+		SpecializationConstants& Set(uint32_t id, int32_t value);
+		SpecializationConstants& Set(uint32_t id, uint32_t value);
+		SpecializationConstants& Set(uint32_t id, float value);
+		SpecializationConstants& Set(uint32_t id, bool value);
+
+		bool Empty() const { return m_entries.empty(); }
+
+		// Points into this object, only valid while it is alive and unchanged
+		VkSpecializationInfo GetInfo() const;
+
+		// "id=value;" per constant, empty for the generic variant
+		std::string Key() const;
+
+	private:
+		SpecializationConstants& SetBits(uint32_t id, uint32_t bits);
+
+		std::vector<VkSpecializationMapEntry> m_entries;
+		std::vector<uint32_t> m_data;
+	};
+
+	// Pipelines built from the same shaders with different specialisation constants
+	// Keyed by shader path and constant values, a permutation is queued on the context's PipelineCompiler the
+	// first time it is asked for and kept until the cache is destroyed. Passes keep the permutation they have
+	// bound until the new one has compiled, so switching settings never stalls a frame once something is bound.
+	// Every pipeline has its own layout, passes bind descriptors with the layout of the pipeline they bound
+	class PipelinePermutations
+	{
+	public:
+		using Pipeline = std::pair<VkPipeline, VkPipelineLayout>;
+		using BuildFunction = std::function<Pipeline(const SpecializationConstants&)>;
+
+		explicit PipelinePermutations(Context& context);
+		~PipelinePermutations();
+
+		PipelinePermutations(const PipelinePermutations&) = delete;
+		PipelinePermutations& operator=(const PipelinePermutations&) = delete;
+
+		// nullptr while the permutation is still compiling, unless wait is set
+		const Pipeline* Get(const std::string& shaderPath, const SpecializationConstants& constants, const BuildFunction& build, bool wait);
+
+		size_t Size() const { return m_pipelines.size(); }
+
+	private:
+		Context& context;
+		std::unordered_map<std::string, std::shared_future<Pipeline>> m_pipelines;
+	};
+}
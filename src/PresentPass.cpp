@@ -4,36 +4,26 @@
 #include "Pipeline.hpp"
 #include "Utils.hpp"
 #include "Buffer.hpp"
+#include "UniformArena.hpp"
 #include "RenderPass.hpp"
 #include "ImGuiRenderer.hpp"
 
 
-vk::PresentPass::PresentPass(Context& context, Image& CompositedResult, Image& AccumulationResult) :
+vk::PresentPass::PresentPass(Context& context, Image& CompositedResult, Image& AccumulationResult, Image& DenoisedResult) :
 	context{ context },
 	CompositedResult{ CompositedResult },
 	AccumulationResult{ AccumulationResult },
+	DenoisedResult{ DenoisedResult },
 	m_pipeline { VK_NULL_HANDLE},
 	m_pipelineLayout{ VK_NULL_HANDLE },
 	m_renderType {renderType}
 {
-	m_accumulationUBO.resize(MAX_FRAMES_IN_FLIGHT);
-
-	for (auto& buffer : m_accumulationUBO)
-	{
-		buffer = CreateBuffer("AccumulationUBO", context, sizeof(AccumulationSetting), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-	}
-
 	BuildDescriptors();
 	CreatePipeline();
 }
 
 vk::PresentPass::~PresentPass()
 {
-	for (auto& buffer : m_accumulationUBO)
-	{
-		buffer.Destroy(context.device);
-	}
-
 	vkDestroyPipeline(context.device, m_pipeline, nullptr);
 	vkDestroyPipelineLayout(context.device, m_pipelineLayout, nullptr);
 	vkDestroyDescriptorSetLayout(context.device, m_descriptorSetLayout, nullptr);
@@ -63,11 +53,34 @@ void vk::PresentPass::Resize()
 
 		UpdateDescriptorSet(context, 2, imgInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
 	}
+
+	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		VkDescriptorImageInfo imgInfo = {
+			.sampler = repeatSampler,
+			.imageView = DenoisedResult.imageView,
+			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+		};
+
+		UpdateDescriptorSet(context, 1, imgInfo, m_denoisedDescriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+	}
+
+	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		VkDescriptorImageInfo imgInfo = {
+			.sampler = repeatSampler,
+			.imageView = AccumulationResult.imageView,
+			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+		};
+
+		UpdateDescriptorSet(context, 2, imgInfo, m_denoisedDescriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+	}
 }
 
 void vk::PresentPass::Update()
 {
-	m_accumulationUBO[currentFrame].WriteToBuffer(accumulationSetting, sizeof(AccumulationSetting));
+	accumulationSetting.renderExtent = glm::vec2(renderExtent.width, renderExtent.height);
+	m_accumulationOffset = context.uniformArena->Push(accumulationSetting);
 }
 
 void vk::PresentPass::Execute(VkCommandBuffer cmd, uint32_t imageIndex)
@@ -104,7 +117,9 @@ void vk::PresentPass::Execute(VkCommandBuffer cmd, uint32_t imageIndex)
 
 	vkCmdBeginRenderPass(cmd, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
 	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
-	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSets[currentFrame], 0, nullptr);
+	// The denoised target only holds this frame when the denoiser ran, otherwise present the shading result
+	VkDescriptorSet descriptorSet = denoiser.enable ? m_denoisedDescriptorSets[currentFrame] : m_descriptorSets[currentFrame];
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &descriptorSet, 1, &m_accumulationOffset);
 
 	// Draw large triangle here
 	vkCmdDraw(cmd, 3, 1, 0, 0);
@@ -120,32 +135,35 @@ void vk::PresentPass::Execute(VkCommandBuffer cmd, uint32_t imageIndex)
 
 void vk::PresentPass::CreatePipeline()
 {
-
-	// Create the pipeline
-	auto pipelineResult = vk::PipelineBuilder(context, PipelineType::GRAPHICS, VertexBinding::NONE, 0)
-		.AddShader("assets/shaders/fs_tri.vert.spv", ShaderType::VERTEX)
-		.AddShader("assets/shaders/present_pass.frag.spv", ShaderType::FRAGMENT)
-		.SetInputAssembly(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
-		.SetDynamicState({ {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR} })
-		.SetRasterizationState(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE)
-		.SetPipelineLayout({ {m_descriptorSetLayout} })
-		.SetSampling(VK_SAMPLE_COUNT_1_BIT)
-		.AddBlendAttachmentState()
-		.SetDepthState(VK_FALSE, VK_FALSE, VK_COMPARE_OP_LESS_OR_EQUAL) // Turn depth read and write OFF ========
-		.SetRenderPass(context.renderPass)
-		.Build();
-
-	m_pipeline = pipelineResult.first;
-	m_pipelineLayout = pipelineResult.second;
+	// Compiled on a worker thread, the renderer waits for every startup pipeline before the first frame
+	context.pipelineCompiler->Submit([this]() {
+		// Create the pipeline
+		auto pipelineResult = vk::PipelineBuilder(context, PipelineType::GRAPHICS, VertexBinding::NONE, 0)
+			.AddShader("assets/shaders/fs_tri.vert.spv", ShaderType::VERTEX)
+			.AddShader("assets/shaders/present_pass.frag.spv", ShaderType::FRAGMENT)
+			.SetInputAssembly(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+			.SetDynamicState({ {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR} })
+			.SetRasterizationState(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE)
+			.SetPipelineLayout({ {m_descriptorSetLayout} })
+			.SetSampling(VK_SAMPLE_COUNT_1_BIT)
+			.AddBlendAttachmentState()
+			.SetDepthState(VK_FALSE, VK_FALSE, VK_COMPARE_OP_LESS_OR_EQUAL) // Turn depth read and write OFF ========
+			.SetRenderPass(context.renderPass)
+			.Build();
+
+		m_pipeline = pipelineResult.first;
+		m_pipelineLayout = pipelineResult.second;
+	});
 }
 
 void vk::PresentPass::BuildDescriptors()
 {
 	m_descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+	m_denoisedDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
 
 	// Set = 0, binding 0 = rendered scene image
 	std::vector<VkDescriptorSetLayoutBinding> bindings = {
-		CreateDescriptorBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT),
+		CreateDescriptorBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_FRAGMENT_BIT), // offset into the uniform arena
 		CreateDescriptorBinding(1, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
 		CreateDescriptorBinding(2, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
 	};
@@ -153,15 +171,17 @@ void vk::PresentPass::BuildDescriptors()
 	m_descriptorSetLayout = CreateDescriptorSetLayout(context, bindings);
 
 	AllocateDescriptorSets(context, context.descriptorPool, m_descriptorSetLayout, MAX_FRAMES_IN_FLIGHT, m_descriptorSets);
+	AllocateDescriptorSets(context, context.descriptorPool, m_descriptorSetLayout, MAX_FRAMES_IN_FLIGHT, m_denoisedDescriptorSets);
 
 
 	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
 	{
 		VkDescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = m_accumulationUBO[i].buffer;
+		bufferInfo.buffer = context.uniformArena->GetBuffer(static_cast<uint32_t>(i)).buffer;
 		bufferInfo.offset = 0;
 		bufferInfo.range = sizeof(AccumulationSetting);
-		UpdateDescriptorSet(context, 0, bufferInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+		UpdateDescriptorSet(context, 0, bufferInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+		UpdateDescriptorSet(context, 0, bufferInfo, m_denoisedDescriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
 	}
 
 	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
@@ -184,6 +204,18 @@ void vk::PresentPass::BuildDescriptors()
 		};
 
 		UpdateDescriptorSet(context, 2, imgInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+		UpdateDescriptorSet(context, 2, imgInfo, m_denoisedDescriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+	}
+
+	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		VkDescriptorImageInfo imgInfo = {
+			.sampler = repeatSampler,
+			.imageView = DenoisedResult.imageView,
+			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+		};
+
+		UpdateDescriptorSet(context, 1, imgInfo, m_denoisedDescriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
 	}
 }
 
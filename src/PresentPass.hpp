@@ -13,7 +13,7 @@ namespace vk
 	{
 	public:
 
-		PresentPass(Context& context, Image& CompositedResult, Image& AccumulationResult);
+		PresentPass(Context& context, Image& CompositedResult, Image& AccumulationResult, Image& DenoisedResult);
 		~PresentPass();
 		void Execute(VkCommandBuffer cmd, uint32_t imageIndex);
 		void Update();
@@ -25,6 +25,7 @@ namespace vk
 		Context& context;
 		Image& CompositedResult;
 		Image& AccumulationResult;
+		Image& DenoisedResult;
 
 		std::shared_ptr<Scene> scene;
 		std::shared_ptr<Camera> camera;
@@ -32,8 +33,9 @@ namespace vk
 		VkPipeline m_pipeline;
 		VkPipelineLayout m_pipelineLayout;
 		std::vector<VkDescriptorSet> m_descriptorSets;
+		std::vector<VkDescriptorSet> m_denoisedDescriptorSets; // same layout with the denoiser output at binding 1
 		VkDescriptorSetLayout m_descriptorSetLayout;
-		std::vector<Buffer> m_accumulationUBO;
+		uint32_t m_accumulationOffset = 0; // of this frame's AccumulationSetting in the uniform arena
 		RenderType m_renderType;
 	};
 }
\ No newline at end of file
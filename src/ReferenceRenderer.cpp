@@ -0,0 +1,896 @@
+#include "Context.hpp"
+#include "GLTF.hpp"
+#include "ReferenceRenderer.hpp"
+
+#include <stb_image.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <unordered_map>
+
+namespace
+{
+	// Camera and scene constants match Renderer.cpp and Camera.cpp, see ReferenceRenderer for the GPU settings it matches
+	constexpr glm::vec3 cameraPos = glm::vec3(-567.0f, 100.0f, -69.0f);
+	constexpr glm::vec3 cameraDir = glm::vec3(1.0f, 20.0f, -1.0f);
+	constexpr glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0);
+	constexpr float cameraFov = 45.0f;
+	constexpr float cameraNear = 0.1f;
+	constexpr float cameraFar = 3500.0f;
+
+	constexpr float LIGHT_INTENSITY = 6000.0f;
+	constexpr float PI = 3.14159265359f;
+	constexpr int NUM_SPATIAL_NEIGHBOURS = 4;
+	constexpr int TEMPORAL_M_CLAMP = 20;
+
+	// Shadow ray ranges differ slightly between the shaders, keep them identical here
+	constexpr float CANDIDATES_SHADOW_TMIN = 0.0f, CANDIDATES_SHADOW_TMAX_BIAS = 0.001f;
+	constexpr float TEMPORAL_SHADOW_TMIN = 0.0f, TEMPORAL_SHADOW_TMAX_BIAS = 0.0f;
+	constexpr float SPATIAL_SHADOW_TMIN = 0.001f, SPATIAL_SHADOW_TMAX_BIAS = 0.0f;
+	constexpr float SHADING_SHADOW_TMIN = 0.0f, SHADING_SHADOW_TMAX_BIAS = 0.0f;
+
+	// Reference: https://github.com/NVIDIAGameWorks/RTXGI-DDGI/blob/main/samples/test-harness/shaders/include/Random.hlsl#L42
+	uint32_t WangHash(uint32_t seed)
+	{
+		seed = (seed ^ 61) ^ (seed >> 16);
+		seed *= 9;
+		seed = seed ^ (seed >> 4);
+		seed *= 0x27d4eb2d;
+		seed = seed ^ (seed >> 15);
+		return seed;
+	}
+
+	uint32_t Xorshift(uint32_t seed)
+	{
+		seed ^= (seed << 13);
+		seed ^= (seed >> 17);
+		seed ^= (seed << 5);
+		return seed;
+	}
+
+	float GetRandomNumber(uint32_t& seed)
+	{
+		seed = WangHash(seed);
+		return float(Xorshift(seed)) * (1.f / 4294967296.f);
+	}
+
+	// Seeds and Sobol sequence of shaders/Sampling.glsl
+	constexpr uint32_t SAMPLING_PASS_CANDIDATES = 0x68bc21ebu;
+	constexpr uint32_t SAMPLING_PASS_TEMPORAL = 0x02e5be93u;
+	constexpr uint32_t SAMPLING_PASS_SPATIAL = 0x967a889bu;
+
+	uint32_t PCGHash(uint32_t v)
+	{
+		uint32_t state = v * 747796405u + 2891336453u;
+		uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+		return (word >> 22u) ^ word;
+	}
+
+	// The passes seed from gl_GlobalInvocationID, which is the pixel at full resolution
+	uint32_t PassSeed(uint32_t x, uint32_t y, uint32_t frameIndex, uint32_t passSalt)
+	{
+		return PCGHash(PCGHash(PCGHash(x ^ passSalt) + y) ^ (frameIndex * 0x9e3779b9u));
+	}
+
+	// bitfieldReverse
+	uint32_t ReverseBits(uint32_t x)
+	{
+		x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+		x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+		x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+		x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+		return (x >> 16) | (x << 16);
+	}
+
+	uint32_t LaineKarrasPermutation(uint32_t x, uint32_t seed)
+	{
+		x += seed;
+		x ^= x * 0x6c50b47cu;
+		x ^= x * 0xb82f1e52u;
+		x ^= x * 0xc7afe638u;
+		x ^= x * 0x8d22f6e6u;
+		return x;
+	}
+
+	uint32_t NestedUniformScramble(uint32_t x, uint32_t seed)
+	{
+		return ReverseBits(LaineKarrasPermutation(ReverseBits(x), seed));
+	}
+
+	uint32_t SobolSecondDimension(uint32_t index)
+	{
+		uint32_t result = 0u;
+		uint32_t v = 1u << 31u;
+		while (index != 0u)
+		{
+			if ((index & 1u) != 0u)
+				result ^= v;
+			v ^= v >> 1u;
+			index >>= 1u;
+		}
+		return result;
+	}
+
+	glm::vec2 SobolOwen(uint32_t index, uint32_t seed)
+	{
+		index = NestedUniformScramble(index, seed);
+		uint32_t x = NestedUniformScramble(ReverseBits(index), PCGHash(seed ^ 0x5bd1e995u));
+		uint32_t y = NestedUniformScramble(SobolSecondDimension(index), PCGHash(seed ^ 0x1b873593u));
+		return glm::vec2(float(x >> 8u), float(y >> 8u)) * (1.0f / 16777216.0f);
+	}
+
+	glm::vec2 DiskPoint(float sampleRadius, float x, float y)
+	{
+		float r = sampleRadius * std::sqrt(x);
+		float theta = y * (2.0f * PI);
+		return glm::vec2(r * std::cos(theta), r * std::sin(theta));
+	}
+
+	glm::vec3 fresnelSchlick(float cosTheta, const glm::vec3& F0)
+	{
+		return F0 + (1.0f - F0) * std::pow(glm::clamp(1.0f - cosTheta, 0.0f, 1.0f), 5.0f);
+	}
+
+	float DistributionGGX(const glm::vec3& N, const glm::vec3& H, float roughness)
+	{
+		float a = roughness * roughness;
+		float a2 = a * a;
+		float NdotH = std::max(glm::dot(N, H), 0.0f);
+		float NdotH2 = NdotH * NdotH;
+
+		float denom = (NdotH2 * (a2 - 1.0f) + 1.0f);
+		denom = PI * denom * denom;
+
+		return a2 / denom;
+	}
+
+	float GeometrySchlickGGX(float NdotV, float roughness)
+	{
+		float r = (roughness + 1.0f);
+		float k = (r * r) / 8.0f;
+
+		return NdotV / (NdotV * (1.0f - k) + k);
+	}
+
+	float GeometrySmith(const glm::vec3& N, const glm::vec3& V, const glm::vec3& L, float roughness)
+	{
+		float NdotV = std::max(glm::dot(N, V), 0.0f);
+		float NdotL = std::max(glm::dot(N, L), 0.0f);
+		return GeometrySchlickGGX(NdotL, roughness) * GeometrySchlickGGX(NdotV, roughness);
+	}
+
+	// Reservoirs are stored as PackedReservoir on the GPU: exact light index, float W and M packed into 16 bits
+	glm::vec4 PackReservoir(int index, float W, int M)
+	{
+		return glm::vec4(float(index), W, float(std::clamp(M, 0, 0xFFFF)), 0.0f);
+	}
+
+	float SRGBToLinear(float c)
+	{
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+}
+
+struct vk::ReferenceRenderer::Texture
+{
+	int width = 1;
+	int height = 1;
+	std::vector<glm::vec4> texels = { glm::vec4(1.0f) };
+
+	// Bilinear, repeat addressing. The GPU samples with mips and anisotropy so expect small differences on minified textures
+	glm::vec4 Sample(glm::vec2 uv) const
+	{
+		uv = uv - glm::floor(uv);
+		float fx = uv.x * width - 0.5f;
+		float fy = uv.y * height - 0.5f;
+		int x0 = static_cast<int>(std::floor(fx));
+		int y0 = static_cast<int>(std::floor(fy));
+		float tx = fx - x0;
+		float ty = fy - y0;
+
+		auto fetch = [&](int x, int y) {
+			x = ((x % width) + width) % width;
+			y = ((y % height) + height) % height;
+			return texels[size_t(y) * width + x];
+		};
+
+		glm::vec4 top = glm::mix(fetch(x0, y0), fetch(x0 + 1, y0), tx);
+		glm::vec4 bottom = glm::mix(fetch(x0, y0 + 1), fetch(x0 + 1, y0 + 1), tx);
+		return glm::mix(top, bottom, ty);
+	}
+};
+
+struct vk::ReferenceRenderer::Material
+{
+	const Texture* albedo;
+	const Texture* metallicRoughness;
+	glm::vec4 baseColourFactor;
+	float metallic;
+	float roughness;
+};
+
+struct vk::ReferenceRenderer::Mesh
+{
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> uvs;
+	std::vector<uint32_t> indices;
+	uint32_t materialIndex;
+};
+
+struct vk::ReferenceRenderer::Surface
+{
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 normal = glm::vec3(0.0f);
+	glm::vec3 albedo = glm::vec3(0.0f);
+	float metallic = 0.0f;
+	float roughness = 0.0f;
+	bool valid = false;
+};
+
+struct vk::ReferenceRenderer::Reservoir
+{
+	int index = -1;
+	float W_y = 0.0f;
+	float W_sum = 0.0f;
+	int M = 0;
+};
+
+namespace
+{
+	// This is Weighted Reservoir Sampling with RIS, same as update() in the shaders
+	template <typename R>
+	void update(uint32_t& seed, R& reservoir, float xi_weight, int index, int in_reservoir_m)
+	{
+		reservoir.W_sum = reservoir.W_sum + xi_weight;
+		float r = GetRandomNumber(seed);
+		reservoir.M += in_reservoir_m;
+		if (r < (xi_weight / reservoir.W_sum))
+		{
+			reservoir.index = index;
+		}
+	}
+}
+
+bool vk::ReferenceImage::WritePFM(const std::string& path) const
+{
+	FILE* file = std::fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		ERROR("Failed to open " + path);
+		return false;
+	}
+
+	std::fprintf(file, "PF\n%u %u\n-1.0\n", width, height);
+
+	// PFM scanlines are stored bottom to top
+	std::vector<float> row(size_t(width) * 3);
+	for (uint32_t y = height; y-- > 0;)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			const glm::vec4& p = At(x, y);
+			row[x * 3 + 0] = p.r;
+			row[x * 3 + 1] = p.g;
+			row[x * 3 + 2] = p.b;
+		}
+		std::fwrite(row.data(), sizeof(float), row.size(), file);
+	}
+
+	std::fclose(file);
+	return true;
+}
+
+vk::ReferenceRenderer::ReferenceRenderer(const ReferenceSettings& settings) :
+	m_settings{ settings },
+	m_threadPool{ std::make_unique<ThreadPool>(settings.threadCount) },
+	m_samplingTables{ Sampling::LoadTables() }
+{
+	std::printf("Launching CPU reference renderer (%u threads)\n", m_threadPool->GetThreadCount());
+
+	LoadScene();
+	CreateLights();
+	SetupCamera();
+
+	m_gbuffer.resize(size_t(m_settings.width) * m_settings.height);
+	m_initialCandidates.Resize(m_settings.width, m_settings.height);
+	m_temporalReservoirs.Resize(m_settings.width, m_settings.height);
+	m_spatialReservoirs.Resize(m_settings.width, m_settings.height);
+	m_previousReservoirs.Resize(m_settings.width, m_settings.height);
+	m_shadingResult.Resize(m_settings.width, m_settings.height);
+
+	// The GPU reservoir buffers start zero filled
+	for (auto& pixel : m_previousReservoirs.pixels)
+		pixel = glm::vec4(0.0f);
+}
+
+vk::ReferenceRenderer::~ReferenceRenderer() = default;
+
+void vk::ReferenceRenderer::LoadScene()
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// LoadGLTF only reads vertex data and texture paths, no device is needed
+	Context context;
+	GLTFModel model = LoadGLTF(context, m_settings.scenePath);
+
+	glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(model.position));
+	modelMatrix = glm::scale(modelMatrix, glm::vec3(model.scale));
+	glm::mat3 normalMatrix = glm::mat3(modelMatrix);
+
+	std::unordered_map<std::string, const Texture*> textureCache;
+	auto loadTexture = [&](const std::string& path, bool isSRGB) -> const Texture* {
+		std::string key = path + (isSRGB ? "#srgb" : "");
+		if (auto it = textureCache.find(key); it != textureCache.end())
+			return it->second;
+
+		auto texture = std::make_unique<Texture>();
+		int channels = 0;
+		stbi_uc* pixels = stbi_load(path.c_str(), &texture->width, &texture->height, &channels, 4);
+		if (pixels)
+		{
+			texture->texels.resize(size_t(texture->width) * texture->height);
+			for (size_t i = 0; i < texture->texels.size(); i++)
+			{
+				glm::vec4 c = glm::vec4(pixels[i * 4 + 0], pixels[i * 4 + 1], pixels[i * 4 + 2], pixels[i * 4 + 3]) / 255.0f;
+				if (isSRGB)
+					c = glm::vec4(SRGBToLinear(c.r), SRGBToLinear(c.g), SRGBToLinear(c.b), c.a);
+				texture->texels[i] = c;
+			}
+			stbi_image_free(pixels);
+		}
+		else
+		{
+			ERROR("Failed to load texture: " + path);
+			texture->width = 1;
+			texture->height = 1;
+			texture->texels = { glm::vec4(1.0f) };
+		}
+
+		m_textures.push_back(std::move(texture));
+		textureCache[key] = m_textures.back().get();
+		return m_textures.back().get();
+	};
+
+	std::vector<BVHTriangle> triangles;
+
+	for (auto& meshData : model.meshes)
+	{
+		Material material = {};
+		material.albedo = loadTexture(meshData.textures[0], true);
+		material.metallicRoughness = loadTexture(meshData.textures[1], false);
+		material.baseColourFactor = meshData.baseColourFactor;
+		material.metallic = meshData.metallic;
+		material.roughness = meshData.roughness;
+		m_materials.push_back(material);
+
+		Mesh mesh = {};
+		mesh.materialIndex = static_cast<uint32_t>(m_materials.size() - 1);
+		mesh.indices = meshData.indices;
+		mesh.normals.reserve(meshData.vertices.size());
+		mesh.uvs.reserve(meshData.vertices.size());
+
+		std::vector<glm::vec3> positions;
+		positions.reserve(meshData.vertices.size());
+
+		for (const auto& vertex : meshData.vertices)
+		{
+			positions.push_back(glm::vec3(modelMatrix * glm::vec4(glm::vec3(vertex.pos), 1.0f)));
+			mesh.normals.push_back(glm::normalize(normalMatrix * glm::vec3(vertex.normal)));
+			mesh.uvs.push_back(vertex.tex);
+		}
+
+		const uint32_t meshIndex = static_cast<uint32_t>(m_meshes.size());
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			BVHTriangle tri = {};
+			tri.v0 = positions[mesh.indices[i + 0]];
+			tri.v1 = positions[mesh.indices[i + 1]];
+			tri.v2 = positions[mesh.indices[i + 2]];
+			tri.meshIndex = meshIndex;
+			tri.primitiveIndex = static_cast<uint32_t>(i / 3);
+			triangles.push_back(tri);
+		}
+
+		m_meshes.push_back(std::move(mesh));
+	}
+
+	const size_t triangleCount = triangles.size();
+	m_bvh.Build(std::move(triangles));
+
+	auto end = std::chrono::high_resolution_clock::now();
+	std::printf("Reference scene: %zu meshes, %zu triangles, %zu textures loaded in %.2f s\n",
+		m_meshes.size(), triangleCount, m_textures.size(), std::chrono::duration<double>(end - start).count());
+}
+
+void vk::ReferenceRenderer::CreateLights()
+{
+	// The grid the Renderer adds to its scene, same seed gives the same colours
+	for (const Light& light : CreateSpotLightGrid(m_settings.lightSeed))
+		m_lights.push_back(LightSample{ glm::vec3(light.position), glm::vec3(light.colour) });
+
+	m_lights.resize(NUM_LIGHTS, LightSample{ glm::vec3(0.0f), glm::vec3(0.0f) });
+}
+
+void vk::ReferenceRenderer::SetupCamera()
+{
+	// Same transforms as Camera::UpdateTransforms
+	glm::vec3 direction = glm::normalize(cameraPos + cameraDir);
+	m_camera.position = cameraPos;
+	m_camera.view = glm::lookAt(cameraPos, cameraPos + direction, up);
+	m_camera.projection = glm::perspective(cameraFov, m_settings.width / (float)m_settings.height, cameraNear, cameraFar);
+	m_camera.projection[1][1] *= -1;
+	m_camera.inverseViewProjection = glm::inverse(m_camera.projection * m_camera.view);
+	m_previousCamera = m_camera;
+}
+
+template <typename Fn>
+double vk::ReferenceRenderer::RunPass(const char* name, Fn&& perPixel)
+{
+	const uint32_t width = m_settings.width;
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Rows are handed out in small batches, the pool balances expensive rows by stealing
+	m_threadPool->ParallelFor(m_settings.height, 4, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t y = begin; y < end; y++)
+			for (uint32_t x = 0; x < width; x++)
+				perPixel(x, y);
+	});
+
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	auto it = std::find_if(m_timings.begin(), m_timings.end(), [&](const PassTiming& t) { return t.name == name; });
+	if (it == m_timings.end())
+	{
+		m_timings.push_back({ name, 0.0, 0 });
+		it = m_timings.end() - 1;
+	}
+	it->seconds += seconds;
+	it->pixels += uint64_t(width) * m_settings.height;
+
+	return seconds;
+}
+
+// Same as BlueNoise in Sampling.glsl
+glm::vec2 vk::ReferenceRenderer::BlueNoise(glm::ivec2 pixel, uint32_t frameIndex) const
+{
+	uint32_t size = m_samplingTables.header.blueNoiseSize;
+	uint32_t mask = size - 1u;
+	uint32_t texel = m_samplingTables.blueNoise[(uint32_t(pixel.y) & mask) * size + (uint32_t(pixel.x) & mask)];
+	glm::vec2 noise = glm::vec2(float(texel & 0xFFFFu), float(texel >> 16)) / 65535.0f;
+
+	const glm::vec2 R2 = glm::vec2(0.7548776662466927f, 0.5698402909980532f);
+	return glm::fract(noise + R2 * float(frameIndex % 65536u));
+}
+
+// Same as PoissonNeighbour in Sampling.glsl
+glm::vec2 vk::ReferenceRenderer::PoissonNeighbour(uint32_t tap, uint32_t tapCount, glm::ivec2 pixel, uint32_t frameIndex, float radius) const
+{
+	glm::vec2 p = m_samplingTables.header.poissonDisk[(frameIndex * tapCount + tap) % Sampling::POISSON_DISK_COUNT];
+
+	float angle = BlueNoise(pixel, frameIndex).x * 6.28318530718f;
+	float c = std::cos(angle);
+	float s = std::sin(angle);
+	return glm::vec2(c * p.x - s * p.y, s * p.x + c * p.y) * radius;
+}
+
+glm::vec3 vk::ReferenceRenderer::GetLightRadiance(int lightIndex, const Surface& surface) const
+{
+	const glm::vec3& world_pos = surface.position;
+	glm::vec3 N = glm::normalize(surface.normal);
+	glm::vec3 V = glm::normalize(m_camera.position - world_pos);
+
+	glm::vec3 F0 = glm::mix(glm::vec3(0.04f), surface.albedo, surface.metallic);
+
+	const LightSample& light = m_lights[lightIndex];
+	glm::vec3 L = glm::normalize(light.position - world_pos);
+	glm::vec3 H = glm::normalize(V + L);
+	float dist = glm::length(light.position - world_pos);
+	float attenuation = 1.0f / (dist * dist);
+	glm::vec3 radiance = light.colour * attenuation * LIGHT_INTENSITY;
+
+	// Cook-Torrance BRDF
+	float NDF = DistributionGGX(N, H, surface.roughness);
+	float G = GeometrySmith(N, V, L, surface.roughness);
+	glm::vec3 F = fresnelSchlick(std::max(glm::dot(H, V), 0.0f), F0);
+
+	glm::vec3 numerator = NDF * G * F;
+	float denominator = 4.0f * std::max(glm::dot(N, V), 0.0f) * std::max(glm::dot(N, L), 0.0f) + 0.001f;
+	glm::vec3 specular = numerator / denominator;
+	glm::vec3 kS = F;
+	glm::vec3 kD = glm::vec3(1.0f) - kS;
+	kD *= 1.0f - surface.metallic;
+	float NdotL = std::max(glm::dot(N, L), 0.0f);
+	return (kD * surface.albedo / PI + specular) * radiance * NdotL;
+}
+
+float vk::ReferenceRenderer::InShadow(const glm::vec3& position, const glm::vec3& normal, float distToLight, const glm::vec3& lightDir, float tMin, float tMaxBias) const
+{
+	BVHRay ray = {};
+	ray.origin = position + normal * 0.001f; // offset to avoid self-intersection
+	ray.direction = lightDir;
+	ray.tMin = tMin;
+	ray.tMax = distToLight - tMaxBias;
+
+	return m_bvh.Occluded(ray) ? 0.0f : 1.0f;
+}
+
+glm::vec2 vk::ReferenceRenderer::MotionVector(uint32_t x, uint32_t y) const
+{
+	// Same as MotionVectors.frag
+	const Surface& surface = m_gbuffer[size_t(y) * m_settings.width + x];
+
+	auto toUV = [&](const CameraState& camera) {
+		glm::vec4 project = camera.projection * camera.view * glm::vec4(surface.position, 1.0f);
+		return glm::vec2(project) / project.w * 0.5f + 0.5f;
+	};
+
+	return toUV(m_previousCamera) - toUV(m_camera);
+}
+
+void vk::ReferenceRenderer::GBufferPass()
+{
+	RunPass("GBuffer", [&](uint32_t x, uint32_t y) {
+		Surface& surface = m_gbuffer[size_t(y) * m_settings.width + x];
+		surface = {};
+
+		glm::vec2 ndc = (glm::vec2(x, y) + 0.5f) / glm::vec2(m_settings.width, m_settings.height) * 2.0f - 1.0f;
+		glm::vec4 farPoint = m_camera.inverseViewProjection * glm::vec4(ndc, 1.0f, 1.0f);
+		farPoint /= farPoint.w;
+
+		BVHRay ray = {};
+		ray.origin = m_camera.position;
+		ray.direction = glm::normalize(glm::vec3(farPoint) - m_camera.position);
+		ray.tMin = cameraNear;
+		ray.tMax = cameraFar;
+
+		auto interpolate = [&](const BVHHit& hit, auto& attribute) {
+			const BVHTriangle& tri = m_bvh.GetTriangles()[hit.triangleIndex];
+			const Mesh& mesh = m_meshes[tri.meshIndex];
+			const uint32_t* idx = &mesh.indices[size_t(tri.primitiveIndex) * 3];
+			return attribute(mesh, idx[0]) * (1.0f - hit.u - hit.v) + attribute(mesh, idx[1]) * hit.u + attribute(mesh, idx[2]) * hit.v;
+		};
+
+		auto uvAttribute = [](const Mesh& mesh, uint32_t i) { return mesh.uvs[i]; };
+		auto normalAttribute = [](const Mesh& mesh, uint32_t i) { return mesh.normals[i]; };
+
+		// Alpha test, same as the discard in gbuffer.frag
+		BVHHit hit = m_bvh.Intersect(ray, [&](const BVHHit& candidate) {
+			const Material& material = m_materials[m_meshes[m_bvh.GetTriangles()[candidate.triangleIndex].meshIndex].materialIndex];
+			float alpha = material.albedo->Sample(interpolate(candidate, uvAttribute)).a * material.baseColourFactor.a;
+			return alpha >= 0.1f;
+		});
+
+		if (!hit.IsValid())
+			return;
+
+		const Material& material = m_materials[m_meshes[m_bvh.GetTriangles()[hit.triangleIndex].meshIndex].materialIndex];
+		glm::vec2 uv = interpolate(hit, uvAttribute);
+		glm::vec4 metallicRoughness = material.metallicRoughness->Sample(uv);
+
+		surface.position = ray.origin + ray.direction * hit.t;
+		surface.normal = glm::normalize(interpolate(hit, normalAttribute));
+		surface.albedo = glm::vec3(material.albedo->Sample(uv) * material.baseColourFactor);
+		surface.metallic = metallicRoughness.b * material.metallic;
+		surface.roughness = metallicRoughness.g * material.roughness;
+		surface.valid = true;
+	});
+}
+
+void vk::ReferenceRenderer::CandidatesPass(uint32_t frameIndex)
+{
+	RunPass("Candidates", [&](uint32_t x, uint32_t y) {
+		const Surface& surface = m_gbuffer[size_t(y) * m_settings.width + x];
+		glm::vec4& output = m_initialCandidates.At(x, y);
+
+		if (!surface.valid)
+		{
+			output = glm::vec4(-1.0f, 0.0f, 0.0f, 0.0f);
+			return;
+		}
+
+		uint32_t seed = PassSeed(x, y, frameIndex, SAMPLING_PASS_CANDIDATES);
+
+		Reservoir reservoir;
+		const int CANDIDATE_MAX = m_settings.candidateM;
+		const float rcpUniformDistributionWeight = float(NUM_LIGHTS);
+		const float rcpM = 1.0f / float(CANDIDATE_MAX);
+
+		// Scramble of this pixel's Sobol sequence, drawn before update() advances the seed
+		uint32_t scramble = PCGHash(seed);
+
+		for (int i = 0; i < CANDIDATE_MAX; i++)
+		{
+			float u = m_settings.samplingMode == SamplingMode::LOW_DISCREPANCY ? SobolOwen(uint32_t(i), scramble).x : GetRandomNumber(seed);
+			int randomLightIndex = std::min(int(u * float(NUM_LIGHTS)), NUM_LIGHTS - 1);
+			float F_x = glm::length(GetLightRadiance(randomLightIndex, surface));
+			float xi_weight = F_x > 0.0f ? rcpM * F_x * rcpUniformDistributionWeight : 0.0f;
+			update(seed, reservoir, xi_weight, randomLightIndex, 1);
+		}
+
+		if (reservoir.index < 0)
+		{
+			output = glm::vec4(-1.0f, 0.0f, 0.0f, 0.0f);
+			return;
+		}
+
+		const LightSample& light = m_lights[reservoir.index];
+		float dist = glm::length(light.position - surface.position);
+		glm::vec3 light_dir = glm::normalize(light.position - surface.position);
+
+		float F_x = glm::length(GetLightRadiance(reservoir.index, surface));
+		reservoir.W_y = F_x > 0.0f ? (1.0f / F_x) * reservoir.W_sum : 0.0f;
+		reservoir.W_y *= InShadow(surface.position, surface.normal, dist, light_dir, CANDIDATES_SHADOW_TMIN, CANDIDATES_SHADOW_TMAX_BIAS);
+
+		output = PackReservoir(reservoir.index, reservoir.W_y, reservoir.M);
+	});
+}
+
+void vk::ReferenceRenderer::TemporalPass(uint32_t frameIndex)
+{
+	const glm::ivec2 viewport = glm::ivec2(m_settings.width, m_settings.height);
+
+	RunPass("Temporal", [&](uint32_t x, uint32_t y) {
+		const Surface& surface = m_gbuffer[size_t(y) * m_settings.width + x];
+		glm::vec4& output = m_temporalReservoirs.At(x, y);
+
+		if (!surface.valid)
+		{
+			output = glm::vec4(-1.0f, 0.0f, 0.0f, 0.0f);
+			return;
+		}
+
+		uint32_t seed = PassSeed(x, y, frameIndex, SAMPLING_PASS_TEMPORAL);
+		const glm::vec4 curr_reservoir = m_initialCandidates.At(x, y);
+
+		Reservoir reservoir;
+		Reservoir reservoirs[2];
+
+		glm::ivec2 current_pixel = glm::ivec2(x, y);
+		glm::ivec2 previous_pixel = glm::ivec2(glm::vec2(current_pixel) + MotionVector(x, y) * glm::vec2(viewport));
+
+		if (m_settings.enableUnbiased)
+			previous_pixel = current_pixel;
+
+		reservoirs[0].index = int(curr_reservoir.x);
+		reservoirs[0].W_y = curr_reservoir.y;
+		reservoirs[0].M = int(curr_reservoir.z);
+
+		// Out of bounds fetches return zero with robust buffer access, treat that as invalid history
+		bool inBounds = previous_pixel.x >= 0 && previous_pixel.y >= 0 && previous_pixel.x < viewport.x && previous_pixel.y < viewport.y;
+		Surface previous = inBounds ? m_gbuffer[size_t(previous_pixel.y) * m_settings.width + previous_pixel.x] : Surface{};
+
+		bool isValidHistory = inBounds && previous.valid && glm::dot(previous.normal, surface.normal) >= 0.99f;
+		int previous_pixel_reservoir_m = 0;
+
+		if (isValidHistory)
+		{
+			const glm::vec4& prev = m_previousReservoirs.At(previous_pixel.x, previous_pixel.y);
+			reservoirs[1].index = int(prev.x);
+			reservoirs[1].W_y = prev.y;
+			reservoirs[1].M = std::min(int(prev.z), TEMPORAL_M_CLAMP * reservoirs[0].M);
+			previous_pixel_reservoir_m = reservoirs[1].M;
+		}
+
+		for (int i = 0; i < 2; i++)
+		{
+			float F_x = reservoirs[i].index >= 0 ? glm::length(GetLightRadiance(reservoirs[i].index, surface)) : 0.0f;
+			float w_i = F_x > 0.0f ? F_x * reservoirs[i].W_y * reservoirs[i].M : 0.0f;
+			update(seed, reservoir, w_i, reservoirs[i].index, reservoirs[i].M);
+		}
+
+		if (reservoir.index < 0)
+		{
+			output = glm::vec4(-1.0f, 0.0f, 0.0f, 0.0f);
+			return;
+		}
+
+		const LightSample& L = m_lights[reservoir.index];
+
+		// Algorithm 6: Z counts the M of every input whose domain contains the selected sample
+		int Z = 0;
+		if (isValidHistory && m_settings.enableUnbiased)
+		{
+			glm::vec3 dir = glm::normalize(L.position - previous.position);
+			float dist = glm::length(L.position - previous.position);
+			float visibility = InShadow(previous.position, previous.normal, dist, dir, TEMPORAL_SHADOW_TMIN, TEMPORAL_SHADOW_TMAX_BIAS);
+			float p_hat = glm::length(GetLightRadiance(reservoir.index, previous) * visibility);
+			Z = p_hat > 0.0f ? Z + previous_pixel_reservoir_m : Z;
+		}
+
+		if (m_settings.enableUnbiased)
+		{
+			glm::vec3 dir = glm::normalize(L.position - surface.position);
+			float dist = glm::length(L.position - surface.position);
+			float visibility = InShadow(surface.position, surface.normal, dist, dir, TEMPORAL_SHADOW_TMIN, TEMPORAL_SHADOW_TMAX_BIAS);
+			float p_hat = glm::length(GetLightRadiance(reservoir.index, surface) * visibility);
+			Z = p_hat > 0.0f ? Z + int(curr_reservoir.z) : Z;
+		}
+
+		float m = (Z > 0) ? 1.0f / float(Z) : 0.0f;
+		float F_x = glm::length(GetLightRadiance(reservoir.index, surface));
+
+		if (!m_settings.enableUnbiased)
+			reservoir.W_y = F_x > 0.0f ? (1.0f / F_x) * (1.0f / reservoir.M) * reservoir.W_sum : 0.0f; // Algorithm 4
+		else
+			reservoir.W_y = F_x > 0.0f ? (1.0f / F_x) * (m * reservoir.W_sum) : 0.0f; // Algorithm 6
+
+		output = PackReservoir(reservoir.index, reservoir.W_y, reservoir.M);
+	});
+}
+
+void vk::ReferenceRenderer::SpatialPass(uint32_t frameIndex)
+{
+	const glm::ivec2 viewport = glm::ivec2(m_settings.width, m_settings.height);
+
+	RunPass("Spatial", [&](uint32_t x, uint32_t y) {
+		const Surface& surface = m_gbuffer[size_t(y) * m_settings.width + x];
+		glm::vec4& output = m_spatialReservoirs.At(x, y);
+
+		if (!surface.valid)
+		{
+			output = glm::vec4(-1.0f, 0.0f, 0.0f, 0.0f);
+			return;
+		}
+
+		uint32_t seed = PassSeed(x, y, frameIndex, SAMPLING_PASS_SPATIAL);
+		const glm::vec4 pixelReservoir = m_temporalReservoirs.At(x, y);
+
+		Reservoir reservoir;
+		Reservoir neighbours[NUM_SPATIAL_NEIGHBOURS];
+		Surface neighbourSurfaces[NUM_SPATIAL_NEIGHBOURS];
+
+		neighbours[0].index = int(pixelReservoir.x);
+		neighbours[0].W_y = pixelReservoir.y;
+		neighbours[0].M = int(pixelReservoir.z);
+		neighbourSurfaces[0] = surface;
+
+		for (int i = 1; i < NUM_SPATIAL_NEIGHBOURS; i++)
+		{
+			glm::vec2 offset;
+			if (m_settings.samplingMode == SamplingMode::LOW_DISCREPANCY)
+				offset = PoissonNeighbour(uint32_t(i - 1), uint32_t(NUM_SPATIAL_NEIGHBOURS - 1), glm::ivec2(x, y), frameIndex, float(m_settings.spatialRadius));
+			else
+			{
+				float u = GetRandomNumber(seed);
+				float v = GetRandomNumber(seed);
+				offset = DiskPoint(float(m_settings.spatialRadius), u, v);
+			}
+
+			glm::ivec2 sample_pixel = glm::ivec2(x, y) + glm::ivec2(offset);
+			sample_pixel = glm::clamp(sample_pixel, glm::ivec2(0), viewport - glm::ivec2(1));
+
+			const glm::vec4& r = m_temporalReservoirs.At(sample_pixel.x, sample_pixel.y);
+			neighbours[i].index = int(r.x);
+			neighbours[i].W_y = r.y;
+			neighbours[i].M = int(r.z);
+			neighbourSurfaces[i] = m_gbuffer[size_t(sample_pixel.y) * m_settings.width + sample_pixel.x];
+		}
+
+		for (int i = 0; i < NUM_SPATIAL_NEIGHBOURS; i++)
+		{
+			float F_x = neighbours[i].index >= 0 ? glm::length(GetLightRadiance(neighbours[i].index, surface)) : 0.0f;
+			float w_i = F_x > 0.0f ? F_x * neighbours[i].W_y * neighbours[i].M : 0.0f;
+			update(seed, reservoir, w_i, neighbours[i].index, neighbours[i].M);
+		}
+
+		if (reservoir.index < 0)
+		{
+			output = glm::vec4(-1.0f, 0.0f, 0.0f, 0.0f);
+			return;
+		}
+
+		float m = 0.0f;
+		if (m_settings.enableUnbiased)
+		{
+			const LightSample& L = m_lights[reservoir.index];
+
+			int Z = 0;
+			for (int i = 0; i < NUM_SPATIAL_NEIGHBOURS; i++)
+			{
+				const Surface& s = neighbourSurfaces[i];
+				float dist = glm::length(L.position - s.position);
+				glm::vec3 dir = glm::normalize(L.position - s.position);
+				float visibility = InShadow(s.position, s.normal, dist, dir, SPATIAL_SHADOW_TMIN, SPATIAL_SHADOW_TMAX_BIAS);
+				float p_hat = s.valid ? glm::length(GetLightRadiance(reservoir.index, s) * visibility) : 0.0f;
+				Z = p_hat > 0.0f ? Z + neighbours[i].M : Z;
+			}
+
+			m = (Z > 0) ? 1.0f / float(Z) : 1.0f;
+		}
+
+		float F_x = glm::length(GetLightRadiance(reservoir.index, surface));
+
+		if (!m_settings.enableUnbiased)
+			reservoir.W_y = F_x > 0.0f ? (1.0f / F_x) * (1.0f / reservoir.M) * reservoir.W_sum : 0.0f; // Algorithm 4
+		else
+			reservoir.W_y = F_x > 0.0f ? (1.0f / F_x) * (m * reservoir.W_sum) : 0.0f; // Algorithm 6
+
+		output = PackReservoir(reservoir.index, reservoir.W_y, reservoir.M);
+	});
+}
+
+void vk::ReferenceRenderer::ShadingPass()
+{
+	// Same selection as ShadingPassData.reservoir_pass
+	const ReferenceImage& reservoirs = m_settings.enableReSTIR ? m_spatialReservoirs : m_initialCandidates;
+
+	RunPass("Shading", [&](uint32_t x, uint32_t y) {
+		const Surface& surface = m_gbuffer[size_t(y) * m_settings.width + x];
+		const glm::vec4& data = reservoirs.At(x, y);
+		int index = int(data.x);
+
+		if (!surface.valid || index < 0)
+		{
+			m_shadingResult.At(x, y) = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+			return;
+		}
+
+		const LightSample& L = m_lights[index];
+		glm::vec3 light_dir = glm::normalize(L.position - surface.position);
+		float dist = glm::length(L.position - surface.position);
+
+		glm::vec3 F_x = GetLightRadiance(index, surface);
+		float Visibility = InShadow(surface.position, surface.normal, dist, light_dir, SHADING_SHADOW_TMIN, SHADING_SHADOW_TMAX_BIAS);
+
+		m_shadingResult.At(x, y) = glm::vec4(F_x * data.y * Visibility, 0.0f);
+	});
+}
+
+void vk::ReferenceRenderer::Render()
+{
+	m_timings.clear();
+
+	// Static camera and scene, the GBuffer only needs to be built once
+	GBufferPass();
+
+	for (uint32_t frame = 0; frame < m_settings.frameCount; frame++)
+	{
+		CandidatesPass(frame);
+
+		if (m_settings.enableReSTIR)
+		{
+			TemporalPass(frame);
+			SpatialPass(frame);
+		}
+
+		ShadingPass();
+
+		// Same as TemporalCompute::CopyImageToImage at the end of the frame
+		if (m_settings.enableReSTIR)
+			m_previousReservoirs.pixels = m_spatialReservoirs.pixels;
+
+		m_previousCamera = m_camera;
+	}
+
+	std::filesystem::create_directories(m_settings.outputDirectory);
+	const std::string dir = m_settings.outputDirectory + "/";
+	m_shadingResult.WritePFM(dir + "shading.pfm");
+	m_initialCandidates.WritePFM(dir + "initial_candidates.pfm");
+	if (m_settings.enableReSTIR)
+	{
+		m_temporalReservoirs.WritePFM(dir + "temporal_reservoirs.pfm");
+		m_spatialReservoirs.WritePFM(dir + "spatial_reservoirs.pfm");
+	}
+
+	std::printf("Reference: %ux%u, %u frames, M = %d, radius = %d, ReSTIR %s, %s, %s sampling\n",
+		m_settings.width, m_settings.height, m_settings.frameCount, m_settings.candidateM, m_settings.spatialRadius,
+		m_settings.enableReSTIR ? "on" : "off", m_settings.enableUnbiased ? "unbiased" : "biased",
+		m_settings.samplingMode == SamplingMode::LOW_DISCREPANCY ? "low discrepancy" : "white noise");
+	std::printf("  Compare against the GPU with light tiles off, full resolution, fixed M, the default ray budgets and the same sampling\n");
+
+	double totalSeconds = 0.0;
+	uint64_t framePixels = uint64_t(m_settings.width) * m_settings.height;
+	for (const auto& timing : m_timings)
+	{
+		totalSeconds += timing.seconds;
+		std::printf("  %-12s %10.2f ms/pass %10.3f Mpixels/s\n", timing.name.c_str(),
+			1000.0 * timing.seconds / double(timing.pixels / framePixels), timing.pixels / timing.seconds * 1e-6);
+	}
+
+	std::printf("  %-12s %10.2f s     %10.3f Mpixels/s (per frame)\n", "Total", totalSeconds,
+		double(framePixels) * m_settings.frameCount / totalSeconds * 1e-6);
+	std::printf("Wrote reference images to %s\n", m_settings.outputDirectory.c_str());
+}
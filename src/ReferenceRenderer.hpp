@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "BVH.hpp"
+#include "Light.hpp"
+#include "Sampling.hpp"
+#include "ThreadPool.hpp"
+#include "Utils.hpp"
+
+namespace vk
+{
+	// Settings mirror the GPU pass uniforms so both paths can be driven with the same values
+	struct ReferenceSettings
+	{
+		std::string scenePath = "assets/GLTF/Sponza/Sponza.gltf";
+		std::string outputDirectory = "reference";
+		uint32_t width = 1280;
+		uint32_t height = 720;
+		uint32_t frameCount = 8;      // temporal reuse needs more than one frame
+		uint32_t threadCount = 0;     // 0 = hardware concurrency
+		uint32_t lightSeed = DEFAULT_LIGHT_SEED; // must match the seed the Renderer built its lights with
+		int candidateM = 32;
+		int spatialRadius = 30;
+		bool enableReSTIR = true;
+		bool enableUnbiased = false;
+		SamplingMode samplingMode = SamplingMode::LOW_DISCREPANCY; // same default as vk::samplingMode
+	};
+
+	// Float image, written out as PFM
+	struct ReferenceImage
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<glm::vec4> pixels;
+
+		void Resize(uint32_t w, uint32_t h) { width = w; height = h; pixels.assign(size_t(w) * h, glm::vec4(0.0f)); }
+		glm::vec4& At(uint32_t x, uint32_t y) { return pixels[size_t(y) * width + x]; }
+		const glm::vec4& At(uint32_t x, uint32_t y) const { return pixels[size_t(y) * width + x]; }
+
+		bool WritePFM(const std::string& path) const;
+	};
+
+	// Multithreaded CPU implementation of the ReSTIR DI passes
+	// Candidates -> Temporal -> Spatial -> Shading follow CandidatesCompute.comp, TemporalCompute.comp,
+	// SpatialCompute.comp and ShadingPass.comp line for line, including the per pass seeds and the sampling
+	// tables of shaders/Sampling.glsl, so the output can be used as a reference for bias checks without a GPU.
+	// It matches one GPU configuration: light tiles off (enableLightTiles), full resolution reservoirs, a fixed
+	// candidate count, no denoiser and the same samplingMode. Every shadow ray is traced, as the GPU does at its default ray budgets,
+	// where reusing a stored visibility only skips a ray whose answer is already known. Below those budgets the
+	// GPU leaves visibility unknown and the two diverge
+	class ReferenceRenderer
+	{
+	public:
+		explicit ReferenceRenderer(const ReferenceSettings& settings);
+		~ReferenceRenderer();
+
+		// Renders settings.frameCount frames, writes the final images and prints pixels/second per pass
+		void Render();
+
+		const ReferenceImage& GetShadingResult() const { return m_shadingResult; }
+
+	private:
+		struct Texture;
+		struct Material;
+		struct Mesh;
+		struct Surface;
+		struct Reservoir;
+
+		struct LightSample
+		{
+			glm::vec3 position;
+			glm::vec3 colour;
+		};
+
+		struct CameraState
+		{
+			glm::mat4 view;
+			glm::mat4 projection;
+			glm::mat4 inverseViewProjection;
+			glm::vec3 position;
+		};
+
+		void LoadScene();
+		void CreateLights();
+		void SetupCamera();
+
+		void GBufferPass();
+		void CandidatesPass(uint32_t frameIndex);
+		void TemporalPass(uint32_t frameIndex);
+		void SpatialPass(uint32_t frameIndex);
+		void ShadingPass();
+
+		// Shader helpers
+		glm::vec3 GetLightRadiance(int lightIndex, const Surface& surface) const;
+		float InShadow(const glm::vec3& position, const glm::vec3& normal, float distToLight, const glm::vec3& lightDir, float tMin, float tMaxBias) const;
+		glm::vec2 MotionVector(uint32_t x, uint32_t y) const;
+		glm::vec2 BlueNoise(glm::ivec2 pixel, uint32_t frameIndex) const;
+		glm::vec2 PoissonNeighbour(uint32_t tap, uint32_t tapCount, glm::ivec2 pixel, uint32_t frameIndex, float radius) const;
+
+		template <typename Fn>
+		double RunPass(const char* name, Fn&& perPixel);
+
+	private:
+		ReferenceSettings m_settings;
+		std::unique_ptr<ThreadPool> m_threadPool;
+		Sampling::Tables m_samplingTables;
+
+		std::vector<std::unique_ptr<Texture>> m_textures;
+		std::vector<Material> m_materials;
+		std::vector<Mesh> m_meshes;
+		std::vector<LightSample> m_lights;
+		BVH m_bvh;
+
+		CameraState m_camera;
+		CameraState m_previousCamera;
+
+		std::vector<Surface> m_gbuffer;
+		ReferenceImage m_initialCandidates;
+		ReferenceImage m_temporalReservoirs;
+		ReferenceImage m_spatialReservoirs;
+		ReferenceImage m_previousReservoirs;
+		ReferenceImage m_shadingResult;
+
+		struct PassTiming
+		{
+			std::string name;
+			double seconds = 0.0;
+			uint64_t pixels = 0;
+		};
+		std::vector<PassTiming> m_timings;
+	};
+}
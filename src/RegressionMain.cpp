@@ -0,0 +1,58 @@
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Engine.hpp"
+#include "RegressionSuite.hpp"
+
+// Renders the regression cases in a hidden window, exits non-zero when one of them failed or has no baseline
+namespace
+{
+	void ParseRegressionArgs(const std::vector<std::string>& args, vk::RegressionSettings& settings)
+	{
+		for (size_t i = 0; i < args.size(); i++)
+		{
+			const std::string& arg = args[i];
+			auto next = [&]() -> std::string {
+				if (i + 1 >= args.size())
+					throw std::runtime_error("Missing value for " + arg);
+				return args[++i];
+			};
+
+			if (arg == "--baseline")                  settings.baselineDirectory = next();
+			else if (arg == "--out")                  settings.outputDirectory = next();
+			else if (arg == "--update-baselines")     settings.updateBaselines = true;
+			else if (arg == "--width")                settings.width = std::stoul(next());
+			else if (arg == "--height")               settings.height = std::stoul(next());
+			else if (arg == "--warmup")               settings.warmupFrames = std::stoul(next());
+			else if (arg == "--frames")               settings.measureFrames = std::stoul(next());
+			else if (arg == "--image-tolerance")      settings.imageTolerance = std::stof(next());
+			else if (arg == "--outlier-tolerance")    settings.outlierTolerance = std::stof(next());
+			else if (arg == "--timing-threshold")     settings.timingThreshold = std::stof(next());
+			else throw std::runtime_error("Unknown argument: " + arg);
+		}
+	}
+}
+
+int main(int argc, char** argv) try
+{
+	vk::RegressionSettings settings;
+	ParseRegressionArgs(vk::ParseEngineArgs(argc, argv), settings);
+
+	vk::Engine engine;
+	if (!engine.Initialize(settings.width, settings.height, false))
+	{
+		std::cout << "Failed to initialize engine. " << std::endl;
+		return 1;
+	}
+
+	return engine.RunRegression(settings) ? 0 : 1;
+}
+catch( std::exception const& eErr )
+{
+	std::fprintf( stderr, "\n" );
+	std::fprintf( stderr, "Error: %s\n", eErr.what() );
+	return 1;
+}
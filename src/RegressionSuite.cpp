@@ -0,0 +1,340 @@
+#include "Context.hpp"
+#include "RegressionSuite.hpp"
+#include "Renderer.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	struct RegressionPose
+	{
+		const char* name;
+		glm::vec3 position;
+		glm::vec3 direction;
+	};
+
+	struct RegressionConfiguration
+	{
+		const char* name;
+		bool restir;
+		bool fusedTemporal;
+		bool unbiased;
+		int M;
+		int radius;
+	};
+
+	const std::array<RegressionPose, 2> regressionPoses = { {
+		{ "start", { -567.0f, 100.0f, -69.0f }, { -566.0f, 120.0f, -70.0f } },
+		{ "atrium", { 400.0f, 150.0f, -40.0f }, { -1.0f, -0.1f, 0.0f } }
+	} };
+
+	// Covers every ReSTIR kernel: candidates, temporal, fused candidates + temporal, spatial and both bias modes
+	constexpr std::array<RegressionConfiguration, 4> regressionConfigurations = { {
+		{ "ris",             false, false, false, 32, 30 },
+		{ "restir",          true,  false, false, 8,  30 },
+		{ "restir_fused",    true,  true,  false, 8,  30 },
+		{ "restir_unbiased", true,  false, true,  8,  30 }
+	} };
+
+	uint32_t CaseCount()
+	{
+		return static_cast<uint32_t>(regressionPoses.size() * regressionConfigurations.size());
+	}
+
+	std::string CaseName(uint32_t index)
+	{
+		const RegressionPose& pose = regressionPoses[index / regressionConfigurations.size()];
+		const RegressionConfiguration& configuration = regressionConfigurations[index % regressionConfigurations.size()];
+		return std::string(pose.name) + "_" + configuration.name;
+	}
+
+	// RGB float image as written by FrameCapture, rows stored bottom to top
+	bool ReadPFM(const std::string& path, uint32_t& width, uint32_t& height, std::vector<float>& pixels)
+	{
+		FILE* file = std::fopen(path.c_str(), "rb");
+		if (!file)
+			return false;
+
+		char magic[3] = {};
+		float scale = 0.0f;
+		const bool header = std::fscanf(file, "%2s %u %u %f", magic, &width, &height, &scale) == 4 && std::string(magic) == "PF" && scale < 0.0f;
+
+		// Exactly one whitespace character separates the header from the data
+		bool read = false;
+		if (header && std::fgetc(file) != EOF)
+		{
+			pixels.resize(size_t(width) * height * 3);
+			read = std::fread(pixels.data(), sizeof(float), pixels.size(), file) == pixels.size();
+		}
+
+		std::fclose(file);
+		return read;
+	}
+
+	// Timings per case and pass from timings.csv, case,pass,gpu_ms,cpu_ms
+	std::map<std::string, std::map<std::string, std::pair<double, double>>> ReadBaselineTimings(const std::string& path)
+	{
+		std::map<std::string, std::map<std::string, std::pair<double, double>>> timings;
+
+		std::ifstream file(path);
+		std::string line;
+		std::getline(file, line); // header
+		while (std::getline(file, line))
+		{
+			std::stringstream row(line);
+			std::string caseName, pass, gpu, cpu;
+			if (std::getline(row, caseName, ',') && std::getline(row, pass, ',') && std::getline(row, gpu, ',') && std::getline(row, cpu, ','))
+				timings[caseName][pass] = { std::stod(gpu), std::stod(cpu) };
+		}
+
+		return timings;
+	}
+}
+
+vk::RegressionSuite::RegressionSuite(const RegressionSettings& settings, Context& context, Renderer& renderer) :
+	settings{ settings },
+	context{ context },
+	renderer{ renderer },
+	m_case{ 0 },
+	m_frame{ 0 }
+{
+	std::filesystem::create_directories(settings.outputDirectory);
+	if (settings.updateBaselines)
+		std::filesystem::create_directories(settings.baselineDirectory);
+
+	m_results.resize(CaseCount());
+	for (uint32_t i = 0; i < CaseCount(); i++)
+		m_results[i].name = CaseName(i);
+
+	// Settings nothing in the suite varies, left at their defaults so every run measures the same frame
+	dynamicResolution.enable = false;
+	denoiser.enable = false;
+	enableGPUStats = false;
+	ShouldAnimateLights = false;
+
+	std::printf("Regression suite: %u cases, %u warmup and %u measured frames at %ux%u\n",
+		CaseCount(), settings.warmupFrames, settings.measureFrames, settings.width, settings.height);
+}
+
+void vk::RegressionSuite::Update()
+{
+	resetTemporalHistory = false;
+	if (m_case >= CaseCount())
+		return;
+
+	ApplyCase();
+
+	// The accumulation is captured once every frame of the case is in it
+	if (m_frame + 1 == settings.warmupFrames + settings.measureFrames)
+		renderer.GetFrameCapture().CaptureTo(GetImagePath(settings.outputDirectory, m_results[m_case].name), CaptureSource::HISTORY, CaptureFormat::PFM);
+}
+
+void vk::RegressionSuite::EndFrame(double cpuMilliseconds)
+{
+	if (m_case >= CaseCount())
+		return;
+
+	if (m_frame >= settings.warmupFrames)
+	{
+		auto& passes = m_results[m_case].passes;
+
+		// GPU results are from the frame rendered MAX_FRAMES_IN_FLIGHT ago, the warmup frames cover the lag
+		for (const auto& result : renderer.GetGPUTimer().GetResults())
+		{
+			Timing& timing = passes[result.name];
+			timing.gpuMilliseconds += result.milliseconds;
+			timing.gpuSamples++;
+		}
+
+		for (const auto& timing : renderer.GetRenderGraph().GetCPUTimings())
+		{
+			passes[timing.name].cpuMilliseconds += timing.cpuMilliseconds;
+			passes[timing.name].cpuSamples++;
+		}
+
+		Timing& frame = passes["Frame"];
+		frame.gpuMilliseconds += renderer.GetGPUTimer().GetFrameMilliseconds();
+		frame.gpuSamples++;
+		frame.cpuMilliseconds += cpuMilliseconds;
+		frame.cpuSamples++;
+	}
+
+	m_frame++;
+	if (m_frame == settings.warmupFrames + settings.measureFrames)
+	{
+		std::printf("Regression case %s done\n", m_results[m_case].name.c_str());
+		m_case++;
+		m_frame = 0;
+	}
+}
+
+bool vk::RegressionSuite::IsDone() const
+{
+	// The last capture is written a few frames after its case
+	return m_case >= CaseCount() && renderer.GetFrameCapture().IsIdle();
+}
+
+void vk::RegressionSuite::ApplyCase()
+{
+	const RegressionPose& pose = regressionPoses[m_case / regressionConfigurations.size()];
+	const RegressionConfiguration& configuration = regressionConfigurations[m_case % regressionConfigurations.size()];
+
+	Camera& camera = renderer.GetCamera();
+	camera.SetPosition(pose.position);
+	camera.SetDirection(glm::normalize(pose.direction));
+
+	enableReSTIR = configuration.restir;
+	enableFusedTemporal = configuration.fusedTemporal;
+	TemporalPassData.enableUnbiased = configuration.unbiased;
+	SpatialPassData.enableUnbiased = configuration.unbiased;
+	CandidatesPassData.M = configuration.M;
+	SpatialPassData.radius = configuration.radius;
+	isAccumulating = true;
+
+	if (m_frame == 0)
+	{
+		// History::Update counts this frame as the first one
+		rtxSettings.frameIndex = -1;
+		shouldClearBeforeDraw = true;
+		resetTemporalHistory = true;
+	}
+}
+
+std::string vk::RegressionSuite::GetImagePath(const std::string& directory, const std::string& caseName) const
+{
+	return (std::filesystem::path(directory) / (caseName + ".pfm")).string();
+}
+
+bool vk::RegressionSuite::Finish()
+{
+	const auto baselineTimings = ReadBaselineTimings((std::filesystem::path(settings.baselineDirectory) / "timings.csv").string());
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(context.pDevice, &properties);
+
+	std::ofstream report((std::filesystem::path(settings.outputDirectory) / "report.json").string(), std::ios::out | std::ios::trunc);
+	report << "{\n  \"device\": \"" << properties.deviceName << "\",\n  \"width\": " << settings.width << ",\n  \"height\": " << settings.height
+		<< ",\n  \"warmup_frames\": " << settings.warmupFrames << ",\n  \"measure_frames\": " << settings.measureFrames
+		<< ",\n  \"baselines_updated\": " << (settings.updateBaselines ? "true" : "false") << ",\n  \"cases\": [\n";
+
+	bool allPassed = true;
+	for (size_t c = 0; c < m_results.size(); c++)
+	{
+		const CaseResult& result = m_results[c];
+		const std::string outputPath = GetImagePath(settings.outputDirectory, result.name);
+		const std::string goldenPath = GetImagePath(settings.baselineDirectory, result.name);
+
+		// Image against the golden, relMSE per channel and the share of pixels off by more than 10%
+		uint32_t width = 0, height = 0, goldenWidth = 0, goldenHeight = 0;
+		std::vector<float> image, golden;
+		const bool hasImage = ReadPFM(outputPath, width, height, image);
+		const bool hasGolden = !settings.updateBaselines && ReadPFM(goldenPath, goldenWidth, goldenHeight, golden);
+
+		// Without a golden, or with one of other dimensions, the case fails unless this run writes the baseline
+		double relMSE = 0.0;
+		double outliers = 0.0;
+		bool imagePassed = hasImage && settings.updateBaselines;
+		if (hasImage && hasGolden && width == goldenWidth && height == goldenHeight)
+		{
+			size_t outlierCount = 0;
+			for (size_t i = 0; i < image.size(); i++)
+			{
+				const double difference = double(image[i]) - golden[i];
+				const double reference = golden[i];
+				relMSE += difference * difference / (reference * reference + 0.01);
+				if (std::abs(difference) > 0.1 * std::abs(reference) + 1e-3)
+					outlierCount++;
+			}
+
+			relMSE /= double(image.size());
+			outliers = double(outlierCount) / double(image.size());
+			imagePassed = relMSE <= settings.imageTolerance && outliers <= settings.outlierTolerance;
+		}
+
+		if (settings.updateBaselines && hasImage)
+			std::filesystem::copy_file(outputPath, goldenPath, std::filesystem::copy_options::overwrite_existing);
+
+		// Timings against the baseline, only slowdowns past both the threshold and the floor fail
+		const auto baselineCase = baselineTimings.find(result.name);
+		const bool hasBaseline = !settings.updateBaselines && baselineCase != baselineTimings.end();
+		bool timingPassed = true;
+
+		std::ostringstream passes;
+		bool firstPass = true;
+		for (const auto& [name, timing] : result.passes)
+		{
+			const double gpu = timing.gpuSamples > 0 ? timing.gpuMilliseconds / timing.gpuSamples : 0.0;
+			const double cpu = timing.cpuSamples > 0 ? timing.cpuMilliseconds / timing.cpuSamples : 0.0;
+
+			auto regressed = [&](double measured, double baseline) {
+				return measured > baseline * (1.0 + settings.timingThreshold) && measured - baseline > settings.timingFloorMilliseconds;
+			};
+
+			passes << (firstPass ? "" : ",\n") << "        { \"name\": \"" << name << "\", \"gpu_ms\": " << gpu << ", \"cpu_ms\": " << cpu;
+			firstPass = false;
+
+			bool passPassed = true;
+			if (hasBaseline)
+			{
+				const auto baseline = baselineCase->second.find(name);
+				if (baseline != baselineCase->second.end())
+				{
+					const auto [baselineGPU, baselineCPU] = baseline->second;
+					passPassed = !regressed(gpu, baselineGPU) && !regressed(cpu, baselineCPU);
+					passes << ", \"gpu_baseline_ms\": " << baselineGPU << ", \"cpu_baseline_ms\": " << baselineCPU;
+				}
+			}
+
+			passes << ", \"passed\": " << (passPassed ? "true" : "false") << " }";
+			timingPassed = timingPassed && passPassed;
+		}
+
+		// A case missing from timings.csv fails like a missing golden, the baseline is incomplete
+		const bool casePassed = imagePassed && timingPassed && (settings.updateBaselines || hasBaseline);
+		const bool noBaseline = !settings.updateBaselines && (!hasGolden || !hasBaseline);
+		allPassed = allPassed && casePassed;
+
+		report << "    {\n      \"name\": \"" << result.name << "\",\n      \"passed\": " << (casePassed ? "true" : "false")
+			<< ",\n      \"status\": \"" << (noBaseline ? "no baseline" : casePassed ? "passed" : "failed") << "\""
+			<< ",\n      \"image\": { \"captured\": " << (hasImage ? "true" : "false") << ", \"golden\": " << (hasGolden ? "true" : "false")
+			<< ", \"rel_mse\": " << relMSE << ", \"outliers\": " << outliers << ", \"passed\": " << (imagePassed ? "true" : "false") << " },"
+			<< "\n      \"timing_baseline\": " << (hasBaseline ? "true" : "false")
+			<< ",\n      \"passes\": [\n" << passes.str() << "\n      ]\n    }" << (c + 1 < m_results.size() ? "," : "") << "\n";
+
+		if (noBaseline)
+			std::printf("%-28s FAIL  no baseline at %s, run with --update-baselines to create it\n", result.name.c_str(), settings.baselineDirectory.c_str());
+		else
+			std::printf("%-28s %s  relMSE %.6f  outliers %.4f%s\n", result.name.c_str(), casePassed ? "PASS" : "FAIL", relMSE, outliers,
+				timingPassed ? "" : "  timing regression");
+	}
+
+	report << "  ],\n  \"passed\": " << (allPassed ? "true" : "false") << "\n}\n";
+
+	if (settings.updateBaselines)
+	{
+		std::ofstream timings((std::filesystem::path(settings.baselineDirectory) / "timings.csv").string(), std::ios::out | std::ios::trunc);
+		timings << "case,pass,gpu_ms,cpu_ms\n";
+		for (const CaseResult& result : m_results)
+		{
+			for (const auto& [name, timing] : result.passes)
+			{
+				timings << result.name << ',' << name << ','
+					<< (timing.gpuSamples > 0 ? timing.gpuMilliseconds / timing.gpuSamples : 0.0) << ','
+					<< (timing.cpuSamples > 0 ? timing.cpuMilliseconds / timing.cpuSamples : 0.0) << '\n';
+			}
+		}
+
+		std::printf("Regression baseline written to %s\n", settings.baselineDirectory.c_str());
+	}
+
+	std::printf("Regression suite %s, report in %s\n", allPassed ? "passed" : "failed",
+		(std::filesystem::path(settings.outputDirectory) / "report.json").string().c_str());
+	return allPassed;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace vk
+{
+	class Context;
+	class Renderer;
+
+	struct RegressionSettings
+	{
+		std::string baselineDirectory = "regression";     // <case>.pfm goldens and timings.csv, a case missing from them fails
+		std::string outputDirectory = "regression_out";   // this run's images and report.json
+		bool updateBaselines = false;                      // write this run's images and timings as the new baseline
+		uint32_t width = 640;
+		uint32_t height = 360;
+		uint32_t warmupFrames = 16;                        // not timed, covers the timer lag and pipeline permutations
+		uint32_t measureFrames = 64;
+		float imageTolerance = 0.01f;                      // mean relMSE against the golden
+		float outlierTolerance = 0.01f;                    // fraction of pixels allowed more than 10% relative error
+		float timingThreshold = 0.15f;                     // relative slowdown of a pass over its baseline
+		float timingFloorMilliseconds = 0.05f;             // slowdowns smaller than this are noise
+	};
+
+	// Headless image and performance regression run over fixed camera poses and ReSTIR configurations
+	// Every case resets the history, accumulates warmup + measure frames with the History pass and times the last
+	// measureFrames of them per render graph pass, on the GPU with GPUTimer and on the CPU while recording. The
+	// accumulated image is captured as PFM and compared against the golden, the timings against timings.csv.
+	// Everything lands in report.json. A case without a golden or timings fails with status "no baseline" unless
+	// updateBaselines is set, the baselines in regression/ are generated on lavapipe.
+	// Meant for a CPU Vulkan implementation, e.g. lavapipe selected with VK_ICD_FILENAMES, so ReSTIR kernel
+	// slowdowns show up without a GPU in the loop. The window is hidden but GLFW still needs a display, on a
+	// headless machine run it under Xvfb: xvfb-run -a ./Regression
+	class RegressionSuite
+	{
+	public:
+		RegressionSuite(const RegressionSettings& settings, Context& context, Renderer& renderer);
+
+		// Poses the camera and applies the case's settings, call before rendering the frame
+		void Update();
+
+		// Timings of the frame just rendered, cpuMilliseconds is the whole Render call
+		void EndFrame(double cpuMilliseconds);
+
+		bool IsDone() const;
+
+		// Compares against the baseline, writes report.json and returns whether every case passed
+		bool Finish();
+
+	private:
+		struct Timing
+		{
+			double gpuMilliseconds = 0.0;
+			double cpuMilliseconds = 0.0;
+			uint32_t gpuSamples = 0;
+			uint32_t cpuSamples = 0;
+		};
+
+		struct CaseResult
+		{
+			std::string name;
+			std::map<std::string, Timing> passes; // "Frame" is the whole frame
+		};
+
+		void ApplyCase();
+		std::string GetImagePath(const std::string& directory, const std::string& caseName) const;
+
+		const RegressionSettings settings;
+		Context& context;
+		Renderer& renderer;
+
+		uint32_t m_case;
+		uint32_t m_frame;
+		std::vector<CaseResult> m_results;
+	};
+}
@@ -0,0 +1,976 @@
+#include "Context.hpp"
+#include "RenderGraph.hpp"
+#include "Buffer.hpp"
+#include "GPUTimer.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+
+namespace
+{
+	// Render passes with an external dependency wait on one of these before transitioning their attachments
+	constexpr VkPipelineStageFlags ATTACHMENT_STAGES =
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+		VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+	constexpr VkAccessFlags WRITE_ACCESS =
+		VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	struct AccessInfo
+	{
+		VkPipelineStageFlags stages;
+		VkAccessFlags access;
+		VkImageLayout layout; // undefined when the pass transitions the image itself
+		bool write;
+		bool read;
+		const char* name;
+	};
+
+	AccessInfo GetAccessInfo(vk::Access access)
+	{
+		switch (access)
+		{
+		case vk::Access::COMPUTE_READ:
+			return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false, true, "compute read" };
+		case vk::Access::COMPUTE_WRITE:
+			return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true, false, "compute write" };
+		case vk::Access::COMPUTE_READ_WRITE:
+			return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true, true, "compute read/write" };
+		case vk::Access::COMPUTE_SAMPLE:
+			return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false, true, "compute sample" };
+		case vk::Access::FRAGMENT_SAMPLE:
+			return { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false, true, "fragment sample" };
+		case vk::Access::COLOR_ATTACHMENT:
+			return { ATTACHMENT_STAGES, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, true, false, "color attachment" };
+		case vk::Access::TRANSFER_READ:
+			return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false, true, "transfer read" };
+		case vk::Access::TRANSFER_WRITE:
+			return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true, false, "transfer write" };
+		}
+		return {};
+	}
+
+	const char* LayoutName(VkImageLayout layout)
+	{
+		switch (layout)
+		{
+		case VK_IMAGE_LAYOUT_UNDEFINED:                return "UNDEFINED";
+		case VK_IMAGE_LAYOUT_GENERAL:                  return "GENERAL";
+		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return "SHADER_READ_ONLY";
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:     return "TRANSFER_SRC";
+		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:     return "TRANSFER_DST";
+		default:                                       return "OTHER";
+		}
+	}
+
+	std::string StageNames(VkPipelineStageFlags stages)
+	{
+		static const std::pair<VkPipelineStageFlags, const char*> names[] = {
+			{ VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, "TOP_OF_PIPE" },
+			{ VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, "EARLY_FRAGMENT_TESTS" },
+			{ VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, "FRAGMENT_SHADER" },
+			{ VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, "LATE_FRAGMENT_TESTS" },
+			{ VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, "COLOR_ATTACHMENT_OUTPUT" },
+			{ VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, "COMPUTE_SHADER" },
+			{ VK_PIPELINE_STAGE_TRANSFER_BIT, "TRANSFER" }
+		};
+
+		std::string result;
+		for (const auto& [bit, name] : names)
+		{
+			if (stages & bit)
+			{
+				if (!result.empty())
+					result += " | ";
+				result += name;
+			}
+		}
+		return result;
+	}
+
+	double Megabytes(VkDeviceSize bytes)
+	{
+		return double(bytes) / (1024.0 * 1024.0);
+	}
+
+	const char* QueueName(vk::QueueType queue)
+	{
+		return queue == vk::QueueType::COMPUTE ? "compute" : "graphics";
+	}
+}
+
+vk::RenderGraph::PassBuilder& vk::RenderGraph::PassBuilder::Read(const Image& image, Access access)
+{
+	graph.AddUse(pass, graph.Find(&image, image.name), access, false, VK_IMAGE_LAYOUT_UNDEFINED);
+	return *this;
+}
+
+vk::RenderGraph::PassBuilder& vk::RenderGraph::PassBuilder::Read(const Buffer& buffer, Access access)
+{
+	graph.AddUse(pass, graph.Find(&buffer, buffer.name), access, false, VK_IMAGE_LAYOUT_UNDEFINED);
+	return *this;
+}
+
+vk::RenderGraph::PassBuilder& vk::RenderGraph::PassBuilder::Write(const Image& image, Access access, VkImageLayout finalLayout)
+{
+	graph.AddUse(pass, graph.Find(&image, image.name), access, true, finalLayout);
+	return *this;
+}
+
+vk::RenderGraph::PassBuilder& vk::RenderGraph::PassBuilder::Write(const Buffer& buffer, Access access)
+{
+	graph.AddUse(pass, graph.Find(&buffer, buffer.name), access, true, VK_IMAGE_LAYOUT_UNDEFINED);
+	return *this;
+}
+
+vk::RenderGraph::PassBuilder& vk::RenderGraph::PassBuilder::SideEffect()
+{
+	graph.m_passes[pass].sideEffect = true;
+	return *this;
+}
+
+vk::RenderGraph::PassBuilder& vk::RenderGraph::PassBuilder::AsyncCompute()
+{
+	graph.m_passes[pass].async = true;
+	return *this;
+}
+
+vk::RenderGraph::RenderGraph(Context& context) : context{ context }
+{
+}
+
+vk::RenderGraph::~RenderGraph()
+{
+	DestroyTransients();
+}
+
+void vk::RenderGraph::Import(const Image& image, VkImageLayout layout)
+{
+	auto it = m_handles.find(&image);
+	if (it != m_handles.end())
+	{
+		m_resources[it->second].importLayout = layout;
+		return;
+	}
+
+	Resource resource;
+	resource.name = image.name;
+	resource.image = &image;
+	resource.importLayout = layout;
+	resource.layout = layout;
+
+	// Transitioned on the graphics queue when it was created
+	if (layout != VK_IMAGE_LAYOUT_UNDEFINED)
+		resource.queue = QueueType::GRAPHICS;
+
+	m_handles[&image] = static_cast<uint32_t>(m_resources.size());
+	m_resources.push_back(std::move(resource));
+}
+
+void vk::RenderGraph::Import(const Buffer& buffer)
+{
+	if (m_handles.count(&buffer))
+		return;
+
+	Resource resource;
+	resource.name = buffer.name;
+	resource.buffer = &buffer;
+
+	m_handles[&buffer] = static_cast<uint32_t>(m_resources.size());
+	m_resources.push_back(std::move(resource));
+}
+
+vk::Image& vk::RenderGraph::CreateImage(const TransientImageDesc& desc)
+{
+	Image& image = m_transientImages.emplace_back();
+
+	Resource resource;
+	resource.name = desc.name;
+	resource.image = &image;
+	resource.transient = true;
+	resource.target = &image;
+	resource.desc = desc;
+
+	const uint32_t index = static_cast<uint32_t>(m_resources.size());
+	m_handles[&image] = index;
+	m_resources.push_back(std::move(resource));
+
+	// Memory of its own until the first Realize knows the lifetimes
+	Resource& created = m_resources[index];
+	CreateTransientImage(created);
+
+	Slot& slot = m_slots.emplace_back();
+	slot.requirements = created.requirements;
+	slot.resources.push_back(index);
+	created.slot = static_cast<uint32_t>(m_slots.size() - 1);
+
+	AllocateSlot(slot, created.slot);
+	BindTransientImage(created);
+
+	return image;
+}
+
+void vk::RenderGraph::BeginFrame()
+{
+	m_passes.clear();
+}
+
+void vk::RenderGraph::AddPass(const std::string& name, const SetupFunction& setup, const ExecuteFunction& execute)
+{
+	Pass& pass = m_passes.emplace_back();
+	pass.name = name;
+	pass.execute = execute;
+
+	PassBuilder builder(*this, static_cast<uint32_t>(m_passes.size() - 1));
+	setup(builder);
+}
+
+bool vk::RenderGraph::Compile()
+{
+	// Walk back from the passes with side effects, a pass survives if anything after it consumes what it writes.
+	// Imported resources outlive the frame, writing one always counts
+	std::vector<bool> consumed(m_resources.size(), false);
+
+	for (int p = static_cast<int>(m_passes.size()) - 1; p >= 0; p--)
+	{
+		Pass& pass = m_passes[p];
+
+		bool live = pass.sideEffect;
+		for (const Use& use : pass.uses)
+		{
+			if (use.write && (!m_resources[use.resource].transient || consumed[use.resource]))
+				live = true;
+		}
+
+		pass.culled = !live;
+		if (!live)
+			continue;
+
+		// Earlier writes to something this pass overwrites are not consumed by anything after it
+		for (const Use& use : pass.uses)
+		{
+			if (use.write && !GetAccessInfo(use.access).read)
+				consumed[use.resource] = false;
+		}
+
+		for (const Use& use : pass.uses)
+		{
+			if (GetAccessInfo(use.access).read)
+				consumed[use.resource] = true;
+		}
+	}
+
+	for (Resource& resource : m_resources)
+	{
+		resource.firstPass = -1;
+		resource.lastPass = -1;
+	}
+
+	for (int p = 0; p < static_cast<int>(m_passes.size()); p++)
+	{
+		if (m_passes[p].culled)
+			continue;
+
+		for (const Use& use : m_passes[p].uses)
+		{
+			Resource& resource = m_resources[use.resource];
+			if (!resource.transient)
+				continue;
+
+			if (resource.firstPass < 0)
+				resource.firstPass = p;
+			resource.lastPass = p;
+		}
+	}
+
+	PlanBatches();
+
+	// The memory plan came from an earlier frame's lifetimes, a different set of passes can make them overlap
+	for (const Slot& slot : m_slots)
+	{
+		for (size_t i = 0; i < slot.resources.size(); i++)
+		{
+			for (size_t j = i + 1; j < slot.resources.size(); j++)
+			{
+				if (Overlaps(m_resources[slot.resources[i]], m_resources[slot.resources[j]]))
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// Walks the surviving passes in order with a copy of where everything was last accessed. A pass joins the open
+// batch of its queue unless it has to wait on more of the other queue than that batch does, and a batch the other
+// queue waits on is closed so nothing recorded into it later delays the waiter
+void vk::RenderGraph::PlanBatches()
+{
+	m_batches.clear();
+	m_releases.clear();
+
+	struct Last
+	{
+		std::optional<QueueType> queue;
+		uint64_t value = 0;
+	};
+
+	std::vector<Last> resources(m_resources.size());
+	for (size_t i = 0; i < m_resources.size(); i++)
+		resources[i] = { m_resources[i].queue, m_resources[i].queueValue };
+
+	std::vector<Last> slots(m_slots.size());
+	for (size_t i = 0; i < m_slots.size(); i++)
+		slots[i] = { m_slots[i].queue, m_slots[i].queueValue };
+
+	std::array<uint64_t, 2> values = m_timelineValues;
+	std::array<int, 2> open = { -1, -1 };   // batch the next pass on the queue joins
+	std::array<int, 2> latest = { -1, -1 }; // last batch this frame on the queue, open or not
+
+	auto addBatch = [&](QueueType queue, uint64_t waitValue) {
+		const uint32_t q = static_cast<uint32_t>(queue);
+		m_batches.push_back({ queue, ++values[q], waitValue, {} });
+		m_releases.emplace_back();
+		latest[q] = static_cast<int>(m_batches.size() - 1);
+		return latest[q];
+	};
+
+	const bool async = enableAsyncCompute && context.HasAsyncCompute();
+
+	for (uint32_t p = 0; p < static_cast<uint32_t>(m_passes.size()); p++)
+	{
+		Pass& pass = m_passes[p];
+		if (pass.culled)
+			continue;
+
+		pass.queue = pass.async && async ? QueueType::COMPUTE : QueueType::GRAPHICS;
+		const uint32_t q = static_cast<uint32_t>(pass.queue);
+		const uint32_t other = 1 - q;
+		const QueueType otherQueue = static_cast<QueueType>(other);
+
+		uint64_t wait = 0;
+		std::vector<std::pair<int, Release>> releases;
+
+		for (const Use& use : pass.uses)
+		{
+			const Resource& resource = m_resources[use.resource];
+			const bool first = resource.transient && resource.firstPass == static_cast<int>(p);
+			const Last& last = first ? slots[resource.slot] : resources[use.resource];
+			if (!last.queue.has_value() || *last.queue == pass.queue)
+				continue;
+
+			wait = std::max(wait, last.value);
+
+			// Overwritten or discarded contents need no handover, the new queue takes the image over from UNDEFINED
+			const AccessInfo info = GetAccessInfo(use.access);
+			if (first || !resource.image || info.layout == VK_IMAGE_LAYOUT_UNDEFINED || (use.write && !info.read))
+				continue;
+
+			bool released = false;
+			for (const auto& pending : releases)
+				released |= pending.second.resource == use.resource;
+			if (released)
+				continue;
+
+			// Released by the batch that accessed it last, or when that was an earlier frame by the other queue's
+			// latest batch of this one, which follows it on that queue
+			int batch = -1;
+			if (last.value > m_timelineValues[other])
+			{
+				for (int b = 0; b < static_cast<int>(m_batches.size()); b++)
+				{
+					if (m_batches[b].queue == otherQueue && m_batches[b].signalValue == last.value)
+						batch = b;
+				}
+			}
+			else
+			{
+				batch = latest[other];
+			}
+
+			if (batch < 0)
+			{
+				batch = addBatch(otherQueue, 0);
+				open[other] = -1;
+			}
+
+			wait = std::max(wait, m_batches[batch].signalValue);
+			releases.push_back({ batch, { use.resource, info.layout } });
+		}
+
+		// The wait happens before the first pass of a batch
+		if (open[q] < 0 || wait > m_batches[open[q]].waitValue)
+			open[q] = addBatch(pass.queue, wait);
+
+		if (open[other] >= 0 && m_batches[open[other]].signalValue <= wait)
+			open[other] = -1;
+
+		Batch& batch = m_batches[open[q]];
+		batch.passes.push_back(p);
+
+		for (const auto& [index, release] : releases)
+			m_releases[index].push_back(release);
+
+		for (const Use& use : pass.uses)
+		{
+			const Resource& resource = m_resources[use.resource];
+			resources[use.resource] = { pass.queue, batch.signalValue };
+			if (resource.transient)
+				slots[resource.slot] = { pass.queue, batch.signalValue };
+		}
+	}
+}
+
+uint32_t vk::RenderGraph::GetFamily(QueueType queue) const
+{
+	return queue == QueueType::COMPUTE ? context.computeFamilyIndex : context.graphicsFamilyIndex;
+}
+
+void vk::RenderGraph::Execute(uint32_t index, VkCommandBuffer cmd, GPUTimer& timer)
+{
+	const Batch& batch = m_batches[index];
+	const QueueType otherQueue = batch.queue == QueueType::COMPUTE ? QueueType::GRAPHICS : QueueType::COMPUTE;
+
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	std::vector<VkBufferMemoryBarrier> bufferBarriers;
+
+	for (uint32_t p : batch.passes)
+	{
+		Pass& pass = m_passes[p];
+
+		imageBarriers.clear();
+		bufferBarriers.clear();
+		VkMemoryBarrier memoryBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+		bool anyBarrier = false;
+
+		pass.srcStages = 0;
+		pass.dstStages = 0;
+		pass.barriers.clear();
+
+		for (const Use& use : pass.uses)
+		{
+			Resource& resource = m_resources[use.resource];
+			const AccessInfo info = GetAccessInfo(use.access);
+			const bool tracksLayout = resource.image && info.layout != VK_IMAGE_LAYOUT_UNDEFINED;
+
+			VkImageLayout oldLayout = resource.layout;
+			bool layoutChange = tracksLayout && info.layout != resource.layout;
+			VkPipelineStageFlags srcStages = 0;
+			VkAccessFlags srcAccess = 0;
+			uint32_t srcFamily = VK_QUEUE_FAMILY_IGNORED;
+			uint32_t dstFamily = VK_QUEUE_FAMILY_IGNORED;
+			bool needed = false;
+
+			const bool first = resource.transient && resource.firstPass == static_cast<int>(p);
+			const bool otherQueueLast = !first && resource.queue.has_value() && *resource.queue != batch.queue;
+
+			// Stages recorded on the other queue mean nothing here, the wait on its timeline already covers them
+			if (otherQueueLast)
+			{
+				resource.writeStages = 0;
+				resource.writeAccess = 0;
+				resource.readStages = 0;
+				resource.visibleStages = 0;
+			}
+
+			if (first)
+			{
+				// First use this frame, the contents are discarded but whatever shared the memory before has to finish
+				Slot& slot = m_slots[resource.slot];
+				const bool sameQueue = !slot.queue.has_value() || *slot.queue == batch.queue;
+				srcStages = sameQueue ? slot.stages : 0;
+				srcAccess = sameQueue ? slot.writeAccess : 0;
+				oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+				layoutChange = tracksLayout;
+				needed = layoutChange || srcStages != 0;
+
+				slot.stages = 0;
+				slot.writeAccess = 0;
+			}
+			else if (resource.released)
+			{
+				// Acquire what the other queue released at the end of a batch this one waited on, with the same layouts
+				srcFamily = GetFamily(*resource.queue);
+				dstFamily = GetFamily(batch.queue);
+				oldLayout = resource.releaseLayout;
+				layoutChange = true;
+				needed = true;
+				resource.released = false;
+			}
+			else if (otherQueueLast)
+			{
+				// Not handed over, this use overwrites it. An image starts over from UNDEFINED on this queue
+				oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+				layoutChange = tracksLayout;
+				needed = layoutChange;
+			}
+			else if (layoutChange || info.write)
+			{
+				// Write after read or write, the transition counts as a write too
+				srcStages = resource.writeStages | resource.readStages;
+				srcAccess = resource.writeAccess;
+				needed = layoutChange || srcStages != 0;
+			}
+			else
+			{
+				// Read after write, once for every stage reading it
+				srcStages = resource.writeStages;
+				srcAccess = resource.writeAccess;
+				needed = srcStages != 0 && (info.stages & ~resource.visibleStages) != 0;
+			}
+
+			if (needed)
+			{
+				anyBarrier = true;
+				pass.srcStages |= srcStages;
+				pass.dstStages |= info.stages;
+
+				if (tracksLayout)
+				{
+					VkImageMemoryBarrier barrier = {
+						.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+						.srcAccessMask = srcAccess,
+						.dstAccessMask = info.access,
+						.oldLayout = oldLayout,
+						.newLayout = info.layout,
+						.srcQueueFamilyIndex = srcFamily,
+						.dstQueueFamilyIndex = dstFamily,
+						.image = resource.image->image,
+						.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS }
+					};
+					imageBarriers.push_back(barrier);
+					pass.barriers.push_back(resource.name + "  " + LayoutName(oldLayout) + " -> " + LayoutName(info.layout) +
+						(srcFamily != dstFamily ? std::string("  acquired from ") + QueueName(otherQueue) : std::string()));
+				}
+				else if (resource.buffer)
+				{
+					VkBufferMemoryBarrier barrier = {
+						.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+						.srcAccessMask = srcAccess,
+						.dstAccessMask = info.access,
+						.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+						.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+						.buffer = resource.buffer->buffer,
+						.offset = 0,
+						.size = VK_WHOLE_SIZE
+					};
+					bufferBarriers.push_back(barrier);
+					pass.barriers.push_back(resource.name + "  buffer");
+				}
+				else
+				{
+					// Attachments, their render pass does the layout transition
+					memoryBarrier.srcAccessMask |= srcAccess;
+					memoryBarrier.dstAccessMask |= info.access;
+					pass.barriers.push_back(resource.name + "  memory, render pass transitions to " + LayoutName(use.finalLayout));
+				}
+			}
+
+			if (info.write)
+			{
+				resource.layout = tracksLayout ? info.layout : (resource.image ? use.finalLayout : resource.layout);
+				resource.writeStages = info.stages;
+				resource.writeAccess = info.access & WRITE_ACCESS;
+				resource.readStages = 0;
+				resource.visibleStages = 0;
+			}
+			else if (layoutChange)
+			{
+				resource.layout = info.layout;
+				resource.writeStages = info.stages;
+				resource.writeAccess = 0;
+				resource.readStages = info.stages;
+				resource.visibleStages = info.stages;
+			}
+			else
+			{
+				resource.readStages |= info.stages;
+				if (needed)
+					resource.visibleStages |= info.stages;
+			}
+
+			resource.queue = batch.queue;
+			resource.queueValue = batch.signalValue;
+
+			if (resource.transient)
+			{
+				Slot& slot = m_slots[resource.slot];
+				if (slot.queue.has_value() && *slot.queue != batch.queue)
+				{
+					slot.stages = 0;
+					slot.writeAccess = 0;
+				}
+
+				slot.stages |= info.stages;
+				if (info.write)
+					slot.writeAccess |= info.access & WRITE_ACCESS;
+				slot.queue = batch.queue;
+				slot.queueValue = batch.signalValue;
+			}
+		}
+
+		timer.Begin(cmd, pass.name, batch.queue == QueueType::COMPUTE);
+
+		if (anyBarrier)
+		{
+			vkCmdPipelineBarrier(
+				cmd,
+				pass.srcStages != 0 ? pass.srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+				pass.dstStages,
+				0,
+				memoryBarrier.srcAccessMask != 0 || memoryBarrier.dstAccessMask != 0 ? 1 : 0, &memoryBarrier,
+				static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+				static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data()
+			);
+		}
+
+		const auto recordStart = std::chrono::steady_clock::now();
+		pass.execute(cmd);
+		pass.cpuMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
+
+		timer.End(cmd);
+	}
+
+	// Hand over what the other queue reads next, after every access on this one. The acquire does the rest
+	imageBarriers.clear();
+	VkPipelineStageFlags releaseStages = 0;
+	for (const Release& release : m_releases[index])
+	{
+		Resource& resource = m_resources[release.resource];
+
+		VkImageMemoryBarrier barrier = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = resource.writeAccess,
+			.dstAccessMask = 0,
+			.oldLayout = resource.layout,
+			.newLayout = release.layout,
+			.srcQueueFamilyIndex = GetFamily(batch.queue),
+			.dstQueueFamilyIndex = GetFamily(otherQueue),
+			.image = resource.image->image,
+			.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS }
+		};
+		imageBarriers.push_back(barrier);
+		releaseStages |= resource.writeStages | resource.readStages;
+
+		resource.released = true;
+		resource.releaseLayout = resource.layout;
+		resource.layout = release.layout;
+	}
+
+	if (!imageBarriers.empty())
+	{
+		vkCmdPipelineBarrier(
+			cmd,
+			releaseStages != 0 ? releaseStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data()
+		);
+	}
+
+	m_timelineValues[static_cast<uint32_t>(batch.queue)] = batch.signalValue;
+}
+
+std::vector<vk::RenderGraph::PassTiming> vk::RenderGraph::GetCPUTimings() const
+{
+	std::vector<PassTiming> timings;
+	for (const Pass& pass : m_passes)
+	{
+		if (!pass.culled)
+			timings.push_back({ pass.name, pass.cpuMilliseconds });
+	}
+	return timings;
+}
+
+void vk::RenderGraph::Realize()
+{
+	DestroyTransients();
+
+	std::vector<uint32_t> transients;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(m_resources.size()); i++)
+	{
+		if (!m_resources[i].transient)
+			continue;
+
+		CreateTransientImage(m_resources[i]);
+		transients.push_back(i);
+	}
+
+	// Largest first, each one joins the first allocation whose images it never overlaps
+	std::stable_sort(transients.begin(), transients.end(), [this](uint32_t a, uint32_t b) {
+		return m_resources[a].requirements.size > m_resources[b].requirements.size;
+	});
+
+	for (uint32_t index : transients)
+	{
+		Resource& resource = m_resources[index];
+
+		Slot* target = nullptr;
+		for (Slot& slot : m_slots)
+		{
+			if ((slot.requirements.memoryTypeBits & resource.requirements.memoryTypeBits) == 0)
+				continue;
+
+			const bool disjoint = std::none_of(slot.resources.begin(), slot.resources.end(), [&](uint32_t other) {
+				return Overlaps(resource, m_resources[other]);
+			});
+
+			if (disjoint)
+			{
+				target = &slot;
+				break;
+			}
+		}
+
+		if (target == nullptr)
+		{
+			target = &m_slots.emplace_back();
+			target->requirements = resource.requirements;
+		}
+
+		target->requirements.size = std::max(target->requirements.size, resource.requirements.size);
+		target->requirements.alignment = std::max(target->requirements.alignment, resource.requirements.alignment);
+		target->requirements.memoryTypeBits &= resource.requirements.memoryTypeBits;
+		target->resources.push_back(index);
+		resource.slot = static_cast<uint32_t>(target - m_slots.data());
+	}
+
+	for (uint32_t i = 0; i < static_cast<uint32_t>(m_slots.size()); i++)
+		AllocateSlot(m_slots[i], i);
+
+	for (uint32_t index : transients)
+		BindTransientImage(m_resources[index]);
+}
+
+void vk::RenderGraph::ResetState()
+{
+	for (Resource& resource : m_resources)
+	{
+		resource.layout = resource.transient ? VK_IMAGE_LAYOUT_UNDEFINED : resource.importLayout;
+		resource.writeStages = 0;
+		resource.writeAccess = 0;
+		resource.readStages = 0;
+		resource.visibleStages = 0;
+
+		// The device is idle, whatever was recreated was transitioned on the graphics queue
+		resource.queue = !resource.transient && resource.importLayout != VK_IMAGE_LAYOUT_UNDEFINED ? std::optional<QueueType>(QueueType::GRAPHICS) : std::nullopt;
+		resource.queueValue = 0;
+		resource.released = false;
+	}
+
+	for (Slot& slot : m_slots)
+	{
+		slot.stages = 0;
+		slot.writeAccess = 0;
+		slot.queue = std::nullopt;
+		slot.queueValue = 0;
+	}
+}
+
+void vk::RenderGraph::Dump(std::ostream& out) const
+{
+	char line[256];
+
+	std::snprintf(line, sizeof(line), "Render graph: %u passes, %u culled\n", GetPassCount(), GetCulledCount());
+	out << line;
+
+	for (uint32_t p = 0; p < static_cast<uint32_t>(m_passes.size()); p++)
+	{
+		const Pass& pass = m_passes[p];
+		std::snprintf(line, sizeof(line), "  [%2u] %s%s\n", p, pass.name.c_str(), pass.culled ? "  (culled, nothing reads its outputs)" : pass.queue == QueueType::COMPUTE ? "  (compute queue)" : "");
+		out << line;
+
+		for (const Use& use : pass.uses)
+		{
+			std::snprintf(line, sizeof(line), "         %-6s %-32s %s\n", use.write ? "write" : "read", m_resources[use.resource].name.c_str(), GetAccessInfo(use.access).name);
+			out << line;
+		}
+
+		if (!pass.culled && !pass.barriers.empty())
+		{
+			out << "         barrier " << StageNames(pass.srcStages != 0 ? pass.srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT) << " -> " << StageNames(pass.dstStages) << "\n";
+			for (const std::string& barrier : pass.barriers)
+				out << "           " << barrier << "\n";
+		}
+	}
+
+	std::snprintf(line, sizeof(line), "Batches: %zu\n", m_batches.size());
+	out << line;
+
+	for (size_t b = 0; b < m_batches.size(); b++)
+	{
+		const Batch& batch = m_batches[b];
+		std::snprintf(line, sizeof(line), "  %-8s signals %llu", QueueName(batch.queue), static_cast<unsigned long long>(batch.signalValue));
+		out << line;
+		if (batch.waitValue != 0)
+		{
+			std::snprintf(line, sizeof(line), ", waits %s %llu", QueueName(batch.queue == QueueType::COMPUTE ? QueueType::GRAPHICS : QueueType::COMPUTE), static_cast<unsigned long long>(batch.waitValue));
+			out << line;
+		}
+		out << ":";
+
+		for (uint32_t p : batch.passes)
+			out << " " << m_passes[p].name;
+		for (const Release& release : m_releases[b])
+			out << "  release " << m_resources[release.resource].name;
+		out << "\n";
+	}
+
+	const VkDeviceSize allocated = GetTransientBytes();
+	const VkDeviceSize unaliased = GetUnaliasedBytes();
+	std::snprintf(line, sizeof(line), "Transient memory: %u images in %u allocations, %.1f MB instead of %.1f MB (%.1f MB saved)\n",
+		GetTransientCount(), GetAllocationCount(), Megabytes(allocated), Megabytes(unaliased), Megabytes(unaliased - allocated));
+	out << line;
+
+	for (uint32_t i = 0; i < static_cast<uint32_t>(m_slots.size()); i++)
+	{
+		std::snprintf(line, sizeof(line), "  allocation %u, %.1f MB:", i, Megabytes(m_slots[i].requirements.size));
+		out << line;
+
+		for (uint32_t index : m_slots[i].resources)
+		{
+			const Resource& resource = m_resources[index];
+			if (resource.firstPass < 0)
+				std::snprintf(line, sizeof(line), " %s (unused)", resource.name.c_str());
+			else
+				std::snprintf(line, sizeof(line), " %s [%d-%d]", resource.name.c_str(), resource.firstPass, resource.lastPass);
+			out << line;
+		}
+		out << "\n";
+	}
+}
+
+uint32_t vk::RenderGraph::GetCulledCount() const
+{
+	return static_cast<uint32_t>(std::count_if(m_passes.begin(), m_passes.end(), [](const Pass& pass) { return pass.culled; }));
+}
+
+VkDeviceSize vk::RenderGraph::GetTransientBytes() const
+{
+	return std::accumulate(m_slots.begin(), m_slots.end(), VkDeviceSize(0), [](VkDeviceSize sum, const Slot& slot) { return sum + slot.requirements.size; });
+}
+
+VkDeviceSize vk::RenderGraph::GetUnaliasedBytes() const
+{
+	VkDeviceSize bytes = 0;
+	for (const Resource& resource : m_resources)
+	{
+		if (resource.transient)
+			bytes += resource.requirements.size;
+	}
+	return bytes;
+}
+
+uint32_t vk::RenderGraph::Find(const void* handle, const std::string& name) const
+{
+	auto it = m_handles.find(handle);
+	if (it == m_handles.end())
+		throw std::runtime_error("Render graph: " + name + " is used by a pass but was never imported");
+	return it->second;
+}
+
+void vk::RenderGraph::AddUse(uint32_t pass, uint32_t resource, Access access, bool write, VkImageLayout finalLayout)
+{
+	m_passes[pass].uses.push_back({ resource, access, write, finalLayout });
+}
+
+void vk::RenderGraph::CreateTransientImage(Resource& resource)
+{
+	const VkExtent2D extent = GetExtent(resource);
+
+	VkImageCreateInfo imageInfo{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent = { extent.width, extent.height, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = resource.desc.format;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = resource.desc.usage;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	Image& image = *resource.target;
+	image.name = resource.desc.name;
+	image.allocator = context.allocator;
+
+	VK_CHECK(vkCreateImage(context.device, &imageInfo, nullptr, &image.image), "Failed to create transient image");
+	context.SetObjectName(context.device, (uint64_t)image.image, VK_OBJECT_TYPE_IMAGE, image.name.c_str());
+
+	vkGetImageMemoryRequirements(context.device, image.image, &resource.requirements);
+}
+
+void vk::RenderGraph::BindTransientImage(Resource& resource)
+{
+	Image& image = *resource.target;
+	image.allocation = m_slots[resource.slot].allocation;
+
+	VK_CHECK(vmaBindImageMemory(context.allocator, image.allocation, image.image), "Failed to bind transient image memory");
+
+	VkImageViewCreateInfo viewInfo{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+	viewInfo.image = image.image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = resource.desc.format;
+	viewInfo.subresourceRange = VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	VK_CHECK(vkCreateImageView(context.device, &viewInfo, nullptr, &image.imageView), "Failed to create transient image view");
+	context.SetObjectName(context.device, (uint64_t)image.imageView, VK_OBJECT_TYPE_IMAGE_VIEW, image.name.c_str());
+
+	resource.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	resource.writeStages = 0;
+	resource.writeAccess = 0;
+	resource.readStages = 0;
+	resource.visibleStages = 0;
+}
+
+void vk::RenderGraph::AllocateSlot(Slot& slot, uint32_t index)
+{
+	VmaAllocationCreateInfo allocInfo = {
+		.usage = VMA_MEMORY_USAGE_UNKNOWN,
+		.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	};
+
+	VK_CHECK(vmaAllocateMemory(context.allocator, &slot.requirements, &allocInfo, &slot.allocation, nullptr), "Failed to allocate transient image memory");
+
+	const std::string name = "RenderGraphTransient" + std::to_string(index);
+	vmaSetAllocationName(context.allocator, slot.allocation, name.c_str());
+}
+
+// Not Image::Destroy, the memory belongs to the slot and may be shared
+void vk::RenderGraph::DestroyTransients()
+{
+	for (Image& image : m_transientImages)
+	{
+		vkDestroyImageView(context.device, image.imageView, nullptr);
+		vkDestroyImage(context.device, image.image, nullptr);
+		image.imageView = VK_NULL_HANDLE;
+		image.image = VK_NULL_HANDLE;
+		image.allocation = VK_NULL_HANDLE;
+	}
+
+	for (Slot& slot : m_slots)
+		vmaFreeMemory(context.allocator, slot.allocation);
+	m_slots.clear();
+
+	for (Resource& resource : m_resources)
+		resource.slot = UINT32_MAX;
+}
+
+bool vk::RenderGraph::Overlaps(const Resource& a, const Resource& b) const
+{
+	if (a.firstPass < 0 || b.firstPass < 0)
+		return false;
+	return a.firstPass <= b.lastPass && b.firstPass <= a.lastPass;
+}
+
+VkExtent2D vk::RenderGraph::GetExtent(const Resource& resource) const
+{
+	if (resource.desc.extent == TransientExtent::RESERVOIR_GRID)
+		return GetReservoirExtent(context.extent, restirResolution);
+	return context.extent;
+}
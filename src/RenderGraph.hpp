@@ -0,0 +1,261 @@
+#pragma once
+#include <volk/volk.h>
+#include <vk_mem_alloc.h>
+#include <array>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Image.hpp"
+
+namespace vk
+{
+	class Context;
+	class Buffer;
+	class GPUTimer;
+
+	// How a pass touches a resource, each maps to the stage, access mask and image layout it is synchronised with
+	enum class Access
+	{
+		COMPUTE_READ,        // storage buffer or storage image
+		COMPUTE_WRITE,
+		COMPUTE_READ_WRITE,
+		COMPUTE_SAMPLE,      // combined image sampler
+		FRAGMENT_SAMPLE,
+		COLOR_ATTACHMENT,    // the render pass transitions the layout itself, the graph only orders it
+		TRANSFER_READ,
+		TRANSFER_WRITE
+	};
+
+	// Queue a pass is recorded for
+	enum class QueueType : uint32_t
+	{
+		GRAPHICS = 0,
+		COMPUTE = 1     // only with a compute only family and enableAsyncCompute, otherwise the graphics queue
+	};
+
+	// Extent a transient image is realised at
+	enum class TransientExtent
+	{
+		SWAPCHAIN,
+		RESERVOIR_GRID
+	};
+
+	struct TransientImageDesc
+	{
+		std::string name;
+		VkFormat format;
+		VkImageUsageFlags usage;
+		TransientExtent extent = TransientExtent::SWAPCHAIN;
+	};
+
+	// Frame graph over the renderer's passes
+	// Passes are declared every frame with the resources they read and write. Compile culls the passes whose
+	// outputs nothing consumes, Execute records the rest with one batched barrier in front of each, derived from
+	// the last access to every resource. Transient images only live within a frame, Realize places the ones
+	// whose lifetimes never overlap in the same memory.
+	// Passes marked AsyncCompute run on the compute queue. Compile splits the frame into batches, runs of passes
+	// on one queue submitted together, each signalling the next value of its queue's timeline semaphore and
+	// waiting on the other queue's timeline only where a pass touches something the other queue touched last.
+	// Images whose contents cross queues are handed over with a release barrier at the end of the batch that
+	// last accessed them and an acquire in front of the pass that needs them; buffers are created concurrent
+	class RenderGraph
+	{
+	public:
+		class PassBuilder
+		{
+		public:
+			PassBuilder& Read(const Image& image, Access access);
+			PassBuilder& Read(const Buffer& buffer, Access access);
+
+			// Attachments pass the layout their render pass leaves them in
+			PassBuilder& Write(const Image& image, Access access, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+			PassBuilder& Write(const Buffer& buffer, Access access);
+
+			// Kept even though nothing in the graph reads its outputs, e.g. presenting
+			PassBuilder& SideEffect();
+
+			// Compute and transfer commands only, recorded for the compute queue when the device has one
+			PassBuilder& AsyncCompute();
+
+		private:
+			friend class RenderGraph;
+			PassBuilder(RenderGraph& graph, uint32_t pass) : graph{ graph }, pass{ pass } {}
+
+			RenderGraph& graph;
+			uint32_t pass;
+		};
+
+		struct PassTiming
+		{
+			std::string name;
+			double cpuMilliseconds;
+		};
+
+		// Passes recorded into one command buffer and submitted to one queue. A batch starts wherever a pass has to
+		// wait on the other queue and ends wherever the other queue waits on it, so only the dependent work waits
+		struct Batch
+		{
+			QueueType queue;
+			uint64_t signalValue;          // on its queue's timeline once it is done
+			uint64_t waitValue;            // on the other queue's timeline before it starts, 0 when it waits on nothing
+			std::vector<uint32_t> passes;  // empty when it only hands images over to the other queue
+		};
+
+		using SetupFunction = std::function<void(PassBuilder&)>;
+		using ExecuteFunction = std::function<void(VkCommandBuffer)>;
+
+		explicit RenderGraph(Context& context);
+		~RenderGraph();
+
+		RenderGraph(const RenderGraph&) = delete;
+		RenderGraph& operator=(const RenderGraph&) = delete;
+
+		// Persistent resources owned by the passes, layout is the one their pass leaves them in after creating them
+		void Import(const Image& image, VkImageLayout layout);
+		void Import(const Buffer& buffer);
+
+		// Owned by the graph, the contents do not survive the frame. The reference stays valid across Realize
+		Image& CreateImage(const TransientImageDesc& desc);
+
+		// Drops last frame's passes, the resources and what the graph knows about them are kept
+		void BeginFrame();
+		void AddPass(const std::string& name, const SetupFunction& setup, const ExecuteFunction& execute);
+
+		// Culls, computes the transient lifetimes and splits the passes into batches, false if two transients
+		// sharing memory now overlap
+		bool Compile();
+
+		// Records one batch, the batches have to be recorded in order and submitted as GetBatches describes them
+		void Execute(uint32_t batch, VkCommandBuffer cmd, GPUTimer& timer);
+		const std::vector<Batch>& GetBatches() const { return m_batches; }
+
+		// Value the last recorded batch on the queue signals, the frame is done once both queues reached theirs
+		uint64_t GetTimelineValue(QueueType queue) const { return m_timelineValues[static_cast<uint32_t>(queue)]; }
+
+		// Recreates every transient at the current extent, aliased from the last compiled lifetimes
+		// The device must be idle and the passes have to rebind the new views afterwards
+		void Realize();
+
+		// Imported resources were recreated in the layout they were imported with
+		void ResetState();
+
+		void Dump(std::ostream& out) const;
+
+		uint32_t GetPassCount() const { return static_cast<uint32_t>(m_passes.size()); }
+		uint32_t GetCulledCount() const;
+		uint32_t GetTransientCount() const { return static_cast<uint32_t>(m_transientImages.size()); }
+		uint32_t GetAllocationCount() const { return static_cast<uint32_t>(m_slots.size()); }
+		VkDeviceSize GetTransientBytes() const;     // memory the transients are allocated in
+		VkDeviceSize GetUnaliasedBytes() const;     // what they would take with memory of their own
+
+		// Time the execute functions of the last executed frame took to record, culled passes are left out
+		std::vector<PassTiming> GetCPUTimings() const;
+
+	private:
+		struct Resource
+		{
+			std::string name;
+			const Image* image = nullptr;
+			const Buffer* buffer = nullptr;
+			bool transient = false;
+			VkImageLayout importLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			// Last access, carried over from frame to frame
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags writeStages = 0;
+			VkAccessFlags writeAccess = 0;
+			VkPipelineStageFlags readStages = 0;    // reads since the last write
+			VkPipelineStageFlags visibleStages = 0; // stages the last write has been made visible to
+
+			// Queue that accessed it last and owns it if it is an image, none until one has.
+			// The stages above are that queue's, a use on the other queue waits on queueValue instead
+			std::optional<QueueType> queue;
+			uint64_t queueValue = 0;                // timeline value of the batch that accessed it last
+			bool released = false;                  // handed to the other queue, its next use there acquires it
+			VkImageLayout releaseLayout = VK_IMAGE_LAYOUT_UNDEFINED; // what the release transitioned from
+
+			// Transient images only
+			Image* target = nullptr;
+			TransientImageDesc desc = {};
+			VkMemoryRequirements requirements = {};
+			uint32_t slot = UINT32_MAX;
+			int firstPass = -1; // compiled lifetime, -1 when no pass left after culling uses it
+			int lastPass = -1;
+		};
+
+		struct Use
+		{
+			uint32_t resource;
+			Access access;
+			bool write;
+			VkImageLayout finalLayout;
+		};
+
+		struct Pass
+		{
+			std::string name;
+			ExecuteFunction execute;
+			std::vector<Use> uses;
+			bool sideEffect = false;
+			bool async = false;
+			bool culled = false;
+			QueueType queue = QueueType::GRAPHICS; // resolved by Compile
+			double cpuMilliseconds = 0.0;
+
+			// Barrier recorded in front of the pass last time it executed, kept for Dump
+			VkPipelineStageFlags srcStages = 0;
+			VkPipelineStageFlags dstStages = 0;
+			std::vector<std::string> barriers;
+		};
+
+		// Memory shared by transients whose lifetimes never overlap
+		struct Slot
+		{
+			VmaAllocation allocation = VK_NULL_HANDLE;
+			VkMemoryRequirements requirements = {};
+			std::vector<uint32_t> resources;
+
+			// Every access to any of its images since the last discard, the next first use waits on them
+			VkPipelineStageFlags stages = 0;
+			VkAccessFlags writeAccess = 0;
+
+			// Last access to any of its images, on the other queue the next first use waits on its timeline
+			std::optional<QueueType> queue;
+			uint64_t queueValue = 0;
+		};
+
+		// Ownership of an image handed to the other queue at the end of a batch
+		struct Release
+		{
+			uint32_t resource;
+			VkImageLayout layout; // the acquiring use's, release and acquire transition to it alike
+		};
+
+		uint32_t Find(const void* handle, const std::string& name) const;
+		void AddUse(uint32_t pass, uint32_t resource, Access access, bool write, VkImageLayout finalLayout);
+		void PlanBatches();
+		uint32_t GetFamily(QueueType queue) const;
+
+		void CreateTransientImage(Resource& resource);
+		void BindTransientImage(Resource& resource);
+		void AllocateSlot(Slot& slot, uint32_t index);
+		void DestroyTransients();
+		bool Overlaps(const Resource& a, const Resource& b) const;
+		VkExtent2D GetExtent(const Resource& resource) const;
+
+		Context& context;
+		std::vector<Resource> m_resources;
+		std::unordered_map<const void*, uint32_t> m_handles; // Image or Buffer address to its resource
+		std::deque<Image> m_transientImages;
+		std::vector<Slot> m_slots;
+		std::vector<Pass> m_passes;
+
+		std::vector<Batch> m_batches;
+		std::vector<std::vector<Release>> m_releases; // recorded at the end of the batch with the same index
+		std::array<uint64_t, 2> m_timelineValues = {}; // last value signalled by a recorded batch, per queue
+	};
+}
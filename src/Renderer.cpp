@@ -3,8 +3,11 @@
 #include "Utils.hpp"
 #include "Light.hpp"
 #include "ImGuiRenderer.hpp"
+#include "PipelineCompiler.hpp"
+#include "BindlessHeap.hpp"
+#include "UniformArena.hpp"
 
-#include <glm/gtc/random.hpp>
+#include <chrono>
 
 namespace
 {
@@ -16,20 +19,17 @@ namespace
 	constexpr glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0);
 }
 
-vk::Renderer::Renderer(Context& context) : context{context}
+vk::Renderer::Renderer(Context& context) :
+	context{context},
+	m_frameTimeline{ VK_NULL_HANDLE },
+	m_computeTimeline{ VK_NULL_HANDLE },
+	m_frameWaitMilliseconds{ 0.0 }
 {
 	std::printf("Launching Renderer\n");
 	vk::renderType = RenderType::RAYPASS;
 
 	CreateResources();
 
-	m_materialManager.materials.reserve(131);
-	for (int i = 0; i < 132; ++i) {
-		m_materialManager.materials.emplace_back(context);
-	}
-
-	m_materialManager.Setup(context);
-
 	// Samplers
 	repeatSamplerAniso	 	  = CreateSampler(context, VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_TRUE,  VK_COMPARE_OP_LESS_OR_EQUAL);
 	repeatSampler			  = CreateSampler(context, VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_FALSE, VK_COMPARE_OP_LESS_OR_EQUAL);
@@ -50,26 +50,6 @@ vk::Renderer::Renderer(Context& context) : context{context}
 	directionalLight.position = glm::vec4(-8.161, 23.6f, 4.0f, 1.0f); // -0.2972
 	directionalLight.colour   = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
 
-	/*********** REPLACE LIGHTING POSITIONS ***********/
-	std::vector<glm::vec4> spotLightPositions;
-	const int gridSize = 10;
-	const float xStart = -1000.0f;
-	const float zStart = -400.0f;
-	const float yStart = 30.0f;
-	const float xSpacing = 230.0f;
-	const float zSpacing = 100.0f;
-	const float ySpacing = 20.0f;
-
-	for (size_t i = 0; i < gridSize; i++) {
-		for (size_t j = 0; j < gridSize; j++) {
-			float x = xStart + i * xSpacing;
-			float y = yStart + i * ySpacing;
-			float z = zStart + j * zSpacing;
-			spotLightPositions.push_back(glm::vec4(x, y, z, 1.0f));
-		}
-	}
-	/*********** REPLACE LIGHTING POSITIONS ***********/
-
 	// Create the scene which will store models and lights
 	// Add GLTF to the scene
 	auto gltf = vk::LoadGLTF(context, "assets/GLTF/Sponza/Sponza.gltf"); // assets/GLTF/cornell/cornell_pbr_no_sphere.gltf
@@ -78,22 +58,9 @@ vk::Renderer::Renderer(Context& context) : context{context}
 
 	m_scene->AddModel(gltf, m_materialManager);
 
-	// Loop through the positions and instantiate a light
-	// and pass to the scene to add the lights to the scene
-	for (const auto& position : spotLightPositions)
-	{
-		Light spotLight = {};
-		spotLight.Type = LightType::Spot;
-		spotLight.basePosition = position;
-		spotLight.position = position;
-		spotLight.colour = glm::vec4(
-			glm::linearRand(0.0f, 1.0f),
-			glm::linearRand(0.0f, 1.f),
-			glm::linearRand(0.0f, 1.0f),
-			1.0f
-		);
+	// Same seeded grid the reference renders, so both images light the scene identically
+	for (Light& spotLight : CreateSpotLightGrid())
 		m_scene->AddLightSource(spotLight);
-	}
 
 	// Models should now all be loaded
 	// We have the data to build materials
@@ -101,30 +68,82 @@ vk::Renderer::Renderer(Context& context) : context{context}
 
 	std::cout << "Number of Lights: " << m_scene->GetLights().size() << std::endl;
 
-	// Renderer passes
+	// Renderer passes, their constructors queue their pipelines on the compiler's worker threads
+	const auto passesStart = std::chrono::steady_clock::now();
+	const double compileStart = context.pipelineMilliseconds.load();
+
+	// Orders the passes below and owns their transient render targets
+	m_RenderGraph = std::make_unique<RenderGraph>(context);
+
 	m_GBuffer = std::make_unique<GBuffer>(context, m_scene, m_camera);
 
-	m_CandidatesPass = std::make_unique<Candidates>(context, m_scene, m_camera, m_GBuffer->GetGBufferMRT());
+	// Light tiles are drawn from the light distribution once per frame and shared by all candidate workgroups
+	m_LightTilesPass = std::make_unique<LightTiles>(context, m_scene);
+
+	// Ray and reservoir counters written by the ReSTIR passes, read back a frame later
+	m_GPUStats = std::make_unique<GPUStats>(context);
+
+	// Blue noise and Poisson disk tables for low discrepancy candidate and neighbour sampling
+	m_Sampling = std::make_unique<Sampling>(context);
 
-	m_MotionVectorsPass = std::make_unique<MotionVectors>(context, m_camera, m_GBuffer->GetGBufferMRT().WorldPositions);
+	m_CandidatesPass = std::make_unique<Candidates>(context, m_scene, m_camera, m_GBuffer->GetGBufferMRTs(), m_LightTilesPass->GetLightTileBuffers(), m_GPUStats->GetBuffers(), m_Sampling->GetBuffer());
 
-	m_TemporalComputePass = std::make_unique<TemporalCompute>(context, m_scene, m_camera, m_CandidatesPass->GetInitialCandidates(), m_MotionVectorsPass->GetRenderTarget(), m_GBuffer->GetGBufferMRT());
+	m_MotionVectorsPass = std::make_unique<MotionVectors>(context, m_camera, m_GBuffer->GetGBufferMRTs());
+
+	m_TemporalComputePass = std::make_unique<TemporalCompute>(context, m_scene, m_camera, m_CandidatesPass->GetInitialCandidates(), m_MotionVectorsPass->GetRenderTargets(), m_GBuffer->GetGBufferMRTs(), m_GPUStats->GetBuffers(), m_CandidatesPass->GetAdaptiveHistory());
+
+	// Fused alternative to the two passes above, writes into the same reservoir buffers
+	m_CandidatesTemporalPass = std::make_unique<CandidatesTemporal>(context, m_scene, m_camera, *m_CandidatesPass, *m_TemporalComputePass, m_MotionVectorsPass->GetRenderTargets(), m_GBuffer->GetGBufferMRTs(), m_LightTilesPass->GetLightTileBuffers(), m_GPUStats->GetBuffers(), m_Sampling->GetBuffer());
 
 	// Spatial pass will take in the temporal resampled reservoir results and spatially reuse to resample
-	m_SpatialComputePass = std::make_unique<SpatialCompute>(context, m_scene, m_camera, m_CandidatesPass->GetInitialCandidates(), m_TemporalComputePass->GetRenderTarget(), m_GBuffer->GetGBufferMRT());
+	m_SpatialComputePass = std::make_unique<SpatialCompute>(context, m_scene, m_camera, m_CandidatesPass->GetInitialCandidates(), m_TemporalComputePass->GetRenderTarget(), m_GBuffer->GetGBufferMRTs(), m_GPUStats->GetBuffers(), m_Sampling->GetBuffer());
+
+	m_ShadingPass = std::make_unique<ShadingPass>(context, m_scene, m_camera, m_GBuffer->GetGBufferMRTs(), m_CandidatesPass->GetInitialCandidates(), m_TemporalComputePass->GetRenderTarget(), m_SpatialComputePass->GetRenderTarget(), m_GPUStats->GetBuffers(), *m_RenderGraph);
 
-	m_ShadingPass = std::make_unique<ShadingPass>(context, m_scene, m_camera, m_GBuffer->GetGBufferMRT(), m_CandidatesPass->GetInitialCandidates(), m_TemporalComputePass->GetRenderTarget(), m_SpatialComputePass->GetRenderTarget());
+	// SVGF on the shading result, reprojected with the motion vectors, presented instead of it when enabled
+	m_Denoiser = std::make_unique<Denoiser>(context, m_ShadingPass->GetRenderTarget(), m_MotionVectorsPass->GetRenderTargets(), m_GBuffer->GetGBufferMRTs(), *m_RenderGraph);
 
 	// Whichever mode you select in the shading pass, will be the mode that is then accumualated in the history pass
 	m_HistoryPass = std::make_unique<History>(context, m_ShadingPass->GetRenderTarget());
 
+	// Error of the presented image against a reference the history pass accumulates, idle until started from ImGui
+	m_ConvergenceBenchmark = std::make_unique<ConvergenceBenchmark>(context, m_ShadingPass->GetRenderTarget(), m_Denoiser->GetRenderTarget(), m_HistoryPass->GetRenderTarget());
+
 	// Shading pass is sent to composite to be gamma corrected
-	m_CompositePass		= std::make_unique<Composite>(context, m_ShadingPass->GetRenderTarget());
+	m_CompositePass		= std::make_unique<Composite>(context, m_ShadingPass->GetRenderTarget(), *m_RenderGraph);
 
 	// Currently passing the spatial pass result to the composite to display, switch to RayPass to show initial candidates
-	m_PresentPass		= std::make_unique<PresentPass>(context, m_ShadingPass->GetRenderTarget(), m_HistoryPass->GetRenderTarget());
+	m_PresentPass		= std::make_unique<PresentPass>(context, m_ShadingPass->GetRenderTarget(), m_HistoryPass->GetRenderTarget(), m_Denoiser->GetRenderTarget());
+
+	// Copies the selected target into host memory when asked to, written to disk on worker threads
+	m_FrameCapture = std::make_unique<FrameCapture>(context, m_ShadingPass->GetRenderTarget(), m_CompositePass->GetRenderTarget(), m_HistoryPass->GetRenderTarget());
+
+	// Per pass GPU timings, shown in ImGui and used by the spatial reuse benchmark
+	m_GPUTimer = std::make_unique<GPUTimer>(context);
+
+	// Internal render resolution steered by the GPU frame time
+	m_DynamicResolution = std::make_unique<DynamicResolution>(context);
 
 	ImGuiRenderer::Initialize(context);
+
+	// Pipelines were built alongside the setup above, building them in order would have added their compile time to it
+	const double setupMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - passesStart).count();
+	context.pipelineCompiler->Wait();
+
+	const double readyMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - passesStart).count();
+	const double compileMilliseconds = context.pipelineMilliseconds.load() - compileStart;
+	std::fprintf(stderr, "Startup pipelines: %.1f ms of compile time on %u threads, passes ready in %.1f ms against %.1f ms compiling in order\n",
+		compileMilliseconds, context.pipelineCompiler->GetThreadCount(), readyMilliseconds, setupMilliseconds + compileMilliseconds);
+
+	context.ReportPipelineCache();
+
+	// Lifetimes from the startup settings decide which transient targets share memory
+	ImportResources();
+	DeclareFrame(0);
+	m_RenderGraph->Compile();
+	RecreateTargets(false);
+	if (dumpRenderGraph)
+		m_RenderGraph->Dump(std::cout);
 }
 
 void vk::Renderer::Destroy()
@@ -135,12 +154,22 @@ void vk::Renderer::Destroy()
 	m_GBuffer.reset();
 	m_ShadingPass.reset();
 	m_CandidatesPass.reset();
+	m_LightTilesPass.reset();
 	m_MotionVectorsPass.reset();
+	m_CandidatesTemporalPass.reset();
 	m_TemporalComputePass.reset();
 	m_SpatialComputePass.reset();
 	m_HistoryPass.reset();
+	m_ConvergenceBenchmark.reset();
+	m_Denoiser.reset();
 	m_CompositePass.reset();
 	m_PresentPass.reset();
+	m_FrameCapture.reset();
+	m_GPUTimer.reset();
+	m_GPUStats.reset();
+	m_Sampling.reset();
+	m_DynamicResolution.reset();
+	m_RenderGraph.reset();
 	m_camera.reset();
 	m_scene->Destroy();
 
@@ -150,10 +179,8 @@ void vk::Renderer::Destroy()
 
 	m_materialManager.Destroy(context);
 
-	for (auto& fence : m_Fences)
-	{
-		vkDestroyFence(context.device, fence, nullptr);
-	}
+	vkDestroySemaphore(context.device, m_frameTimeline, nullptr);
+	vkDestroySemaphore(context.device, m_computeTimeline, nullptr);
 
 	for (auto& semaphore : m_imageAvailableSemaphores)
 	{
@@ -165,39 +192,40 @@ void vk::Renderer::Destroy()
 		vkDestroySemaphore(context.device, semaphore, nullptr);
 	}
 
-	for (size_t i = 0; i < (size_t)vk::MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		vkFreeCommandBuffers(context.device, m_commandPool[i], 1, &m_commandBuffers[i]);
-	}
-
+	// Frees their command buffers with them
 	for (size_t i = 0; i < (size_t)vk::MAX_FRAMES_IN_FLIGHT; i++)
 	{
 		vkDestroyCommandPool(context.device, m_commandPool[i], nullptr);
+		vkDestroyCommandPool(context.device, m_computeCommandPool[i], nullptr);
 	}
 }
 
 void vk::Renderer::CreateResources()
 {
-	CreateFences();
+	CreateFrameTimeline();
 	CreateSemaphores();
 	CreateCommandPool();
-	AllocateCommandBuffers();
 }
 
-void vk::Renderer::CreateFences()
+void vk::Renderer::CreateFrameTimeline()
 {
-	for (size_t i = 0; i < (size_t)vk::MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		// Fence
-		VkFenceCreateInfo fenceInfo{
-			.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-			.flags = VK_FENCE_CREATE_SIGNALED_BIT
-		};
+	VkSemaphoreTypeCreateInfo typeInfo = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+		.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+		.initialValue = 0
+	};
 
-		VkFence fence = VK_NULL_HANDLE;
-		VK_CHECK(vkCreateFence(context.device, &fenceInfo, nullptr, &fence), "Failedd to create Fence.");
-		m_Fences.push_back(std::move(fence));
-	}
+	VkSemaphoreCreateInfo semaphoreInfo = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = &typeInfo
+	};
+
+	VK_CHECK(vkCreateSemaphore(context.device, &semaphoreInfo, nullptr, &m_frameTimeline), "Failed to create frame timeline semaphore");
+	VK_CHECK(vkCreateSemaphore(context.device, &semaphoreInfo, nullptr, &m_computeTimeline), "Failed to create compute timeline semaphore");
+
+	// Nothing submitted yet, waiting for 0 returns at once
+	m_frameSignalValues.assign(vk::MAX_FRAMES_IN_FLIGHT, 0);
+	m_computeSignalValues.assign(vk::MAX_FRAMES_IN_FLIGHT, 0);
 }
 
 void vk::Renderer::CreateSemaphores()
@@ -214,7 +242,7 @@ void vk::Renderer::CreateSemaphores()
 	}
 
 	// Render finished sempahore
-	for (size_t i = 0; i < (size_t)vk::MAX_FRAMES_IN_FLIGHT; i++) {
+	for (size_t i = 0; i < context.swapchainImages.size(); i++) {
 		VkSemaphoreCreateInfo semaphoreInfo = {
 			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO
 		};
@@ -229,37 +257,73 @@ void vk::Renderer::CreateCommandPool()
 {
 	for (size_t i = 0; i < (size_t)vk::MAX_FRAMES_IN_FLIGHT; i++)
 	{
+		// Reset whole once the frame slot is free again
 		VkCommandPoolCreateInfo cmdPool{};
 		cmdPool.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-		cmdPool.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 		cmdPool.queueFamilyIndex = context.graphicsFamilyIndex;
 
 		VkCommandPool commandPool = VK_NULL_HANDLE;
 		VK_CHECK(vkCreateCommandPool(context.device, &cmdPool, nullptr, &commandPool), "Failed to create command pool");
 		m_commandPool.push_back(std::move(commandPool));
+
+		// On the graphics family too when the device has no compute only one
+		cmdPool.queueFamilyIndex = context.computeFamilyIndex;
+		VK_CHECK(vkCreateCommandPool(context.device, &cmdPool, nullptr, &commandPool), "Failed to create command pool");
+		m_computeCommandPool.push_back(std::move(commandPool));
 	}
+
+	m_commandBuffers.resize(vk::MAX_FRAMES_IN_FLIGHT);
+	m_computeCommandBuffers.resize(vk::MAX_FRAMES_IN_FLIGHT);
 }
 
-void vk::Renderer::AllocateCommandBuffers()
+// The index-th command buffer of this frame slot on the queue, allocated the first time a frame has that many batches on it
+VkCommandBuffer vk::Renderer::GetCommandBuffer(QueueType queue, uint32_t index)
 {
-	for (size_t i = 0; i < (size_t)vk::MAX_FRAMES_IN_FLIGHT; i++)
+	const bool compute = queue == QueueType::COMPUTE;
+	std::vector<VkCommandBuffer>& commandBuffers = (compute ? m_computeCommandBuffers : m_commandBuffers)[vk::currentFrame];
+
+	while (commandBuffers.size() <= index)
 	{
-		// Allocate command buffers from command pool
 		VkCommandBufferAllocateInfo cmdAlloc{};
 		cmdAlloc.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		cmdAlloc.commandPool = m_commandPool[i];
+		cmdAlloc.commandPool = (compute ? m_computeCommandPool : m_commandPool)[vk::currentFrame];
 		cmdAlloc.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 		cmdAlloc.commandBufferCount = 1;
 
 		VkCommandBuffer cmd = VK_NULL_HANDLE;
 		VK_CHECK(vkAllocateCommandBuffers(context.device, &cmdAlloc, &cmd), "Failed to allocate command buffer");
-		m_commandBuffers.push_back(cmd);
+		commandBuffers.push_back(cmd);
 	}
+
+	return commandBuffers[index];
 }
 
 void vk::Renderer::Render(double deltaTime)
 {
-	vkWaitForFences(context.device, 1, &m_Fences[vk::currentFrame], VK_TRUE, UINT64_MAX);
+	// The slot's previous frame has to be done before its command buffer, queries and uniforms are reused
+	const auto waitStart = std::chrono::steady_clock::now();
+
+	const VkSemaphore timelines[] = { m_frameTimeline, m_computeTimeline };
+	const uint64_t values[] = { m_frameSignalValues[vk::currentFrame], m_computeSignalValues[vk::currentFrame] };
+
+	VkSemaphoreWaitInfo waitInfo = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.semaphoreCount = 2,
+		.pSemaphores = timelines,
+		.pValues = values
+	};
+	VK_CHECK(vkWaitSemaphores(context.device, &waitInfo, UINT64_MAX), "Failed to wait for the frame timeline");
+
+	m_frameWaitMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+
+	// This frame slot's queries are complete once its timeline value has been reached
+	m_GPUTimer->Collect();
+	m_GPUStats->Collect(*m_GPUTimer);
+	m_ConvergenceBenchmark->Collect(*m_GPUTimer);
+	m_FrameCapture->Collect();
+	context.bindlessHeap->Collect();
+	context.uniformArena->BeginFrame(vk::currentFrame);
+	m_DynamicResolution->Update(*m_GPUTimer);
 
 	Update(deltaTime);
 
@@ -270,83 +334,213 @@ void vk::Renderer::Render(double deltaTime)
 	{
 		// Recreate swapchain
 		context.RecreateSwapchain();
-		m_GBuffer->Resize();
-		m_CandidatesPass->Resize();
-		m_MotionVectorsPass->Resize();
-		m_TemporalComputePass->Resize();
-		m_SpatialComputePass->Resize();
-		m_ShadingPass->Resize();
-		m_HistoryPass->Resize();
-		m_CompositePass->Resize();
-		m_PresentPass->Resize();
+		RecreateTargets(true);
 	}
 	else if (getImageIndex != VK_SUCCESS && getImageIndex != VK_SUBOPTIMAL_KHR)
 	{
 		throw std::runtime_error("Failed to aquire swapchain image");
 	}
 
-	vkResetFences(context.device, 1, &m_Fences[vk::currentFrame]);
-	vkResetCommandBuffer(m_commandBuffers[vk::currentFrame], 0);
+	// The timeline wait above retired every command buffer of this slot on both queues
+	VK_CHECK(vkResetCommandPool(context.device, m_commandPool[vk::currentFrame], 0), "Failed to reset command pool");
+	VK_CHECK(vkResetCommandPool(context.device, m_computeCommandPool[vk::currentFrame], 0), "Failed to reset command pool");
+
+	DeclareFrame(index);
+	if (!m_RenderGraph->Compile())
+	{
+		// Toggled passes made two targets sharing memory overlap, plan it again from this frame's lifetimes
+		// and batch the frame again from the state the graph was reset to
+		vkDeviceWaitIdle(context.device);
+		RecreateTargets(false);
+		m_RenderGraph->Compile();
+	}
 
-	VkCommandBuffer& cmd = m_commandBuffers[vk::currentFrame];
+	const std::vector<RenderGraph::Batch>& batches = m_RenderGraph->GetBatches();
 
+	// The ReSTIR passes write the stats counters, they are cleared on the queue those run on
+	uint32_t statsBatch = 0;
+	for (uint32_t b = static_cast<uint32_t>(batches.size()); b-- > 0;)
 	{
+		if (batches[b].queue == QueueType::COMPUTE && !batches[b].passes.empty())
+			statsBatch = b;
+	}
+
+	// The frame span is timed on the graphics queue, from its first batch to its last
+	uint32_t firstGraphics = ~0u;
+	uint32_t lastGraphics = ~0u;
+	for (uint32_t b = 0; b < static_cast<uint32_t>(batches.size()); b++)
+	{
+		if (batches[b].queue != QueueType::GRAPHICS)
+			continue;
+
+		firstGraphics = std::min(firstGraphics, b);
+		lastGraphics = b;
+	}
+
+	m_GPUTimer->BeginFrame();
+
+	// Every pass that survived culling, each timed under its own name, one command buffer per batch
+	std::vector<VkCommandBuffer> commandBuffers;
+	std::array<uint32_t, 2> queueCounts = {};
+	for (uint32_t b = 0; b < static_cast<uint32_t>(batches.size()); b++)
+	{
+		VkCommandBuffer cmd = GetCommandBuffer(batches[b].queue, queueCounts[static_cast<uint32_t>(batches[b].queue)]++);
+
 		VkCommandBufferBeginInfo beginInfo = {
-			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
 		};
 
 		VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo), "Failed to begin command buffer");
 
-		m_GBuffer->Execute(cmd);
-		m_CandidatesPass->Execute(cmd);
-		m_MotionVectorsPass->Execute(cmd);
-
-		if (enableReSTIR) {
-			m_TemporalComputePass->Execute(cmd);
-			m_SpatialComputePass->Execute(cmd);
-		}
+		if (b == firstGraphics)
+			m_GPUTimer->WriteFrameBegin(cmd);
 
-		m_ShadingPass->Execute(cmd);
-		m_HistoryPass->Execute(cmd);
+		if (b == statsBatch)
+			m_GPUStats->BeginFrame(cmd);
 
-		m_CompositePass->Execute(cmd);
-		m_PresentPass->Execute(cmd, index);
+		m_RenderGraph->Execute(b, cmd, *m_GPUTimer);
 
+		if (b == lastGraphics)
+			m_GPUTimer->WriteFrameEnd(cmd);
 
 		vkEndCommandBuffer(cmd);
+		commandBuffers.push_back(cmd);
+	}
+
+	context.uniformArena->Flush();
+
+	if (dumpRenderGraph)
+	{
+		std::ofstream file("render_graph.txt");
+		m_RenderGraph->Dump(file);
+		m_RenderGraph->Dump(std::cout);
+		dumpRenderGraph = false;
 	}
 
-	Submit();
+	Submit(index, commandBuffers);
 	Present(index);
 
-	m_TemporalComputePass->CopyImageToImage(m_SpatialComputePass->GetRenderTarget());
 	m_MotionVectorsPass->Update();
 
 	vk::currentFrame = (vk::currentFrame + 1) % vk::MAX_FRAMES_IN_FLIGHT;
 
 }
 
-void vk::Renderer::Submit()
+void vk::Renderer::Submit(uint32_t imageIndex, const std::vector<VkCommandBuffer>& commandBuffers)
 {
-	VkPipelineStageFlags waitStage = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	// A recreated swapchain can come back with more images
+	while (m_renderFinishedSemaphores.size() <= imageIndex)
+	{
+		VkSemaphoreCreateInfo semaphoreInfo = {
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO
+		};
 
-	VkSubmitInfo subtmitInfo = {
-		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = &m_imageAvailableSemaphores[vk::currentFrame],
-		.pWaitDstStageMask = &waitStage,
-		.commandBufferCount = 1,
-		.pCommandBuffers = &m_commandBuffers[vk::currentFrame],
-		.signalSemaphoreCount = 1,
-		.pSignalSemaphores = &m_renderFinishedSemaphores[vk::currentFrame]
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+		VK_CHECK(vkCreateSemaphore(context.device, &semaphoreInfo, nullptr, &semaphore), "Failed to create render finished semaphore");
+		m_renderFinishedSemaphores.push_back(semaphore);
+	}
+
+	const std::vector<RenderGraph::Batch>& batches = m_RenderGraph->GetBatches();
+	const VkSemaphore timelines[] = { m_frameTimeline, m_computeTimeline };
+
+	// The first graphics batch waits for the swapchain image and presentation waits for the last one
+	uint32_t firstGraphics = ~0u;
+	uint32_t lastGraphics = ~0u;
+	for (uint32_t b = 0; b < static_cast<uint32_t>(batches.size()); b++)
+	{
+		if (batches[b].queue != QueueType::GRAPHICS)
+			continue;
+
+		firstGraphics = std::min(firstGraphics, b);
+		lastGraphics = b;
+	}
+
+	// Filled in full before any submit info points into them
+	struct BatchSemaphores
+	{
+		std::array<VkSemaphore, 2> waits;
+		std::array<uint64_t, 2> waitValues;
+		std::array<VkPipelineStageFlags, 2> waitStages;
+		std::array<VkSemaphore, 2> signals;
+		std::array<uint64_t, 2> signalValues;
+		VkTimelineSemaphoreSubmitInfo timelineInfo;
 	};
 
-	VkResult result = vkQueueSubmit(context.graphicsQueue, 1, &subtmitInfo, m_Fences[vk::currentFrame]);
+	std::vector<BatchSemaphores> semaphores(batches.size());
+	std::array<std::vector<VkSubmitInfo>, 2> submitInfos;
+
+	for (uint32_t b = 0; b < static_cast<uint32_t>(batches.size()); b++)
+	{
+		const RenderGraph::Batch& batch = batches[b];
+		const uint32_t queue = static_cast<uint32_t>(batch.queue);
+		BatchSemaphores& s = semaphores[b];
+		uint32_t waitCount = 0;
+		uint32_t signalCount = 0;
+
+		// Binary semaphores ignore their value
+		if (b == firstGraphics)
+		{
+			s.waits[waitCount] = m_imageAvailableSemaphores[vk::currentFrame];
+			s.waitValues[waitCount] = 0;
+			s.waitStages[waitCount++] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		}
+
+		// What the other queue produced for this batch, ownership of the images it hands over included
+		if (batch.waitValue != 0)
+		{
+			s.waits[waitCount] = timelines[1 - queue];
+			s.waitValues[waitCount] = batch.waitValue;
+			s.waitStages[waitCount++] = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		}
 
-	if (result != VK_SUCCESS)
+		s.signals[signalCount] = timelines[queue];
+		s.signalValues[signalCount++] = batch.signalValue;
+
+		if (b == lastGraphics)
+		{
+			s.signals[signalCount] = m_renderFinishedSemaphores[imageIndex];
+			s.signalValues[signalCount++] = 0;
+		}
+
+		s.timelineInfo = {
+			.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+			.waitSemaphoreValueCount = waitCount,
+			.pWaitSemaphoreValues = s.waitValues.data(),
+			.signalSemaphoreValueCount = signalCount,
+			.pSignalSemaphoreValues = s.signalValues.data()
+		};
+
+		submitInfos[queue].push_back({
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+			.pNext = &s.timelineInfo,
+			.waitSemaphoreCount = waitCount,
+			.pWaitSemaphores = s.waits.data(),
+			.pWaitDstStageMask = s.waitStages.data(),
+			.commandBufferCount = 1,
+			.pCommandBuffers = &commandBuffers[b],
+			.signalSemaphoreCount = signalCount,
+			.pSignalSemaphores = s.signals.data()
+		});
+	}
+
+	// Timeline waits may be submitted before the signal they wait for, so each queue gets all of its batches at once
+	const VkQueue queues[] = { context.graphicsQueue, context.computeQueue };
+	for (uint32_t queue = 0; queue < 2; queue++)
 	{
-		throw std::runtime_error("Failed to submit command buffers");
+		if (submitInfos[queue].empty())
+			continue;
+
+		VkResult result = vkQueueSubmit(queues[queue], static_cast<uint32_t>(submitInfos[queue].size()), submitInfos[queue].data(), VK_NULL_HANDLE);
+
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to submit command buffers");
+		}
 	}
+
+	m_frameSignalValues[vk::currentFrame] = m_RenderGraph->GetTimelineValue(QueueType::GRAPHICS);
+	m_computeSignalValues[vk::currentFrame] = m_RenderGraph->GetTimelineValue(QueueType::COMPUTE);
 }
 
 void vk::Renderer::Present(uint32_t imageIndex)
@@ -354,7 +548,7 @@ void vk::Renderer::Present(uint32_t imageIndex)
 	VkPresentInfoKHR presentInfo = {
 		.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
 		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = &m_renderFinishedSemaphores[vk::currentFrame],
+		.pWaitSemaphores = &m_renderFinishedSemaphores[imageIndex],
 		.swapchainCount = 1,
 		.pSwapchains = &context.swapchain,
 		.pImageIndices = &imageIndex,
@@ -367,15 +561,7 @@ void vk::Renderer::Present(uint32_t imageIndex)
 	{
 		// Recreate the swapchain
 		context.RecreateSwapchain();
-		m_GBuffer->Resize();
-		m_CandidatesPass->Resize();
-		m_MotionVectorsPass->Resize();
-		m_TemporalComputePass->Resize();
-		m_SpatialComputePass->Resize();
-		m_ShadingPass->Resize();
-		m_HistoryPass->Resize();
-		m_CompositePass->Resize();
-		m_PresentPass->Resize();
+		RecreateTargets(true);
 	}
 
 	frameNumber += 1;
@@ -383,17 +569,316 @@ void vk::Renderer::Present(uint32_t imageIndex)
 
 void vk::Renderer::Update(double deltaTime)
 {
-	m_camera->Update(context.window, context.extent.width, context.extent.height, deltaTime);
+	// Poses the camera before it writes its transforms
+	m_ConvergenceBenchmark->Update(*m_camera);
+
+	m_camera->Update(context.window, renderExtent.width, renderExtent.height, deltaTime);
 	m_scene->Update(context.window, deltaTime);
 
+	// Benchmark settings have to be in place before ImGui and the pass uniforms read them
+	m_SpatialComputePass->UpdateBenchmark(m_GPUTimer->GetMilliseconds("Spatial"));
+
 	// Update passes
-	ImGuiRenderer::Update(m_scene, m_camera);
+	ImGuiRenderer::Update(m_scene, m_camera, *m_GPUTimer, *m_GPUStats, *m_DynamicResolution, *m_RenderGraph, *m_FrameCapture, m_frameWaitMilliseconds);
+
+	// Reservoir buffers and the per reservoir shading are sized for the grid, so switching it rebuilds them like a swapchain resize
+	if (restirResolution != m_ReSTIRResolution)
+	{
+		vkDeviceWaitIdle(context.device);
+		m_ReSTIRResolution = restirResolution;
+		RecreateTargets(false);
+	}
+
+	m_LightTilesPass->Update();
 	m_CandidatesPass->Update();
 	m_TemporalComputePass->Update();
+	m_CandidatesTemporalPass->Update();
 	m_SpatialComputePass->Update();
 	m_ShadingPass->Update();
 	m_HistoryPass->Update();
+	m_Denoiser->Update();
 	m_PresentPass->Update();
+	m_FrameCapture->Update();
+}
+
+// Resources the passes own and share with each other, the graph tracks their last access across frames
+void vk::Renderer::ImportResources()
+{
+	// Render pass attachments, initial layout UNDEFINED. Every frame in flight's copy, DeclareFrame uses the current one
+	for (const GBuffer::GBufferMRT& gbuffer : m_GBuffer->GetGBufferMRTs())
+	{
+		m_RenderGraph->Import(gbuffer.WorldPositions, VK_IMAGE_LAYOUT_UNDEFINED);
+		m_RenderGraph->Import(gbuffer.Surface, VK_IMAGE_LAYOUT_UNDEFINED);
+	}
+
+	for (const Image& motionVectors : m_MotionVectorsPass->GetRenderTargets())
+		m_RenderGraph->Import(motionVectors, VK_IMAGE_LAYOUT_UNDEFINED);
+
+	for (const Buffer& buffer : m_LightTilesPass->GetLightTileBuffers())
+		m_RenderGraph->Import(buffer);
+
+	m_RenderGraph->Import(m_CandidatesPass->GetInitialCandidates());
+	m_RenderGraph->Import(m_CandidatesPass->GetAdaptiveHistory(), VK_IMAGE_LAYOUT_GENERAL);
+	m_RenderGraph->Import(m_TemporalComputePass->GetRenderTarget());
+	m_RenderGraph->Import(m_TemporalComputePass->GetPreviousReservoirs());
+	m_RenderGraph->Import(m_SpatialComputePass->GetRenderTarget());
+	m_RenderGraph->Import(m_HistoryPass->GetRenderTarget(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	m_RenderGraph->Import(m_ConvergenceBenchmark->GetReference(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	m_RenderGraph->Import(m_ConvergenceBenchmark->GetPartials());
+	for (const Buffer& buffer : m_ConvergenceBenchmark->GetResults())
+		m_RenderGraph->Import(buffer);
+
+	// Both history sets, which one is current swaps every frame
+	for (const Denoiser::FrameHistory* history : { &m_Denoiser->GetCurrentHistory(), &m_Denoiser->GetPreviousHistory() })
+	{
+		m_RenderGraph->Import(history->depthNormal, VK_IMAGE_LAYOUT_GENERAL);
+		m_RenderGraph->Import(history->colour, VK_IMAGE_LAYOUT_GENERAL);
+		m_RenderGraph->Import(history->moments, VK_IMAGE_LAYOUT_GENERAL);
+	}
+}
+
+// Every pass of the frame and what it reads and writes, passes that are switched off are left out.
+// The setup functions run straight away, the execute functions when the graph is recorded
+void vk::Renderer::DeclareFrame(uint32_t imageIndex)
+{
+	// This frame in flight's copies, the next frame's G-buffer and motion vectors do not wait on the compute
+	// passes reading these
+	const GBuffer::GBufferMRT& gbuffer = m_GBuffer->GetGBufferMRT();
+	const Buffer& lightTiles = m_LightTilesPass->GetLightTileBuffers()[vk::currentFrame];
+	const Buffer& initialCandidates = m_CandidatesPass->GetInitialCandidates();
+	const Buffer& temporalReservoirs = m_TemporalComputePass->GetRenderTarget();
+	const Buffer& previousReservoirs = m_TemporalComputePass->GetPreviousReservoirs();
+	const Buffer& spatialReservoirs = m_SpatialComputePass->GetRenderTarget();
+	const Image& adaptiveHistory = m_CandidatesPass->GetAdaptiveHistory();
+	const Image& motionVectors = m_MotionVectorsPass->GetRenderTarget();
+	const Image& shading = m_ShadingPass->GetRenderTarget();
+	const Image& reservoirShading = m_ShadingPass->GetReservoirShading();
+	const Image& history = m_HistoryPass->GetRenderTarget();
+	const Image& composite = m_CompositePass->GetRenderTarget();
+
+	RenderGraph& graph = *m_RenderGraph;
+	graph.BeginFrame();
+
+	if (enableLightTiles)
+	{
+		graph.AddPass("LightTiles", [&](RenderGraph::PassBuilder& pass) {
+			pass.AsyncCompute()
+				.Write(lightTiles, Access::COMPUTE_WRITE);
+		}, [this](VkCommandBuffer cmd) { m_LightTilesPass->Execute(cmd); });
+	}
+
+	graph.AddPass("GBuffer", [&](RenderGraph::PassBuilder& pass) {
+		pass.Write(gbuffer.WorldPositions, Access::COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+			.Write(gbuffer.Surface, Access::COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}, [this](VkCommandBuffer cmd) { m_GBuffer->Execute(cmd); });
+
+	// Only temporal reuse and the denoiser read them, culled when neither runs
+	graph.AddPass("MotionVectors", [&](RenderGraph::PassBuilder& pass) {
+		pass.Read(gbuffer.WorldPositions, Access::FRAGMENT_SAMPLE)
+			.Write(motionVectors, Access::COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}, [this](VkCommandBuffer cmd) { m_MotionVectorsPass->Execute(cmd); });
+
+	if (enableReSTIR && enableFusedTemporal)
+	{
+		graph.AddPass("CandidatesTemporal", [&](RenderGraph::PassBuilder& pass) {
+			pass.AsyncCompute()
+				.Read(gbuffer.Surface, Access::COMPUTE_SAMPLE)
+				.Read(motionVectors, Access::COMPUTE_SAMPLE)
+				.Read(previousReservoirs, Access::COMPUTE_READ)
+				.Write(adaptiveHistory, Access::COMPUTE_READ_WRITE)
+				.Write(initialCandidates, Access::COMPUTE_WRITE)
+				.Write(temporalReservoirs, Access::COMPUTE_WRITE);
+			if (enableLightTiles)
+				pass.Read(lightTiles, Access::COMPUTE_READ);
+		}, [this](VkCommandBuffer cmd) { m_CandidatesTemporalPass->Execute(cmd); });
+	}
+	else
+	{
+		graph.AddPass("Candidates", [&](RenderGraph::PassBuilder& pass) {
+			pass.AsyncCompute()
+				.Read(gbuffer.Surface, Access::COMPUTE_SAMPLE)
+				.Write(adaptiveHistory, Access::COMPUTE_READ_WRITE)
+				.Write(initialCandidates, Access::COMPUTE_WRITE);
+			if (enableLightTiles)
+				pass.Read(lightTiles, Access::COMPUTE_READ);
+		}, [this](VkCommandBuffer cmd) { m_CandidatesPass->Execute(cmd); });
+
+		if (enableReSTIR)
+		{
+			graph.AddPass("Temporal", [&](RenderGraph::PassBuilder& pass) {
+				pass.AsyncCompute()
+					.Read(gbuffer.Surface, Access::COMPUTE_SAMPLE)
+					.Read(motionVectors, Access::COMPUTE_SAMPLE)
+					.Read(initialCandidates, Access::COMPUTE_READ)
+					.Read(previousReservoirs, Access::COMPUTE_READ)
+					.Write(adaptiveHistory, Access::COMPUTE_READ_WRITE)
+					.Write(temporalReservoirs, Access::COMPUTE_WRITE);
+			}, [this](VkCommandBuffer cmd) { m_TemporalComputePass->Execute(cmd); });
+		}
+	}
+
+	if (enableReSTIR)
+	{
+		graph.AddPass("Spatial", [&](RenderGraph::PassBuilder& pass) {
+			pass.AsyncCompute()
+				.Read(gbuffer.Surface, Access::COMPUTE_SAMPLE)
+				.Read(initialCandidates, Access::COMPUTE_READ)
+				.Read(temporalReservoirs, Access::COMPUTE_READ)
+				.Write(spatialReservoirs, Access::COMPUTE_WRITE);
+		}, [this](VkCommandBuffer cmd) { m_SpatialComputePass->Execute(cmd); });
+	}
+
+	graph.AddPass("Shading", [&](RenderGraph::PassBuilder& pass) {
+		pass.AsyncCompute()
+			.Read(gbuffer.Surface, Access::COMPUTE_SAMPLE)
+			.Read(initialCandidates, Access::COMPUTE_READ)
+			.Read(temporalReservoirs, Access::COMPUTE_READ)
+			.Read(spatialReservoirs, Access::COMPUTE_READ)
+			.Write(shading, Access::COMPUTE_WRITE);
+		if (ShadingPassData.upsample != 0)
+			pass.Write(reservoirShading, Access::COMPUTE_WRITE);
+	}, [this](VkCommandBuffer cmd) { m_ShadingPass->Execute(cmd); });
+
+	if (denoiser.enable)
+	{
+		const Denoiser::FrameHistory& current = m_Denoiser->GetCurrentHistory();
+		const Denoiser::FrameHistory& previous = m_Denoiser->GetPreviousHistory();
+		const Image& integrated = m_Denoiser->GetIntegrated();
+
+		graph.AddPass("SVGFTemporal", [&](RenderGraph::PassBuilder& pass) {
+			pass.AsyncCompute()
+				.Read(shading, Access::COMPUTE_READ)
+				.Read(motionVectors, Access::COMPUTE_SAMPLE)
+				.Read(gbuffer.Surface, Access::COMPUTE_SAMPLE)
+				.Read(previous.depthNormal, Access::COMPUTE_READ)
+				.Read(previous.colour, Access::COMPUTE_READ)
+				.Read(previous.moments, Access::COMPUTE_READ)
+				.Write(current.depthNormal, Access::COMPUTE_WRITE)
+				.Write(current.moments, Access::COMPUTE_WRITE)
+				.Write(integrated, Access::COMPUTE_WRITE);
+		}, [this](VkCommandBuffer cmd) { m_Denoiser->Temporal(cmd); });
+
+		graph.AddPass("SVGFVariance", [&](RenderGraph::PassBuilder& pass) {
+			pass.AsyncCompute()
+				.Read(gbuffer.Surface, Access::COMPUTE_SAMPLE)
+				.Read(current.moments, Access::COMPUTE_READ)
+				.Read(integrated, Access::COMPUTE_READ)
+				.Write(m_Denoiser->GetFilterInput(0), Access::COMPUTE_WRITE);
+		}, [this](VkCommandBuffer cmd) { m_Denoiser->Variance(cmd); });
+
+		// The first pass also writes next frame's colour history, the last one the denoised target
+		const uint32_t iterations = static_cast<uint32_t>(denoiser.atrousIterations);
+		for (uint32_t i = 0; i < iterations; i++)
+		{
+			graph.AddPass("SVGFAtrous" + std::to_string(i), [&](RenderGraph::PassBuilder& pass) {
+				pass.AsyncCompute()
+					.Read(gbuffer.Surface, Access::COMPUTE_SAMPLE)
+					.Read(m_Denoiser->GetFilterInput(i), Access::COMPUTE_READ);
+				if (i == 0)
+					pass.Write(current.colour, Access::COMPUTE_WRITE);
+				if (i + 1 == iterations)
+					pass.Write(m_Denoiser->GetRenderTarget(), Access::COMPUTE_WRITE);
+				else
+					pass.Write(m_Denoiser->GetFilterOutput(i), Access::COMPUTE_WRITE);
+			}, [this, i](VkCommandBuffer cmd) { m_Denoiser->Filter(cmd, i); });
+		}
+	}
+
+	if (shouldClearBeforeDraw)
+	{
+		graph.AddPass("HistoryClear", [&](RenderGraph::PassBuilder& pass) {
+			pass.AsyncCompute()
+				.Write(history, Access::TRANSFER_WRITE);
+		}, [this](VkCommandBuffer cmd) { m_HistoryPass->Clear(cmd); });
+	}
+
+	graph.AddPass("History", [&](RenderGraph::PassBuilder& pass) {
+		pass.AsyncCompute()
+			.Read(shading, Access::COMPUTE_SAMPLE)
+			.Write(history, Access::COMPUTE_READ_WRITE);
+	}, [this](VkCommandBuffer cmd) { m_HistoryPass->Execute(cmd); });
+
+	// The reference is copied out of the history once it has accumulated, each measured frame is compared against it
+	if (m_ConvergenceBenchmark->IsCapturingReference())
+	{
+		graph.AddPass("ConvergenceReference", [&](RenderGraph::PassBuilder& pass) {
+			pass.Read(history, Access::TRANSFER_READ)
+				.Write(m_ConvergenceBenchmark->GetReference(), Access::TRANSFER_WRITE);
+		}, [this](VkCommandBuffer cmd) { m_ConvergenceBenchmark->CopyReference(cmd); });
+	}
+
+	if (m_ConvergenceBenchmark->IsMeasuring())
+	{
+		const Buffer& partials = m_ConvergenceBenchmark->GetPartials();
+
+		graph.AddPass("ConvergenceError", [&](RenderGraph::PassBuilder& pass) {
+			pass.Read(denoiser.enable ? m_Denoiser->GetRenderTarget() : shading, Access::COMPUTE_SAMPLE)
+				.Read(m_ConvergenceBenchmark->GetReference(), Access::COMPUTE_SAMPLE)
+				.Write(partials, Access::COMPUTE_WRITE);
+		}, [this](VkCommandBuffer cmd) { m_ConvergenceBenchmark->Measure(cmd); });
+
+		graph.AddPass("ConvergenceReduce", [&](RenderGraph::PassBuilder& pass) {
+			pass.Read(partials, Access::COMPUTE_READ)
+				.Write(m_ConvergenceBenchmark->GetResults()[vk::currentFrame], Access::COMPUTE_WRITE);
+		}, [this](VkCommandBuffer cmd) { m_ConvergenceBenchmark->Reduce(cmd); });
+	}
+
+	graph.AddPass("Composite", [&](RenderGraph::PassBuilder& pass) {
+		pass.Read(shading, Access::FRAGMENT_SAMPLE)
+			.Write(composite, Access::COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}, [this](VkCommandBuffer cmd) { m_CompositePass->Execute(cmd); });
+
+	// Keeps the captured target and the passes writing it alive, the staging buffer is outside the graph
+	if (m_FrameCapture->IsCapturing())
+	{
+		graph.AddPass("Capture", [&](RenderGraph::PassBuilder& pass) {
+			pass.Read(m_FrameCapture->GetSource(), Access::TRANSFER_READ)
+				.SideEffect();
+		}, [this](VkCommandBuffer cmd) { m_FrameCapture->Copy(cmd); });
+	}
+
+	graph.AddPass("Present", [&](RenderGraph::PassBuilder& pass) {
+		pass.Read(denoiser.enable ? m_Denoiser->GetRenderTarget() : shading, Access::FRAGMENT_SAMPLE)
+			.Read(history, Access::FRAGMENT_SAMPLE)
+			.SideEffect();
+	}, [this, imageIndex](VkCommandBuffer cmd) { m_PresentPass->Execute(cmd, imageIndex); });
+
+	// Next frame's temporal reuse reads this frame's spatial result
+	if (enableReSTIR)
+	{
+		graph.AddPass("ReservoirHistory", [&](RenderGraph::PassBuilder& pass) {
+			pass.AsyncCompute()
+				.Read(spatialReservoirs, Access::TRANSFER_READ)
+				.Write(previousReservoirs, Access::TRANSFER_WRITE);
+		}, [this](VkCommandBuffer cmd) { m_TemporalComputePass->CopyReservoirHistory(cmd, m_SpatialComputePass->GetRenderTarget()); });
+	}
+}
+
+// Everything sized to the swapchain or the reservoir grid. The render graph realises its transient targets
+// first, aliased from the last compiled lifetimes, so the passes bind the new views when they resize
+void vk::Renderer::RecreateTargets(bool swapchain)
+{
+	m_RenderGraph->Realize();
+
+	if (swapchain)
+	{
+		m_DynamicResolution->Resize();
+		m_GBuffer->Resize();
+		m_MotionVectorsPass->Resize();
+	}
+
+	m_CandidatesPass->Resize();
+	m_TemporalComputePass->Resize();
+	m_CandidatesTemporalPass->Resize();
+	m_SpatialComputePass->Resize();
+	m_ShadingPass->Resize();
+	m_HistoryPass->Resize();
+	m_Denoiser->Resize();
+	m_ConvergenceBenchmark->Resize();
+	m_CompositePass->Resize();
+	m_PresentPass->Resize();
+
+	m_RenderGraph->ResetState();
 }
 
 void vk::Renderer::glfwHandleKeyboard(GLFWwindow* window, int key, int scancode, int action, int mods)
@@ -14,7 +14,17 @@
 #include "SpatialCompute.hpp"
 #include "GBuffer.hpp"
 #include "Candidates.hpp"
+#include "CandidatesTemporal.hpp"
+#include "LightTiles.hpp"
 #include "ShadingPass.hpp"
+#include "GPUTimer.hpp"
+#include "GPUStats.hpp"
+#include "Sampling.hpp"
+#include "DynamicResolution.hpp"
+#include "RenderGraph.hpp"
+#include "Denoiser.hpp"
+#include "ConvergenceBenchmark.hpp"
+#include "FrameCapture.hpp"
 
 #include <fstream>
 
@@ -33,39 +43,74 @@ namespace vk
 		void Update(double deltaTime);
 
 		// Should be moved out of renderer when we do better input/controls
+		// Used by RegressionSuite to pose the camera, request captures and read the timings
+		Camera& GetCamera() { return *m_camera; }
+		FrameCapture& GetFrameCapture() { return *m_FrameCapture; }
+		const GPUTimer& GetGPUTimer() const { return *m_GPUTimer; }
+		const RenderGraph& GetRenderGraph() const { return *m_RenderGraph; }
+
+		// CPU time the last frame spent waiting for the GPU to release its frame slot
+		double GetFrameWaitMilliseconds() const { return m_frameWaitMilliseconds; }
+
 		static void glfwHandleKeyboard(GLFWwindow* window, int key, int scancode, int action, int mods);
 		static void glfwMouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 		static void glfwCallbackMotion(GLFWwindow* window, double x, double y);
 
 	private:
 		void CreateResources();
-		void CreateFences();
+		void CreateFrameTimeline();
 		void CreateSemaphores();
 		void CreateCommandPool();
-		void AllocateCommandBuffers();
+		VkCommandBuffer GetCommandBuffer(QueueType queue, uint32_t index);
 
-		void Submit();
+		void Submit(uint32_t imageIndex, const std::vector<VkCommandBuffer>& commandBuffers);
 		void Present(uint32_t imageIndex);
 
+		void ImportResources();
+		void DeclareFrame(uint32_t imageIndex);
+		void RecreateTargets(bool swapchain);
+
 	private:
 		Context& context;
-		std::vector<VkFence> m_Fences;
-		std::vector<VkSemaphore> m_imageAvailableSemaphores;
-		std::vector<VkSemaphore> m_renderFinishedSemaphores;
-		std::vector<VkCommandBuffer> m_commandBuffers;
+		// One timeline per queue, every render graph batch signals the next value of its queue's and waits on the other's.
+		// They pace the CPU too, a frame slot is free again once the values its last batches signalled have been reached
+		VkSemaphore m_frameTimeline;   // graphics queue
+		VkSemaphore m_computeTimeline; // async compute queue
+		std::vector<uint64_t> m_frameSignalValues; // per frame in flight
+		std::vector<uint64_t> m_computeSignalValues;
+		double m_frameWaitMilliseconds;
+
+		std::vector<VkSemaphore> m_imageAvailableSemaphores;  // per frame in flight
+		std::vector<VkSemaphore> m_renderFinishedSemaphores; // per swapchain image, presentation holds it until the image returns
+
+		// Per frame in flight and queue, a command buffer for each of the frame's batches on that queue
 		std::vector<VkCommandPool> m_commandPool;
+		std::vector<VkCommandPool> m_computeCommandPool;
+		std::vector<std::vector<VkCommandBuffer>> m_commandBuffers;
+		std::vector<std::vector<VkCommandBuffer>> m_computeCommandBuffers;
 
 		std::shared_ptr<Scene> m_scene;
 
+		std::unique_ptr<RenderGraph>      m_RenderGraph; // owns the transient targets of the passes, reset after them
 		std::unique_ptr<GBuffer>	      m_GBuffer;
+		std::unique_ptr<LightTiles>       m_LightTilesPass;
 		std::unique_ptr<Candidates>       m_CandidatesPass;
 		std::unique_ptr<ShadingPass>      m_ShadingPass;
 		std::unique_ptr<Composite>        m_CompositePass;
 		std::unique_ptr<PresentPass>	  m_PresentPass;
 		std::unique_ptr<MotionVectors>    m_MotionVectorsPass;
 		std::unique_ptr<TemporalCompute>  m_TemporalComputePass;
+		std::unique_ptr<CandidatesTemporal> m_CandidatesTemporalPass;
 		std::unique_ptr<SpatialCompute>   m_SpatialComputePass;
 		std::unique_ptr<History>          m_HistoryPass;
+		std::unique_ptr<Denoiser>         m_Denoiser;
+		std::unique_ptr<ConvergenceBenchmark> m_ConvergenceBenchmark;
+		std::unique_ptr<FrameCapture>     m_FrameCapture;
+		std::unique_ptr<GPUTimer>         m_GPUTimer;
+		std::unique_ptr<GPUStats>         m_GPUStats;
+		std::unique_ptr<Sampling>         m_Sampling;
+		std::unique_ptr<DynamicResolution> m_DynamicResolution;
+		ReSTIRResolution m_ReSTIRResolution = ReSTIRResolution::FULL; // grid the reservoir passes were last sized for
 		std::shared_ptr<Camera> m_camera;
 		MaterialManager m_materialManager;
 	};
@@ -0,0 +1,282 @@
+#include "Context.hpp"
+#include "Sampling.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <random>
+
+namespace
+{
+	constexpr const char* TABLES_PATH = "assets/sampling_tables.bin";
+	constexpr uint32_t TABLES_MAGIC = 0x4C504D53; // "SMPL"
+	constexpr uint32_t TABLES_VERSION = 1;        // bump when the generators or their seeds change
+
+	// Written in front of the Header and the blue noise texels
+	struct TablesFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+	};
+}
+
+vk::Sampling::Sampling(Context& context) :
+	context{ context }
+{
+	const Tables tables = LoadTables();
+
+	std::vector<uint8_t> data(sizeof(Header) + tables.blueNoise.size() * sizeof(uint32_t));
+	std::memcpy(data.data(), &tables.header, sizeof(Header));
+	std::memcpy(data.data() + sizeof(Header), tables.blueNoise.data(), tables.blueNoise.size() * sizeof(uint32_t));
+
+	CreateAndUploadBuffer(context, data.data(), data.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_buffer);
+}
+
+vk::Sampling::~Sampling()
+{
+	m_buffer.Destroy(context.device);
+}
+
+vk::Sampling::Tables vk::Sampling::LoadTables()
+{
+	const size_t texels = BLUE_NOISE_SIZE * BLUE_NOISE_SIZE;
+	const size_t expectedSize = sizeof(TablesFileHeader) + sizeof(Header) + texels * sizeof(uint32_t);
+
+	Tables tables = {};
+	std::ifstream file(TABLES_PATH, std::ios::ate | std::ios::binary);
+	if (file.is_open())
+	{
+		const size_t fileSize = static_cast<size_t>(file.tellg());
+		TablesFileHeader fileHeader = {};
+
+		file.seekg(0);
+		if (fileSize == expectedSize && file.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader)) &&
+			fileHeader.magic == TABLES_MAGIC && fileHeader.version == TABLES_VERSION &&
+			file.read(reinterpret_cast<char*>(&tables.header), sizeof(Header)) && tables.header.blueNoiseSize == BLUE_NOISE_SIZE)
+		{
+			tables.blueNoise.resize(texels);
+			if (file.read(reinterpret_cast<char*>(tables.blueNoise.data()), texels * sizeof(uint32_t)))
+				return tables;
+		}
+
+		std::fprintf(stderr, "Sampling: %s is invalid or from another version, regenerating\n", TABLES_PATH);
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	tables = GenerateTables();
+	auto end = std::chrono::high_resolution_clock::now();
+	std::printf("Sampling: generated %ux%u blue noise and %u point Poisson disk in %.1f ms\n", BLUE_NOISE_SIZE, BLUE_NOISE_SIZE, POISSON_DISK_COUNT, std::chrono::duration<double, std::milli>(end - start).count());
+
+	// Written to a temporary file and renamed over the old one, as the pipeline cache is
+	const TablesFileHeader fileHeader = { .magic = TABLES_MAGIC, .version = TABLES_VERSION };
+	const std::string temporaryPath = std::string(TABLES_PATH) + ".tmp";
+	{
+		std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+		out.write(reinterpret_cast<const char*>(&tables.header), sizeof(Header));
+		out.write(reinterpret_cast<const char*>(tables.blueNoise.data()), texels * sizeof(uint32_t));
+
+		if (!out)
+		{
+			std::fprintf(stderr, "Sampling: failed to write %s\n", temporaryPath.c_str());
+			return tables;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, TABLES_PATH, error);
+	if (error)
+		std::fprintf(stderr, "Sampling: failed to replace %s: %s\n", TABLES_PATH, error.message().c_str());
+
+	return tables;
+}
+
+vk::Sampling::Tables vk::Sampling::GenerateTables()
+{
+	const uint32_t texels = BLUE_NOISE_SIZE * BLUE_NOISE_SIZE;
+	const std::vector<uint32_t> red = VoidAndCluster(BLUE_NOISE_SIZE, 0x1234u);
+	const std::vector<uint32_t> green = VoidAndCluster(BLUE_NOISE_SIZE, 0xbeefu);
+	const std::vector<glm::vec2> disk = PoissonDisk(POISSON_DISK_COUNT, 0x5eedu);
+
+	Tables tables = {};
+	tables.header.blueNoiseSize = BLUE_NOISE_SIZE;
+	std::copy(disk.begin(), disk.end(), tables.header.poissonDisk);
+
+	// Ranks become evenly spaced values centred in their bucket, packed as unorm16x2
+	tables.blueNoise.resize(texels);
+	for (uint32_t i = 0; i < texels; i++)
+	{
+		const uint32_t r = static_cast<uint32_t>((red[i] + 0.5) / texels * 65535.0 + 0.5);
+		const uint32_t g = static_cast<uint32_t>((green[i] + 0.5) / texels * 65535.0 + 0.5);
+		tables.blueNoise[i] = r | (g << 16);
+	}
+
+	return tables;
+}
+
+// Reference: Ulichney, The void-and-cluster method for dither array generation, 1993
+// Energy is a Gaussian splat of every minority pixel on the torus, so the tile repeats without seams.
+// Clusters are the set pixels with the highest energy, voids the empty pixels with the lowest
+std::vector<uint32_t> vk::Sampling::VoidAndCluster(uint32_t size, uint32_t seed)
+{
+	const uint32_t count = size * size;
+	const float sigma = 1.5f;
+
+	// Splat weight by toroidal offset, shared by every update
+	std::vector<float> kernel(count);
+	for (uint32_t y = 0; y < size; y++)
+	{
+		for (uint32_t x = 0; x < size; x++)
+		{
+			const float dx = static_cast<float>(std::min(x, size - x));
+			const float dy = static_cast<float>(std::min(y, size - y));
+			kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+		}
+	}
+
+	std::vector<uint8_t> pattern(count, 0);
+	std::vector<float> energy(count, 0.0f);
+
+	auto splat = [&](uint32_t index, float sign) {
+		const uint32_t px = index % size;
+		const uint32_t py = index / size;
+		for (uint32_t y = 0; y < size; y++)
+		{
+			const uint32_t ky = ((y + size - py) % size) * size;
+			for (uint32_t x = 0; x < size; x++)
+				energy[y * size + x] += sign * kernel[ky + (x + size - px) % size];
+		}
+	};
+
+	auto tightestCluster = [&]() {
+		uint32_t best = 0;
+		float bestEnergy = -std::numeric_limits<float>::max();
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (pattern[i] && energy[i] > bestEnergy)
+			{
+				bestEnergy = energy[i];
+				best = i;
+			}
+		}
+		return best;
+	};
+
+	auto largestVoid = [&]() {
+		uint32_t best = 0;
+		float bestEnergy = std::numeric_limits<float>::max();
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (!pattern[i] && energy[i] < bestEnergy)
+			{
+				bestEnergy = energy[i];
+				best = i;
+			}
+		}
+		return best;
+	};
+
+	// Random initial pattern with a tenth of the pixels set
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<uint32_t> pick(0, count - 1);
+	const uint32_t initialCount = count / 10;
+	for (uint32_t placed = 0; placed < initialCount;)
+	{
+		const uint32_t index = pick(rng);
+		if (pattern[index])
+			continue;
+		pattern[index] = 1;
+		splat(index, 1.0f);
+		placed++;
+	}
+
+	// Move the tightest cluster into the largest void until the pattern stops changing
+	for (;;)
+	{
+		const uint32_t cluster = tightestCluster();
+		pattern[cluster] = 0;
+		splat(cluster, -1.0f);
+
+		const uint32_t hole = largestVoid();
+		pattern[hole] = 1;
+		splat(hole, 1.0f);
+
+		if (hole == cluster)
+			break;
+	}
+
+	std::vector<uint32_t> rank(count, 0);
+	const std::vector<uint8_t> initialPattern = pattern;
+	const std::vector<float> initialEnergy = energy;
+
+	// Phase 1, the initial points ranked by removing the tightest cluster each time
+	for (uint32_t r = initialCount; r-- > 0;)
+	{
+		const uint32_t cluster = tightestCluster();
+		pattern[cluster] = 0;
+		splat(cluster, -1.0f);
+		rank[cluster] = r;
+	}
+
+	// Phase 2 and 3, the remaining points ranked by filling the largest void each time
+	pattern = initialPattern;
+	energy = initialEnergy;
+	for (uint32_t r = initialCount; r < count; r++)
+	{
+		const uint32_t hole = largestVoid();
+		pattern[hole] = 1;
+		splat(hole, 1.0f);
+		rank[hole] = r;
+	}
+
+	return rank;
+}
+
+// Reference: Mitchell, Spectrally optimal sampling for distribution ray tracing, 1991
+// Each new point is the candidate furthest from the points already placed, out of a count growing with the set
+std::vector<glm::vec2> vk::Sampling::PoissonDisk(uint32_t count, uint32_t seed)
+{
+	const uint32_t candidatesPerPoint = 16;
+
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+	auto diskPoint = [&]() {
+		const float r = std::sqrt(uniform(rng));
+		const float theta = 6.28318530718f * uniform(rng);
+		return glm::vec2(r * std::cos(theta), r * std::sin(theta));
+	};
+
+	std::vector<glm::vec2> points;
+	points.reserve(count);
+	points.push_back(diskPoint());
+
+	while (points.size() < count)
+	{
+		glm::vec2 best = {};
+		float bestDistance = -1.0f;
+		const size_t candidates = candidatesPerPoint * points.size();
+		for (size_t c = 0; c < candidates; c++)
+		{
+			const glm::vec2 candidate = diskPoint();
+			float nearest = std::numeric_limits<float>::max();
+			for (const auto& point : points)
+				nearest = std::min(nearest, glm::dot(candidate - point, candidate - point));
+
+			if (nearest > bestDistance)
+			{
+				bestDistance = nearest;
+				best = candidate;
+			}
+		}
+		points.push_back(best);
+	}
+
+	return points;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <volk/volk.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "Buffer.hpp"
+
+namespace vk
+{
+	class Context;
+
+	// Sample tables behind the low discrepancy sampling of the ReSTIR kernels, see shaders/Sampling.glsl
+	// A two channel void and cluster blue noise tile and a progressive Poisson disk, baked into TABLES_PATH and
+	// uploaded into one read only storage buffer, bound at binding 13 by the candidate and spatial passes
+	class Sampling
+	{
+	public:
+		// Must match SAMPLING_POISSON_COUNT in shaders/Sampling.glsl
+		static constexpr uint32_t POISSON_DISK_COUNT = 32;
+		static constexpr uint32_t BLUE_NOISE_SIZE = 64;
+
+		// Must match the fixed part of SamplingBuffer in shaders/Sampling.glsl, the blue noise texels follow it
+		struct Header
+		{
+			uint32_t blueNoiseSize;
+			uint32_t pad[3];
+			glm::vec2 poissonDisk[POISSON_DISK_COUNT];
+		};
+
+		// Host copy of the buffer contents, the reference renderer samples from the same tables as the GPU
+		struct Tables
+		{
+			Header header;
+			std::vector<uint32_t> blueNoise; // BLUE_NOISE_SIZE^2 texels, two 16 bit unorm channels each
+		};
+
+		// Reads the baked tables, or generates them and writes the file when it is missing or stale.
+		// Generating takes a few hundred ms and the std::mt19937 distributions differ between standard libraries,
+		// the baked file keeps every platform on the same tables
+		static Tables LoadTables();
+
+		explicit Sampling(Context& context);
+		~Sampling();
+
+		Sampling(const Sampling&) = delete;
+		Sampling& operator=(const Sampling&) = delete;
+
+		const Buffer& GetBuffer() const { return m_buffer; }
+
+	private:
+		static Tables GenerateTables();
+
+		// Rank of every texel in a size x size void and cluster pattern, 0 to size * size - 1
+		static std::vector<uint32_t> VoidAndCluster(uint32_t size, uint32_t seed);
+
+		// Mitchell's best candidate points in the unit disk, every prefix of the result is well spread
+		static std::vector<glm::vec2> PoissonDisk(uint32_t count, uint32_t seed);
+
+		Context& context;
+		Buffer m_buffer;
+	};
+}
@@ -4,9 +4,9 @@
 vk::Scene::Scene(Context& context, MaterialManager& materialManager) : context(context), materialManager{ materialManager }
 {
 	m_LightUBO.resize(MAX_FRAMES_IN_FLIGHT);
-	// Light uniform buffers
+	// Light uniform buffers, shared by most passes' sets like the camera's and mapped once
 	for (auto& buffer : m_LightUBO)
-		buffer = CreateBuffer("LightUBO", context, sizeof(LightBuffer), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+		buffer = CreateBuffer("LightUBO", context, sizeof(LightBuffer), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
 
 }
 
@@ -15,6 +15,8 @@ void vk::Scene::AddModel(GLTFModel& GLTF, MaterialManager& materialManager)
 	// Check if the material index this mesh refers to is already in-use
 	for (auto& mesh : GLTF.meshes)
 	{
+		materialManager.Reserve(context, mesh.materialIndex + 1);
+
 		if (materialManager.materialLookup[mesh.materialIndex] > 0)
 		{
 			// This index is already in use
@@ -30,8 +32,7 @@ void vk::Scene::AddModel(GLTFModel& GLTF, MaterialManager& materialManager)
 			}
 			else
 			{
-				uint32_t newIndex = materialManager.GetNextAvailableIndex();
-				assert(newIndex != -1);
+				uint32_t newIndex = materialManager.GetNextAvailableIndex(context);
 ;				materialManager.materials[newIndex].textures.resize(mesh.textures.size());
 				for (size_t i = 0; i < mesh.textures.size(); i++) {
 					VkFormat FORMAT = i == 0 ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM; // index 0 is albedo, the rest should use UNORM
@@ -441,13 +442,13 @@ void vk::Scene::DrawGLTF(VkCommandBuffer cmd, VkPipelineLayout pipelineLayout)
 	{
 		for (auto& mesh : model.meshes)
 		{
-			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &materialManager.materialDescriptorSets[mesh.materialIndex], 0, nullptr);
-
 			MeshPushConstants pc = {};
 			pc.ModelMatrix = glm::mat4(1.0f);
 			pc.BaseColourFactor = mesh.baseColourFactor;
 			pc.Metallic = mesh.metallic;
 			pc.Roughness = mesh.roughness;
+			pc.MaterialIndex = mesh.materialIndex;
+			pc.MaterialBuffer = materialManager.materialBufferHandle;
 
 			pc.ModelMatrix = glm::translate(pc.ModelMatrix, glm::vec3(model.position)); // Apply translation
 			// pc.ModelMatrix = glm::rotate(pc.ModelMatrix, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
@@ -1,4 +1,4 @@
-// Image& initial_candidates, Image& hit_world_positions, Image& hit_normals, Image& motion_vectors
+// Image& initial_candidates, Image& hit_world_positions, Image& hit_normals, const std::vector<Image>& motion_vectors
 
 #include "Context.hpp"
 #include "Camera.hpp"
@@ -7,8 +7,10 @@
 #include "Pipeline.hpp"
 #include "Utils.hpp"
 #include "Buffer.hpp"
+#include "UniformArena.hpp"
+#include "RenderGraph.hpp"
 
-vk::ShadingPass::ShadingPass(Context& context, std::shared_ptr<Scene>& scene, std::shared_ptr<Camera>& camera, const GBuffer::GBufferMRT& gbufferMRT, Image& InitialCandidatesReservoirs, Image& TemporalPassReservoirs, Image& SpatialPassReservoirs) :
+vk::ShadingPass::ShadingPass(Context& context, std::shared_ptr<Scene>& scene, std::shared_ptr<Camera>& camera, const std::vector<GBuffer::GBufferMRT>& gbufferMRT, Buffer& InitialCandidatesReservoirs, Buffer& TemporalPassReservoirs, Buffer& SpatialPassReservoirs, const std::vector<Buffer>& gpuStats, RenderGraph& graph) :
 	context{ context },
 	scene{ scene },
 	camera{ camera },
@@ -16,42 +18,23 @@ vk::ShadingPass::ShadingPass(Context& context, std::shared_ptr<Scene>& scene, st
 	InitialCandidatesReservoirs{ InitialCandidatesReservoirs },
 	TemporalPassReservoirs{ TemporalPassReservoirs },
 	SpatialPassReservoirs{ SpatialPassReservoirs },
+	gpuStats{ gpuStats },
+	m_RenderTarget{ graph.CreateImage({ "ShadingPassRT", VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT }) },
+	m_ReservoirShading{ graph.CreateImage({ "ShadingPassReservoirRT", VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT, TransientExtent::RESERVOIR_GRID }) },
 	m_Pipeline{ VK_NULL_HANDLE },
 	m_PipelineLayout{ VK_NULL_HANDLE },
+	m_UpsamplePipeline{ VK_NULL_HANDLE },
+	m_UpsamplePipelineLayout{ VK_NULL_HANDLE },
 	m_descriptorSetLayout{ VK_NULL_HANDLE },
+	m_descriptorTemplate{ VK_NULL_HANDLE },
 	m_width{ 0 },
-	m_height{ 0 }
+	m_height{ 0 },
+	m_reservoirExtent{ 0, 0 }
 {
 
 	m_width = context.extent.width;
 	m_height = context.extent.height;
-
-	m_uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-	for (auto& buffer : m_uniformBuffers)
-		buffer = CreateBuffer("ShadingPassUBO", context, sizeof(uShadingPass), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-
-	m_RenderTarget = CreateImageTexture2D(
-		"ShadingPassRT",
-		context,
-		m_width,
-		m_height,
-		VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-	ExecuteSingleTimeCommands(context, [&](VkCommandBuffer cmd) {
-
-		ImageTransition(
-			cmd,
-			m_RenderTarget.image,
-			VK_FORMAT_R32G32B32A32_SFLOAT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0,
-			VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-		);
-	});
+	m_reservoirExtent = GetReservoirExtent(context.extent, restirResolution);
 
 	BuildDescriptors();
 	CreatePipeline();
@@ -59,147 +42,22 @@ vk::ShadingPass::ShadingPass(Context& context, std::shared_ptr<Scene>& scene, st
 
 vk::ShadingPass::~ShadingPass()
 {
-	for (auto& buffer : m_uniformBuffers)
-	{
-		buffer.Destroy(context.device);
-	}
-	m_RenderTarget.Destroy(context.device);
 	vkDestroyPipeline(context.device, m_Pipeline, nullptr);
 	vkDestroyPipelineLayout(context.device, m_PipelineLayout, nullptr);
+	vkDestroyPipeline(context.device, m_UpsamplePipeline, nullptr);
+	vkDestroyPipelineLayout(context.device, m_UpsamplePipelineLayout, nullptr);
 	vkDestroyDescriptorSetLayout(context.device, m_descriptorSetLayout, nullptr);
+	vkDestroyDescriptorUpdateTemplate(context.device, m_descriptorTemplate, nullptr);
 }
 
+// Both targets belong to the render graph and were realised again before this
 void vk::ShadingPass::Resize()
 {
-	m_RenderTarget.Destroy(context.device);
-
 	m_width = context.extent.width;
 	m_height = context.extent.height;
+	m_reservoirExtent = GetReservoirExtent(context.extent, restirResolution);
 
-	m_RenderTarget = CreateImageTexture2D(
-		"ShadingPassRT",
-		context,
-		m_width,
-		m_height,
-		VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-	ExecuteSingleTimeCommands(context, [&](VkCommandBuffer cmd) {
-
-		ImageTransition(
-			cmd,
-			m_RenderTarget.image,
-			VK_FORMAT_R32G32B32A32_SFLOAT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0,
-			VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-		);
-	});
-
-	// G-Buffer World position
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.WorldPositions.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 3, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	// G-Buffer World Normal
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.Normal.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 4, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	// G-Buffer Albedo
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.Albedo.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 5, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	// Initial candidates reservoirs
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = InitialCandidatesReservoirs.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 6, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	// Temporal pass reservoirs
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = TemporalPassReservoirs.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 7, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	// Spatial pass reservoirs
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = SpatialPassReservoirs.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 8, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	// Shading result image
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-			.sampler = VK_NULL_HANDLE,
-			.imageView = m_RenderTarget.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_GENERAL
-		};
-
-		UpdateDescriptorSet(context, 9, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.MetallicRoughness.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 11, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
+	UpdateDescriptors();
 }
 
 void vk::ShadingPass::Execute(VkCommandBuffer cmd)
@@ -208,30 +66,31 @@ void vk::ShadingPass::Execute(VkCommandBuffer cmd)
 	RenderPassLabel(cmd, "ShadingPass");
 #endif // !DEBUG
 
-	ImageTransition(
-		cmd,
-		m_RenderTarget.image,
-		VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
-		VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
-		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-	);
-
 	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
-	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &m_descriptorSets[currentFrame], 0, nullptr);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &m_descriptorSets[currentFrame], 1, &m_uniformOffset);
 
-	// 8x8x1 threads per dispatch
-	vkCmdDispatch(cmd, m_width / 8, m_height / 8, 1);
+	if (ShadingPassData.upsample != 0)
+	{
+		// Shade once per reservoir cell, then rebuild every pixel from those with the joint bilateral upsample
+		const VkExtent2D grid = GetReservoirExtent(renderExtent, restirResolution);
+		vkCmdDispatch(cmd, (grid.width + 7) / 8, (grid.height + 7) / 8, 1);
 
-	ImageTransition(
-		cmd,
-		m_RenderTarget.image,
-		VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_LAYOUT_GENERAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
-		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-	);
+		// Within the pass, the render graph only orders it against the other passes
+		ImageTransition(
+			cmd,
+			m_ReservoirShading.image,
+			VK_FORMAT_R32G32B32A32_SFLOAT,
+			VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+			VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+		);
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_UpsamplePipeline);
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_UpsamplePipelineLayout, 0, 1, &m_descriptorSets[currentFrame], 1, &m_uniformOffset);
+	}
+
+	// 8x8x1 threads per dispatch, rounded up, the kernel skips invocations past the viewport
+	vkCmdDispatch(cmd, (renderExtent.width + 7) / 8, (renderExtent.height + 7) / 8, 1);
 
 #ifdef _DEBUG
 	EndRenderPassLabel(cmd);
@@ -241,19 +100,35 @@ void vk::ShadingPass::Execute(VkCommandBuffer cmd)
 
 void vk::ShadingPass::Update()
 {
-	m_uniformBuffers[currentFrame].WriteToBuffer(&ShadingPassData, sizeof(uShadingPass));
+	ShadingPassData.frameIndex = frameNumber;
+	ShadingPassData.resolutionMode = static_cast<int>(restirResolution);
+	ShadingPassData.upsample = enableReSTIRUpsample && restirResolution != ReSTIRResolution::FULL ? 1 : 0;
+	m_uniformOffset = context.uniformArena->Push(ShadingPassData);
 }
 
 void vk::ShadingPass::CreatePipeline()
 {
-	auto pipelineResult = vk::PipelineBuilder(context, PipelineType::COMPUTE, VertexBinding::NONE, 0)
-		.AddShader("assets/shaders/ShadingPass.comp.spv", ShaderType::COMPUTE)
-		.SetPipelineLayout({ {m_descriptorSetLayout} })
-		.Build();
+	// Compiled on worker threads, the renderer waits for every startup pipeline before the first frame
+	context.pipelineCompiler->Submit([this]() {
+		auto pipelineResult = vk::PipelineBuilder(context, PipelineType::COMPUTE, VertexBinding::NONE, 0)
+			.AddShader("assets/shaders/ShadingPass.comp.spv", ShaderType::COMPUTE)
+			.SetPipelineLayout({ {m_descriptorSetLayout} })
+			.Build();
+
+		m_Pipeline = pipelineResult.first;
+		m_PipelineLayout = pipelineResult.second;
+	});
 
-	m_Pipeline = pipelineResult.first;
-	m_PipelineLayout = pipelineResult.second;
+	// Same layout, only dispatched when a reduced resolution grid is upsampled
+	context.pipelineCompiler->Submit([this]() {
+		auto upsampleResult = vk::PipelineBuilder(context, PipelineType::COMPUTE, VertexBinding::NONE, 0)
+			.AddShader("assets/shaders/ShadingUpsample.comp.spv", ShaderType::COMPUTE)
+			.SetPipelineLayout({ {m_descriptorSetLayout} })
+			.Build();
 
+		m_UpsamplePipeline = upsampleResult.first;
+		m_UpsamplePipelineLayout = upsampleResult.second;
+	});
 }
 
 void vk::ShadingPass::BuildDescriptors()
@@ -261,161 +136,48 @@ void vk::ShadingPass::BuildDescriptors()
 	m_descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
 	{
 		std::vector<VkDescriptorSetLayoutBinding> bindings = {
-			CreateDescriptorBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // ubo
+			CreateDescriptorBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT), // ubo, offset into the uniform arena
 			CreateDescriptorBinding(1, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // Light ubo
 			CreateDescriptorBinding(2, 1, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, VK_SHADER_STAGE_COMPUTE_BIT), // TLAS
-			CreateDescriptorBinding(3, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),  // GBuffer - World position
-			CreateDescriptorBinding(4, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),  // GBuffer - World Normal
-			CreateDescriptorBinding(5, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),  // GBuffer - Albedo
-			CreateDescriptorBinding(6, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),  // Initial candidates reservoirs
-			CreateDescriptorBinding(7, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),  // Temporal pass reservoirs
-			CreateDescriptorBinding(8, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),  // Spatial pass reservoirs
+			CreateDescriptorBinding(3, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),  // GBuffer - Packed surface
+			CreateDescriptorBinding(6, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),  // Initial candidates reservoirs
+			CreateDescriptorBinding(7, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),  // Temporal pass reservoirs
+			CreateDescriptorBinding(8, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),  // Spatial pass reservoirs
 			CreateDescriptorBinding(9, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT),	        // Shading result image
 			CreateDescriptorBinding(10, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
-			CreateDescriptorBinding(11, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+			CreateDescriptorBinding(11, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // GPU stats
+			CreateDescriptorBinding(12, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)   // Per reservoir shading
 		};
 
 		m_descriptorSetLayout = CreateDescriptorSetLayout(context, bindings);
 		AllocateDescriptorSets(context, context.descriptorPool, m_descriptorSetLayout, MAX_FRAMES_IN_FLIGHT, m_descriptorSets);
 	}
 
-	// Shading pass UBO
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorBufferInfo buffer_info = {
-			.buffer = m_uniformBuffers[i].buffer,
-			.offset = 0,
-			.range = sizeof(uShadingPass)
-		};
-		UpdateDescriptorSet(context, 0, buffer_info, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-	}
-
-	// Lights UBO
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorBufferInfo buffer_info = {
-			.buffer = scene->GetLightsUBO()[i].buffer,
-			.offset = 0,
-			.range = sizeof(LightBuffer)
-		};
-		UpdateDescriptorSet(context, 1, buffer_info, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-	}
-
-	// TLAS
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		UpdateDescriptorSet(context, 2, scene->TopLevelAccelerationStructure.handle, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR);
-	}
-
-	// G-Buffer World position
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.WorldPositions.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 3, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	// G-Buffer World Normal
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.Normal.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 4, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	// G-Buffer Albedo
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.Albedo.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 5, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	// Initial candidates reservoirs
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = InitialCandidatesReservoirs.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 6, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	// Temporal pass reservoirs
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = TemporalPassReservoirs.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 7, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	// Spatial pass reservoirs
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = SpatialPassReservoirs.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 8, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	// Shading result image
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-			.sampler = VK_NULL_HANDLE,
-			.imageView = m_RenderTarget.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_GENERAL
-		};
-
-		UpdateDescriptorSet(context, 9, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-	}
-
-	// Camera Transform UBO
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = camera->GetBuffers()[i].buffer;
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(CameraTransform);
-		UpdateDescriptorSet(context, 10, bufferInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.MetallicRoughness.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
+	UpdateDescriptors();
+}
 
-		UpdateDescriptorSet(context, 11, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+// Every binding of every frame in flight, one templated update per set
+void vk::ShadingPass::UpdateDescriptors()
+{
+	DescriptorWriter writer;
+	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		writer
+			.WriteBuffer(0, context.uniformArena->GetBuffer(static_cast<uint32_t>(i)).buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, sizeof(uShadingPass))
+			.WriteBuffer(1, scene->GetLightsUBO()[i].buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sizeof(LightBuffer))
+			.WriteAccelerationStructure(2, scene->TopLevelAccelerationStructure.handle)
+			.WriteImage(3, gbufferMRT[i].Surface.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, clampToEdgeSamplerAniso)
+			.WriteBuffer(6, InitialCandidatesReservoirs.buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteBuffer(7, TemporalPassReservoirs.buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteBuffer(8, SpatialPassReservoirs.buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteImage(9, m_RenderTarget.imageView, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+			.WriteBuffer(10, camera->GetBuffers()[i].buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sizeof(CameraTransform))
+			.WriteBuffer(11, gpuStats[i].buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteImage(12, m_ReservoirShading.imageView, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+
+		if (m_descriptorTemplate == VK_NULL_HANDLE)
+			m_descriptorTemplate = writer.CreateTemplate(context, m_descriptorSetLayout);
+
+		writer.Update(context, m_descriptorSets[i], m_descriptorTemplate);
 	}
 }
@@ -4,12 +4,14 @@
 #include "Image.hpp"
 #include <vector>
 #include "GBuffer.hpp"
+#include "DescriptorWriter.hpp"
 
 namespace vk
 {
 	class Context;
 	class Camera;
 	class Scene;
+	class RenderGraph;
 
 	class ShadingPass
 	{
@@ -18,10 +20,12 @@ namespace vk
 			Context& context,
 			std::shared_ptr<Scene>& scene,
 			std::shared_ptr<Camera>& camera,
-			const GBuffer::GBufferMRT& gbufferMRT,
-			Image& InitialCandidatesReservoirs,
-			Image& TemporalPassReservoirs,
-			Image& SpatialPassReservoirs
+			const std::vector<GBuffer::GBufferMRT>& gbufferMRT,
+			Buffer& InitialCandidatesReservoirs,
+			Buffer& TemporalPassReservoirs,
+			Buffer& SpatialPassReservoirs,
+			const std::vector<Buffer>& gpuStats,
+			RenderGraph& graph
 			);
 		~ShadingPass();
 
@@ -30,29 +34,37 @@ namespace vk
 		void Resize();
 
 		Image& GetRenderTarget() { return m_RenderTarget; }
+		Image& GetReservoirShading() { return m_ReservoirShading; }
 
 	private:
 		void CreatePipeline();
 		void BuildDescriptors();
+		void UpdateDescriptors();
 
 		Context& context;
 		std::shared_ptr<Scene> scene;
 		std::shared_ptr<Camera> camera;
-		const GBuffer::GBufferMRT& gbufferMRT;
-		Image& InitialCandidatesReservoirs;
-		Image& TemporalPassReservoirs;
-		Image& SpatialPassReservoirs;
+		const std::vector<GBuffer::GBufferMRT>& gbufferMRT;
+		Buffer& InitialCandidatesReservoirs;
+		Buffer& TemporalPassReservoirs;
+		Buffer& SpatialPassReservoirs;
+		const std::vector<Buffer>& gpuStats;
 
-		Image m_RenderTarget;
+		Image& m_RenderTarget;     // transient, owned by the render graph
+		Image& m_ReservoirShading; // one texel per reservoir cell, input of the bilateral upsample
 
 		VkPipeline m_Pipeline;
 		VkPipelineLayout m_PipelineLayout;
+		VkPipeline m_UpsamplePipeline;
+		VkPipelineLayout m_UpsamplePipelineLayout;
 		std::vector<VkDescriptorSet> m_descriptorSets;
 		VkDescriptorSetLayout m_descriptorSetLayout;
+		VkDescriptorUpdateTemplate m_descriptorTemplate;
 
 		uint32_t m_width;
 		uint32_t m_height;
+		VkExtent2D m_reservoirExtent; // grid the reservoirs are stored for at the swapchain extent, dispatches cover the grid of renderExtent
 
-		std::vector<Buffer> m_uniformBuffers;
+		uint32_t m_uniformOffset = 0; // of this frame's uShadingPass in the uniform arena
 	};
 }
\ No newline at end of file
@@ -1,4 +1,4 @@
-// Image& initial_candidates, Image& hit_world_positions, Image& hit_normals, Image& motion_vectors
+// Image& initial_candidates, Image& hit_world_positions, Image& hit_normals, const std::vector<Image>& motion_vectors
 
 #include "Context.hpp"
 #include "Camera.hpp"
@@ -7,65 +7,61 @@
 #include "Pipeline.hpp"
 #include "Utils.hpp"
 #include "Buffer.hpp"
+#include "UniformArena.hpp"
 
-vk::SpatialCompute::SpatialCompute(Context& context, std::shared_ptr<Scene>& scene, std::shared_ptr<Camera>& camera, Image& initial_candidates, Image& temporal_pass_reservoirs, const GBuffer::GBufferMRT& gbufferMRT) :
+#include <array>
+#include <cstdio>
+
+namespace
+{
+	constexpr std::array<int, 6> benchmarkRadii = { 2, 4, 8, 16, 30, 60 };
+	constexpr uint32_t benchmarkWarmupFrames = 8; // timer results lag MAX_FRAMES_IN_FLIGHT frames behind the settings
+	constexpr uint32_t benchmarkSampleFrames = 64;
+
+	// Shared memory of SpatialComputeTiled.comp, a 24x24 tile of a packed surface and three reservoir words
+	constexpr uint32_t tiledSharedMemorySize = 24 * 24 * (4 + 3) * sizeof(uint32_t);
+}
+
+vk::SpatialCompute::SpatialCompute(Context& context, std::shared_ptr<Scene>& scene, std::shared_ptr<Camera>& camera, Buffer& initial_candidates, Buffer& temporal_pass_reservoirs, const std::vector<GBuffer::GBufferMRT>& gbufferMRT, const std::vector<Buffer>& gpuStats, const Buffer& sampling) :
 	context{ context },
 	scene{ scene },
 	camera{ camera },
 	initial_candidates{ initial_candidates },
 	temporal_pass_reservoirs{ temporal_pass_reservoirs },
 	gbufferMRT{ gbufferMRT },
+	gpuStats{ gpuStats },
+	sampling{ sampling },
 	m_Pipeline{ VK_NULL_HANDLE },
 	m_PipelineLayout{ VK_NULL_HANDLE },
+	m_Permutations{ context },
 	m_descriptorSetLayout{ VK_NULL_HANDLE },
+	m_descriptorTemplate{ VK_NULL_HANDLE },
 	m_width{ 0 },
-	m_height{ 0 }
+	m_height{ 0 },
+	m_reservoirExtent{ 0, 0 }
 {
 
 	m_width = context.extent.width;
 	m_height = context.extent.height;
+	m_reservoirExtent = GetReservoirExtent(context.extent, restirResolution);
+
+	m_RenderTarget = CreateReservoirBuffer("SpatialComputeReservoirs", context, m_reservoirExtent.width, m_reservoirExtent.height);
 
-	m_uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-	for (auto& buffer : m_uniformBuffers)
-		buffer = CreateBuffer("SpatialComputeUBO", context, sizeof(uSpatialPass), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-
-	m_RenderTarget = CreateImageTexture2D(
-		"SpatialComputeRT",
-		context,
-		m_width,
-		m_height,
-		VK_FORMAT_R16G16B16A16_SFLOAT,
-		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-	ExecuteSingleTimeCommands(context, [&](VkCommandBuffer cmd) {
-
-		ImageTransition(
-			cmd,
-			m_RenderTarget.image,
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0,
-			VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-		);
-	});
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(context.pDevice, &props);
+	m_tiledSupported = props.limits.maxComputeSharedMemorySize >= tiledSharedMemorySize;
+	if (!m_tiledSupported)
+		std::printf("Tiled spatial reuse needs %u bytes of shared memory, device has %u. Using the global kernel only\n", tiledSharedMemorySize, props.limits.maxComputeSharedMemorySize);
 
 	BuildDescriptors();
-	CreatePipeline();
+	SelectPipeline(false);
 }
 
 vk::SpatialCompute::~SpatialCompute()
 {
-	for (auto& buffer : m_uniformBuffers)
-	{
-		buffer.Destroy(context.device);
-	}
 	m_RenderTarget.Destroy(context.device);
-	vkDestroyPipeline(context.device, m_Pipeline, nullptr);
-	vkDestroyPipelineLayout(context.device, m_PipelineLayout, nullptr);
 	vkDestroyDescriptorSetLayout(context.device, m_descriptorSetLayout, nullptr);
+	vkDestroyDescriptorUpdateTemplate(context.device, m_descriptorTemplate, nullptr);
 }
 
 void vk::SpatialCompute::Resize()
@@ -74,118 +70,11 @@ void vk::SpatialCompute::Resize()
 
 	m_width = context.extent.width;
 	m_height = context.extent.height;
+	m_reservoirExtent = GetReservoirExtent(context.extent, restirResolution);
 
-	m_RenderTarget = CreateImageTexture2D(
-		"SpatialComputeRT",
-		context,
-		m_width,
-		m_height,
-		VK_FORMAT_R16G16B16A16_SFLOAT,
-		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-	ExecuteSingleTimeCommands(context, [&](VkCommandBuffer cmd) {
-
-		ImageTransition(
-			cmd,
-			m_RenderTarget.image,
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0,
-			VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-		);
-	});
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = initial_candidates.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 2, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = temporal_pass_reservoirs.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 3, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-			.sampler = VK_NULL_HANDLE,
-			.imageView = m_RenderTarget.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_GENERAL
-		};
-
-		UpdateDescriptorSet(context, 4, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		UpdateDescriptorSet(context, 5, scene->TopLevelAccelerationStructure.handle, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.WorldPositions.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 6, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.Normal.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 7, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.Albedo.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 8, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.MetallicRoughness.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
+	m_RenderTarget = CreateReservoirBuffer("SpatialComputeReservoirs", context, m_reservoirExtent.width, m_reservoirExtent.height);
 
-		UpdateDescriptorSet(context, 10, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
+	UpdateDescriptors();
 }
 
 void vk::SpatialCompute::Execute(VkCommandBuffer cmd)
@@ -194,30 +83,12 @@ void vk::SpatialCompute::Execute(VkCommandBuffer cmd)
 	RenderPassLabel(cmd, "SpatialCompute");
 #endif // !DEBUG
 
-	ImageTransition(
-		cmd,
-		m_RenderTarget.image,
-		VK_FORMAT_R16G16B16A16_SFLOAT,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
-		VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
-		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-	);
-
 	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
-	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &m_descriptorSets[currentFrame], 0, nullptr);
-
-	// 8x8x1 threads per dispatch
-	vkCmdDispatch(cmd, m_width / 8, m_height / 8, 1);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &m_descriptorSets[currentFrame], 1, &m_uniformOffset);
 
-	ImageTransition(
-		cmd,
-		m_RenderTarget.image,
-		VK_FORMAT_R16G16B16A16_SFLOAT,
-		VK_IMAGE_LAYOUT_GENERAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
-		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-	);
+	// 8x8x1 threads per dispatch, rounded up, the kernel skips invocations past the grid
+	const VkExtent2D grid = GetReservoirExtent(renderExtent, restirResolution);
+	vkCmdDispatch(cmd, (grid.width + 7) / 8, (grid.height + 7) / 8, 1);
 
 #ifdef _DEBUG
 	EndRenderPassLabel(cmd);
@@ -228,23 +99,103 @@ void vk::SpatialCompute::Execute(VkCommandBuffer cmd)
 void vk::SpatialCompute::Update()
 {
 	SpatialPassData.frameIndex = frameNumber;
-	SpatialPassData.viewportSize = { m_width, m_height };
+	SpatialPassData.viewportSize = { renderExtent.width, renderExtent.height };
 	SpatialPassData.M = SpatialPassData.M;
 	SpatialPassData.radius = SpatialPassData.radius;
 	SpatialPassData.enableUnbiased = SpatialPassData.enableUnbiased;
-	m_uniformBuffers[currentFrame].WriteToBuffer(&SpatialPassData, sizeof(uSpatialPass));
+	SpatialPassData.resolutionMode = static_cast<int>(restirResolution);
+	m_uniformOffset = context.uniformArena->Push(SpatialPassData);
+
+	// The benchmark times each kernel from the frame it switches to it
+	SelectPipeline(m_Pipeline == VK_NULL_HANDLE || m_benchmark.running);
 }
 
-void vk::SpatialCompute::CreatePipeline()
+void vk::SpatialCompute::UpdateBenchmark(double spatialMilliseconds)
 {
-	auto pipelineResult = vk::PipelineBuilder(context, PipelineType::COMPUTE, VertexBinding::NONE, 0)
-		.AddShader("assets/shaders/SpatialCompute.comp.spv", ShaderType::COMPUTE)
-		.SetPipelineLayout({ {m_descriptorSetLayout} })
-		.Build();
-
-	m_Pipeline = pipelineResult.first;
-	m_PipelineLayout = pipelineResult.second;
+	auto& bench = m_benchmark;
+	const size_t stepCount = benchmarkRadii.size() * 2;
+
+	if (!bench.running)
+	{
+		if (!runSpatialBenchmark)
+			return;
+
+		runSpatialBenchmark = false;
+		bench = {};
+		bench.running = true;
+		bench.savedRadius = SpatialPassData.radius;
+		bench.savedTiled = enableTiledSpatial;
+		bench.savedReSTIR = enableReSTIR;
+		std::printf("Spatial reuse benchmark: %zu radii, %u frames each\n", benchmarkRadii.size(), benchmarkSampleFrames);
+	}
+	else
+	{
+		// Only frames recorded with this step's settings count
+		if (bench.frame >= benchmarkWarmupFrames)
+			bench.accumulated += spatialMilliseconds;
+
+		bench.frame++;
+		if (bench.frame == benchmarkWarmupFrames + benchmarkSampleFrames)
+		{
+			const double average = bench.accumulated / benchmarkSampleFrames;
+			const size_t radiusIndex = bench.step / 2;
+			if (bench.step % 2 == 0)
+				bench.results.push_back({ benchmarkRadii[radiusIndex], average, 0.0 });
+			else
+				bench.results.back().tiledMilliseconds = average;
+
+			bench.step++;
+			bench.frame = 0;
+			bench.accumulated = 0.0;
+		}
+	}
+
+	if (bench.step >= stepCount)
+	{
+		std::printf("%8s %14s %14s %10s\n", "Radius", "Global (ms)", "Tiled (ms)", "Speedup");
+		for (const auto& result : bench.results)
+		{
+			const double speedup = result.tiledMilliseconds > 0.0 ? result.globalMilliseconds / result.tiledMilliseconds : 0.0;
+			std::printf("%8d %14.4f %14.4f %9.2fx\n", result.radius, result.globalMilliseconds, result.tiledMilliseconds, speedup);
+		}
+
+		SpatialPassData.radius = bench.savedRadius;
+		enableTiledSpatial = bench.savedTiled;
+		enableReSTIR = bench.savedReSTIR;
+		bench.running = false;
+		return;
+	}
+
+	// The spatial pass only runs with ReSTIR enabled
+	enableReSTIR = true;
+	SpatialPassData.radius = benchmarkRadii[bench.step / 2];
+	enableTiledSpatial = (bench.step % 2) == 1;
+}
 
+// Permutation of the enabled kernel for the current settings, compiled in the background the first time they are used
+// Waits only when asked to, the first frame has nothing bound yet
+void vk::SpatialCompute::SelectPipeline(bool wait)
+{
+	// Both kernels share the descriptor set layout, the tiled one only runs where its tile fits in shared memory
+	enableTiledSpatial = enableTiledSpatial && m_tiledSupported;
+	const std::string shaderPath = enableTiledSpatial ? "assets/shaders/SpatialComputeTiled.comp.spv" : "assets/shaders/SpatialCompute.comp.spv";
+
+	SpecializationConstants constants;
+	if (enableSpecializedPipelines)
+		constants.Set(SPEC_UNBIASED, SpatialPassData.enableUnbiased ? 1 : 0);
+
+	constants.Set(SPEC_SAMPLING, samplingMode == SamplingMode::LOW_DISCREPANCY);
+
+	const auto* pipeline = m_Permutations.Get(shaderPath, constants, [this, shaderPath](const SpecializationConstants& specialization) {
+		return vk::PipelineBuilder(context, PipelineType::COMPUTE, VertexBinding::NONE, 0)
+			.AddShader(shaderPath, ShaderType::COMPUTE, specialization)
+			.SetPipelineLayout({ {m_descriptorSetLayout} })
+			.Build();
+	}, wait);
+
+	// The bound permutation stays in use until the new one has compiled
+	if (pipeline)
+		std::tie(m_Pipeline, m_PipelineLayout) = *pipeline;
 }
 
 void vk::SpatialCompute::BuildDescriptors()
@@ -252,139 +203,46 @@ void vk::SpatialCompute::BuildDescriptors()
 	m_descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
 	{
 		std::vector<VkDescriptorSetLayoutBinding> bindings = {
-			CreateDescriptorBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // ubo
+			CreateDescriptorBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT), // ubo, offset into the uniform arena
 			CreateDescriptorBinding(1, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // Light ubo
-			CreateDescriptorBinding(2, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT), // Initial candidates
-			CreateDescriptorBinding(3, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT), // Temporal pass results
-			CreateDescriptorBinding(4, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT), // Store spatial reuse updated reservoirs
+			CreateDescriptorBinding(2, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // Initial candidates
+			CreateDescriptorBinding(3, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // Temporal pass results
+			CreateDescriptorBinding(4, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // Store spatial reuse updated reservoirs
 			CreateDescriptorBinding(5, 1, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, VK_SHADER_STAGE_COMPUTE_BIT), // TLAS
-			CreateDescriptorBinding(6, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT), // GBuffer - World position
-			CreateDescriptorBinding(7, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT), // GBuffer - World Normal
-			CreateDescriptorBinding(8, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),  // GBuffer - Albedo
+			CreateDescriptorBinding(6, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT), // GBuffer - Packed surface
 			CreateDescriptorBinding(9, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
-			CreateDescriptorBinding(10, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+			CreateDescriptorBinding(11, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // GPU stats
+			CreateDescriptorBinding(13, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // Sampling tables
 		};
 
 		m_descriptorSetLayout = CreateDescriptorSetLayout(context, bindings);
 		AllocateDescriptorSets(context, context.descriptorPool, m_descriptorSetLayout, MAX_FRAMES_IN_FLIGHT, m_descriptorSets);
 	}
 
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorBufferInfo buffer_info = {
-			.buffer = m_uniformBuffers[i].buffer,
-			.offset = 0,
-			.range = sizeof(uSpatialPass)
-		};
-		UpdateDescriptorSet(context, 0, buffer_info, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorBufferInfo buffer_info = {
-			.buffer = scene->GetLightsUBO()[i].buffer,
-			.offset = 0,
-			.range = sizeof(LightBuffer)
-		};
-		UpdateDescriptorSet(context, 1, buffer_info, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = initial_candidates.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 2, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = temporal_pass_reservoirs.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 3, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-			.sampler = VK_NULL_HANDLE,
-			.imageView = m_RenderTarget.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_GENERAL
-		};
-
-		UpdateDescriptorSet(context, 4, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		UpdateDescriptorSet(context, 5, scene->TopLevelAccelerationStructure.handle, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.WorldPositions.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 6, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.Normal.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 7, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.Albedo.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 8, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	// Camera Transform UBO
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = camera->GetBuffers()[i].buffer;
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(CameraTransform);
-		UpdateDescriptorSet(context, 9, bufferInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-	}
+	UpdateDescriptors();
+}
 
+// Every binding of every frame in flight, one templated update per set
+void vk::SpatialCompute::UpdateDescriptors()
+{
+	DescriptorWriter writer;
 	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
 	{
-		VkDescriptorImageInfo imageInfo = {
+		writer
+			.WriteBuffer(0, context.uniformArena->GetBuffer(static_cast<uint32_t>(i)).buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, sizeof(uSpatialPass))
+			.WriteBuffer(1, scene->GetLightsUBO()[i].buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sizeof(LightBuffer))
+			.WriteBuffer(2, initial_candidates.buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteBuffer(3, temporal_pass_reservoirs.buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteBuffer(4, m_RenderTarget.buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteAccelerationStructure(5, scene->TopLevelAccelerationStructure.handle)
+			.WriteImage(6, gbufferMRT[i].Surface.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, clampToEdgeSamplerAniso)
+			.WriteBuffer(9, camera->GetBuffers()[i].buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sizeof(CameraTransform))
+			.WriteBuffer(11, gpuStats[i].buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteBuffer(13, sampling.buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
 
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.MetallicRoughness.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
+		if (m_descriptorTemplate == VK_NULL_HANDLE)
+			m_descriptorTemplate = writer.CreateTemplate(context, m_descriptorSetLayout);
 
-		UpdateDescriptorSet(context, 10, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+		writer.Update(context, m_descriptorSets[i], m_descriptorTemplate);
 	}
 }
@@ -4,6 +4,8 @@
 #include "Image.hpp"
 #include <vector>
 #include "GBuffer.hpp"
+#include "PipelinePermutations.hpp"
+#include "DescriptorWriter.hpp"
 
 namespace vk
 {
@@ -14,35 +16,68 @@ namespace vk
 	class SpatialCompute
 	{
 	public:
-		explicit SpatialCompute(Context& context, std::shared_ptr<Scene>& scene, std::shared_ptr<Camera>& camera, Image& initial_candidates, Image& temporal_pass_reservoirs, const GBuffer::GBufferMRT& gbufferMRT);
+		explicit SpatialCompute(Context& context, std::shared_ptr<Scene>& scene, std::shared_ptr<Camera>& camera, Buffer& initial_candidates, Buffer& temporal_pass_reservoirs, const std::vector<GBuffer::GBufferMRT>& gbufferMRT, const std::vector<Buffer>& gpuStats, const Buffer& sampling);
 		~SpatialCompute();
 
 		void Execute(VkCommandBuffer cmd);
 		void Update();
 		void Resize();
 
-		Image& GetRenderTarget() { return m_RenderTarget; }
+		// Steps the global vs tiled kernel sweep, call before Update() with the last collected "Spatial" GPU time
+		void UpdateBenchmark(double spatialMilliseconds);
+		bool IsBenchmarking() const { return m_benchmark.running; }
+
+		Buffer& GetRenderTarget() { return m_RenderTarget; }
 	private:
-		void CreatePipeline();
+		void SelectPipeline(bool wait);
 		void BuildDescriptors();
+		void UpdateDescriptors();
 
 		Context& context;
 		std::shared_ptr<Scene> scene;
 		std::shared_ptr<Camera> camera;
-		Image m_RenderTarget;
+		Buffer m_RenderTarget;
 
-		Image& initial_candidates;
-		Image& temporal_pass_reservoirs;
-		const GBuffer::GBufferMRT& gbufferMRT;
+		Buffer& initial_candidates;
+		Buffer& temporal_pass_reservoirs;
+		const std::vector<GBuffer::GBufferMRT>& gbufferMRT;
+		const std::vector<Buffer>& gpuStats;
+		const Buffer& sampling;
 
-		VkPipeline m_Pipeline;
+		VkPipeline m_Pipeline;              // SpatialCompute.comp or SpatialComputeTiled.comp, whichever is enabled
 		VkPipelineLayout m_PipelineLayout;
+		PipelinePermutations m_Permutations; // owns m_Pipeline
 		std::vector<VkDescriptorSet> m_descriptorSets;
 		VkDescriptorSetLayout m_descriptorSetLayout;
+		VkDescriptorUpdateTemplate m_descriptorTemplate;
 
 		uint32_t m_width;
 		uint32_t m_height;
+		VkExtent2D m_reservoirExtent; // grid the reservoirs are stored for at the swapchain extent, dispatches cover the grid of renderExtent
+
+		uint32_t m_uniformOffset = 0; // of this frame's uSpatialPass in the uniform arena
+		bool m_tiledSupported = false; // maxComputeSharedMemorySize holds SpatialComputeTiled.comp's tile
+
+		struct BenchmarkResult
+		{
+			int radius;
+			double globalMilliseconds;
+			double tiledMilliseconds;
+		};
+
+		struct BenchmarkState
+		{
+			bool running = false;
+			size_t step = 0;     // radius index * 2 + kernel
+			uint32_t frame = 0;
+			double accumulated = 0.0;
+
+			// Restored when the sweep finishes
+			int savedRadius = 0;
+			bool savedTiled = false;
+			bool savedReSTIR = false;
 
-		std::vector<Buffer> m_uniformBuffers;
+			std::vector<BenchmarkResult> results;
+		} m_benchmark;
 	};
 }
\ No newline at end of file
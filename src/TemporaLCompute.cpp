@@ -1,4 +1,4 @@
-// Image& initial_candidates, Image& hit_world_positions, Image& hit_normals, Image& motion_vectors
+// Image& initial_candidates, Image& hit_world_positions, Image& hit_normals, const std::vector<Image>& motion_vectors
 
 #include "Context.hpp"
 #include "Camera.hpp"
@@ -7,334 +7,80 @@
 #include "Pipeline.hpp"
 #include "Utils.hpp"
 #include "Buffer.hpp"
+#include "UniformArena.hpp"
 
-vk::TemporalCompute::TemporalCompute(Context& context, std::shared_ptr<Scene>& scene, std::shared_ptr<Camera>& camera, Image& initial_candidates, Image& motion_vectors, const GBuffer::GBufferMRT& gbufferMRT) :
+vk::TemporalCompute::TemporalCompute(Context& context, std::shared_ptr<Scene>& scene, std::shared_ptr<Camera>& camera, Buffer& initial_candidates, const std::vector<Image>& motion_vectors, const std::vector<GBuffer::GBufferMRT>& gbufferMRT, const std::vector<Buffer>& gpuStats, Image& adaptive_history) :
 	context{ context },
 	scene{ scene },
 	camera{ camera },
 	initial_candidates{ initial_candidates },
 	motion_vectors{ motion_vectors },
 	gbufferMRT{ gbufferMRT },
+	gpuStats{ gpuStats },
+	adaptive_history{ adaptive_history },
 	m_Pipeline{ VK_NULL_HANDLE },
 	m_PipelineLayout{ VK_NULL_HANDLE },
+	m_Permutations{ context },
 	m_descriptorSetLayout{ VK_NULL_HANDLE },
+	m_descriptorTemplate{ VK_NULL_HANDLE },
 	m_width{ 0 },
-	m_height{ 0 }
+	m_height{ 0 },
+	m_reservoirExtent{ 0, 0 }
 {
 
 	m_width = context.extent.width;
 	m_height = context.extent.height;
+	m_reservoirExtent = GetReservoirExtent(context.extent, restirResolution);
 
-	m_uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-	for(auto& buffer : m_uniformBuffers)
-		buffer = CreateBuffer("TemporalComputeUBO", context, sizeof(uTemporalPass), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-
-	m_RenderTarget = CreateImageTexture2D(
-		"TemporalComputeRT",
-		context,
-		m_width,
-		m_height,
-		VK_FORMAT_R16G16B16A16_SFLOAT,
-		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-	// This starts off as shader read only since it'll be read from during the TemporalCompute pass first
-	// then at the end, we transition to transfer dst optimal and copy data into it which requires layout transition
-	m_PreviousImage = CreateImageTexture2D(
-		"PreviousImage",
-		context,
-		m_width,
-		m_height,
-		VK_FORMAT_R16G16B16A16_SFLOAT,
-		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-
-	ExecuteSingleTimeCommands(context, [&](VkCommandBuffer cmd) {
-
-		ImageTransition(
-			cmd,
-			m_RenderTarget.image,
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0,
-			VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-		);
-
-
-		ImageTransition(
-			cmd,
-			m_PreviousImage.image,
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0,
-			VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-		);
-
-	});
+	m_RenderTarget = CreateReservoirBuffer("TemporalComputeReservoirs", context, m_reservoirExtent.width, m_reservoirExtent.height);
+
+	// Read during the TemporalCompute pass, then overwritten with the spatial result at the end of the frame
+	m_PreviousReservoirs = CreateReservoirBuffer("PreviousReservoirs", context, m_reservoirExtent.width, m_reservoirExtent.height);
 
 	BuildDescriptors();
-	CreatePipeline();
+	SelectPipeline(false);
 }
 
-void vk::TemporalCompute::CopyImageToImage(const Image& currentSpatialTemporalComputeReservoirImage)
+// Recorded at the end of the frame, the render graph orders it after the last reads of both buffers
+void vk::TemporalCompute::CopyReservoirHistory(VkCommandBuffer cmd, const Buffer& currentSpatialReservoirs)
 {
-	// Useful link: https://gpuopen.com/learn/vulkan-barriers-explained/
-	ExecuteSingleTimeCommands(context, [&](VkCommandBuffer cmd)
-		{
-			// Transition the output to a TRANSFER_SRC_OPTIMAL layout since we will use this as the source
-			// to copy data to the DST image
-			// Write the reservoirs for each pixel to a seperate output image in the spatial reuse pass
-			// Ensure its final layout is SHADER_READ_ONLY so this can transition it
-			ImageTransition(
-				cmd,
-				currentSpatialTemporalComputeReservoirImage.image,
-				VK_FORMAT_R16G16B16A16_SFLOAT,
-				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				VK_ACCESS_SHADER_READ_BIT,
-				VK_ACCESS_TRANSFER_READ_BIT,
-				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, // Before this copy op, this image is sampled in a compute shader
-				VK_PIPELINE_STAGE_TRANSFER_BIT
-			);
-
-			// Transition to TRANSFER_DST_OPTIMAL layout since it will data copied to it from the other image
-			ImageTransition(
-				cmd,
-				m_PreviousImage.image,
-				VK_FORMAT_R16G16B16A16_SFLOAT,
-				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				VK_ACCESS_SHADER_READ_BIT,
-				VK_ACCESS_TRANSFER_WRITE_BIT,
-				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, // Before this copy op, this image is sampled in a compute shader
-				VK_PIPELINE_STAGE_TRANSFER_BIT
-			);
-
-			VkImageCopy imgCopy =
-			{
-				.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
-				.srcOffset = {0,0, 0},
-				.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
-				.dstOffset = {0, 0, 0},
-				.extent = {m_width, m_height, 1}
-			};
-
-			vkCmdCopyImage(
-				cmd,
-				currentSpatialTemporalComputeReservoirImage.image,
-				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				m_PreviousImage.image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				1,
-				&imgCopy
-			);
-
-
-			// Transiton the resource back to make sure its in the correct layout for the rendering loop where it will
-			// transition these resources to ensure they're in the correct layout for the ray tracing shaders to write to it
-
-			ImageTransition(
-				cmd,
-				currentSpatialTemporalComputeReservoirImage.image,
-				VK_FORMAT_R16G16B16A16_SFLOAT,
-				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-				VK_ACCESS_TRANSFER_READ_BIT,
-				VK_ACCESS_SHADER_READ_BIT,
-				VK_PIPELINE_STAGE_TRANSFER_BIT,
-				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-			);
-
-			// Transition this back to shader read only for the same reasons as the m_RenderTarget transition back after finishing copy
-			ImageTransition(
-				cmd,
-				m_PreviousImage.image,
-				VK_FORMAT_R16G16B16A16_SFLOAT,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-				VK_ACCESS_TRANSFER_WRITE_BIT,
-				VK_ACCESS_SHADER_READ_BIT,
-				VK_PIPELINE_STAGE_TRANSFER_BIT,
-				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-			);
-		});
+	// Only the grid of the current render extent is in use, packed at its own pitch
+	const VkExtent2D grid = GetReservoirExtent(renderExtent, restirResolution);
+
+	VkBufferCopy copy = {
+		.srcOffset = 0,
+		.dstOffset = 0,
+		.size = VkDeviceSize(grid.width) * grid.height * sizeof(PackedReservoir)
+	};
+
+	vkCmdCopyBuffer(cmd, currentSpatialReservoirs.buffer, m_PreviousReservoirs.buffer, 1, &copy);
 }
 
 
 vk::TemporalCompute::~TemporalCompute()
 {
-	for (auto& buffer : m_uniformBuffers)
-	{
-		buffer.Destroy(context.device);
-	}
 	m_RenderTarget.Destroy(context.device);
-	m_PreviousImage.Destroy(context.device);
-	vkDestroyPipeline(context.device, m_Pipeline, nullptr);
-	vkDestroyPipelineLayout(context.device, m_PipelineLayout, nullptr);
+	m_PreviousReservoirs.Destroy(context.device);
 	vkDestroyDescriptorSetLayout(context.device, m_descriptorSetLayout, nullptr);
+	vkDestroyDescriptorUpdateTemplate(context.device, m_descriptorTemplate, nullptr);
 }
 
 void vk::TemporalCompute::Resize()
 {
 
 	m_RenderTarget.Destroy(context.device);
-	m_PreviousImage.Destroy(context.device);
+	m_PreviousReservoirs.Destroy(context.device);
 
 	m_width = context.extent.width;
 	m_height = context.extent.height;
+	m_reservoirExtent = GetReservoirExtent(context.extent, restirResolution);
 
-	m_RenderTarget = CreateImageTexture2D(
-		"TemporalComputeRT",
-		context,
-		m_width,
-		m_height,
-		VK_FORMAT_R16G16B16A16_SFLOAT,
-		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-	// This starts off as shader read only since it'll be read from during the TemporalCompute pass first
-	// then at the end, we transition to transfer dst optimal and copy data into it which requires layout transition
-	m_PreviousImage = CreateImageTexture2D(
-		"PreviousImage",
-		context,
-		m_width,
-		m_height,
-		VK_FORMAT_R16G16B16A16_SFLOAT,
-		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		1
-	);
-
-
-	ExecuteSingleTimeCommands(context, [&](VkCommandBuffer cmd) {
-
-		ImageTransition(
-			cmd,
-			m_RenderTarget.image,
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0,
-			VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-		);
-
-
-		ImageTransition(
-			cmd,
-			m_PreviousImage.image,
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0,
-			VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-		);
-
-	});
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = initial_candidates.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 2, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = motion_vectors.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 3, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = m_PreviousImage.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 4, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-			.sampler = VK_NULL_HANDLE,
-			.imageView = m_RenderTarget.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_GENERAL
-		};
-
-		UpdateDescriptorSet(context, 5, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		UpdateDescriptorSet(context, 6, scene->TopLevelAccelerationStructure.handle, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.WorldPositions.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 7, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
+	m_RenderTarget = CreateReservoirBuffer("TemporalComputeReservoirs", context, m_reservoirExtent.width, m_reservoirExtent.height);
 
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.Normal.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 8, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
+	// Read during the TemporalCompute pass, then overwritten with the spatial result at the end of the frame
+	m_PreviousReservoirs = CreateReservoirBuffer("PreviousReservoirs", context, m_reservoirExtent.width, m_reservoirExtent.height);
 
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.Albedo.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 10, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.MetallicRoughness.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 11, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
+	UpdateDescriptors();
 }
 
 void vk::TemporalCompute::Execute(VkCommandBuffer cmd)
@@ -343,30 +89,12 @@ void vk::TemporalCompute::Execute(VkCommandBuffer cmd)
 	RenderPassLabel(cmd, "TemporalCompute");
 #endif // !DEBUG
 
-	ImageTransition(
-		cmd,
-		m_RenderTarget.image,
-		VK_FORMAT_R16G16B16A16_SFLOAT,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
-		VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
-		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-	);
-
 	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
-	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &m_descriptorSets[currentFrame], 0, nullptr);
-
-	// 8x8x1 threads per dispatch
-	vkCmdDispatch(cmd, m_width / 8, m_height / 8, 1);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &m_descriptorSets[currentFrame], 1, &m_uniformOffset);
 
-	ImageTransition(
-		cmd,
-		m_RenderTarget.image,
-		VK_FORMAT_R16G16B16A16_SFLOAT,
-		VK_IMAGE_LAYOUT_GENERAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
-		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-	);
+	// 8x8x1 threads per dispatch, rounded up, the kernel skips invocations past the grid
+	const VkExtent2D grid = GetReservoirExtent(renderExtent, restirResolution);
+	vkCmdDispatch(cmd, (grid.width + 7) / 8, (grid.height + 7) / 8, 1);
 
 #ifdef _DEBUG
 	EndRenderPassLabel(cmd);
@@ -377,22 +105,36 @@ void vk::TemporalCompute::Execute(VkCommandBuffer cmd)
 void vk::TemporalCompute::Update()
 {
 	TemporalPassData.frameIndex = frameNumber;
-	TemporalPassData.viewportSize = { m_width, m_height };
+	TemporalPassData.viewportSize = { renderExtent.width, renderExtent.height };
 	TemporalPassData.M = TemporalPassData.M;
 	TemporalPassData.enableUnbiased = TemporalPassData.enableUnbiased;
-	m_uniformBuffers[currentFrame].WriteToBuffer(&TemporalPassData, sizeof(uTemporalPass));
+	TemporalPassData.resolutionMode = static_cast<int>(restirResolution);
+	TemporalPassData.resetHistory = renderExtentChanged || resetTemporalHistory ? 1 : 0;
+	m_uniformOffset = context.uniformArena->Push(TemporalPassData);
+
+	SelectPipeline(m_Pipeline == VK_NULL_HANDLE);
 }
 
-void vk::TemporalCompute::CreatePipeline()
+// Permutation for the current settings, compiled in the background the first time they are used
+// Waits only when asked to, the first frame has nothing bound yet
+void vk::TemporalCompute::SelectPipeline(bool wait)
 {
-	auto pipelineResult = vk::PipelineBuilder(context, PipelineType::COMPUTE, VertexBinding::NONE, 0)
-		.AddShader("assets/shaders/TemporalCompute.comp.spv", ShaderType::COMPUTE)
-		.SetPipelineLayout({{m_descriptorSetLayout}})
-		.Build();
-
-	m_Pipeline = pipelineResult.first;
-	m_PipelineLayout = pipelineResult.second;
-
+	const std::string shaderPath = "assets/shaders/TemporalCompute.comp.spv";
+
+	SpecializationConstants constants;
+	if (enableSpecializedPipelines)
+		constants.Set(SPEC_UNBIASED, TemporalPassData.enableUnbiased ? 1 : 0);
+
+	const auto* pipeline = m_Permutations.Get(shaderPath, constants, [this, shaderPath](const SpecializationConstants& specialization) {
+		return vk::PipelineBuilder(context, PipelineType::COMPUTE, VertexBinding::NONE, 0)
+			.AddShader(shaderPath, ShaderType::COMPUTE, specialization)
+			.SetPipelineLayout({{m_descriptorSetLayout}})
+			.Build();
+	}, wait);
+
+	// The bound permutation stays in use until the new one has compiled
+	if (pipeline)
+		std::tie(m_Pipeline, m_PipelineLayout) = *pipeline;
 }
 
 void vk::TemporalCompute::BuildDescriptors()
@@ -400,151 +142,48 @@ void vk::TemporalCompute::BuildDescriptors()
 	m_descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
 	{
 		std::vector<VkDescriptorSetLayoutBinding> bindings = {
-			CreateDescriptorBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // ubo
+			CreateDescriptorBinding(0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT), // ubo, offset into the uniform arena
 			CreateDescriptorBinding(1, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // Light ubo
-			CreateDescriptorBinding(2, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT), // Initial candidates
+			CreateDescriptorBinding(2, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // Initial candidates
 			CreateDescriptorBinding(3, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT), // Motion vectors
-			CreateDescriptorBinding(4, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT), // Previous frame
-			CreateDescriptorBinding(5, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT), // Output
+			CreateDescriptorBinding(4, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // Previous frame
+			CreateDescriptorBinding(5, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // Output
 			CreateDescriptorBinding(6, 1, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, VK_SHADER_STAGE_COMPUTE_BIT), // TLAS
-			CreateDescriptorBinding(7, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),  // GBuffer - World position
-			CreateDescriptorBinding(8, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),   // GBuffer - World Normal
+			CreateDescriptorBinding(7, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),  // GBuffer - Packed surface
 			CreateDescriptorBinding(9, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
-			CreateDescriptorBinding(10, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT),
-			CreateDescriptorBinding(11, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+			CreateDescriptorBinding(11, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT), // GPU stats
+			CreateDescriptorBinding(12, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
 		};
 
 		m_descriptorSetLayout = CreateDescriptorSetLayout(context, bindings);
 		AllocateDescriptorSets(context, context.descriptorPool, m_descriptorSetLayout, MAX_FRAMES_IN_FLIGHT, m_descriptorSets);
 	}
 
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorBufferInfo buffer_info = {
-			.buffer = m_uniformBuffers[i].buffer,
-			.offset = 0,
-			.range = sizeof(uTemporalPass)
-		};
-		UpdateDescriptorSet(context, 0, buffer_info, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorBufferInfo buffer_info = {
-			.buffer = scene->GetLightsUBO()[i].buffer,
-			.offset = 0,
-			.range = sizeof(LightBuffer)
-		};
-		UpdateDescriptorSet(context, 1, buffer_info, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = initial_candidates.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 2, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = motion_vectors.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 3, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = m_PreviousImage.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 4, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-			.sampler = VK_NULL_HANDLE,
-			.imageView = m_RenderTarget.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_GENERAL
-		};
-
-		UpdateDescriptorSet(context, 5, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		UpdateDescriptorSet(context, 6, scene->TopLevelAccelerationStructure.handle, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.WorldPositions.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 7, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.Normal.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 8, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	// Camera Transform UBO
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = camera->GetBuffers()[i].buffer;
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(CameraTransform);
-		UpdateDescriptorSet(context, 9, bufferInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.Albedo.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		UpdateDescriptorSet(context, 10, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-	}
-
-	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
-	{
-		VkDescriptorImageInfo imageInfo = {
-
-			.sampler = clampToEdgeSamplerAniso,
-			.imageView = gbufferMRT.MetallicRoughness.imageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
+	UpdateDescriptors();
+}
 
-		UpdateDescriptorSet(context, 11, imageInfo, m_descriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+// Every binding of every frame in flight, one templated update per set
+void vk::TemporalCompute::UpdateDescriptors()
+{
+	DescriptorWriter writer;
+	for (size_t i = 0; i < (size_t)MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		writer
+			.WriteBuffer(0, context.uniformArena->GetBuffer(static_cast<uint32_t>(i)).buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, sizeof(uTemporalPass))
+			.WriteBuffer(1, scene->GetLightsUBO()[i].buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sizeof(LightBuffer))
+			.WriteBuffer(2, initial_candidates.buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteImage(3, motion_vectors[i].imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, clampToEdgeSamplerAniso)
+			.WriteBuffer(4, m_PreviousReservoirs.buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteBuffer(5, m_RenderTarget.buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteAccelerationStructure(6, scene->TopLevelAccelerationStructure.handle)
+			.WriteImage(7, gbufferMRT[i].Surface.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, clampToEdgeSamplerAniso)
+			.WriteBuffer(9, camera->GetBuffers()[i].buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sizeof(CameraTransform))
+			.WriteBuffer(11, gpuStats[i].buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+			.WriteImage(12, adaptive_history.imageView, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+
+		if (m_descriptorTemplate == VK_NULL_HANDLE)
+			m_descriptorTemplate = writer.CreateTemplate(context, m_descriptorSetLayout);
+
+		writer.Update(context, m_descriptorSets[i], m_descriptorTemplate);
 	}
 }
@@ -4,6 +4,8 @@
 #include "Image.hpp"
 #include <vector>
 #include "GBuffer.hpp"
+#include "PipelinePermutations.hpp"
+#include "DescriptorWriter.hpp"
 
 namespace vk
 {
@@ -14,37 +16,45 @@ namespace vk
 	class TemporalCompute
 	{
 	public:
-		explicit TemporalCompute(Context& context, std::shared_ptr<Scene>& scene, std::shared_ptr<Camera>& camera, Image& initial_candidates, Image& motion_vectors, const GBuffer::GBufferMRT& gbufferMRT);
+		explicit TemporalCompute(Context& context, std::shared_ptr<Scene>& scene, std::shared_ptr<Camera>& camera, Buffer& initial_candidates, const std::vector<Image>& motion_vectors, const std::vector<GBuffer::GBufferMRT>& gbufferMRT, const std::vector<Buffer>& gpuStats, Image& adaptive_history);
 		~TemporalCompute();
 
 		void Execute(VkCommandBuffer cmd);
 		void Update();
 		void Resize();
 
-		void CopyImageToImage(const Image& currentSpatialTemporalReservoirImage);
+		void CopyReservoirHistory(VkCommandBuffer cmd, const Buffer& currentSpatialReservoirs);
 
-		Image& GetRenderTarget() { return m_RenderTarget; }
+		Buffer& GetRenderTarget() { return m_RenderTarget; }
+		Buffer& GetPreviousReservoirs() { return m_PreviousReservoirs; }
+		uint32_t GetUniformOffset() const { return m_uniformOffset; }
 	private:
-		void CreatePipeline();
+		void SelectPipeline(bool wait);
 		void BuildDescriptors();
+		void UpdateDescriptors();
 
 		Context& context;
 		std::shared_ptr<Scene> scene;
 		std::shared_ptr<Camera> camera;
-		Image m_RenderTarget;
-		Image m_PreviousImage;
-		Image& initial_candidates;
-		Image& motion_vectors;
-		const GBuffer::GBufferMRT& gbufferMRT;
+		Buffer m_RenderTarget;
+		Buffer m_PreviousReservoirs;
+		Buffer& initial_candidates;
+		const std::vector<Image>& motion_vectors;
+		const std::vector<GBuffer::GBufferMRT>& gbufferMRT;
+		const std::vector<Buffer>& gpuStats;
+		Image& adaptive_history;
 
 		VkPipeline m_Pipeline;
 		VkPipelineLayout m_PipelineLayout;
+		PipelinePermutations m_Permutations; // owns m_Pipeline
 		std::vector<VkDescriptorSet> m_descriptorSets;
 		VkDescriptorSetLayout m_descriptorSetLayout;
+		VkDescriptorUpdateTemplate m_descriptorTemplate;
 
 		uint32_t m_width;
 		uint32_t m_height;
+		VkExtent2D m_reservoirExtent; // grid the reservoirs are stored for at the swapchain extent, dispatches cover the grid of renderExtent
 
-		std::vector<Buffer> m_uniformBuffers;
+		uint32_t m_uniformOffset = 0; // of this frame's uTemporalPass in the uniform arena
 	};
 }
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+vk::ThreadPool::ThreadPool(uint32_t threadCount) :
+	m_nextQueue{ 0 },
+	m_pendingTasks{ 0 },
+	m_queuedTasks{ 0 },
+	m_stop{ false }
+{
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	m_queues.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; i++)
+		m_queues.push_back(std::make_unique<WorkQueue>());
+
+	m_workers.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; i++)
+		m_workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+vk::ThreadPool::~ThreadPool()
+{
+	Wait();
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+
+	for (auto& worker : m_workers)
+		worker.join();
+}
+
+void vk::ThreadPool::Submit(std::function<void()> task)
+{
+	// Round robin the initial placement, stealing evens it out afterwards
+	uint32_t queueIndex = m_nextQueue.fetch_add(1, std::memory_order_relaxed) % static_cast<uint32_t>(m_queues.size());
+
+	m_pendingTasks.fetch_add(1, std::memory_order_acq_rel);
+	m_queuedTasks.fetch_add(1, std::memory_order_acq_rel);
+	{
+		std::lock_guard<std::mutex> lock(m_queues[queueIndex]->mutex);
+		m_queues[queueIndex]->tasks.push_back(std::move(task));
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+	}
+	m_wake.notify_one();
+}
+
+void vk::ThreadPool::ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& fn)
+{
+	grainSize = std::max(1u, grainSize);
+
+	for (uint32_t begin = 0; begin < count; begin += grainSize)
+	{
+		uint32_t end = std::min(count, begin + grainSize);
+		Submit([&fn, begin, end]() { fn(begin, end); });
+	}
+
+	Wait();
+}
+
+void vk::ThreadPool::Wait()
+{
+	uint32_t queueIndex = 0;
+	while (m_pendingTasks.load(std::memory_order_acquire) > 0)
+	{
+		// Help out instead of sleeping while there is still work queued
+		if (TryRunTask(queueIndex))
+			continue;
+
+		queueIndex = (queueIndex + 1) % static_cast<uint32_t>(m_queues.size());
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_idle.wait_for(lock, std::chrono::milliseconds(1), [this]() { return m_pendingTasks.load(std::memory_order_acquire) == 0; });
+	}
+}
+
+bool vk::ThreadPool::TryRunTask(uint32_t queueIndex)
+{
+	std::function<void()> task;
+	const uint32_t queueCount = static_cast<uint32_t>(m_queues.size());
+
+	// Own queue first (LIFO for locality)
+	{
+		std::lock_guard<std::mutex> lock(m_queues[queueIndex]->mutex);
+		if (!m_queues[queueIndex]->tasks.empty())
+		{
+			task = std::move(m_queues[queueIndex]->tasks.back());
+			m_queues[queueIndex]->tasks.pop_back();
+		}
+	}
+
+	// Steal from the front of the other queues (FIFO, takes the oldest and usually largest work)
+	for (uint32_t i = 1; !task && i < queueCount; i++)
+	{
+		WorkQueue& victim = *m_queues[(queueIndex + i) % queueCount];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+		}
+	}
+
+	if (!task)
+		return false;
+
+	m_queuedTasks.fetch_sub(1, std::memory_order_acq_rel);
+
+	task();
+
+	if (m_pendingTasks.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_idle.notify_all();
+	}
+
+	return true;
+}
+
+void vk::ThreadPool::WorkerLoop(uint32_t workerIndex)
+{
+	while (true)
+	{
+		if (TryRunTask(workerIndex))
+			continue;
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wake.wait_for(lock, std::chrono::milliseconds(1), [this]() { return m_stop || m_queuedTasks.load(std::memory_order_acquire) > 0; });
+
+		if (m_stop)
+			return;
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vk
+{
+	// Work-stealing thread pool
+	// Each worker owns a deque. Workers pop from the back of their own deque and steal from the front of
+	// another worker's deque when theirs is empty, so uneven tasks (e.g. pixels that trace more rays) balance out
+	class ThreadPool
+	{
+	public:
+		explicit ThreadPool(uint32_t threadCount = 0); // 0 = hardware concurrency
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		void Submit(std::function<void()> task);
+
+		// Splits [0, count) into chunks of grainSize and blocks until every chunk has run
+		void ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& fn);
+
+		// Blocks until every submitted task has finished. The calling thread helps run tasks while it waits
+		void Wait();
+
+		uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+	private:
+		struct WorkQueue
+		{
+			std::mutex mutex;
+			std::deque<std::function<void()>> tasks;
+		};
+
+		void WorkerLoop(uint32_t workerIndex);
+		bool TryRunTask(uint32_t queueIndex);
+
+		std::vector<std::thread> m_workers;
+		std::vector<std::unique_ptr<WorkQueue>> m_queues;
+
+		std::mutex m_sleepMutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_idle;
+
+		std::atomic<uint32_t> m_nextQueue;
+		std::atomic<uint64_t> m_pendingTasks; // queued + running
+		std::atomic<uint64_t> m_queuedTasks;
+		bool m_stop;
+	};
+}
@@ -0,0 +1,49 @@
+#include "Context.hpp"
+#include "UniformArena.hpp"
+#include "Utils.hpp"
+
+vk::UniformArena::UniformArena(Context& context, VkDeviceSize capacity) :
+	context{ context },
+	m_capacity{ capacity },
+	m_alignment{ 0 },
+	m_head{ 0 },
+	m_frame{ 0 }
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(context.pDevice, &properties);
+	m_alignment = properties.limits.minUniformBufferOffsetAlignment;
+
+	m_buffers.resize(MAX_FRAMES_IN_FLIGHT);
+	for (auto& buffer : m_buffers)
+		buffer = CreateBuffer("UniformArena", context, m_capacity, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+}
+
+vk::UniformArena::~UniformArena()
+{
+	for (auto& buffer : m_buffers)
+		buffer.Destroy(context.device);
+}
+
+void vk::UniformArena::BeginFrame(uint32_t frame)
+{
+	m_frame = frame;
+	m_head = 0;
+}
+
+void vk::UniformArena::Flush()
+{
+	if (m_head > 0)
+		vmaFlushAllocation(context.allocator, m_buffers[m_frame].allocation, 0, m_head);
+}
+
+uint32_t vk::UniformArena::Allocate(const void* data, VkDeviceSize size)
+{
+	const VkDeviceSize offset = (m_head + m_alignment - 1) & ~(m_alignment - 1);
+	if (offset + size > m_capacity)
+		throw std::runtime_error("Uniform arena is out of memory");
+
+	std::memcpy(static_cast<uint8_t*>(m_buffers[m_frame].mapped) + offset, data, size);
+	m_head = offset + size;
+
+	return static_cast<uint32_t>(offset);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <volk/volk.h>
+#include <cstdint>
+#include <vector>
+#include "Buffer.hpp"
+
+namespace vk
+{
+	class Context;
+
+	// Linear allocator for the small uniforms written every frame, one persistently mapped buffer per frame in flight
+	// A pass copies its data in with Push and binds the returned offset as the dynamic offset of a
+	// VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC binding, written once against GetBuffer(frame). Everything pushed is
+	// dropped by the next BeginFrame of the same slot, once the renderer's frame timeline semaphores show the GPU
+	// has finished the frame that last used it
+	class UniformArena
+	{
+	public:
+		UniformArena(Context& context, VkDeviceSize capacity);
+		~UniformArena();
+
+		// Rewinds the slot the frame is about to record into
+		void BeginFrame(uint32_t frame);
+
+		// Makes the frame's writes visible to the device, only does work on non-coherent memory
+		void Flush();
+
+		// Offset of the copy in the current frame's buffer, aligned for a dynamic uniform buffer offset
+		uint32_t Allocate(const void* data, VkDeviceSize size);
+
+		template <typename T>
+		uint32_t Push(const T& data) { return Allocate(&data, sizeof(T)); }
+
+		const Buffer& GetBuffer(uint32_t frame) const { return m_buffers[frame]; }
+		VkDeviceSize GetUsed() const { return m_head; }
+
+	private:
+		Context& context;
+
+		std::vector<Buffer> m_buffers;
+		VkDeviceSize m_capacity;
+		VkDeviceSize m_alignment; // minUniformBufferOffsetAlignment
+		VkDeviceSize m_head;
+		uint32_t m_frame;
+	};
+}
@@ -4,6 +4,7 @@
 #include <functional>
 #include <glm/glm.hpp>
 #include <array>
+#include <algorithm>
 
 class Context;
 
@@ -18,6 +19,8 @@ class Context;
 #define ERROR(message) std::cout << "[ERROR]: " << message << std::endl; \
 
 constexpr int NUM_LIGHTS = 100;
+constexpr int MAX_LIGHT_TILES = 128;
+constexpr int MAX_LIGHT_TILE_SIZE = 1024;
 
 namespace vk
 {
@@ -28,8 +31,51 @@ namespace vk
 		MESH_DENSITY
 	};
 
+	// Resolution the ReSTIR reservoir passes run at, must match RESOLUTION_* in shaders/Reservoir.glsl
+	// Shading always writes every pixel, either from the nearest matching reservoir or through the bilateral upsample
+	enum class ReSTIRResolution
+	{
+		FULL,
+		HALF,           // one reservoir per 2x2 block, the pixel it is sampled for moves around the block every frame
+		CHECKERBOARD    // one reservoir per horizontal pixel pair, alternating between the two every frame
+	};
+
+	// Specialisation constant ids of the ReSTIR kernels, must match shaders/Specialization.glsl
+	enum ReSTIRConstant : uint32_t
+	{
+		SPEC_CANDIDATE_COUNT = 0,
+		SPEC_UNBIASED = 1,
+		SPEC_TEMPORAL_M_CLAMP = 2,
+		SPEC_SPATIAL_NEIGHBOURS = 3,
+		SPEC_SAMPLING = 4
+	};
+
+	// Random numbers the ReSTIR kernels draw candidates and spatial neighbours from, see shaders/Sampling.glsl
+	enum class SamplingMode
+	{
+		WHITE_NOISE,
+		LOW_DISCREPANCY     // Owen scrambled Sobol candidates, blue noise light tile offsets, Poisson disk neighbours
+	};
+
+	// Target FrameCapture copies out of the frame
+	enum class CaptureSource
+	{
+		SHADING,
+		COMPOSITE,          // tone mapped and gamma corrected
+		HISTORY             // the accumulation
+	};
+
+	enum class CaptureFormat
+	{
+		PNG,                // 8 bit, HDR sources are tone mapped like the present pass
+		EXR,                // uncompressed 32 bit float RGB
+		PFM
+	};
 
-	inline int MAX_FRAMES_IN_FLIGHT;
+
+	// Frames the CPU may record ahead of the GPU, independent of the swapchain image count. Set before the context is
+	// made (--frames-in-flight), every per frame resource is sized by it
+	inline int MAX_FRAMES_IN_FLIGHT = 2;
 	inline int currentFrame;
 
 	inline VkSampler repeatSamplerAniso;
@@ -48,6 +94,8 @@ namespace vk
 		glm::vec4 BaseColourFactor;
 		float Metallic;
 		float Roughness;
+		uint32_t MaterialIndex;  // into the material buffer
+		uint32_t MaterialBuffer; // bindless handle of the material buffer
 	};
 
 	struct LightUBO
@@ -61,6 +109,7 @@ namespace vk
 	struct AccumulationSetting
 	{
 		alignas(1) bool Enable;
+		alignas(8) glm::vec2 renderExtent;  // sub rectangle of the targets that was rendered, upscaled to the swapchain
 	};
 
 	struct LightBuffer
@@ -81,16 +130,15 @@ namespace vk
 		alignas(4) int numPastFrames;
 	};
 
-	struct Reservoir
-	{
-		int Y; // Currently Y is index light array
-		float Y_weight;
-	};
-
-	struct ReservoirStorage
+	// One reservoir per pixel in the ReSTIR storage buffers, must match PackedReservoir in shaders/Reservoir.glsl
+	// packedM: bits 0-15 = M, bit 16 = visibility known, bit 17 = visible, bits 18-31 reserved
+	struct PackedReservoir
 	{
-		Reservoir reservoirs[1280 * 720];
+		int lightIndex;
+		float W;
+		uint32_t packedM;
 	};
+	static_assert(sizeof(PackedReservoir) == 12, "PackedReservoir must match the std430 layout in Reservoir.glsl");
 
 	struct ReusePass
 	{
@@ -103,6 +151,28 @@ namespace vk
 		alignas(4) int frameIndex;
 		alignas(8) glm::vec2 viewportSize;
 		alignas(4) int M;
+		alignas(4) int lightTileCount;
+		alignas(4) int lightTileSize;
+		alignas(4) int enableLightTiles;
+		alignas(4) int rayBudget;           // shadow rays per pixel, 0 leaves visibility to a later pass
+		alignas(4) int resolutionMode;      // ReSTIRResolution
+		alignas(4) int adaptiveM;           // pick each cell's candidate count between minM and M, see shaders/AdaptiveCandidates.glsl
+		alignas(4) int minM;
+	};
+
+	// Compact copy of a light drawn into a light tile
+	// position.w = pdf the light was drawn with, colour.w = index into the light buffer
+	struct LightTileSample
+	{
+		alignas(16) glm::vec4 position;
+		alignas(16) glm::vec4 colour;
+	};
+
+	struct uLightTilesPass
+	{
+		alignas(4) int frameIndex;
+		alignas(4) int tileCount;
+		alignas(4) int tileSize;
 	};
 
 	struct uTemporalPass
@@ -111,6 +181,9 @@ namespace vk
 		alignas(8) glm::vec2 viewportSize;
 		alignas(4) int M;
 		alignas(1) bool enableUnbiased;
+		alignas(4) int rayBudget;
+		alignas(4) int resolutionMode;
+		alignas(4) int resetHistory;        // render extent changed, the previous reservoirs use a different grid
 	};
 
 	struct uSpatialPass
@@ -120,11 +193,17 @@ namespace vk
 		alignas(4) int M;
 		alignas(4) int radius;
 		alignas(1) bool enableUnbiased;
+		alignas(4) int rayBudget;
+		alignas(4) int resolutionMode;
 	};
 
 	struct uShadingPass
 	{
 		alignas(4) int reservoir_pass;
+		alignas(4) int rayBudget;
+		alignas(4) int frameIndex;
+		alignas(4) int resolutionMode;
+		alignas(4) int upsample;            // shade once per reservoir then run ShadingUpsample.comp
 	};
 
 	inline AccumulationSetting accumulationSetting = {};
@@ -132,17 +211,97 @@ namespace vk
 	inline uint32_t setRenderingPipeline = 1;
 	inline uint32_t setAlphaMakingPipeline = 2;
 	inline RTX rtxSettings = { 1, 0, 1000 };
-	inline VkDescriptorSetLayout materialDescriptorSetLayout;
 	inline uint32_t frameNumber = 0;
 	inline bool isAccumulating = false;
 	inline bool shouldClearBeforeDraw = false;
-	inline uCandidatesPass CandidatesPassData = { 0, {1280, 720}, 32 };
-	inline uTemporalPass TemporalPassData = { 0, { 1280, 720 }, 20 };
-	inline uSpatialPass SpatialPassData = { 0, { 1280, 720 }, 20, 30 };
-	inline uShadingPass ShadingPassData = { 0 };
+	inline uCandidatesPass CandidatesPassData = { 0, {1280, 720}, 32, 64, 512, 1, 1, 0, 0, 4 };
+	inline uLightTilesPass LightTilesPassData = { 0, 64, 512 };
+	inline uTemporalPass TemporalPassData = { 0, { 1280, 720 }, 20, false, 2 };
+	inline uSpatialPass SpatialPassData = { 0, { 1280, 720 }, 20, 30, false, 4 };
+	inline uShadingPass ShadingPassData = { 0, 1 };
 	inline bool enableReSTIR = false;
 	inline bool ShouldAnimateLights = false;
-	inline bool ShouldWriteToFile = false;
+	inline bool ShouldWriteToFile = false;      // capture every frame while set, see FrameCapture
+	inline bool enableLightTiles = true;
+	inline bool enableTiledSpatial = false;     // shared memory spatial reuse kernel, SpatialComputeTiled.comp
+	inline bool runSpatialBenchmark = false;    // set from ImGui, cleared by SpatialCompute once the sweep starts
+	inline bool enableFusedTemporal = false;    // candidates + temporal reuse in one dispatch, CandidatesTemporalFused.comp
+	inline bool enableGPUStats = false;         // ray and reservoir counters in the ReSTIR passes, see GPUStats
+	inline bool logGPUStats = false;            // append every collected GPUStats frame to gpu_stats.csv
+	inline ReSTIRResolution restirResolution = ReSTIRResolution::FULL;
+	inline bool enableReSTIRUpsample = true;    // joint bilateral upsample of reduced resolution shading, otherwise full resolution shading
+	inline bool enableAdaptiveCandidates = false; // candidate count per cell from its temporal history, needs ReSTIR for the history
+	inline bool enableSpecializedPipelines = true; // ReSTIR passes bind permutations with their settings baked in, see PipelinePermutations
+	inline bool enableAsyncCompute = true;      // ReSTIR, denoiser and history passes on the compute only queue when the device has one, see RenderGraph
+	inline SamplingMode samplingMode = SamplingMode::LOW_DISCREPANCY;
+	inline bool dumpRenderGraph = false;        // set from ImGui, the renderer writes the compiled graph to render_graph.txt
+	inline bool runConvergenceBenchmark = false; // set from ImGui, cleared by ConvergenceBenchmark once the run starts
+	inline bool resetTemporalHistory = false;   // set for one frame, temporal reuse and the denoiser start over without their history
+
+	// Dynamic resolution, see DynamicResolution
+	// Targets stay allocated at context.extent, every pass renders into the top left renderExtent of them
+	struct DynamicResolutionSettings
+	{
+		bool enable;
+		float targetMilliseconds;   // GPU frame time the controller holds
+		float minScale;             // per axis
+		float maxScale;
+		float kp;                   // proportional gain, scale per unit of relative frame time error
+		float ki;                   // integral gain
+	};
+
+	inline DynamicResolutionSettings dynamicResolution = { false, 16.6f, 0.5f, 1.0f, 0.25f, 0.05f };
+	inline VkExtent2D renderExtent = { 1280, 720 };
+	inline bool renderExtentChanged = false;    // set for the frame the extent changed on, temporal reuse skips its history
+
+	// Spatiotemporal variance-guided filtering of the shading result, see Denoiser
+	constexpr int MAX_ATROUS_ITERATIONS = 5;
+
+	struct DenoiserSettings
+	{
+		bool enable;
+		int atrousIterations;       // wavelet passes, the step doubles every pass, 1 to MAX_ATROUS_ITERATIONS
+		float colourAlpha;          // weight of the new frame once the history is longer than 1 / alpha
+		float momentsAlpha;
+		float phiColour;            // luminance edge stopping in filtered standard deviations
+		float phiNormal;            // exponent on the normal dot product
+		float phiDepth;             // relative depth tolerance per pixel of step
+	};
+
+	inline DenoiserSettings denoiser = { false, 4, 0.2f, 0.2f, 4.0f, 128.0f, 1.0f };
+
+	// Frame capture, see FrameCapture
+	struct CaptureSettings
+	{
+		CaptureSource source;
+		CaptureFormat format;
+		int sequenceLength;         // frames a sequence capture writes
+		int framesRemaining;        // set from ImGui, counted down once per captured frame
+	};
+
+	inline CaptureSettings capture = { CaptureSource::SHADING, CaptureFormat::PNG, 1000, 0 };
+
+	// Push constants of the denoiser kernels, must match shaders/SVGF.glsl
+	struct uDenoiserPass
+	{
+		alignas(8) glm::vec2 renderExtent;
+		alignas(4) int stepSize;
+		alignas(4) int writeHistory;        // first wavelet pass, its output is the next frame's colour history
+		alignas(4) int finalIteration;      // multiply the albedo back in and write the denoised target
+		alignas(4) int resetHistory;
+		alignas(4) float colourAlpha;
+		alignas(4) float momentsAlpha;
+		alignas(4) float phiColour;
+		alignas(4) float phiNormal;
+		alignas(4) float phiDepth;
+	};
+
+	// Push constants of the convergence error kernels, must match shaders/Convergence.glsl
+	struct uConvergencePass
+	{
+		alignas(8) glm::vec2 renderExtent;
+		alignas(4) int partialCount;        // workgroups ConvergenceError.comp wrote a partial sum for
+	};
 }
 
 namespace vk
@@ -160,11 +319,20 @@ namespace vk
 		uint32_t srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
 		uint32_t dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED);
 
+	void BufferBarrier(
+		VkCommandBuffer cmd,
+		VkBuffer buffer,
+		VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask,
+		VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
+		VkDeviceSize offset = 0,
+		VkDeviceSize size = VK_WHOLE_SIZE);
+
 	VkDescriptorSetLayout CreateDescriptorSetLayout(Context& context, const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayoutCreateFlags flags = 0);
 	void AllocateDescriptorSets(Context& context, VkDescriptorPool descriptorPool, const VkDescriptorSetLayout descriptorLayout, uint32_t setCount, std::vector<VkDescriptorSet>& descriptorSet);
 	void AllocateDescriptorSet(Context& context, VkDescriptorPool descriptorPool, const VkDescriptorSetLayout descriptorLayout, uint32_t setCount, VkDescriptorSet& descriptorSet);
 	VkDescriptorSetLayoutBinding CreateDescriptorBinding(uint32_t binding, uint32_t count, VkDescriptorType type, VkShaderStageFlags shaderStage);
 
+	// Single writes, DescriptorWriter batches every write of a set into one call
 	// Update buffer descriptor
 	void UpdateDescriptorSet(Context& context, uint32_t binding, VkDescriptorBufferInfo bufferInfo, VkDescriptorSet descriptorSet, VkDescriptorType descriptorType);
 	// Update image descriptor
@@ -189,6 +357,34 @@ namespace vk
 		vkCmdEndDebugUtilsLabelEXT(commandBuffer);
 	}
 
+	// Size of the reservoir buffers and of the ReSTIR dispatches for a swapchain extent
+	inline VkExtent2D GetReservoirExtent(VkExtent2D extent, ReSTIRResolution resolution)
+	{
+		switch (resolution)
+		{
+		case ReSTIRResolution::HALF:
+			return { extent.width / 2, extent.height / 2 };
+		case ReSTIRResolution::CHECKERBOARD:
+			return { extent.width / 2, extent.height };
+		default:
+			return extent;
+		}
+	}
+
+	// Internal render resolution for a scale of the swapchain extent
+	// Rounded down to 16 pixels so the 8x8 and 16x16 dispatches and the half resolution grids cover it exactly
+	inline VkExtent2D GetRenderExtent(VkExtent2D extent, float scale)
+	{
+		if (scale >= 1.0f)
+		{
+			return extent;
+		}
+
+		uint32_t width = (uint32_t(float(extent.width) * scale) / 16) * 16;
+		uint32_t height = (uint32_t(float(extent.height) * scale) / 16) * 16;
+		return { std::max(width, 16u), std::max(height, 16u) };
+	}
+
 	inline VkDeviceAddress GetBufferDeviceAddress(VkDevice device, VkBuffer buffer)
 	{
 		VkBufferDeviceAddressInfo addressInfo{
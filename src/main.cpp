@@ -1,4 +1,5 @@
 #include <tuple>
+#include <algorithm>
 #include <chrono>
 #include <limits>
 #include <vector>
@@ -23,10 +24,57 @@
 #include "Utils.hpp"
 #include "Context.hpp"
 #include "Engine.hpp"
+#include "ReferenceRenderer.hpp"
 #include <string>
 
-int main() try
+namespace
 {
+	// --reference runs the CPU reference renderer instead of the engine, no GPU or window is needed
+	bool ParseReferenceArgs(const std::vector<std::string>& args, vk::ReferenceSettings& settings)
+	{
+		const bool isReference = std::find(args.begin(), args.end(), "--reference") != args.end();
+		for (size_t i = 0; i < args.size(); i++)
+		{
+			const std::string& arg = args[i];
+			auto next = [&]() -> std::string {
+				if (i + 1 >= args.size())
+					throw std::runtime_error("Missing value for " + arg);
+				return args[++i];
+			};
+
+			if (!isReference)
+				throw std::runtime_error("Unknown argument: " + arg + ", reference renderer settings need --reference");
+
+			if (arg == "--reference")       continue;
+			else if (arg == "--scene")      settings.scenePath = next();
+			else if (arg == "--out")        settings.outputDirectory = next();
+			else if (arg == "--width")      settings.width = std::stoul(next());
+			else if (arg == "--height")     settings.height = std::stoul(next());
+			else if (arg == "--frames")     settings.frameCount = std::stoul(next());
+			else if (arg == "--threads")    settings.threadCount = std::stoul(next());
+			else if (arg == "--M")          settings.candidateM = std::stoi(next());
+			else if (arg == "--radius")     settings.spatialRadius = std::stoi(next());
+			else if (arg == "--unbiased")   settings.enableUnbiased = true;
+			else if (arg == "--no-restir")  settings.enableReSTIR = false;
+			else if (arg == "--white-noise") settings.samplingMode = vk::SamplingMode::WHITE_NOISE;
+			else throw std::runtime_error("Unknown argument: " + arg);
+		}
+		return isReference;
+	}
+}
+
+int main(int argc, char** argv) try
+{
+	const std::vector<std::string> args = vk::ParseEngineArgs(argc, argv);
+
+	vk::ReferenceSettings referenceSettings;
+	if (ParseReferenceArgs(args, referenceSettings))
+	{
+		vk::ReferenceRenderer reference(referenceSettings);
+		reference.Render();
+		return 0;
+	}
+
 	vk::Engine engine;
 
 	if (!engine.Initialize())
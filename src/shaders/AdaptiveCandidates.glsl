@@ -0,0 +1,46 @@
+// Per reservoir cell history driving the adaptive candidate count, owned by vk::Candidates
+//
+// r, g = moving mean of the sample luminance and of its square
+// b    = frames of accepted temporal history, written by the temporal pass after its history test
+// a    = candidates drawn this frame
+//
+// The candidates kernel reads all of it before generating candidates and writes r, g and a, the temporal pass
+// writes b. Every invocation only touches its own cell so no other synchronisation is needed within a dispatch
+
+layout(set = 0, binding = 12, rgba32f) uniform image2D adaptive_history;
+
+// Accepted history frames before a cell counts as converged
+#define ADAPTIVE_CONVERGED_FRAMES 16.0
+// Weight of the newest sample in the luminance moments
+#define ADAPTIVE_MOMENT_ALPHA 0.1
+// Relative standard deviation of the luminance that keeps the full candidate count
+#define ADAPTIVE_NOISE_LIMIT 2.0
+
+// Disoccluded or freshly rejected cells get maxM, converged cells fall towards minM unless their
+// luminance is still noisy
+int AdaptiveCandidateCount(vec4 history, int minM, int maxM)
+{
+    float confidence = clamp(history.b / ADAPTIVE_CONVERGED_FRAMES, 0.0, 1.0);
+
+    float mean = history.r;
+    float deviation = sqrt(max(history.g - mean * mean, 0.0));
+    float noise = mean > 1e-4 ? clamp(deviation / (mean * ADAPTIVE_NOISE_LIMIT), 0.0, 1.0) : 0.0;
+
+    float need = max(1.0 - confidence, noise);
+    return clamp(int(round(mix(float(minM), float(maxM), need))), 1, maxM);
+}
+
+// Moments restart from the current sample when the cell has no history, they belong to another surface
+vec4 UpdateLuminanceMoments(vec4 history, float luminance, int candidateCount)
+{
+    vec2 moments = vec2(luminance, luminance * luminance);
+    history.rg = history.b > 0.0 ? mix(history.rg, moments, ADAPTIVE_MOMENT_ALPHA) : moments;
+    history.a = float(candidateCount);
+    return history;
+}
+
+vec4 UpdateHistoryLength(vec4 history, bool isValidHistory)
+{
+    history.b = isValidHistory ? min(history.b + 1.0, ADAPTIVE_CONVERGED_FRAMES) : 0.0;
+    return history;
+}
@@ -0,0 +1,27 @@
+// Global bindless heap (BindlessHeap.hpp), one update-after-bind set every resource is addressed in by a 32-bit handle
+//   binding 0 - storage buffers
+//   binding 1 - storage images
+//   binding 2 - sampled textures, the variable count binding the heap grows
+// Indices that differ within a draw or dispatch have to go through nonuniformEXT
+//
+// Define BINDLESS_SET before including when the pass binds the heap somewhere other than set 1
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+#ifndef BINDLESS_SET
+#define BINDLESS_SET 1
+#endif
+
+// Matches MaterialHandles in GLTF.hpp, one per material
+struct MaterialHandles
+{
+    uint albedo;
+    uint metallicRoughness;
+};
+
+layout(set = BINDLESS_SET, binding = 0) readonly buffer BindlessMaterials
+{
+    MaterialHandles materials[];
+} bindlessMaterials[];
+
+layout(set = BINDLESS_SET, binding = 2) uniform sampler2D bindlessTextures[];
@@ -0,0 +1,40 @@
+// Shared by ConvergenceError.comp and ConvergenceReduce.comp, see ConvergenceBenchmark
+// The error kernel writes one partial sum per 16x16 workgroup, the reduce kernel adds them up in a single workgroup
+// so the result for the frame is one vec4: x = MSE, y = relMSE, z = FLIP-like error, w = pixel count
+//
+//    0 - image under test, shading result or denoised target
+//    1 - reference, History accumulated in fp32
+//    2 - partial sums, one per error workgroup
+//    3 - frame result, host visible
+
+#define CONVERGENCE_GROUP_SIZE 256
+
+layout(push_constant) uniform ConvergencePushConstants
+{
+    vec2 renderExtent;
+    int partialCount;
+} convergence;
+
+layout(std430, set = 0, binding = 2) buffer PartialSums
+{
+    vec4 partials[];
+};
+
+layout(std430, set = 0, binding = 3) buffer FrameResult
+{
+    vec4 result;
+};
+
+shared vec4 sharedSums[CONVERGENCE_GROUP_SIZE];
+
+// Tree reduction of sharedSums, the total ends up in sharedSums[0]
+void ReduceShared(uint index)
+{
+    barrier();
+    for (uint stride = CONVERGENCE_GROUP_SIZE / 2; stride > 0; stride >>= 1)
+    {
+        if (index < stride)
+            sharedSums[index] += sharedSums[index + stride];
+        barrier();
+    }
+}
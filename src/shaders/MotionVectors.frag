@@ -38,7 +38,8 @@ vec2 world_to_screen_space_uv(vec3 world_pos, mat4 projection, mat4 view)
 
 void main()
 {
-	vec3 current_world_pos = texture(g_buffer_world_positions, uv).xyz;
+	// Fetched by pixel, uv spans the render extent viewport rather than the whole target
+	vec3 current_world_pos = texelFetch(g_buffer_world_positions, ivec2(gl_FragCoord.xy), 0).xyz;
 
 	vec2 curr_uv = world_to_screen_space_uv(current_world_pos, current_camera_transform.projection, current_camera_transform.view);
 	vec2 prev_uv = world_to_screen_space_uv(current_world_pos, previous_camera_transform.projection, previous_camera_transform.view);
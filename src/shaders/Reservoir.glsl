@@ -0,0 +1,135 @@
+// Reservoir storage shared by the Candidates, Temporal, Spatial and Shading passes
+// Must match vk::PackedReservoir in Utils.hpp
+//
+// 12 bytes per reservoir in a std430 storage buffer, indexed y * width + x over the reservoir grid:
+//   lightIndex - full 32 bit index into the light buffer (RGBA16F was only exact up to 2048)
+//   W          - unbiased contribution weight, full float
+//   packedM    - bits 0-15 hold M, bits 16-17 the visibility of the selected light, bits 18-31 are reserved
+//
+// The visibility is the shadow ray result for the selected light from this pixel's surface, traced this frame.
+// Later passes in the frame reuse it instead of tracing again while the sample and surface are unchanged,
+// it is reset whenever a pass selects a different light for the pixel
+//
+// Declare the buffer in the shader as
+//   layout(std430, set = 0, binding = N) buffer Name { PackedReservoir reservoirs[]; } name;
+// and go through LoadReservoir / StoreReservoir so every pass agrees on the layout
+//
+// The grid is the viewport at full resolution, or a reduced grid where each cell holds the reservoir of one pixel
+// (see vk::ReSTIRResolution). Passes dispatch one invocation per cell, define RESOLUTION_MODE and RESOLUTION_FRAME
+// from their uniforms and use CellPixel / PixelCell to move between cells and the pixels of the G-buffer
+
+struct PackedReservoir
+{
+    int lightIndex;
+    float W;
+    uint packedM;
+};
+
+struct StoredReservoir
+{
+    int index;
+    float W;
+    int M;
+};
+
+const uint RESERVOIR_M_MASK = 0xFFFFu;
+const uint RESERVOIR_VISIBILITY_KNOWN = 1u << 16;
+const uint RESERVOIR_VISIBLE = 1u << 17;
+
+const int VISIBILITY_UNKNOWN = -1;
+const int VISIBILITY_OCCLUDED = 0;
+const int VISIBILITY_VISIBLE = 1;
+
+uint ReservoirAddress(ivec2 pixel, vec2 viewportSize)
+{
+    return uint(pixel.y) * uint(viewportSize.x) + uint(pixel.x);
+}
+
+// Must match vk::ReSTIRResolution and vk::GetReservoirExtent in Utils.hpp
+const int RESOLUTION_FULL = 0;
+const int RESOLUTION_HALF = 1;
+const int RESOLUTION_CHECKERBOARD = 2;
+
+ivec2 ReservoirGridSize(int mode, vec2 viewportSize)
+{
+    ivec2 size = ivec2(viewportSize);
+    if(mode == RESOLUTION_HALF)
+        return size / 2;
+    if(mode == RESOLUTION_CHECKERBOARD)
+        return ivec2(size.x / 2, size.y);
+    return size;
+}
+
+// Pixel the reservoir in a cell is sampled for this frame. Half resolution walks the 2x2 block over four frames,
+// the checkerboard flips between the two pixels of the pair so every pixel is covered every other frame
+ivec2 ReservoirPixel(ivec2 cell, int mode, int frameIndex)
+{
+    const ivec2 blockOffsets[4] = ivec2[](ivec2(0, 0), ivec2(1, 1), ivec2(1, 0), ivec2(0, 1));
+
+    if(mode == RESOLUTION_HALF)
+        return cell * 2 + blockOffsets[frameIndex & 3];
+    if(mode == RESOLUTION_CHECKERBOARD)
+        return ivec2(cell.x * 2 + ((cell.y + frameIndex) & 1), cell.y);
+    return cell;
+}
+
+// Cell covering a pixel, clamped to the grid since an odd viewport has a last row or column without a cell
+ivec2 ReservoirCell(ivec2 pixel, int mode, ivec2 gridSize)
+{
+    ivec2 cell = pixel;
+    if(mode == RESOLUTION_HALF)
+        cell = pixel / 2;
+    else if(mode == RESOLUTION_CHECKERBOARD)
+        cell = ivec2(pixel.x / 2, pixel.y);
+    return clamp(cell, ivec2(0), gridSize - ivec2(1));
+}
+
+#define ReservoirGrid() vec2(ReservoirGridSize(RESOLUTION_MODE, ubo.viewportSize))
+#define CellPixel(cell) ReservoirPixel(cell, RESOLUTION_MODE, RESOLUTION_FRAME)
+#define PixelCell(pixel) ReservoirCell(pixel, RESOLUTION_MODE, ReservoirGridSize(RESOLUTION_MODE, ubo.viewportSize))
+
+// Dispatches round the grid up to whole 8x8 workgroups, the invocations past its last row or column have no cell
+#define OutsideGrid(cell) any(greaterThanEqual(cell, ReservoirGridSize(RESOLUTION_MODE, ubo.viewportSize)))
+
+PackedReservoir PackReservoir(int index, float W, int M, int visibility)
+{
+    PackedReservoir encoded;
+    encoded.lightIndex = index;
+    encoded.W = W;
+    encoded.packedM = min(uint(max(M, 0)), RESERVOIR_M_MASK); // temporal M is clamped to 20x the candidate count so this never saturates in practice
+    if(visibility != VISIBILITY_UNKNOWN)
+        encoded.packedM |= RESERVOIR_VISIBILITY_KNOWN | (visibility == VISIBILITY_VISIBLE ? RESERVOIR_VISIBLE : 0u);
+    return encoded;
+}
+
+PackedReservoir PackReservoir(int index, float W, int M)
+{
+    return PackReservoir(index, W, M, VISIBILITY_UNKNOWN);
+}
+
+int UnpackVisibility(uint packedM)
+{
+    if((packedM & RESERVOIR_VISIBILITY_KNOWN) == 0u)
+        return VISIBILITY_UNKNOWN;
+    return (packedM & RESERVOIR_VISIBLE) != 0u ? VISIBILITY_VISIBLE : VISIBILITY_OCCLUDED;
+}
+
+// Unknown visibility is treated as visible, the same assumption the biased path makes for every sample
+float VisibilityFactor(int visibility)
+{
+    return visibility == VISIBILITY_OCCLUDED ? 0.0 : 1.0;
+}
+
+StoredReservoir UnpackReservoir(PackedReservoir encoded)
+{
+    StoredReservoir reservoir;
+    reservoir.index = encoded.lightIndex;
+    reservoir.W = encoded.W;
+    reservoir.M = int(encoded.packedM & RESERVOIR_M_MASK);
+    return reservoir;
+}
+
+#define LoadReservoir(block, pixel, viewportSize) UnpackReservoir(block.reservoirs[ReservoirAddress(pixel, viewportSize)])
+#define StoreReservoir(block, pixel, viewportSize, index, W, M) block.reservoirs[ReservoirAddress(pixel, viewportSize)] = PackReservoir(index, W, M)
+#define LoadReservoirVisibility(block, pixel, viewportSize) UnpackVisibility(block.reservoirs[ReservoirAddress(pixel, viewportSize)].packedM)
+#define StoreReservoirWithVisibility(block, pixel, viewportSize, index, W, M, visibility) block.reservoirs[ReservoirAddress(pixel, viewportSize)] = PackReservoir(index, W, M, visibility)
@@ -0,0 +1,65 @@
+// Shared by the SVGF denoiser kernels (SVGFTemporal, SVGFVariance and SVGFAtrous.comp), see Denoiser
+// Illumination is divided by the surface albedo before it is accumulated and filtered so texture detail is not
+// blurred away, the last wavelet pass multiplies it back in. Include after Surface.glsl
+//
+// Descriptor set shared by the three kernels, each declares the bindings it uses:
+//    0 - shading result, rgba32f          7 - colour history written this frame
+//    1 - motion vectors                   8 - moments written this frame
+//    2 - packed G-buffer surface          9 - integrated illumination, rgb + temporal variance
+//    3 - previous depth and normal       10 - wavelet input, rgb + variance
+//    4 - previous colour history         11 - wavelet output
+//    5 - previous moments                12 - denoised target
+//    6 - depth and normal written this frame
+
+layout(push_constant) uniform DenoiserPushConstants
+{
+    vec2 renderExtent;
+    int stepSize;
+    int writeHistory;
+    int finalIteration;
+    int resetHistory;
+    float colourAlpha;
+    float momentsAlpha;
+    float phiColour;
+    float phiNormal;
+    float phiDepth;
+} svgf;
+
+float Luminance(vec3 c)
+{
+    return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// Black albedo would divide by zero, the floor keeps those pixels filtered as they are
+vec3 Demodulation(vec3 albedo)
+{
+    return max(albedo, vec3(0.01));
+}
+
+bool InsideRender(ivec2 pixel)
+{
+    return all(greaterThanEqual(pixel, ivec2(0))) && all(lessThan(pixel, ivec2(svgf.renderExtent)));
+}
+
+// Depth and normal of a pixel kept for the next frame's reprojection in one r32ui texel:
+// half float linear depth in the low 16 bits, octahedral normal as snorm 8:8 in the high 16 bits
+uint PackDepthNormal(float depth, vec3 normal)
+{
+    return (packHalf2x16(vec2(depth, 0.0)) & 0xFFFFu) | (packSnorm4x8(vec4(OctEncode(normal), 0.0, 0.0)) << 16);
+}
+
+void UnpackDepthNormal(uint packed, out float depth, out vec3 normal)
+{
+    depth = unpackHalf2x16(packed).x;
+    normal = OctDecode(unpackSnorm4x8(packed >> 16).xy);
+}
+
+// Wavelet weight of a tap against the pixel being filtered. Depth is compared relative to the centre and the tolerance
+// grows with the distance to the tap, luminance is compared in standard deviations of the filtered variance
+float WaveletWeight(float centerDepth, vec3 centerNormal, float centerLuminance, float depth, vec3 normal, float luminance, float stepDistance, float luminanceSigma)
+{
+    float depthTerm = abs(centerDepth - depth) / (svgf.phiDepth * 0.02 * centerDepth * stepDistance + 1e-4);
+    float luminanceTerm = abs(centerLuminance - luminance) / (svgf.phiColour * luminanceSigma + 1e-6);
+    float normalWeight = pow(max(dot(centerNormal, normal), 0.0), svgf.phiNormal);
+    return exp(-depthTerm - luminanceTerm) * normalWeight;
+}
@@ -0,0 +1,105 @@
+// Seeds and low discrepancy sequences shared by the ReSTIR kernels, see vk::Sampling
+//
+// Every pass seeds its white noise stream from the cell, the frame and its own salt, so no cell starts at seed 0
+// on the first frame and the passes (and the two halves of the fused kernel) draw uncorrelated numbers.
+// With low discrepancy sampling (SPEC_SAMPLING in Specialization.glsl) the candidate light picks use a per cell
+// Owen scrambled Sobol sequence and the spatial neighbours come from a Poisson disk table rotated by blue noise.
+// Both tables are generated on the host and bound at binding 13 by the passes that use them
+
+const uint SAMPLING_PASS_CANDIDATES = 0x68bc21ebu;
+const uint SAMPLING_PASS_TEMPORAL = 0x02e5be93u;
+const uint SAMPLING_PASS_SPATIAL = 0x967a889bu;
+
+// Must match vk::Sampling::POISSON_DISK_COUNT
+const uint SAMPLING_POISSON_COUNT = 32u;
+
+// Kernels that only need the seeds define SAMPLING_SEEDS_ONLY and leave binding 13 out of their layout
+#ifndef SAMPLING_SEEDS_ONLY
+layout(std430, set = 0, binding = 13) readonly buffer SamplingBuffer {
+    uint blueNoiseSize;     // power of two, the tile repeats across the screen
+    uint pad0;
+    uint pad1;
+    uint pad2;
+    vec2 poissonDisk[SAMPLING_POISSON_COUNT]; // unit disk, every prefix is well spread
+    uint blueNoise[];       // two 16 bit unorm channels per texel
+} sampling;
+#endif
+
+// Reference: https://www.jcgt.org/published/0009/03/02/
+uint PCGHash(uint v)
+{
+    uint state = v * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+uint PassSeed(uvec2 cell, uint frameIndex, uint passSalt)
+{
+    return PCGHash(PCGHash(PCGHash(cell.x ^ passSalt) + cell.y) ^ (frameIndex * 0x9e3779b9u));
+}
+
+// Reference: Burley, Practical Hash-based Owen Scrambling, JCGT 2020
+uint LaineKarrasPermutation(uint x, uint seed)
+{
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+uint NestedUniformScramble(uint x, uint seed)
+{
+    return bitfieldReverse(LaineKarrasPermutation(bitfieldReverse(x), seed));
+}
+
+// Second Sobol dimension, its direction numbers follow v ^= v >> 1
+uint SobolSecondDimension(uint index)
+{
+    uint result = 0u;
+    uint v = 1u << 31u;
+    while(index != 0u) {
+        if((index & 1u) != 0u)
+            result ^= v;
+        v ^= v >> 1u;
+        index >>= 1u;
+    }
+    return result;
+}
+
+// Point index of a shuffled, Owen scrambled 2D Sobol sequence in [0, 1)^2
+vec2 SobolOwen(uint index, uint seed)
+{
+    index = NestedUniformScramble(index, seed);
+    uint x = NestedUniformScramble(bitfieldReverse(index), PCGHash(seed ^ 0x5bd1e995u));
+    uint y = NestedUniformScramble(SobolSecondDimension(index), PCGHash(seed ^ 0x1b873593u));
+    return vec2(x >> 8u, y >> 8u) * (1.0 / 16777216.0);
+}
+
+#ifndef SAMPLING_SEEDS_ONLY
+
+// Blue noise tile offset every frame by the R2 sequence, stays blue in space and covers [0, 1)^2 evenly over time
+vec2 BlueNoise(ivec2 pixel, uint frameIndex)
+{
+    uint mask = sampling.blueNoiseSize - 1u;
+    uint texel = (uint(pixel.y) & mask) * sampling.blueNoiseSize + (uint(pixel.x) & mask);
+    vec2 noise = unpackUnorm2x16(sampling.blueNoise[texel]);
+
+    // Reference: https://extremelearning.com.au/unreasonable-effectiveness-of-quasirandom-sequences/
+    const vec2 R2 = vec2(0.7548776662466927, 0.5698402909980532);
+    return fract(noise + R2 * float(frameIndex % 65536u));
+}
+
+// Offset in pixels of neighbour tap of tapCount this frame. Each frame takes the next consecutive taps of the
+// table and every pixel rotates them by its blue noise angle, so nearby pixels gather from different directions
+vec2 PoissonNeighbour(uint tap, uint tapCount, ivec2 pixel, uint frameIndex, float radius)
+{
+    vec2 p = sampling.poissonDisk[(frameIndex * tapCount + tap) % SAMPLING_POISSON_COUNT];
+
+    float angle = BlueNoise(pixel, frameIndex).x * 6.28318530718;
+    float c = cos(angle);
+    float s = sin(angle);
+    return vec2(c * p.x - s * p.y, s * p.x + c * p.y) * radius;
+}
+#endif
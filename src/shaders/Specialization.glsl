@@ -0,0 +1,22 @@
+// Specialisation constants of the ReSTIR kernels, ids must match vk::ReSTIRConstant in Utils.hpp
+//
+// The defaults give the generic kernels, which read their settings from the pass uniforms at runtime.
+// The passes build permutations with the settings baked in through vk::PipelinePermutations, the driver then
+// folds the constants so the candidate and neighbour loops get fixed trip counts and the unbiased branch disappears
+
+// Candidates drawn per reservoir, 0 reads cand_ubo.M or the adaptive count at runtime
+layout(constant_id = 0) const int SPEC_CANDIDATE_COUNT = 0;
+
+// Unbiased reuse, -1 reads enableUnbiased from the pass uniforms, 0 and 1 fix the branch
+layout(constant_id = 1) const int SPEC_UNBIASED = -1;
+
+// Temporal history M is clamped to this multiple of the current reservoir's M
+layout(constant_id = 2) const int SPEC_TEMPORAL_M_CLAMP = 20;
+
+// Neighbours merged per pixel by the spatial kernels, paper suggests 3 for the unbiased algorithm
+layout(constant_id = 3) const int SPEC_SPATIAL_NEIGHBOURS = 4;
+
+// 0 draws candidates and neighbours from white noise, 1 uses the low discrepancy sequences of Sampling.glsl
+layout(constant_id = 4) const int SPEC_SAMPLING = 1;
+
+#define LOW_DISCREPANCY_SAMPLING (SPEC_SAMPLING != 0)
@@ -0,0 +1,99 @@
+// Optional counters for the ReSTIR passes, read back by vk::GPUStats
+// Must match vk::GPUStats::Counters in GPUStats.hpp
+//
+// Every pass binds the buffer at binding 11. Each counter is summed across the subgroup first and written
+// with one atomic from a single invocation, so enabled counters cost a few subgroup operations per pixel.
+// enabled is written by the host each frame, when it is 0 every function returns before touching the counters
+
+#extension GL_KHR_shader_subgroup_basic : enable
+#extension GL_KHR_shader_subgroup_arithmetic : enable
+
+const uint STATS_CANDIDATES = 0u;
+const uint STATS_TEMPORAL = 1u;
+const uint STATS_SPATIAL = 2u;
+const uint STATS_SHADING = 3u;
+const uint STATS_PASS_COUNT = 4u;
+
+// Histogram of the candidates drawn per reservoir, bin i counts M in [i * width + 1, (i + 1) * width]
+const uint STATS_M_BINS = 16u;
+const uint STATS_M_BIN_WIDTH = 8u;
+
+struct PassStats
+{
+    uint shadowRays;
+    uint invalidReservoirs;
+    uint historyRejections;
+    uint reservoirs;
+    uint mSumLow;   // 64 bit sum of M over valid reservoirs, carried by hand
+    uint mSumHigh;
+    uint mMax;
+    uint pad;
+};
+
+layout(std430, set = 0, binding = 11) buffer RenderStatsBuffer {
+    uint enabled;
+    uint frameIndex;
+    uint pad0;
+    uint pad1;
+    PassStats passes[STATS_PASS_COUNT];
+    uint candidateHistogram[STATS_M_BINS];
+} render_stats;
+
+void CountShadowRays(uint pass, int rays)
+{
+    if(render_stats.enabled == 0u)
+        return;
+
+    uint total = subgroupAdd(uint(rays));
+    if(subgroupElect() && total > 0u)
+        atomicAdd(render_stats.passes[pass].shadowRays, total);
+}
+
+void CountHistoryRejections(uint pass, bool rejected)
+{
+    if(render_stats.enabled == 0u)
+        return;
+
+    uint total = subgroupAdd(rejected ? 1u : 0u);
+    if(subgroupElect() && total > 0u)
+        atomicAdd(render_stats.passes[pass].historyRejections, total);
+}
+
+// Call once per pixel with the reservoir the pass writes
+void CountReservoir(uint pass, int index, int M)
+{
+    if(render_stats.enabled == 0u)
+        return;
+
+    bool valid = index >= 0;
+    uint invalid = subgroupAdd(valid ? 0u : 1u);
+    uint reservoirs = subgroupAdd(valid ? 1u : 0u);
+    uint mSum = subgroupAdd(valid ? uint(max(M, 0)) : 0u);
+    uint mMax = subgroupMax(valid ? uint(max(M, 0)) : 0u);
+
+    if(subgroupElect())
+    {
+        atomicAdd(render_stats.passes[pass].invalidReservoirs, invalid);
+        atomicAdd(render_stats.passes[pass].reservoirs, reservoirs);
+        atomicMax(render_stats.passes[pass].mMax, mMax);
+
+        uint previous = atomicAdd(render_stats.passes[pass].mSumLow, mSum);
+        if(previous + mSum < previous)
+            atomicAdd(render_stats.passes[pass].mSumHigh, 1u);
+    }
+}
+
+// Call once per reservoir with the candidate count it drew, one subgroup sum per bin
+void CountCandidates(int M)
+{
+    if(render_stats.enabled == 0u)
+        return;
+
+    uint bin = min(uint(max(M - 1, 0)) / STATS_M_BIN_WIDTH, STATS_M_BINS - 1u);
+    for(uint i = 0u; i < STATS_M_BINS; i++)
+    {
+        uint total = subgroupAdd(bin == i ? 1u : 0u);
+        if(subgroupElect() && total > 0u)
+            atomicAdd(render_stats.candidateHistogram[i], total);
+    }
+}
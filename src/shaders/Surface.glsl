@@ -0,0 +1,125 @@
+// Packed surface written by gbuffer.frag and read by the Candidates, Temporal, Spatial and Shading passes
+// 16 bytes per pixel in an RGBA32UI attachment (GBufferMRT.Surface):
+//   x - linear view depth as float bits, 0 where nothing was drawn
+//   y - octahedral normal, snorm 16:16
+//   z - albedo, sRGB encoded rgba8 (a unused)
+//   w - metallic and roughness, unorm 16:16
+// World position is reconstructed from the depth and the camera inverse view-projection. It replaces separate
+// attachments of 26 bytes per pixel (RGBA32F position, A2R10G10B10 normal, RGBA8 albedo, RG8 metallic/roughness)
+//
+// Declare the attachment in the shader as
+//   layout(set = 0, binding = N) uniform usampler2D g_surface;
+// next to a SceneUniform named ubo with inverseViewProjection, and go through LoadSurface
+
+struct Surface
+{
+    vec3 position;
+    float depth;    // linear view depth
+    vec3 normal;
+    vec3 albedo;
+    float metallic;
+    float roughness;
+    bool valid;
+};
+
+vec2 OctWrap(vec2 v)
+{
+    return (1.0 - abs(v.yx)) * mix(vec2(-1.0), vec2(1.0), greaterThanEqual(v, vec2(0.0)));
+}
+
+vec2 OctEncode(vec3 n)
+{
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+    return n.z >= 0.0 ? n.xy : OctWrap(n.xy);
+}
+
+vec3 OctDecode(vec2 e)
+{
+    vec3 n = vec3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+
+uint EncodeNormal(vec3 n)
+{
+    return packSnorm2x16(OctEncode(n));
+}
+
+vec3 DecodeNormal(uint encoded)
+{
+    return OctDecode(unpackSnorm2x16(encoded));
+}
+
+// Albedo keeps the sRGB curve so 8 bits are spent the same way as an R8G8B8A8_SRGB texture
+vec3 LinearToSRGB(vec3 c)
+{
+    return mix(c * 12.92, 1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055, greaterThan(c, vec3(0.0031308)));
+}
+
+vec3 SRGBToLinear(vec3 c)
+{
+    return mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)), greaterThan(c, vec3(0.04045)));
+}
+
+uvec4 PackSurface(float linearDepth, vec3 normal, vec3 albedo, float metallic, float roughness)
+{
+    return uvec4(
+        floatBitsToUint(linearDepth),
+        EncodeNormal(normalize(normal)),
+        packUnorm4x8(vec4(LinearToSRGB(clamp(albedo, 0.0, 1.0)), 0.0)),
+        packUnorm2x16(vec2(metallic, roughness))
+    );
+}
+
+// The far plane point under the pixel is camera + ray * far, so scaling the ray by depth / far gives the surface
+vec3 ReconstructPosition(ivec2 pixel, float linearDepth, mat4 inverseViewProjection, vec3 cameraPosition, vec2 viewportSize, float farPlane)
+{
+    vec2 ndc = ((vec2(pixel) + 0.5) / viewportSize) * 2.0 - 1.0;
+    vec4 farPoint = inverseViewProjection * vec4(ndc, 1.0, 1.0);
+    farPoint.xyz /= farPoint.w;
+    return cameraPosition + (farPoint.xyz - cameraPosition) * (linearDepth / farPlane);
+}
+
+Surface DecodeSurface(uvec4 encoded, ivec2 pixel, mat4 inverseViewProjection, vec3 cameraPosition, vec2 viewportSize, float farPlane)
+{
+    Surface surface;
+    float linearDepth = uintBitsToFloat(encoded.x);
+    surface.valid = linearDepth > 0.0;
+    surface.depth = linearDepth;
+
+    // Background pixels decode to what the cleared G-buffer attachments used to hold
+    if(!surface.valid)
+    {
+        surface.position = vec3(0.0);
+        surface.normal = normalize(vec3(-1.0));
+        surface.albedo = vec3(0.0);
+        surface.metallic = 0.0;
+        surface.roughness = 0.0;
+        return surface;
+    }
+
+    vec2 metallicRoughness = unpackUnorm2x16(encoded.w);
+    surface.position = ReconstructPosition(pixel, linearDepth, inverseViewProjection, cameraPosition, viewportSize, farPlane);
+    surface.normal = DecodeNormal(encoded.y);
+    surface.albedo = SRGBToLinear(unpackUnorm4x8(encoded.z).rgb);
+    surface.metallic = metallicRoughness.x;
+    surface.roughness = metallicRoughness.y;
+    return surface;
+}
+
+// Joint bilateral weight of a neighbouring surface against the one being reconstructed, used to upsample the
+// reduced ReSTIR grid. Depth is compared relative to the centre so the falloff is the same at any distance
+float EdgeStoppingWeight(Surface center, Surface neighbour)
+{
+    if(center.valid != neighbour.valid)
+        return 0.0;
+    if(!center.valid)
+        return 1.0;
+
+    float depthWeight = exp(-abs(center.depth - neighbour.depth) / (0.05 * center.depth));
+    float normalWeight = pow(max(dot(center.normal, neighbour.normal), 0.0), 32.0);
+    return depthWeight * normalWeight;
+}
+
+#define LoadSurface(pixel) DecodeSurface(texelFetch(g_surface, pixel, 0), pixel, ubo.inverseViewProjection, ubo.cameraPosition.xyz, ubo.viewportSize, ubo.farPlane)
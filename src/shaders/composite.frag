@@ -8,7 +8,8 @@ layout(set = 0, binding = 0) uniform sampler2D shading_result;
 
 void main()
 {
-	vec4 color = clamp(texture(shading_result, uv), 0.0, 1.0);
+	// Fetched by pixel, uv spans the render extent viewport rather than the whole target
+	vec4 color = clamp(texelFetch(shading_result, ivec2(gl_FragCoord.xy), 0), 0.0, 1.0);
 
 	vec3 ldrColor = color.rgb / (color.rgb + vec3(1.0));
 	vec3 gammaCorrectedColor = pow(ldrColor, vec3(1.0 / 2.2));
@@ -18,6 +18,8 @@ layout(push_constant) uniform Push
 	vec4 BaseColourFactor;
 	float Metallic;
 	float Roughness;
+	uint MaterialIndex;  // into the material buffer
+	uint MaterialBuffer; // bindless handle of the material buffer
 }pc;
 
 layout(location = 0) in vec4 pos;
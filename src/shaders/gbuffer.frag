@@ -1,13 +1,16 @@
 #version 450
 
+#extension GL_GOOGLE_include_directive : enable
+
+#include "Surface.glsl"
+#include "Bindless.glsl"
+
 layout(location = 0) in vec4 WorldPos;
 layout(location = 1) in vec2 uv;
 layout(location = 2) in vec4 WorldNormal;
 
-layout(location = 0) out vec4 g_albedo;
-layout(location = 1) out vec4 g_normal;
-layout(location = 2) out vec4 g_world_position;
-layout(location = 3) out vec2 g_metallicRoughness;
+layout(location = 0) out vec4 g_world_position; // read by the motion vectors pass
+layout(location = 1) out uvec4 g_surface; // depth, normal and material read by the ReSTIR compute passes
 
 layout(set = 0, binding = 0) uniform SceneUniform
 {
@@ -41,25 +44,29 @@ layout(push_constant) uniform Push
 	vec4 BaseColourFactor;
 	float Metallic;
 	float Roughness;
+	uint MaterialIndex;  // into the material buffer
+	uint MaterialBuffer; // bindless handle of the material buffer
 }pc;
 
 layout(set = 0, binding = 2) uniform sampler2DShadow shadowMap;
-layout(set = 1, binding = 0) uniform sampler2D albedoTexture;
-layout(set = 1, binding = 1) uniform sampler2D metallicRoughness;
 
 void main()
 {
-	vec4 color = texture(albedoTexture, uv) * pc.BaseColourFactor;
+	// Push constants are uniform across the draw, no nonuniformEXT needed
+	MaterialHandles material = bindlessMaterials[pc.MaterialBuffer].materials[pc.MaterialIndex];
+	vec4 metallicRoughness = texture(bindlessTextures[material.metallicRoughness], uv);
+
+	vec4 color = texture(bindlessTextures[material.albedo], uv) * pc.BaseColourFactor;
     vec3 world_normal = (WorldNormal).xyz;
-	float metallic = texture(metallicRoughness, uv).b * pc.Metallic;
-	float roughness = texture(metallicRoughness, uv).g * pc.Roughness;
+	float metallic = metallicRoughness.b * pc.Metallic;
+	float roughness = metallicRoughness.g * pc.Roughness;
 
 	if(color.a < 0.1) {
 		discard;
 	}
 
-	g_albedo = color;
-	g_normal = vec4(world_normal * 0.5 + 0.5, 0.0); // convert to 0-1 range for packing
 	g_world_position = WorldPos;
-	g_metallicRoughness = vec2(metallic, roughness); // r = metallic, g = roughness
+
+	float linear_depth = -(ubo.view * vec4(WorldPos.xyz, 1.0)).z;
+	g_surface = PackSurface(linear_depth, world_normal, color.rgb, metallic, roughness);
 }
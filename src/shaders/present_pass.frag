@@ -7,23 +7,33 @@ layout(location = 0) out vec4 fragColor;
 layout(set = 0, binding = 0) uniform PostProcessSettings
 {
 	bool Enable;
+	vec2 renderExtent;
 }ppSettings;
 
 layout(set = 0, binding = 1) uniform sampler2D composited_result; // this is the shading result with gamma correction
 layout(set = 0, binding = 2) uniform sampler2D accumulated_result; // this is temporal accumulated result to provide a ground truth
 
+// Upscales the dynamic resolution sub rectangle over the swapchain with the bilinear sampler
+// Clamped half a texel inside the rectangle so nothing bleeds in from the unrendered part of the target
+vec2 RenderUV(sampler2D target)
+{
+	vec2 size = vec2(textureSize(target, 0));
+	vec2 scaled = uv * ppSettings.renderExtent / size;
+	return clamp(scaled, vec2(0.5) / size, (ppSettings.renderExtent - vec2(0.5)) / size);
+}
+
 void main()
 {
 	// If enabled use the accumulated result
 	if(ppSettings.Enable)
 	{
-		vec3 scene = texture(accumulated_result, uv).rgb;
+		vec3 scene = texture(accumulated_result, RenderUV(accumulated_result)).rgb;
 		vec3 ldrColor = scene.rgb / (scene.rgb + vec3(1.0));
 		vec3 gammaCorrectedColor = pow(ldrColor, vec3(1.0 / 2.2));
 		fragColor = vec4(gammaCorrectedColor, 1.0);
 	} else
 	{
-		vec3 scene = texture(composited_result, uv).rgb;
+		vec3 scene = texture(composited_result, RenderUV(composited_result)).rgb;
 		vec3 ldrColor = scene.rgb / (scene.rgb + vec3(1.0));
 		vec3 gammaCorrectedColor = pow(ldrColor, vec3(1.0 / 2.2));
 		fragColor = vec4(gammaCorrectedColor, 1.0);